@@ -13,6 +13,10 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
+
+#include "../src/defs.h"
+#include "../src/net/protocol.h"
 
 #define MAX_MEM_BUFFER_SIZE 8192
 #define PORT_DEFAULT 8765
@@ -68,6 +72,190 @@ int init_tcp_sock(const char *server_host, int server_port) {
     return sockfd;
 }
 
+/**
+ * @brief 发送全部数据
+ */
+bool send_all(int sockfd, const std::string &data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t len = write(sockfd, data.data() + sent, data.size() - sent);
+        if (len <= 0) {
+            return false;
+        }
+        sent += len;
+    }
+    return true;
+}
+
+/**
+ * @brief 读取一条完整的服务端消息(不含长度字段)
+ */
+bool recv_message(int sockfd, std::string &recv_data, std::string *msg) {
+    char recv_buf[MAX_MEM_BUFFER_SIZE];
+    size_t frame_size;
+    while ((frame_size = protocol::complete_frame_size(recv_data)) == 0) {
+        int len = recv(sockfd, recv_buf, MAX_MEM_BUFFER_SIZE, 0);
+        if (len <= 0) {
+            return false;
+        }
+        recv_data.append(recv_buf, len);
+    }
+    msg->assign(recv_data, protocol::FRAME_HEADER_SIZE, frame_size - protocol::FRAME_HEADER_SIZE);
+    recv_data.erase(0, frame_size);
+    return true;
+}
+
+/**
+ * @brief 二进制协议握手
+ */
+bool binary_handshake(int sockfd) {
+    char magic[sizeof(protocol::PROTOCOL_MAGIC)];
+    if (!send_all(sockfd, std::string(protocol::PROTOCOL_MAGIC, sizeof(protocol::PROTOCOL_MAGIC)))) {
+        return false;
+    }
+    size_t got = 0;
+    while (got < sizeof(magic)) {
+        int len = recv(sockfd, magic + got, sizeof(magic) - got, 0);
+        if (len <= 0) {
+            return false;
+        }
+        got += len;
+    }
+    return memcmp(magic, protocol::PROTOCOL_MAGIC, sizeof(magic)) == 0;
+}
+
+/**
+ * @brief 把二进制协议的命令转换成消息:
+ *   prepare <sql>              预编译sql
+ *   execute <stmt_id> [v, ...] 执行预编译的语句, 参数可以是整数, 带小数点的浮点数或'字符串'
+ *   close <stmt_id>            释放预编译的语句
+ *   其他                        直接作为sql执行
+ */
+bool build_binary_request(const std::string &command, std::string *request) {
+    auto starts_with = [&](const char *prefix) { return strncasecmp(command.c_str(), prefix, strlen(prefix)) == 0; };
+    if (starts_with("prepare ")) {
+        *request = protocol::MessageBuilder(protocol::MSG_PREPARE).put_str(command.substr(8)).build();
+    } else if (starts_with("close ")) {
+        *request = protocol::MessageBuilder(protocol::MSG_CLOSE).put_u32(strtoul(command.c_str() + 6, nullptr, 10)).build();
+    } else if (starts_with("execute ")) {
+        const char *p = command.c_str() + 8;
+        char *end;
+        uint32_t stmt_id = strtoul(p, &end, 10);
+        p = end;
+        protocol::MessageBuilder params(protocol::MSG_EXECUTE);
+        uint16_t num_params = 0;
+        std::string body;
+        while (true) {
+            while (*p == ' ' || *p == ',') {
+                p++;
+            }
+            if (*p == '\0' || *p == ';') {
+                break;
+            }
+            protocol::MessageBuilder param(0);
+            if (*p == '\'') {
+                const char *close_quote = strchr(p + 1, '\'');
+                if (close_quote == nullptr) {
+                    return false;
+                }
+                param.put_u8(TYPE_STRING).put_str(std::string(p + 1, close_quote - p - 1));
+                p = close_quote + 1;
+            } else {
+                size_t len = strcspn(p, " ,;");
+                std::string token(p, len);
+                if (token.find('.') != std::string::npos) {
+                    param.put_u8(TYPE_FLOAT).put_f32(strtof(token.c_str(), nullptr));
+                } else {
+                    param.put_u8(TYPE_INT).put_i32(strtol(token.c_str(), nullptr, 10));
+                }
+                p += len;
+            }
+            // 去掉占位用的长度字段和消息类型
+            body += param.build().substr(protocol::FRAME_HEADER_SIZE + 1);
+            num_params++;
+        }
+        *request = params.put_u32(stmt_id).put_u16(num_params).put(body.data(), body.size()).build();
+    } else {
+        *request = protocol::MessageBuilder(protocol::MSG_QUERY).put_str(command).build();
+    }
+    return true;
+}
+
+/**
+ * @brief 读取并打印一个请求的所有响应消息, 直到READY
+ */
+bool print_binary_response(int sockfd, std::string &recv_data) {
+    std::vector<std::pair<ColType, uint32_t>> cols;
+    uint64_t num_rows = 0;  // 本次结果已经打印的记录数
+    std::string msg;
+    while (recv_message(sockfd, recv_data, &msg)) {
+        if (msg.empty()) {
+            return false;
+        }
+        protocol::MessageReader reader(msg.data() + 1, msg.size() - 1);
+        switch (msg[0]) {
+            case protocol::MSG_ROW_DESC: {
+                cols.clear();
+                uint16_t num_cols = reader.get_u16();
+                std::string header = "|";
+                for (uint16_t i = 0; i < num_cols; i++) {
+                    auto type = (ColType)reader.get_u8();
+                    uint32_t len = reader.get_u32();
+                    cols.emplace_back(type, len);
+                    header += " " + reader.get_str() + " |";
+                }
+                num_rows = 0;
+                printf("%s\n", header.c_str());
+                break;
+            }
+            case protocol::MSG_DATA_ROW: {
+                const char *data = msg.data() + 1;
+                std::string row = "|";
+                for (auto &col : cols) {
+                    if (col.first == TYPE_INT) {
+                        row += " " + std::to_string(*(const int *)data) + " |";
+                    } else if (col.first == TYPE_FLOAT) {
+                        row += " " + std::to_string(*(const float *)data) + " |";
+                    } else {
+                        row += " " + std::string(data, strnlen(data, col.second)) + " |";
+                    }
+                    data += col.second;
+                }
+                num_rows++;
+                printf("%s\n", row.c_str());
+                break;
+            }
+            case protocol::MSG_COMPLETE:
+                printf("Total record(s): %lu\n", (unsigned long)reader.get_u64());
+                break;
+            case protocol::MSG_PREPARED: {
+                uint32_t stmt_id = reader.get_u32();
+                printf("Prepared statement %u with %u parameter(s)\n", stmt_id, reader.get_u16());
+                break;
+            }
+            case protocol::MSG_TEXT:
+                printf("%s", reader.get_str().c_str());
+                break;
+            case protocol::MSG_ERROR:
+                printf("%s\n", reader.get_str().c_str());
+                break;
+            case protocol::MSG_ABORTED:
+                // 已经打印的记录无法收回, 提示用户它们不是完整的结果
+                printf("%s%s\nThe %lu record(s) above are an incomplete result and must be discarded\n",
+                       protocol::TEXT_RESULT_ABORTED, reader.get_str().c_str(), (unsigned long)num_rows);
+                break;
+            case protocol::MSG_READY:
+                fflush(stdout);
+                return true;
+            default:
+                fprintf(stderr, "Unknown message type %d\n", msg[0]);
+                return false;
+        }
+    }
+    printf("Connection has been closed\n");
+    return false;
+}
+
 int main(int argc, char *argv[]) {
     int ret = 0;  // set_terminal_noncanonical();
                   //    if (ret < 0) {
@@ -78,10 +266,14 @@ int main(int argc, char *argv[]) {
     const char *unix_socket_path = nullptr;
     const char *server_host = "127.0.0.1";  // 127.0.0.1 192.168.31.25
     int server_port = PORT_DEFAULT;
+    bool binary = false;  // 使用二进制协议
     int opt;
 
-    while ((opt = getopt(argc, argv, "s:h:p:")) > 0) {
+    while ((opt = getopt(argc, argv, "s:h:p:b")) > 0) {
         switch (opt) {
+            case 'b':
+                binary = true;
+                break;
             case 's':
                 unix_socket_path = optarg;
                 break;
@@ -110,8 +302,14 @@ int main(int argc, char *argv[]) {
     if (sockfd < 0) {
         return 1;
     }
+    if (binary && !binary_handshake(sockfd)) {
+        fprintf(stderr, "Binary protocol handshake failed\n");
+        close(sockfd);
+        return 1;
+    }
 
     char recv_buf[MAX_MEM_BUFFER_SIZE];
+    std::string recv_data;  // 二进制协议下已收到但还没有处理的数据
 
     while (1) {
         char *line_read = readline("Rucbase> ");
@@ -129,27 +327,48 @@ int main(int argc, char *argv[]) {
                 break;
             }
 
+            if (binary) {
+                std::string request;
+                if (!build_binary_request(command, &request)) {
+                    fprintf(stderr, "Invalid command\n");
+                    continue;
+                }
+                if (!send_all(sockfd, request)) {
+                    std::cerr << "send error: " << errno << ":" << strerror(errno) << " \n" << std::endl;
+                    exit(1);
+                }
+                if (!print_binary_response(sockfd, recv_data)) {
+                    break;
+                }
+                continue;
+            }
+
             if ((send_bytes = write(sockfd, command.c_str(), command.length() + 1)) == -1) {
                 // fprintf(stderr, "send error: %d:%s \n", errno, strerror(errno));
                 std::cerr << "send error: " << errno << ":" << strerror(errno) << " \n" << std::endl;
                 exit(1);
             }
-            int len = recv(sockfd, recv_buf, MAX_MEM_BUFFER_SIZE, 0);
-            if (len < 0) {
-                fprintf(stderr, "Connection was broken: %s\n", strerror(errno));
-                break;
-            } else if (len == 0) {
-                printf("Connection has been closed\n");
-                break;
-            } else {
-                for (int i = 0; i <= len; i++) {
-                    if (recv_buf[i] == '\0') {
-                        break;
-                    } else {
-                        printf("%c", recv_buf[i]);
-                    }
+            // 服务端分块发送结果, 以'\0'标志本次结果结束
+            bool finished = false;
+            while (!finished) {
+                int len = recv(sockfd, recv_buf, MAX_MEM_BUFFER_SIZE, 0);
+                if (len < 0) {
+                    fprintf(stderr, "Connection was broken: %s\n", strerror(errno));
+                    break;
+                } else if (len == 0) {
+                    printf("Connection has been closed\n");
+                    break;
+                }
+                char *end = (char *)memchr(recv_buf, '\0', len);
+                if (end != nullptr) {
+                    len = end - recv_buf;
+                    finished = true;
                 }
-                memset(recv_buf, 0, MAX_MEM_BUFFER_SIZE);
+                fwrite(recv_buf, 1, len, stdout);
+            }
+            fflush(stdout);
+            if (!finished) {
+                break;
             }
         }
     }
@@ -15,16 +15,29 @@
 #include <atomic>
 #include <chrono>  // NOLINT
 #include <cstdint>
+#include <string>
 
 /** Cycle detection is performed every CYCLE_DETECTION_INTERVAL milliseconds. */
 extern std::chrono::milliseconds cycle_detection_interval;
 
+/** A transaction waiting longer than LOCK_WAIT_TIMEOUT for a lock is aborted. */
+extern std::chrono::milliseconds lock_wait_timeout;
+
 /** True if logging should be enabled, false otherwise. */
 extern std::atomic<bool> enable_logging;
 
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
+/** Committing transactions wait up to GROUP_COMMIT_DELAY for more commits to share one log fsync. */
+extern std::chrono::microseconds group_commit_delay;
+
+/** If ENABLE_LOGGING is true, a fuzzy checkpoint is taken every CHECKPOINT_INTERVAL and the log before it is truncated. */
+extern std::chrono::seconds checkpoint_interval;
+
+/** If ENABLE_LOGGING is true, the log records of every flush are compressed before they are written to disk. */
+extern std::atomic<bool> log_compression;
+
 static constexpr int INVALID_FRAME_ID = -1;                                   // invalid frame id
 static constexpr int INVALID_PAGE_ID = -1;                                    // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
@@ -34,6 +47,23 @@ static constexpr int HEADER_PAGE_ID = 0;                                      //
 static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte
 static constexpr int BUFFER_POOL_SIZE = 65536;                                // size of buffer pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
+static constexpr size_t SORT_WORK_MEM = 16 * 1024 * 1024;                     // memory budget of a sort in byte
+static constexpr int RESULT_CHUNK_SIZE = 8192;                                // size of a result chunk sent to client
+static constexpr size_t MAX_CONNECTIONS = 1024;                               // max number of client connections
+static constexpr size_t MAX_REQUEST_SIZE = 1024 * 1024;                       // max size of a client request in byte
+static constexpr size_t MAX_BLOCKED_WORKERS = 64;                             // extra workers started while workers wait for locks
+static constexpr size_t PLAN_CACHE_SIZE = 1024;                               // max number of cached statement plans
+static constexpr size_t MAX_OPEN_FILES = 256;                                 // max number of open record files, and of open index files
+static constexpr size_t LOAD_BATCH_SIZE = 16 * 1024 * 1024;                   // bytes of csv parsed per LOAD DATA batch
+static constexpr size_t LOCK_TABLE_PARTITIONS = 64;                           // number of independently latched lock table partitions
+static constexpr size_t LOCK_ESCALATION_THRESHOLD = 5000;                     // row locks per table before escalating to a table lock
+static constexpr size_t TXN_TABLE_PARTITIONS = 16;                            // number of independently latched transaction table partitions
+static constexpr size_t TXN_POOL_SIZE = 64;                                   // finished transactions cached per partition for reuse
+static constexpr size_t STATS_SAMPLE_PAGES = 1024;                            // data pages read by ANALYZE, larger tables are sampled
+static constexpr size_t STATS_SAMPLE_VALUES = 30000;                          // values per column kept for building a histogram
+static constexpr size_t STATS_HISTOGRAM_BUCKETS = 64;                         // buckets of an equi-depth histogram
+static constexpr int64_t STATS_STALE_MIN_ROWS = 1000;                         // modified rows before a table is analyzed again
+static constexpr int64_t STATS_STALE_PERCENT = 20;                            // plus this percentage of the analyzed row count
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
 
 using frame_id_t = int32_t;  // frame id type, 帧页ID, 页在BufferPool中的存储单元称为帧,一帧对应一页
@@ -45,7 +75,10 @@ using oid_t = uint16_t;
 using timestamp_t = int32_t;  // timestamp type, used for transaction concurrency
 
 // log file
-static const std::string LOG_FILE_NAME = "db.log";
+static const std::string LOG_FILE_NAME = "db.log";                 // prefix of the log segment files
+static constexpr int64_t LOG_SEGMENT_SIZE = 16 * 1024 * 1024;      // size of a preallocated log segment file in byte
+static constexpr int64_t LOG_SEGMENT_HEADER_SIZE = 512;            // size of the header of a log segment in byte
+static constexpr size_t LOG_SEGMENT_SPARES = 4;                    // recycled log segments kept for reuse
 
 // replacer
 static const std::string REPLACER_TYPE = "LRU";
@@ -1,7 +1,11 @@
 #pragma once
 
 #include "transaction/concurrency/lock_manager.h"
+#include "transaction/concurrency/version_store.h"
 #include "recovery/log_manager.h"
+#include "common/result_writer.h"
+
+class RowSink;
 
 // used for data_send
 static int const_offset = -1;
@@ -11,11 +15,27 @@ public:
     Context (LockManager *lock_mgr, LogManager *log_mgr, 
             Transaction *txn, char *data_send = nullptr, int *offset = &const_offset)
         : lock_mgr_(lock_mgr), log_mgr_(log_mgr), txn_(txn),
-          data_send_(data_send), offset_(offset) {}
+          data_send_(data_send), offset_(offset) {
+        if (data_send != nullptr) {
+            owned_writer_ = std::make_unique<ResultWriter>(data_send, RESULT_CHUNK_SIZE, offset);
+            writer_ = owned_writer_.get();
+        }
+    }
+
+    // 结果以流的方式写入writer
+    Context (LockManager *lock_mgr, LogManager *log_mgr, Transaction *txn, ResultWriter *writer)
+        : lock_mgr_(lock_mgr), log_mgr_(log_mgr), txn_(txn),
+          data_send_(nullptr), offset_(&const_offset), writer_(writer) {}
 
     LockManager *lock_mgr_;
     LogManager *log_mgr_;
     Transaction *txn_;
     char *data_send_;
     int *offset_;
+    ResultWriter *writer_ = nullptr;  // 查询结果输出, 为nullptr时丢弃输出
+    RowSink *row_sink_ = nullptr;     // select结果的输出方式, 为nullptr时以文本表格输出
+    VersionStore *version_store_ = nullptr;  // 记录的旧版本, 为nullptr时不保存旧版本, 也不支持快照读
+
+   private:
+    std::unique_ptr<ResultWriter> owned_writer_;
 };
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief HyperLogLog, 用固定的2^precision个字节估计一组值中不同值的个数, 标准误差约为1.04/sqrt(2^precision)
+ */
+class HyperLogLog {
+   public:
+    explicit HyperLogLog(int precision = 12) : precision_(precision), registers_(size_t(1) << precision, 0) {}
+
+    void add(const char *data, size_t len) {
+        uint64_t hash = mix(std::hash<std::string_view>()(std::string_view(data, len)));
+        size_t idx = hash >> (64 - precision_);
+        // 剩下的位中第一个1的位置, 最低位作为哨兵保证不会全为0
+        uint64_t rest = (hash << precision_) | (uint64_t(1) << (precision_ - 1));
+        uint8_t rank = __builtin_clzll(rest) + 1;
+        if (rank > registers_[idx]) {
+            registers_[idx] = rank;
+        }
+    }
+
+    double estimate() const {
+        double m = registers_.size();
+        double sum = 0;
+        size_t zeros = 0;
+        for (uint8_t r : registers_) {
+            sum += std::ldexp(1.0, -r);
+            zeros += r == 0;
+        }
+        double alpha = 0.7213 / (1 + 1.079 / m);
+        double est = alpha * m * m / sum;
+        // 值较少时很多寄存器还是0, 改用线性计数
+        if (est <= 2.5 * m && zeros != 0) {
+            est = m * std::log(m / zeros);
+        }
+        return est;
+    }
+
+   private:
+    // std::hash的低位和高位分布不一定均匀, 再混合一次(splitmix64的终结步骤)
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    int precision_;
+    std::vector<uint8_t> registers_;
+};
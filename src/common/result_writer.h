@@ -0,0 +1,128 @@
+#pragma once
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+#include "errors.h"
+
+/**
+ * @brief 查询结果输出器
+ * @details 有三种工作方式:
+ * 1. 流式: 结果先写入固定大小(RESULT_CHUNK_SIZE)的缓冲区, 缓冲区写满即发送给客户端socket,
+ *    socket发送缓冲区满时阻塞等待, 内存占用与结果集大小无关
+ * 2. 定长缓冲区: 结果写入调用者提供的定长缓冲区(测试中使用), 超出部分截断, 保证末尾有'\0'
+ * 3. 字符串: 结果追加到调用者提供的字符串中, 由调用者决定如何发送
+ * 一次请求的全部结果写完后调用finish(), 向客户端发送'\0'作为本次结果的结束标志
+ */
+class ResultWriter {
+   public:
+    explicit ResultWriter(int fd, size_t chunk_size = RESULT_CHUNK_SIZE) : fd_(fd), chunk_(chunk_size) {}
+
+    ResultWriter(char *buf, size_t buf_len, int *offset) : buf_(buf), buf_len_(buf_len), offset_(offset) {}
+
+    explicit ResultWriter(std::string *str) : str_(str) {}
+
+    DISALLOW_COPY(ResultWriter);
+
+    void write(const char *data, size_t len) {
+        if (str_ != nullptr) {
+            str_->append(data, len);
+            return;
+        }
+        if (buf_ != nullptr) {
+            // 留一个字节给'\0'
+            size_t n = std::min(len, buf_len_ - 1 - std::min<size_t>(*offset_, buf_len_ - 1));
+            memcpy(buf_ + *offset_, data, n);
+            *offset_ += n;
+            return;
+        }
+        while (len > 0) {
+            size_t n = std::min(len, chunk_.size() - chunk_len_);
+            memcpy(chunk_.data() + chunk_len_, data, n);
+            chunk_len_ += n;
+            data += n;
+            len -= n;
+            if (chunk_len_ == chunk_.size()) {
+                flush();
+            }
+        }
+    }
+
+    void write(const std::string &str) { write(str.c_str(), str.length()); }
+
+    /**
+     * @brief 把缓冲区中的结果发送给客户端, 阻塞直到全部写入socket
+     */
+    void flush() {
+        if (buf_ != nullptr || str_ != nullptr || chunk_len_ == 0) {
+            return;
+        }
+        send_all(chunk_.data(), chunk_len_);
+        chunk_len_ = 0;
+    }
+
+    /**
+     * @brief 结束本次请求的结果: 写入'\0'结束符并发送
+     */
+    void finish() {
+        if (buf_ != nullptr || str_ != nullptr) {
+            return;
+        }
+        write("", 1);
+        flush();
+    }
+
+    /**
+     * @brief 丢弃还未发送的结果, 用于出错后改为返回错误信息; 已经发送的部分无法收回, 见bytes_sent()
+     */
+    void discard() {
+        if (buf_ != nullptr) {
+            memset(buf_, 0, *offset_);
+            *offset_ = 0;
+        }
+        if (str_ != nullptr) {
+            str_->clear();
+        }
+        chunk_len_ = 0;
+    }
+
+    /**
+     * @brief 已经写入socket的字节数, 调用者在请求开始和出错时各取一次, 判断客户端是否已经收到了部分结果
+     */
+    size_t bytes_sent() const { return bytes_sent_; }
+
+   private:
+    void send_all(const char *data, size_t len) {
+        while (len > 0) {
+            // MSG_NOSIGNAL: 客户端断开时返回EPIPE而不是触发SIGPIPE
+            ssize_t n = send(fd_, data, len, MSG_NOSIGNAL);
+            if (n == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw UnixError();
+            }
+            data += n;
+            len -= n;
+            bytes_sent_ += n;
+        }
+    }
+
+    int fd_ = -1;
+    std::vector<char> chunk_;
+    size_t chunk_len_ = 0;
+    size_t bytes_sent_ = 0;
+
+    char *buf_ = nullptr;
+    size_t buf_len_ = 0;
+    int *offset_ = nullptr;
+
+    std::string *str_ = nullptr;
+};
@@ -0,0 +1,101 @@
+#include "common/result_writer.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+// 从socket读取一次请求的结果, 直到遇到'\0'
+static std::string read_result(int fd) {
+    std::string res;
+    char buf[1024];
+    while (true) {
+        ssize_t len = read(fd, buf, sizeof(buf));
+        if (len <= 0) {
+            return res;
+        }
+        char *end = (char *)memchr(buf, '\0', len);
+        res.append(buf, end == nullptr ? len : end - buf);
+        if (end != nullptr) {
+            return res;
+        }
+    }
+}
+
+// 结果远大于一个块时按块流式发送, 接收端读到完整结果
+TEST(ResultWriterTest, StreamLargeResult) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    std::string expected;
+    for (int i = 0; i < 100000; i++) {
+        expected += "| row " + std::to_string(i) + " |\n";
+    }
+    std::string received;
+    std::thread reader([&] { received = read_result(fds[1]); });
+    {
+        ResultWriter writer(fds[0], 64);
+        for (int i = 0; i < 100000; i++) {
+            writer.write("| row " + std::to_string(i) + " |\n");
+        }
+        writer.finish();
+    }
+    reader.join();
+    EXPECT_EQ(received, expected);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// flush后数据立即可读, 不需要等到整个结果写完
+TEST(ResultWriterTest, FlushSendsImmediately) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    ResultWriter writer(fds[0]);
+    writer.write("first row\n");
+    writer.flush();
+    char buf[16] = {0};
+    ASSERT_EQ(read(fds[1], buf, sizeof(buf)), 10);
+    EXPECT_STREQ(buf, "first row\n");
+    writer.write("second row\n");
+    writer.finish();
+    EXPECT_EQ(read_result(fds[1]), "second row\n");
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// 出错时只能丢弃还未发送的部分, bytes_sent()说明客户端是否已经收到了部分结果
+TEST(ResultWriterTest, DiscardAfterPartialSend) {
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    ResultWriter writer(fds[0], 8);
+    size_t sent_before = writer.bytes_sent();
+    writer.write("abc");
+    writer.discard();
+    EXPECT_EQ(writer.bytes_sent(), sent_before);
+
+    writer.write("0123456789");
+    EXPECT_EQ(writer.bytes_sent(), sent_before + 8);
+    writer.discard();
+    writer.write("X");
+    writer.finish();
+    EXPECT_EQ(read_result(fds[1]), "01234567X");
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// 定长缓冲区模式下超出部分被截断, 末尾保留'\0'
+TEST(ResultWriterTest, FixedBuffer) {
+    char buf[16];
+    memset(buf, 0, sizeof(buf));
+    int offset = 0;
+    ResultWriter writer(buf, sizeof(buf), &offset);
+    writer.write("0123456789");
+    writer.write("0123456789");
+    EXPECT_EQ(offset, 15);
+    EXPECT_STREQ(buf, "012345678901234");
+    writer.discard();
+    EXPECT_EQ(offset, 0);
+    EXPECT_STREQ(buf, "");
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "common/config.h"
+#include "common/macros.h"
+
+/**
+ * @brief 固定大小的线程池, 任务按提交顺序由空闲的工作线程执行
+ * @details 任务中可能长时间阻塞的等待(如等待其他事务释放锁)放在BlockingScope中: 阻塞的工作线程不计入线程池的大小,
+ * 线程池临时增加工作线程, 保证排队的任务(如持有锁的事务的COMMIT)始终有线程执行; 阻塞结束后多出的线程空闲时退出.
+ * 临时增加的线程最多max_extra个, 线程总数不超过num_threads + max_extra; 达到上限后新的任务排队,
+ * 直到有阻塞的线程结束等待(锁等待最多持续lock_wait_timeout)
+ */
+class ThreadPool {
+   public:
+    /**
+     * @param num_threads 工作线程数, 为0时取CPU核数
+     * @param max_extra 工作线程阻塞时最多临时增加的线程数
+     */
+    explicit ThreadPool(size_t num_threads = 0, size_t max_extra = MAX_BLOCKED_WORKERS) : max_extra_(max_extra) {
+        if (num_threads == 0) {
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        size_ = num_threads;
+        std::lock_guard<std::mutex> lock(latch_);
+        for (size_t i = 0; i < num_threads; i++) {
+            spawn();
+        }
+    }
+
+    DISALLOW_COPY(ThreadPool);
+
+    ~ThreadPool() { shutdown(); }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(latch_);
+            tasks_.push(std::move(task));
+        }
+        cv_.notify_one();
+    }
+
+    /**
+     * @brief 执行完已提交的任务后停止所有工作线程
+     */
+    void shutdown() {
+        std::list<std::thread> exited;
+        {
+            std::unique_lock<std::mutex> lock(latch_);
+            if (stop_) {
+                return;
+            }
+            stop_ = true;
+            cv_.notify_all();
+            exit_cv_.wait(lock, [this] { return workers_.empty(); });
+            exited.swap(exited_);
+        }
+        for (auto &worker : exited) {
+            worker.join();
+        }
+    }
+
+    size_t size() const { return size_; }
+
+    /**
+     * @brief 在工作线程上标记一段可能长时间阻塞的等待, 不在线程池的工作线程上时什么也不做
+     */
+    class BlockingScope {
+       public:
+        BlockingScope() : pool_(current_) {
+            if (pool_ != nullptr) {
+                pool_->begin_blocking();
+            }
+        }
+
+        ~BlockingScope() {
+            if (pool_ != nullptr) {
+                pool_->end_blocking();
+            }
+        }
+
+        DISALLOW_COPY(BlockingScope);
+
+       private:
+        ThreadPool *pool_;
+    };
+
+   private:
+    // 创建一个工作线程, 调用者持有latch_
+    void spawn() {
+        workers_.emplace_back();
+        auto self = std::prev(workers_.end());
+        *self = std::thread([this, self] { work(self); });
+    }
+
+    // 不阻塞的工作线程多于线程池的大小
+    bool surplus() const { return workers_.size() - num_blocked_ > size_; }
+
+    void begin_blocking() {
+        std::list<std::thread> exited;
+        {
+            std::lock_guard<std::mutex> lock(latch_);
+            num_blocked_++;
+            if (workers_.size() - num_blocked_ < size_ && workers_.size() < size_ + max_extra_) {
+                spawn();
+            }
+            // 之前退出的线程在这里回收, 它们已经不再访问线程池
+            exited.swap(exited_);
+        }
+        for (auto &worker : exited) {
+            worker.join();
+        }
+    }
+
+    void end_blocking() {
+        {
+            std::lock_guard<std::mutex> lock(latch_);
+            num_blocked_--;
+        }
+        // 唤醒一个空闲线程, 线程数多于需要时由它退出
+        cv_.notify_one();
+    }
+
+    void work(std::list<std::thread>::iterator self) {
+        current_ = this;
+        std::unique_lock<std::mutex> lock(latch_);
+        while (true) {
+            cv_.wait(lock, [this] { return stop_ || !tasks_.empty() || surplus(); });
+            if (tasks_.empty()) {
+                exited_.splice(exited_.end(), workers_, self);
+                exit_cv_.notify_all();
+                return;
+            }
+            auto task = std::move(tasks_.front());
+            tasks_.pop();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+    static inline thread_local ThreadPool *current_ = nullptr;  // 当前线程所属的线程池
+
+    size_t size_;
+    size_t max_extra_;
+    std::list<std::thread> workers_;  // 正在运行的工作线程
+    std::list<std::thread> exited_;   // 已经退出, 还没有join的工作线程
+    size_t num_blocked_ = 0;          // 正在BlockingScope中阻塞的工作线程数
+    std::queue<std::function<void()>> tasks_;
+    std::mutex latch_;
+    std::condition_variable cv_;
+    std::condition_variable exit_cv_;  // 工作线程退出时通知shutdown
+    bool stop_ = false;
+};
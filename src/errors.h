@@ -122,11 +122,39 @@ class IncompatibleTypeError : public RedBaseError {
         : RedBaseError("Incompatible type error: lhs " + lhs + ", rhs " + rhs) {}
 };
 
+class CsvFormatError : public RedBaseError {
+   public:
+    CsvFormatError(const std::string &file_name, size_t line, const std::string &msg)
+        : RedBaseError("Invalid csv at " + file_name + ':' + std::to_string(line) + ": " + msg) {}
+};
+
 class AmbiguousColumnError : public RedBaseError {
    public:
     AmbiguousColumnError(const std::string &col_name) : RedBaseError("Ambiguous column: " + col_name) {}
 };
 
+class InvalidParamCountError : public RedBaseError {
+   public:
+    InvalidParamCountError(int expected, int actual)
+        : RedBaseError("Invalid parameter count: expected " + std::to_string(expected) + ", got " +
+                       std::to_string(actual)) {}
+};
+
+class StatementNotFoundError : public RedBaseError {
+   public:
+    StatementNotFoundError(uint32_t stmt_id) : RedBaseError("Prepared statement not found: " + std::to_string(stmt_id)) {}
+};
+
+class StatementNotPreparableError : public RedBaseError {
+   public:
+    StatementNotPreparableError() : RedBaseError("Only SELECT, INSERT, DELETE and UPDATE can be prepared") {}
+};
+
+class ProtocolError : public RedBaseError {
+   public:
+    ProtocolError(const std::string &msg) : RedBaseError("Protocol error: " + msg) {}
+};
+
 class PageNotExistError : public RedBaseError {
    public:
     PageNotExistError(const std::string &table_name, int page_no)
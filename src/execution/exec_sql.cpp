@@ -24,13 +24,13 @@ int offset;
 
 char *exec_sql(const std::string &sql) {
     std::cout << "rucbase> " + sql << std::endl;
-    YY_BUFFER_STATE yy_buffer = yy_scan_string(sql.c_str());
-    assert(yyparse() == 0 && ast::parse_tree != nullptr);
-    yy_delete_buffer(yy_buffer);
+    std::shared_ptr<ast::TreeNode> parse_tree;
+    bool parsed = ast::parse(sql, &parse_tree);
+    assert(parsed && parse_tree != nullptr);
     memset(result, 0, BUFFER_LENGTH);
     offset = 0;
     Context *context = new Context(nullptr, nullptr, new Transaction(0), result, &offset);
-    interp_->interp_sql(ast::parse_tree, context);  // 主要执行逻辑
+    interp_->interp_sql(parse_tree, context);  // 主要执行逻辑
     // std::cout << result << std::endl;
     return result;
 };
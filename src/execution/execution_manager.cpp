@@ -1,14 +1,20 @@
 #include "execution_manager.h"
 
+#include <cmath>
+#include <limits>
+
 #include "executor_delete.h"
 #include "executor_index_scan.h"
 #include "executor_insert.h"
+#include "executor_limit.h"
+#include "executor_load.h"
 #include "executor_nestedloop_join.h"
 #include "executor_projection.h"
 #include "executor_seq_scan.h"
+#include "executor_sort.h"
 #include "executor_update.h"
 #include "index/ix.h"
-#include "record_printer.h"
+#include "row_sink.h"
 
 TabCol QlManager::check_column(const std::vector<ColMeta> &all_cols, TabCol target) {
     if (target.tab_name.empty()) {
@@ -61,6 +67,10 @@ std::vector<Condition> QlManager::check_where_clause(const std::vector<std::stri
         auto lhs_col = lhs_tab.get_col(cond.lhs_col.col_name);
         ColType lhs_type = lhs_col->type;
         ColType rhs_type;
+        if (cond.is_rhs_val && cond.rhs_val.param_idx >= 0) {
+            // 参数的类型在执行时才能确定
+            continue;
+        }
         if (cond.is_rhs_val) {
             cond.rhs_val.init_raw(lhs_col->len);
             rhs_type = cond.rhs_val.type;
@@ -76,40 +86,144 @@ std::vector<Condition> QlManager::check_where_clause(const std::vector<std::stri
     return res_conds;
 }
 
-int QlManager::get_indexNo(std::string tab_name, std::vector<Condition> curr_conds) {
+namespace {
+
+// 没有统计信息或者条件右侧是参数时使用的默认选择率
+constexpr double DEFAULT_EQ_SELECTIVITY = 0.005;
+constexpr double DEFAULT_RANGE_SELECTIVITY = 1.0 / 3;
+// 按索引读一条记录的代价, 以顺序扫描读一条记录为1
+constexpr double INDEX_FETCH_COST = 4;
+// 选择率区间的个数, 选择率不超过2^-MAX_SELECTIVITY_BUCKET的都在最后一个区间
+constexpr int MAX_SELECTIVITY_BUCKET = 32;
+
+}  // namespace
+
+double QlManager::estimate_selectivity(TabMeta &tab, const TabStats *stats, const Condition &cond,
+                                       const std::vector<Value> *params) {
+    if (!cond.is_rhs_val) {
+        // 连接条件的值来自外表, 扫描这张表时才知道
+        return 1;
+    }
+    auto col = tab.get_col(cond.lhs_col.col_name);
+    const char *val = cond.rhs_val.param_idx < 0 && cond.rhs_val.raw != nullptr ? cond.rhs_val.raw->data : nullptr;
+    // 知道参数的值时按参数值估计, 类型不符或者过长的参数在执行时报错
+    Value param;
+    int param_idx = cond.rhs_val.param_idx;
+    if (param_idx >= 0 && params != nullptr && param_idx < (int)params->size() &&
+        (*params)[param_idx].type == col->type && (int)(*params)[param_idx].str_val.size() <= col->len) {
+        param = (*params)[param_idx];
+        param.raw = nullptr;
+        param.init_raw(col->len);
+        val = param.raw->data;
+    }
+    if (stats == nullptr || val == nullptr) {
+        double eq_sel = DEFAULT_EQ_SELECTIVITY;
+        if (stats != nullptr && stats->cols[col - tab.cols.begin()].num_distinct > 0) {
+            eq_sel = 1.0 / stats->cols[col - tab.cols.begin()].num_distinct;
+        }
+        return cond.op == OP_EQ ? eq_sel : cond.op == OP_NE ? 1 - eq_sel : DEFAULT_RANGE_SELECTIVITY;
+    }
+    auto &col_stats = stats->cols[col - tab.cols.begin()];
+    switch (cond.op) {
+        case OP_EQ:
+            return col_stats.eq_selectivity(val, col->type, col->len);
+        case OP_NE:
+            return 1 - col_stats.eq_selectivity(val, col->type, col->len);
+        case OP_LT:
+            return col_stats.lt_selectivity(val, col->type, col->len, false);
+        case OP_LE:
+            return col_stats.lt_selectivity(val, col->type, col->len, true);
+        case OP_GT:
+            return 1 - col_stats.lt_selectivity(val, col->type, col->len, true);
+        case OP_GE:
+            return 1 - col_stats.lt_selectivity(val, col->type, col->len, false);
+    }
+    return 1;
+}
+
+int QlManager::get_indexNo(std::string tab_name, std::vector<Condition> curr_conds, const std::vector<Value> *params) {
     int index_no = -1;
     TabMeta &tab = sm_manager_->db_.get_table(tab_name);
+    auto stats = tab.stats->get();
+    if (stats == nullptr) {
+        for (auto &cond : curr_conds) {
+            if (cond.is_rhs_val && cond.op != OP_NE) {
+                // If rhs is value and op is not "!=", find if lhs has index
+                auto lhs_col = tab.get_col(cond.lhs_col.col_name);
+                if (lhs_col->index) {
+                    // This column has index, use it
+                    index_no = lhs_col - tab.cols.begin();
+                    break;
+                }
+            }
+        }
+        return index_no;
+    }
+    // 有统计信息时选择估计读出的记录最少的索引, 代价超过顺序扫描时不使用索引.
+    // 条件右侧是不知道值的参数时不知道实际的选择率, 和没有统计信息时一样总是使用索引
+    std::vector<double> col_selectivity(tab.cols.size(), 1);
+    std::vector<bool> usable(tab.cols.size(), false);
+    bool has_param = false;
     for (auto &cond : curr_conds) {
         if (cond.is_rhs_val && cond.op != OP_NE) {
-            // If rhs is value and op is not "!=", find if lhs has index
-            auto lhs_col = tab.get_col(cond.lhs_col.col_name);
-            if (lhs_col->index) {
-                // This column has index, use it
-                index_no = lhs_col - tab.cols.begin();
-                break;
-            }
+            size_t col_idx = tab.get_col(cond.lhs_col.col_name) - tab.cols.begin();
+            usable[col_idx] = tab.cols[col_idx].index;
+            col_selectivity[col_idx] *= estimate_selectivity(tab, stats.get(), cond, params);
+            has_param |= usable[col_idx] && cond.rhs_val.param_idx >= 0 && params == nullptr;
+        }
+    }
+    double num_rows = tab.stats->estimate_rows();
+    double best_cost = has_param ? std::numeric_limits<double>::infinity() : num_rows;
+    for (size_t i = 0; i < tab.cols.size(); i++) {
+        double cost = col_selectivity[i] * num_rows * INDEX_FETCH_COST;
+        if (usable[i] && cost < best_cost) {
+            best_cost = cost;
+            index_no = i;
         }
     }
     return index_no;
 }
 
-void QlManager::insert_into(const std::string &tab_name, std::vector<Value> values, Context *context) {
-    // lab3 task3 Todo
-    // make InsertExecutor
-    // call InsertExecutor.Next()
-    context->lock_mgr_->LockIXOnTable(context->txn_,sm_manager_->fhs_[tab_name].get()->GetFd());
+void QlManager::insert_into(const std::string &tab_name, std::vector<std::vector<Value>> rows, Context *context) {
+    // 所有元组共用一次表锁和一个InsertExecutor
     TabMeta &tab = sm_manager_->db_.get_table(tab_name);
-    for(int i=0;i<values.size();i++){
-        values[i].init_raw(tab.cols[i].len);
+    context->lock_mgr_->LockIXOnTable(context->txn_,tab.id);
+    for (auto &values : rows) {
+        if (values.size() != tab.cols.size()) {
+            throw InvalidValueCountError();
+        }
+        for(int i=0;i<values.size();i++){
+            values[i].init_raw(tab.cols[i].len);
+        }
     }
-    std::unique_ptr<AbstractExecutor> insertExecutor(new InsertExecutor(sm_manager_,tab_name,values,context));
+    int64_t num_rows = rows.size();
+    std::unique_ptr<AbstractExecutor> insertExecutor(new InsertExecutor(sm_manager_,tab_name,std::move(rows),context));
     insertExecutor->Next().get();
-    // lab3 task3 Todo end
+    sm_manager_->record_modifications(tab_name, num_rows, 0, 0);
+}
+
+size_t QlManager::load_data(const std::string &file_name, const std::string &tab_name, Context *context) {
+    // 导入期间独占整张表, 不再对每条记录加锁
+    context->lock_mgr_->LockExclusiveOnTable(context->txn_, sm_manager_->db_.get_table(tab_name).id);
+    LoadExecutor loadExecutor(sm_manager_, file_name, tab_name, context);
+    loadExecutor.Next();
+    sm_manager_->record_modifications(tab_name, loadExecutor.num_loaded(), 0, 0);
+    return loadExecutor.num_loaded();
+}
+
+void QlManager::check_write_conflict(const std::string &tab_name, const Rid &rid, Context *context) {
+    if (context->version_store_ == nullptr || !context->txn_->IsSnapshotRead()) {
+        return;
+    }
+    if (context->version_store_->has_conflict(sm_manager_->db_.get_table(tab_name).id, rid, context->txn_)) {
+        throw TransactionAbortException(context->txn_->GetTransactionId(), AbortReason::WRITE_CONFLICT);
+    }
 }
 
 void QlManager::delete_from(const std::string &tab_name, std::vector<Condition> conds, Context *context) {
     // Parse where clause
-    context->lock_mgr_->LockIXOnTable(context->txn_,sm_manager_->fhs_[tab_name].get()->GetFd());
+    int tab_id = sm_manager_->db_.get_table(tab_name).id;
+    context->lock_mgr_->LockIXOnTable(context->txn_,tab_id);
     conds = check_where_clause({tab_name}, conds);
     // Get all RID to delete
     std::vector<Rid> rids;
@@ -118,7 +232,7 @@ void QlManager::delete_from(const std::string &tab_name, std::vector<Condition>
     // lab3 task3 Todo
     // 根据get_indexNo判断conds上有无索引
     // 创建合适的scan executor(有索引优先用索引)
-    int index_no = get_indexNo(tab_name,conds);
+    int index_no = get_indexNo(tab_name, conds, nullptr);
     if(index_no>=0){
         scanExecutor=std::make_unique<IndexScanExecutor>(sm_manager_,tab_name,conds,index_no,context);
     }
@@ -128,7 +242,8 @@ void QlManager::delete_from(const std::string &tab_name, std::vector<Condition>
     // lab3 task3 Todo end
 
     for (scanExecutor->beginTuple(); !scanExecutor->is_end(); scanExecutor->nextTuple()) {
-        context->lock_mgr_->LockExclusiveOnRecord(context->txn_,scanExecutor->rid(),sm_manager_->fhs_[tab_name].get()->GetFd());
+        context->lock_mgr_->LockExclusiveOnRecord(context->txn_,scanExecutor->rid(),tab_id);
+        check_write_conflict(tab_name, scanExecutor->rid(), context);
         rids.push_back(scanExecutor->rid());
     }
 
@@ -137,13 +252,14 @@ void QlManager::delete_from(const std::string &tab_name, std::vector<Condition>
     // call deleteExecutor.Next()
     auto deleteExecutor=new DeleteExecutor(sm_manager_,tab_name,conds,rids,context);
     deleteExecutor->Next().get();
+    sm_manager_->record_modifications(tab_name, 0, rids.size(), 0);
     // lab3 task3 Todo end
 }
 
 void QlManager::update_set(const std::string &tab_name, std::vector<SetClause> set_clauses,
                            std::vector<Condition> conds, Context *context) {
     TabMeta &tab = sm_manager_->db_.get_table(tab_name);
-    context->lock_mgr_->LockIXOnTable(context->txn_,sm_manager_->fhs_[tab_name].get()->GetFd());
+    context->lock_mgr_->LockIXOnTable(context->txn_,tab.id);
     // Parse where clause
     conds = check_where_clause({tab_name}, conds);
     // Get raw values in set clause
@@ -164,7 +280,7 @@ void QlManager::update_set(const std::string &tab_name, std::vector<SetClause> s
     // make updateExecutor
     // call updateExecutor.Next()
     std::unique_ptr<AbstractExecutor> scanExecutor;
-    int index_no = get_indexNo(tab_name,conds);
+    int index_no = get_indexNo(tab_name, conds, nullptr);
     if(index_no>=0){
         scanExecutor=std::make_unique<IndexScanExecutor>(sm_manager_,tab_name,conds,index_no,context);
     }
@@ -172,11 +288,13 @@ void QlManager::update_set(const std::string &tab_name, std::vector<SetClause> s
         scanExecutor=std::make_unique<SeqScanExecutor>(sm_manager_,tab_name,conds,context);
     }
     for (scanExecutor->beginTuple(); !scanExecutor->is_end(); scanExecutor->nextTuple()) {
-        context->lock_mgr_->LockExclusiveOnRecord(context->txn_,scanExecutor->rid(),sm_manager_->fhs_[tab_name].get()->GetFd());
+        context->lock_mgr_->LockExclusiveOnRecord(context->txn_,scanExecutor->rid(),tab.id);
+        check_write_conflict(tab_name, scanExecutor->rid(), context);
         rids.push_back(scanExecutor->rid());
     }
     auto updateExecutor=new UpdateExecutor(sm_manager_,tab_name,set_clauses,conds,rids,context);
     updateExecutor->Next();
+    sm_manager_->record_modifications(tab_name, 0, 0, rids.size());
     // lab3 task3 Todo end
 }
 
@@ -205,17 +323,37 @@ std::vector<Condition> pop_conds(std::vector<Condition> &conds, const std::vecto
 }
 
 /**
- * @brief select plan 生成
+ * @brief select plan 生成并执行
  *
  * @param sel_cols select plan 选取的列
  * @param tab_names select plan 目标的表
  * @param conds select plan 选取条件
+ * @param order_cols ORDER BY 排序列, 为空表示不排序
+ * @param limit LIMIT 输出的最大记录数, -1表示没有LIMIT
  */
 void QlManager::select_from(std::vector<TabCol> sel_cols, const std::vector<std::string> &tab_names,
-                            std::vector<Condition> conds, Context *context) {
+                            std::vector<Condition> conds, std::vector<OrderByCol> order_cols, int limit,
+                            Context *context) {
+    auto plan = plan_select(std::move(sel_cols), tab_names, std::move(conds), std::move(order_cols), limit);
+    execute_select(*plan, {}, context);
+}
+
+/**
+ * @brief select plan 生成: 校验列和条件, 把条件下推到各表并选择扫描方式
+ * @details 条件右侧可以是参数(param_idx >= 0), 参数值在execute_select时绑定
+ */
+std::shared_ptr<SelectPlan> QlManager::plan_select(std::vector<TabCol> sel_cols,
+                                                   const std::vector<std::string> &tab_names,
+                                                   std::vector<Condition> conds,
+                                                   std::vector<OrderByCol> order_cols, int limit,
+                                                   const std::vector<Value> *params) {
+    auto plan = std::make_shared<SelectPlan>();
+    plan->catalog_version = sm_manager_->get_catalog_version();
+    for (auto &tab_name : tab_names) {
+        auto &stats = sm_manager_->db_.get_table(tab_name).stats;
+        plan->stats_versions.emplace_back(stats, stats->version());
+    }
     // Parse selector
-    //for(auto tab_name:tab_names)
-        //context->lock_mgr_->LockISOnTable(context->txn_,sm_manager_->fhs_[tab_name].get()->GetFd());
     auto all_cols = get_all_cols(tab_names);
     if (sel_cols.empty()) {
         // select all columns
@@ -229,27 +367,155 @@ void QlManager::select_from(std::vector<TabCol> sel_cols, const std::vector<std:
             sel_col = check_column(all_cols, sel_col);  //列元数据校验
         }
     }
+    // Parse order by clause
+    for (auto &order_col : order_cols) {
+        order_col.col = check_column(all_cols, order_col.col);
+    }
     // Parse where clause
     conds = check_where_clause(tab_names, conds);
+    // 单表且只按一个有索引的列升序排序时, 直接按索引顺序扫描, 省去排序; 快照读在执行时仍然排序, 见execute_select
+    int order_index_no = -1;
+    if (tab_names.size() == 1 && order_cols.size() == 1 && !order_cols[0].is_desc &&
+        order_cols[0].col.tab_name == tab_names[0]) {
+        TabMeta &tab = sm_manager_->db_.get_table(tab_names[0]);
+        auto order_col = tab.get_col(order_cols[0].col.col_name);
+        if (order_col->index) {
+            order_index_no = order_col - tab.cols.begin();
+        }
+    }
+    plan->need_sort = !order_cols.empty();
+    auto scan_order = get_join_order(tab_names, conds, params);
+    // 每个表的扫描条件和扫描方式
+    for (size_t i = 0; i < scan_order.size(); i++) {
+        auto curr_conds = pop_conds(conds, {scan_order.begin(), scan_order.begin() + i + 1});
+        int index_no = get_indexNo(scan_order[i], curr_conds, params);
+        // 有LIMIT时按排序列的索引扫描可以提前结束, 否则只在没有更好的索引时使用它
+        if (order_index_no != -1 && (limit >= 0 || index_no == -1 || index_no == order_index_no)) {
+            index_no = order_index_no;
+            plan->need_sort = false;
+        }
+        for (size_t j = 0; j < curr_conds.size(); j++) {
+            auto &cond = curr_conds[j];
+            if (cond.is_rhs_val && cond.rhs_val.param_idx >= 0) {
+                auto lhs_col = sm_manager_->db_.get_table(cond.lhs_col.tab_name).get_col(cond.lhs_col.col_name);
+                plan->params.push_back({.tab_idx = i,
+                                        .cond_idx = j,
+                                        .param_idx = cond.rhs_val.param_idx,
+                                        .type = lhs_col->type,
+                                        .len = lhs_col->len});
+            }
+        }
+        plan->tab_conds.push_back(std::move(curr_conds));
+        plan->index_nos.push_back(index_no);
+    }
+    assert(conds.empty());
+    // Column titles
+    plan->captions.reserve(sel_cols.size());
+    for (auto &sel_col : sel_cols) {
+        plan->captions.push_back(sel_col.col_name);
+    }
+    plan->sel_cols = std::move(sel_cols);
+    plan->tab_names = std::move(scan_order);
+    plan->order_cols = std::move(order_cols);
+    plan->limit = limit;
+    if (params != nullptr) {
+        plan->param_buckets = get_param_buckets(*plan, *params);
+    }
+    return plan;
+}
+
+bool QlManager::plan_fits_params(const SelectPlan &plan, const std::vector<Value> &params) {
+    return plan.params.empty() || plan.param_buckets == get_param_buckets(plan, params);
+}
+
+std::vector<int> QlManager::get_param_buckets(const SelectPlan &plan, const std::vector<Value> &params) {
+    std::vector<int> buckets;
+    buckets.reserve(plan.params.size());
+    for (auto &slot : plan.params) {
+        TabMeta &tab = sm_manager_->db_.get_table(plan.tab_names[slot.tab_idx]);
+        auto stats = tab.stats->get();
+        double sel = estimate_selectivity(tab, stats.get(), plan.tab_conds[slot.tab_idx][slot.cond_idx], &params);
+        buckets.push_back(sel <= 0 ? MAX_SELECTIVITY_BUCKET
+                                   : std::min<int>(MAX_SELECTIVITY_BUCKET, std::floor(-std::log2(sel))));
+    }
+    return buckets;
+}
+
+/**
+ * @brief 连接的顺序, 第一个表是最外层的outer table
+ * @details 所有表都有统计信息时按估计的过滤后的行数从小到大排列, 内表被扫描的次数最少; 否则按FROM中的顺序
+ */
+std::vector<std::string> QlManager::get_join_order(const std::vector<std::string> &tab_names,
+                                                   const std::vector<Condition> &conds,
+                                                   const std::vector<Value> *params) {
+    if (tab_names.size() <= 1) {
+        return tab_names;
+    }
+    std::vector<std::pair<double, std::string>> tab_rows;
+    for (auto &tab_name : tab_names) {
+        TabMeta &tab = sm_manager_->db_.get_table(tab_name);
+        auto stats = tab.stats->get();
+        double num_rows = tab.stats->estimate_rows();
+        if (stats == nullptr) {
+            return tab_names;
+        }
+        for (auto &cond : conds) {
+            if (cond.is_rhs_val && cond.lhs_col.tab_name == tab_name) {
+                num_rows *= estimate_selectivity(tab, stats.get(), cond, params);
+            }
+        }
+        tab_rows.emplace_back(num_rows, tab_name);
+    }
+    std::stable_sort(tab_rows.begin(), tab_rows.end(),
+                     [](const auto &a, const auto &b) { return a.first < b.first; });
+    std::vector<std::string> order;
+    for (auto &entry : tab_rows) {
+        order.push_back(std::move(entry.second));
+    }
+    return order;
+}
+
+/**
+ * @brief 绑定参数, 构建算子树并执行select plan
+ * @param params 参数值, 按param_idx下标
+ */
+void QlManager::execute_select(const SelectPlan &plan, const std::vector<Value> &params, Context *context) {
+    // 绑定参数
+    std::vector<std::vector<Condition>> tab_conds = plan.tab_conds;
+    for (auto &slot : plan.params) {
+        const Value &param = params.at(slot.param_idx);
+        if (param.type != slot.type) {
+            throw IncompatibleTypeError(coltype2str(slot.type), coltype2str(param.type));
+        }
+        Value &rhs_val = tab_conds[slot.tab_idx][slot.cond_idx].rhs_val;
+        rhs_val = param;
+        rhs_val.raw = nullptr;
+        rhs_val.init_raw(slot.len);
+    }
+    // 不读快照的只读事务对每张表加一次表级读锁, 代替逐行加读锁
+    Transaction *txn = context->txn_;
+    bool snapshot_read = context->version_store_ != nullptr && txn->IsSnapshotRead();
+    if (txn->IsReadOnly() && !snapshot_read && txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED) {
+        for (auto &tab_name : plan.tab_names) {
+            context->lock_mgr_->LockSharedOnTable(txn, sm_manager_->db_.get_table(tab_name).id);
+        }
+    }
     // Scan table , 生成表算子列表tab_nodes
     std::vector<std::unique_ptr<AbstractExecutor>> table_scan_executors;
-    for (size_t i = 0; i < tab_names.size(); i++) {
-        auto curr_conds = pop_conds(conds, {tab_names.begin(), tab_names.begin() + i + 1});
-        int index_no = get_indexNo(tab_names[i], curr_conds);
+    for (size_t i = 0; i < plan.tab_names.size(); i++) {
         // lab3 task2 Todo
         // 根据get_indexNo判断conds上有无索引
         // 创建合适的scan executor(有索引优先用索引)存入table_scan_executors
-        if(index_no!=-1){
-            std::unique_ptr<AbstractExecutor> ptr(new IndexScanExecutor(sm_manager_,tab_names[i],curr_conds,index_no,context));
+        if(plan.index_nos[i]!=-1){
+            std::unique_ptr<AbstractExecutor> ptr(new IndexScanExecutor(sm_manager_,plan.tab_names[i],tab_conds[i],plan.index_nos[i],context));
             table_scan_executors.push_back(std::move(ptr));
         }
         else{
-            std::unique_ptr<AbstractExecutor> ptr(new SeqScanExecutor(sm_manager_,tab_names[i],curr_conds,context));
+            std::unique_ptr<AbstractExecutor> ptr(new SeqScanExecutor(sm_manager_,plan.tab_names[i],tab_conds[i],context));
             table_scan_executors.push_back(std::move(ptr));
         }
         // lab3 task2 Todo end
     }
-    assert(conds.empty());
     std::unique_ptr<AbstractExecutor> executorTreeRoot = std::move(table_scan_executors.back());
     // lab3 task2 Todo
     // 构建算子二叉树
@@ -263,46 +529,30 @@ void QlManager::select_from(std::vector<TabCol> sel_cols, const std::vector<std:
         executorTreeRoot=std::move(new_root);
         table_scan_executors.pop_back();
     }
-    std::unique_ptr<AbstractExecutor> new_root(new ProjectionExecutor(std::move(executorTreeRoot),sel_cols));
+    // 排序与LIMIT在投影之前进行, 使排序列不必出现在选择列中.
+    // 快照读的索引扫描按快照可见的版本判断条件, 还会最后返回索引键已经被修改的记录, 不保证按键的顺序, 仍然要排序
+    if (plan.need_sort || (snapshot_read && !plan.order_cols.empty())) {
+        executorTreeRoot = std::make_unique<SortExecutor>(std::move(executorTreeRoot), plan.order_cols, plan.limit, sort_work_mem_);
+    } else if (plan.limit >= 0) {
+        executorTreeRoot = std::make_unique<LimitExecutor>(std::move(executorTreeRoot), plan.limit);
+    }
+    std::unique_ptr<AbstractExecutor> new_root(new ProjectionExecutor(std::move(executorTreeRoot),plan.sel_cols));
     executorTreeRoot=std::move(new_root);
     // lab3 task2 Todo End
 
-    // Column titles
-    std::vector<std::string> captions;
-    captions.reserve(sel_cols.size());
-    for (auto &sel_col : sel_cols) {
-        captions.push_back(sel_col.col_name);
-    }
+    TextRowSink text_sink;
+    RowSink *sink = context->row_sink_ != nullptr ? context->row_sink_ : &text_sink;
     // Print header
-    RecordPrinter rec_printer(sel_cols.size());
-    rec_printer.print_separator(context);
-    rec_printer.print_record(captions, context);
-    rec_printer.print_separator(context);
+    sink->send_header(executorTreeRoot->cols(), plan.captions, context);
     // Print records
     size_t num_rec = 0;
     // 执行query_plan
     for (executorTreeRoot->beginTuple(); !executorTreeRoot->is_end(); executorTreeRoot->nextTuple()) {
         auto Tuple = executorTreeRoot->Next();
-        std::vector<std::string> columns;
-        for (auto &col : executorTreeRoot->cols()) {
-            std::string col_str;
-            char *rec_buf = Tuple->data + col.offset;
-            if (col.type == TYPE_INT) {
-                col_str = std::to_string(*(int *)rec_buf);
-            } else if (col.type == TYPE_FLOAT) {
-                col_str = std::to_string(*(float *)rec_buf);
-            } else if (col.type == TYPE_STRING) {
-                col_str = std::string((char *)rec_buf, col.len);
-                col_str.resize(strlen(col_str.c_str()));
-            }
-            columns.push_back(col_str);
-        }
-        rec_printer.print_record(columns, context);
+        // 记录攒满一块才发送, 结果不超过一块时出错可以整体作废, 客户端不会收到不完整的结果
+        sink->send_row(*Tuple, executorTreeRoot->cols(), context);
         num_rec++;
     }
-    // Print footer
-    rec_printer.print_separator(context);
-    // Print record count
-    RecordPrinter::print_record_count(num_rec, context);
-    
+    // Print footer and record count
+    sink->send_footer(num_rec, context);
 }
@@ -30,6 +30,8 @@ struct Value {
 
     std::shared_ptr<RmRecord> raw;  // raw record buffer
 
+    int param_idx = -1;  // 预编译语句中参数占位符的序号, -1表示不是参数
+
     void set_int(int int_val_) {
         type = TYPE_INT;
         int_val = int_val_;
@@ -79,14 +81,68 @@ struct SetClause {
     Value rhs;
 };
 
+struct OrderByCol {
+    TabCol col;    // column to sort on
+    bool is_desc;  // true if sorted in descending order
+};
+
+/**
+ * @brief 生成好的select计划, 可以带着不同的参数多次执行
+ * @details 计划只在生成时的catalog版本下有效, 表结构或索引变化后需要重新生成; 用到的表重新收集统计信息后也重新生成
+ */
+struct SelectPlan {
+    // 条件右侧的参数, 执行时按对应列的类型和长度绑定
+    struct ParamSlot {
+        size_t tab_idx;   // 条件所在的tab_conds下标
+        size_t cond_idx;  // 条件在tab_conds[tab_idx]中的下标
+        int param_idx;
+        ColType type;
+        int len;
+    };
+
+    uint64_t catalog_version;
+    std::vector<std::pair<std::shared_ptr<TableStatistics>, uint64_t>> stats_versions;  // 每个表生成计划时的统计信息版本
+    std::vector<TabCol> sel_cols;
+    std::vector<std::string> tab_names;
+    std::vector<std::vector<Condition>> tab_conds;  // 下推到每个表的扫描算子上的条件
+    std::vector<int> index_nos;                     // 每个表使用的索引, -1表示顺序扫描
+    std::vector<OrderByCol> order_cols;
+    bool need_sort;
+    int limit;
+    std::vector<ParamSlot> params;
+    std::vector<int> param_buckets;  // 生成计划时按参数值估计的每个参数条件的选择率区间, 下标同params
+    std::vector<std::string> captions;
+
+    bool is_valid(uint64_t current_catalog_version) const {
+        if (catalog_version != current_catalog_version) {
+            return false;
+        }
+        for (auto &[stats, version] : stats_versions) {
+            if (stats->version() != version) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
 class QlManager {
    private:
     SmManager *sm_manager_;
+    size_t sort_work_mem_;  // memory budget of a sort executor, in bytes
 
    public:
-    QlManager(SmManager *sm_manager) : sm_manager_(sm_manager) {}
+    QlManager(SmManager *sm_manager) : sm_manager_(sm_manager), sort_work_mem_(SORT_WORK_MEM) {}
+
+    void set_sort_work_mem(size_t sort_work_mem) { sort_work_mem_ = sort_work_mem; }
 
-    void insert_into(const std::string &tab_name, std::vector<Value> values, Context *context);
+    void insert_into(const std::string &tab_name, std::vector<std::vector<Value>> rows, Context *context);
+
+    /**
+     * @brief 把csv文件中的记录批量导入到表中
+     * @return 导入的记录数
+     */
+    size_t load_data(const std::string &file_name, const std::string &tab_name, Context *context);
 
     void delete_from(const std::string &tab_name, std::vector<Condition> conds, Context *context);
 
@@ -94,12 +150,47 @@ class QlManager {
                     std::vector<Condition> conds, Context *context);
 
     void select_from(std::vector<TabCol> sel_cols, const std::vector<std::string> &tab_names,
-                     std::vector<Condition> conds, Context *context);
+                     std::vector<Condition> conds, std::vector<OrderByCol> order_cols, int limit, Context *context);
+
+    /**
+     * @param params 不为nullptr时按这些参数值估计参数条件的选择率; 为nullptr时参数条件使用默认选择率
+     */
+    std::shared_ptr<SelectPlan> plan_select(std::vector<TabCol> sel_cols, const std::vector<std::string> &tab_names,
+                                            std::vector<Condition> conds, std::vector<OrderByCol> order_cols,
+                                            int limit, const std::vector<Value> *params = nullptr);
+
+    /**
+     * @brief 按params估计的参数条件的选择率和生成计划时在同一个区间, 计划可以直接使用; 否则需要按params重新生成
+     */
+    bool plan_fits_params(const SelectPlan &plan, const std::vector<Value> &params);
+
+    void execute_select(const SelectPlan &plan, const std::vector<Value> &params, Context *context);
 
    private:
     TabCol check_column(const std::vector<ColMeta> &all_cols, TabCol target);
     std::vector<ColMeta> get_all_cols(const std::vector<std::string> &tab_names);
     std::vector<Condition> check_where_clause(const std::vector<std::string> &tab_names,
                                               const std::vector<Condition> &conds);
-    int get_indexNo(std::string tab_name, std::vector<Condition> curr_conds);
+    /**
+     * @brief 扫描表时使用的索引, -1表示顺序扫描
+     * @details 没有统计信息时使用第一个可用的索引; 有统计信息时选择估计代价最小的索引, 都不如顺序扫描时返回-1
+     */
+    int get_indexNo(std::string tab_name, std::vector<Condition> curr_conds, const std::vector<Value> *params);
+
+    /**
+     * @brief 估计满足cond的行所占的比例, 没有统计信息或者条件右侧是不知道值的参数时使用默认值
+     */
+    double estimate_selectivity(TabMeta &tab, const TabStats *stats, const Condition &cond,
+                                const std::vector<Value> *params);
+
+    std::vector<std::string> get_join_order(const std::vector<std::string> &tab_names,
+                                            const std::vector<Condition> &conds, const std::vector<Value> *params);
+
+    // 计划中每个参数条件按params估计的选择率所在的区间, 区间的上下界相差一倍
+    std::vector<int> get_param_buckets(const SelectPlan &plan, const std::vector<Value> &params);
+
+    /**
+     * @brief 快照读的事务加上记录的写锁后调用, 记录在快照之后被其他事务修改过时中止事务(先更新者胜)
+     */
+    void check_write_conflict(const std::string &tab_name, const Rid &rid, Context *context);
 };
@@ -9,7 +9,7 @@ class DeleteExecutor : public AbstractExecutor {
    private:
     TabMeta tab_;
     std::vector<Condition> conds_;
-    RmFileHandle *fh_;
+    std::shared_ptr<RmFileHandle> fh_;
     std::vector<Rid> rids_;
     std::string tab_name_;
     SmManager *sm_manager_;
@@ -20,19 +20,19 @@ class DeleteExecutor : public AbstractExecutor {
         sm_manager_ = sm_manager;
         tab_name_ = tab_name;
         tab_ = sm_manager_->db_.get_table(tab_name);
-        fh_ = sm_manager_->fhs_.at(tab_name).get();
+        fh_ = sm_manager_->get_file_handle(tab_name);
         conds_ = conds;
         rids_ = rids;
         context_ = context;
     }
     std::unique_ptr<RmRecord> Next() override {
         // Get all index files
-        std::vector<IxIndexHandle *> ihs(tab_.cols.size(), nullptr);
+        std::vector<std::shared_ptr<IxIndexHandle>> ihs(tab_.cols.size());
         for (size_t col_i = 0; col_i < tab_.cols.size(); col_i++) {
             if (tab_.cols[col_i].index) {
                 // lab3 task3 Todo
                 // 获取需要的索引句柄,填充vector ihs
-                ihs[col_i]=sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_,col_i)).get();
+                ihs[col_i]=sm_manager_->get_index_handle(tab_name_,col_i);
                 // lab3 task3 Todo end
             }
         }
@@ -4,13 +4,15 @@
 #include "execution_manager.h"
 #include "executor_abstract.h"
 #include "index/ix.h"
+#include "snapshot_scan.h"
 #include "system/sm.h"
 
 class IndexScanExecutor : public AbstractExecutor {
    private:
     std::string tab_name_;
     std::vector<Condition> conds_;
-    RmFileHandle *fh_;
+    std::shared_ptr<RmFileHandle> fh_;
+    std::shared_ptr<IxIndexHandle> ih_;
     std::vector<ColMeta> cols_;
     size_t len_;
     std::vector<Condition> fed_conds_;
@@ -19,6 +21,8 @@ class IndexScanExecutor : public AbstractExecutor {
 
     Rid rid_;
     std::unique_ptr<RecScan> scan_;
+    bool snapshot_read_ = false;  // 快照读时扫描完索引后还要扫描snapshot_tail_
+    std::unique_ptr<SnapshotScanTail> snapshot_tail_;
 
     SmManager *sm_manager_;
 
@@ -31,7 +35,7 @@ class IndexScanExecutor : public AbstractExecutor {
         tab_name_ = std::move(tab_name);
         conds_ = std::move(conds);
         TabMeta &tab = sm_manager_->db_.get_table(tab_name_);
-        fh_ = sm_manager_->fhs_.at(tab_name_).get();
+        fh_ = sm_manager_->get_file_handle(tab_name_);
         cols_ = tab.cols;
         len_ = cols_.back().offset + cols_.back().len;
         context_ = context;
@@ -50,6 +54,7 @@ class IndexScanExecutor : public AbstractExecutor {
         }
         fed_conds_ = conds_;
         index_no_=index_no;
+        ih_ = sm_manager_->get_index_handle(tab_name_, index_no_);
         // lab3 task2 todo
     }
 
@@ -59,7 +64,7 @@ class IndexScanExecutor : public AbstractExecutor {
         check_runtime_conds();
 
         // index is available, scan index
-        auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index_no_)).get();
+        auto ih = ih_.get();
         Iid lower = ih->leaf_begin();
         Iid upper = ih->leaf_end();
         auto &index_col = cols_[index_no_];
@@ -96,15 +101,15 @@ class IndexScanExecutor : public AbstractExecutor {
             }
         }
         scan_ = std::make_unique<IxScan>(ih, lower, upper, sm_manager_->get_bpm());
-        // Get the first record
-        while (!scan_->is_end()) {
-            rid_ = scan_->rid();
-            auto rec = fh_->get_record(rid_, context_);
-            if (eval_conds(cols_, fed_conds_, rec.get())) {
-                break;
+        snapshot_read_ = context_->version_store_ != nullptr && context_->txn_->IsSnapshotRead();
+        if (snapshot_read_) {
+            if (snapshot_tail_ == nullptr) {
+                snapshot_tail_ = std::make_unique<SnapshotScanTail>(fh_->get_file_hdr().num_records_per_page);
             }
-            scan_->next();
+            snapshot_tail_->reset();
         }
+        // Get the first record
+        find_tuple(false);
     }
 
     void nextTuple() {
@@ -112,19 +117,13 @@ class IndexScanExecutor : public AbstractExecutor {
         assert(!is_end());
         // lab3 task2 todo
         // 扫描到下一个满足条件的记录,赋rid_,中止循环
-        scan_->next();
-        while(!scan_->is_end()){
-            rid_ = scan_->rid();
-            auto rec = fh_->get_record(rid_, context_);
-            if (eval_conds(cols_, fed_conds_, rec.get())) {
-                break;
-            }
-            scan_->next();
-        }
+        find_tuple(true);
         // lab3 task2 todo end
     }
 
-    bool is_end() const override { return scan_->is_end(); }
+    bool is_end() const override {
+        return snapshot_read_ && snapshot_tail_->started() ? snapshot_tail_->is_end() : scan_->is_end();
+    }
 
     size_t tupleLen() const override { return len_; }
 
@@ -151,6 +150,44 @@ class IndexScanExecutor : public AbstractExecutor {
 
     Rid &rid() override { return rid_; }
 
+    /**
+     * @brief 从当前位置(advance为true时从下一条记录)开始, 找到第一个满足fed_conds_的记录, 赋给rid_
+     * @details 快照读时索引中是记录最新的键, 要用快照可见的版本重新判断条件; 索引扫描结束后继续扫描snapshot_tail_,
+     * 找回快照中满足条件但索引键已经被修改的记录
+     */
+    void find_tuple(bool advance) {
+        if (!snapshot_read_ || !snapshot_tail_->started()) {
+            if (advance) {
+                scan_->next();
+            }
+            for (; !scan_->is_end(); scan_->next()) {
+                rid_ = scan_->rid();
+                auto rec = fh_->get_record(rid_, context_);
+                if (snapshot_read_) {
+                    snapshot_tail_->visit(rid_);
+                }
+                if (rec != nullptr && eval_conds(cols_, fed_conds_, rec.get())) {
+                    return;
+                }
+            }
+            if (!snapshot_read_) {
+                return;
+            }
+            snapshot_tail_->start(context_->version_store_, fh_->GetTabId());
+            advance = false;
+        }
+        if (advance) {
+            snapshot_tail_->next();
+        }
+        for (; !snapshot_tail_->is_end(); snapshot_tail_->next()) {
+            rid_ = snapshot_tail_->rid();
+            auto rec = fh_->get_record(rid_, context_);
+            if (rec != nullptr && eval_conds(cols_, fed_conds_, rec.get())) {
+                return;
+            }
+        }
+    }
+
     void check_runtime_conds() {
         for (auto &cond : fed_conds_) {
             assert(cond.lhs_col.tab_name == tab_name_);
@@ -1,4 +1,6 @@
 #pragma once
+#include <algorithm>
+
 #include "execution_defs.h"
 #include "execution_manager.h"
 #include "executor_abstract.h"
@@ -8,52 +10,88 @@
 class InsertExecutor : public AbstractExecutor {
    private:
     TabMeta tab_;
-    std::vector<Value> values_;
-    RmFileHandle *fh_;
+    std::vector<std::vector<Value>> rows_;
+    std::shared_ptr<RmFileHandle> fh_;
     std::string tab_name_;
     Rid rid_;
     SmManager *sm_manager_;
 
    public:
-    InsertExecutor(SmManager *sm_manager, const std::string &tab_name, std::vector<Value> values, Context *context) {
+    InsertExecutor(SmManager *sm_manager, const std::string &tab_name, std::vector<Value> values, Context *context)
+        : InsertExecutor(sm_manager, tab_name, std::vector<std::vector<Value>>{std::move(values)}, context) {}
+
+    /**
+     * @brief 一次插入多个元组, 所有元组的值都已经init_raw
+     */
+    InsertExecutor(SmManager *sm_manager, const std::string &tab_name, std::vector<std::vector<Value>> rows,
+                   Context *context) {
         sm_manager_ = sm_manager;
         tab_ = sm_manager_->db_.get_table(tab_name);
-        values_ = values;
+        rows_ = std::move(rows);
         tab_name_ = tab_name;
-        if (values.size() != tab_.cols.size()) {
-            throw InvalidValueCountError();
+        for (auto &values : rows_) {
+            if (values.size() != tab_.cols.size()) {
+                throw InvalidValueCountError();
+            }
         }
         // Get record file handle
-        fh_ = sm_manager_->fhs_.at(tab_name).get();
+        fh_ = sm_manager_->get_file_handle(tab_name);
         context_ = context;
     };
 
     std::unique_ptr<RmRecord> Next() override {
-        // lab3 task3 Todo
         // Make record buffer
-        // Insert into record file
-        // Insert into index
-        int tot_size=0;
-        for(auto i:tab_.cols){
-            tot_size+=i.len;
+        int record_size = fh_->get_file_hdr().record_size;
+        std::vector<char> buf(rows_.size() * record_size);
+        for (size_t r = 0; r < rows_.size(); r++) {
+            char *data = buf.data() + r * record_size;
+            for (size_t i = 0; i < rows_[r].size(); i++) {
+                memcpy(data + tab_.cols[i].offset, rows_[r][i].raw->data, rows_[r][i].raw->size);
+            }
         }
-        char *data=(char *)malloc(tot_size);
-        for(int i=0;i<values_.size();i++){
-            memcpy(data+tab_.cols[i].offset,values_[i].raw->data,values_[i].raw->size);
+        // Insert into record file and index
+        auto rids = insert_batch(sm_manager_, tab_, buf.data(), rows_.size(), context_);
+        rid_ = rids.back();
+        return std::make_unique<RmRecord>(record_size, buf.data() + (rows_.size() - 1) * record_size);
+    }
+
+    Rid &rid() override { return rid_; }
+
+    /**
+     * @brief 把连续存放的num_records条记录追加到表中, 并维护表上的所有索引
+     * @details 记录通过RmFileHandle::insert_records按页批量写入; 每个索引的键先排序再依次插入,
+     * 相邻的插入落在B+树的同一个叶子上. 每条记录都写入事务的写集合, 事务回滚时删除
+     * @return 每条记录的插入位置
+     */
+    static std::vector<Rid> insert_batch(SmManager *sm_manager, const TabMeta &tab, const char *buf,
+                                         size_t num_records, Context *context) {
+        if (num_records == 0) {
+            return {};
         }
-        std::unique_ptr<RmRecord> rmRecord(new RmRecord(tot_size,data));
-        auto ix_manager=sm_manager_->get_ix_manager();
-        rid_=fh_->insert_record(data,context_);
-        for(int i=0;i<tab_.cols.size();i++){
-            if(tab_.cols[i].index){
-                auto ix_file_handle=sm_manager_->ihs_.at(ix_manager->get_index_name(tab_name_,i)).get();
-                ix_file_handle->insert_entry(values_[i].raw->data,rid_,nullptr);
+        auto fh = sm_manager->get_file_handle(tab.name);
+        int record_size = fh->get_file_hdr().record_size;
+        auto rids = fh->insert_records(buf, num_records, context);
+        std::vector<size_t> order(num_records);
+        for (size_t i = 0; i < tab.cols.size(); i++) {
+            const ColMeta &col = tab.cols[i];
+            if (!col.index) {
+                continue;
+            }
+            auto key = [&](size_t r) { return buf + r * record_size + col.offset; };
+            for (size_t r = 0; r < num_records; r++) {
+                order[r] = r;
             }
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return ix_compare(key(a), key(b), col.type, col.len) < 0;
+            });
+            auto ih = sm_manager->get_index_handle(tab.name, i);
+            for (size_t r : order) {
+                ih->insert_entry(key(r), rids[r], nullptr);
+            }
+        }
+        for (auto &rid : rids) {
+            context->txn_->AppendWriteRecord(new WriteRecord(WType::INSERT_TUPLE, tab.name, rid));
         }
-        WriteRecord* writerecord=new WriteRecord(WType::INSERT_TUPLE,tab_name_,rid_);
-        context_->txn_->AppendWriteRecord(writerecord);
-        // lab3 task3 Todo end
-        return rmRecord;
+        return rids;
     }
-    Rid &rid() override { return rid_; }
-};
\ No newline at end of file
+};
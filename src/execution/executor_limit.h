@@ -0,0 +1,57 @@
+#pragma once
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/**
+ * @brief LIMIT算子，只输出子算子的前limit_条记录
+ */
+class LimitExecutor : public AbstractExecutor {
+   private:
+    std::unique_ptr<AbstractExecutor> prev_;
+    int limit_;
+    int num_emitted_ = 0;
+
+   public:
+    LimitExecutor(std::unique_ptr<AbstractExecutor> prev, int limit) {
+        prev_ = std::move(prev);
+        limit_ = limit;
+    }
+
+    std::string getType() override { return "Limit"; }
+
+    size_t tupleLen() const override { return prev_->tupleLen(); }
+
+    const std::vector<ColMeta> &cols() const override { return prev_->cols(); }
+
+    void beginTuple() override {
+        num_emitted_ = 0;
+        // LIMIT 0 不需要启动子算子
+        if (limit_ != 0) {
+            prev_->beginTuple();
+        }
+    }
+
+    void nextTuple() override {
+        assert(!is_end());
+        num_emitted_++;
+        if (num_emitted_ < limit_) {
+            prev_->nextTuple();
+        }
+    }
+
+    bool is_end() const override { return num_emitted_ >= limit_ || prev_->is_end(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        return prev_->Next();
+    }
+
+    void feed(const std::map<TabCol, Value> &feed_dict) override {
+        throw InternalError("Cannot feed a limit node");
+    }
+
+    Rid &rid() override { return prev_->rid(); }
+};
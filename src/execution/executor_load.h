@@ -0,0 +1,232 @@
+#pragma once
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "executor_insert.h"
+#include "system/sm.h"
+
+/**
+ * @brief LOAD DATA: 把csv文件中的记录批量导入到表中
+ * @details 文件每次读入LOAD_BATCH_SIZE字节, 在换行处切成若干段, 由多个线程并行解析成记录;
+ * 解析完成后按文件中的顺序通过InsertExecutor::insert_batch写入记录文件和索引.
+ * 每行一条记录, 字段以逗号分隔, 个数和顺序与表的列一致; 字符串可以用双引号括起来, 引号内的""表示一个",
+ * 字段中不能有换行. 空行被跳过
+ */
+class LoadExecutor : public AbstractExecutor {
+   private:
+    // 一个线程负责解析的一段文本
+    struct Chunk {
+        const char *begin;
+        const char *end;
+        std::vector<char> records;  // 解析出的记录, 连续存放
+        size_t num_records = 0;
+        size_t num_lines = 0;       // 段中的行数, 包括空行
+        size_t error_line = 0;      // 出错的行在段中的行号, 从1开始, 0表示没有出错
+        std::string error;
+    };
+
+    TabMeta tab_;
+    std::string file_name_;
+    SmManager *sm_manager_;
+    int record_size_;
+    size_t num_threads_;
+    size_t num_loaded_ = 0;
+    Rid rid_;
+
+   public:
+    /**
+     * @param num_threads 解析csv的线程数, 为0时取CPU核数
+     */
+    LoadExecutor(SmManager *sm_manager, const std::string &file_name, const std::string &tab_name, Context *context,
+                 size_t num_threads = 0) {
+        sm_manager_ = sm_manager;
+        tab_ = sm_manager_->db_.get_table(tab_name);
+        file_name_ = file_name;
+        record_size_ = sm_manager_->get_file_handle(tab_name)->get_file_hdr().record_size;
+        num_threads_ = num_threads != 0 ? num_threads : std::max(1u, std::thread::hardware_concurrency());
+        context_ = context;
+    }
+
+    std::unique_ptr<RmRecord> Next() override {
+        FILE *file = fopen(file_name_.c_str(), "r");
+        if (file == nullptr) {
+            throw FileNotFoundError(file_name_);
+        }
+        std::unique_ptr<FILE, int (*)(FILE *)> guard(file, fclose);
+        std::string buf;     // 还没有解析的文本
+        size_t line_no = 1;  // buf中第一行在文件中的行号
+        bool eof = false;
+        while (!eof) {
+            size_t old_size = buf.size();
+            buf.resize(old_size + LOAD_BATCH_SIZE);
+            size_t n = fread(&buf[old_size], 1, LOAD_BATCH_SIZE, file);
+            buf.resize(old_size + n);
+            if (n < LOAD_BATCH_SIZE) {
+                if (ferror(file)) {
+                    throw UnixError();
+                }
+                eof = true;
+            }
+            // 最后一行可能不完整, 留到下一批
+            size_t end = buf.size();
+            if (!eof) {
+                end = buf.rfind('\n');
+                if (end == std::string::npos) {
+                    continue;
+                }
+                end++;
+            }
+            load_batch(buf.data(), buf.data() + end, &line_no);
+            buf.erase(0, end);
+        }
+        return nullptr;
+    }
+
+    Rid &rid() override { return rid_; }
+
+    size_t num_loaded() const { return num_loaded_; }
+
+   private:
+    /**
+     * @brief 并行解析[begin, end)中的完整行, 没有错误时全部插入表中
+     */
+    void load_batch(const char *begin, const char *end, size_t *line_no) {
+        std::vector<Chunk> chunks;
+        size_t len = end - begin;
+        const char *pos = begin;
+        for (size_t i = 1; i <= num_threads_ && pos < end; i++) {
+            const char *chunk_end = i == num_threads_ ? end : std::max(pos, begin + len * i / num_threads_);
+            if (chunk_end < end) {
+                auto eol = static_cast<const char *>(memchr(chunk_end, '\n', end - chunk_end));
+                chunk_end = eol == nullptr ? end : eol + 1;
+            }
+            chunks.push_back(Chunk{pos, chunk_end});
+            pos = chunk_end;
+        }
+        if (chunks.size() == 1) {
+            parse_chunk(&chunks[0]);
+        } else {
+            std::vector<std::thread> workers;
+            for (auto &chunk : chunks) {
+                workers.emplace_back([this, &chunk] { parse_chunk(&chunk); });
+            }
+            for (auto &worker : workers) {
+                worker.join();
+            }
+        }
+        for (auto &chunk : chunks) {
+            if (chunk.error_line != 0) {
+                throw CsvFormatError(file_name_, *line_no + chunk.error_line - 1, chunk.error);
+            }
+            *line_no += chunk.num_lines;
+        }
+        for (auto &chunk : chunks) {
+            auto rids = InsertExecutor::insert_batch(sm_manager_, tab_, chunk.records.data(), chunk.num_records,
+                                                     context_);
+            if (!rids.empty()) {
+                rid_ = rids.back();
+            }
+            num_loaded_ += chunk.num_records;
+        }
+    }
+
+    void parse_chunk(Chunk *chunk) {
+        std::string field;
+        const char *p = chunk->begin;
+        while (p < chunk->end) {
+            auto eol = static_cast<const char *>(memchr(p, '\n', chunk->end - p));
+            const char *line_end = eol == nullptr ? chunk->end : eol;
+            chunk->num_lines++;
+            if (line_end > p && line_end[-1] == '\r') {
+                line_end--;
+            }
+            if (line_end > p) {
+                chunk->records.resize((chunk->num_records + 1) * record_size_);
+                char *record = chunk->records.data() + chunk->num_records * record_size_;
+                chunk->error = parse_line(p, line_end, record, &field);
+                if (!chunk->error.empty()) {
+                    chunk->error_line = chunk->num_lines;
+                    return;
+                }
+                chunk->num_records++;
+            }
+            p = eol == nullptr ? chunk->end : eol + 1;
+        }
+    }
+
+    /**
+     * @brief 把一行解析成一条记录
+     * @return 出错时返回错误信息, 否则返回空串
+     */
+    std::string parse_line(const char *p, const char *end, char *record, std::string *field) const {
+        for (size_t i = 0; i < tab_.cols.size(); i++) {
+            const ColMeta &col = tab_.cols[i];
+            if (i > 0) {
+                if (p == end || *p != ',') {
+                    return "expected " + std::to_string(tab_.cols.size()) + " fields, got " + std::to_string(i);
+                }
+                p++;
+            }
+            field->clear();
+            if (p < end && *p == '"') {
+                // quoted field
+                p++;
+                while (true) {
+                    if (p == end) {
+                        return "unterminated quoted field";
+                    }
+                    if (*p == '"') {
+                        if (p + 1 < end && p[1] == '"') {
+                            field->push_back('"');
+                            p += 2;
+                            continue;
+                        }
+                        p++;
+                        break;
+                    }
+                    field->push_back(*p++);
+                }
+            } else {
+                const char *field_end = static_cast<const char *>(memchr(p, ',', end - p));
+                if (field_end == nullptr) {
+                    field_end = end;
+                }
+                field->assign(p, field_end);
+                p = field_end;
+            }
+            char *dst = record + col.offset;
+            if (col.type == TYPE_INT) {
+                char *num_end;
+                errno = 0;
+                long val = strtol(field->c_str(), &num_end, 10);
+                if (field->empty() || *num_end != '\0' || errno == ERANGE || val < INT_MIN || val > INT_MAX) {
+                    return "invalid int value '" + *field + "' for column " + col.name;
+                }
+                *(int *)dst = (int)val;
+            } else if (col.type == TYPE_FLOAT) {
+                char *num_end;
+                float val = strtof(field->c_str(), &num_end);
+                if (field->empty() || *num_end != '\0') {
+                    return "invalid float value '" + *field + "' for column " + col.name;
+                }
+                *(float *)dst = val;
+            } else {
+                if ((int)field->size() > col.len) {
+                    return "string is too long for column " + col.name;
+                }
+                memset(dst, 0, col.len);
+                memcpy(dst, field->data(), field->size());
+            }
+        }
+        if (p != end) {
+            return "expected " + std::to_string(tab_.cols.size()) + " fields, got more";
+        }
+        return "";
+    }
+};
@@ -4,19 +4,22 @@
 #include "execution_manager.h"
 #include "executor_abstract.h"
 #include "index/ix.h"
+#include "snapshot_scan.h"
 #include "system/sm.h"
 
 class SeqScanExecutor : public AbstractExecutor {
    private:
     std::string tab_name_;
     std::vector<Condition> conds_;  // 初始扫描条件(来自SQL)
-    RmFileHandle *fh_;              // TableHeap
+    std::shared_ptr<RmFileHandle> fh_;  // TableHeap
     std::vector<ColMeta> cols_;
     size_t len_;
     std::vector<Condition> fed_conds_;  // 实际扫描条件(可能由于连接运算动态改变)
 
     Rid rid_;                        // 当前扫描到的记录的rid
     std::unique_ptr<RecScan> scan_;  // table_iterator
+    bool snapshot_read_ = false;     // 快照读时扫描完堆文件后还要扫描snapshot_tail_
+    std::unique_ptr<SnapshotScanTail> snapshot_tail_;
 
     SmManager *sm_manager_;
 
@@ -26,7 +29,7 @@ class SeqScanExecutor : public AbstractExecutor {
         tab_name_ = std::move(tab_name);
         conds_ = std::move(conds);
         TabMeta &tab = sm_manager_->db_.get_table(tab_name_);
-        fh_ = sm_manager_->fhs_.at(tab_name_).get();
+        fh_ = sm_manager_->get_file_handle(tab_name_);
         cols_ = tab.cols;
         len_ = cols_.back().offset + cols_.back().len;
         context_ = context;
@@ -55,46 +58,27 @@ class SeqScanExecutor : public AbstractExecutor {
     void beginTuple() override {
         check_runtime_conds();
 
-        scan_ = std::make_unique<RmScan>(fh_);
-
-        // 得到第一个满足fed_conds_条件的record,并把其rid赋给算子成员rid_
-        while (!scan_->is_end()) {
-            rid_ = scan_->rid();
-            try {
-                auto rec = fh_->get_record(rid_, context_);  // TableHeap->GetTuple() 当前扫描到的记录
-                // lab3 task2 todo
-                // 利用eval_conds判断是否当前记录(rec.get())满足谓词条件
-                if(eval_conds(cols_,fed_conds_,rec.get())){
-                    break;
-                }
-                // 满足则中止循环
-                // lab3 task2 todo end
-            } catch (RecordNotFoundError &e) {
-                std::cerr << e.what() << std::endl;
+        scan_ = std::make_unique<RmScan>(fh_.get());
+        snapshot_read_ = context_->version_store_ != nullptr && context_->txn_->IsSnapshotRead();
+        if (snapshot_read_) {
+            if (snapshot_tail_ == nullptr) {
+                snapshot_tail_ = std::make_unique<SnapshotScanTail>(fh_->get_file_hdr().num_records_per_page);
             }
-
-            scan_->next();  // 找下一个有record的位置
+            snapshot_tail_->reset();
         }
+        // 得到第一个满足fed_conds_条件的record,并把其rid赋给算子成员rid_
+        find_tuple(false);
     }
 
     void nextTuple() override {
         check_runtime_conds();
         assert(!is_end());
-        for (scan_->next(); !scan_->is_end(); scan_->next()) {  // 用TableIterator遍历TableHeap中的所有Tuple
-            // lab3 task2 todo
-            // 获取当前记录(参考beginTuple())赋给算子成员rid_
-            // 利用eval_conds判断是否当前记录(rec.get())满足谓词条件
-            // 满足则中止循环
-            rid_ = scan_->rid();
-            auto rec = fh_->get_record(rid_, context_);
-            if(eval_conds(cols_,fed_conds_,rec.get())){
-                break;
-            }
-            // lab3 task2 todo End
-        }
+        find_tuple(true);
     }
 
-    bool is_end() const override { return scan_->is_end(); }
+    bool is_end() const override {
+        return snapshot_read_ && snapshot_tail_->started() ? snapshot_tail_->is_end() : scan_->is_end();
+    }
 
     size_t tupleLen() const override { return len_; }
 
@@ -126,6 +110,43 @@ class SeqScanExecutor : public AbstractExecutor {
 
     Rid &rid() override { return rid_; }
 
+    /**
+     * @brief 从当前位置(advance为true时从下一条记录)开始, 找到第一个满足fed_conds_的记录, 赋给rid_
+     * @details 快照读时记录可能在快照中不存在(get_record返回nullptr); 堆文件扫描结束后继续扫描snapshot_tail_
+     */
+    void find_tuple(bool advance) {
+        if (!snapshot_read_ || !snapshot_tail_->started()) {
+            if (advance) {
+                scan_->next();
+            }
+            for (; !scan_->is_end(); scan_->next()) {  // 用TableIterator遍历TableHeap中的所有Tuple
+                rid_ = scan_->rid();
+                auto rec = fh_->get_record(rid_, context_);  // TableHeap->GetTuple() 当前扫描到的记录
+                if (snapshot_read_) {
+                    snapshot_tail_->visit(rid_);
+                }
+                if (rec != nullptr && eval_conds(cols_, fed_conds_, rec.get())) {
+                    return;
+                }
+            }
+            if (!snapshot_read_) {
+                return;
+            }
+            snapshot_tail_->start(context_->version_store_, fh_->GetTabId());
+            advance = false;
+        }
+        if (advance) {
+            snapshot_tail_->next();
+        }
+        for (; !snapshot_tail_->is_end(); snapshot_tail_->next()) {
+            rid_ = snapshot_tail_->rid();
+            auto rec = fh_->get_record(rid_, context_);
+            if (rec != nullptr && eval_conds(cols_, fed_conds_, rec.get())) {
+                return;
+            }
+        }
+    }
+
     void check_runtime_conds() {
         for (auto &cond : fed_conds_) {
             assert(cond.lhs_col.tab_name == tab_name_);
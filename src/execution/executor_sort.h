@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+
+#include "execution_defs.h"
+#include "execution_manager.h"
+#include "executor_abstract.h"
+#include "index/ix.h"
+#include "system/sm.h"
+
+/**
+ * @brief 排序算子，支持ORDER BY col [ASC|DESC], ... [LIMIT n]
+ * @details 三种执行方式:
+ * 1. LIMIT较小(limit * tuple_len <= work_mem): 用大小为limit的有界堆做top-N，只保留前n条记录
+ * 2. 全部记录能放入work_mem: 内存中直接排序
+ * 3. 超出work_mem: 每当缓冲区满时把排好序的run溢出到临时文件，最后对所有run做多路归并
+ */
+class SortExecutor : public AbstractExecutor {
+   private:
+    std::unique_ptr<AbstractExecutor> prev_;
+    std::vector<ColMeta> cols_;
+    size_t len_;
+    std::vector<std::pair<ColMeta, bool>> order_cols_;  // 排序列及其是否降序
+    int limit_;                                         // -1表示没有LIMIT
+    size_t work_mem_;                                   // 排序可用的内存大小(byte)
+
+    std::vector<char> buf_;        // 内存中的记录，每条记录占len_字节
+    std::vector<size_t> order_;    // buf_中记录的下标，按排序后的顺序排列
+    size_t pos_ = 0;               // 内存排序时当前记录在order_中的位置
+
+    struct SortRun {
+        std::FILE *file;
+        std::vector<char> curr;  // 当前run中的下一条记录
+    };
+    std::vector<SortRun> runs_;    // 溢出到临时文件的有序run
+    std::vector<size_t> heap_;     // 多路归并使用的堆，存放runs_的下标
+    std::vector<char> curr_;       // 归并时当前输出的记录
+
+    size_t num_emitted_ = 0;
+    bool is_end_ = true;
+
+   public:
+    SortExecutor(std::unique_ptr<AbstractExecutor> prev, const std::vector<OrderByCol> &order_cols, int limit,
+                 size_t work_mem) {
+        prev_ = std::move(prev);
+        cols_ = prev_->cols();
+        len_ = prev_->tupleLen();
+        for (auto &order_col : order_cols) {
+            order_cols_.emplace_back(*get_col(cols_, order_col.col), order_col.is_desc);
+        }
+        limit_ = limit;
+        work_mem_ = std::max(work_mem, len_);
+    }
+
+    ~SortExecutor() override { clear_runs(); }
+
+    std::string getType() override { return "Sort"; }
+
+    size_t tupleLen() const override { return len_; }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    void beginTuple() override {
+        buf_.clear();
+        order_.clear();
+        clear_runs();
+        pos_ = 0;
+        num_emitted_ = 0;
+        if (limit_ == 0) {
+            is_end_ = true;
+            return;
+        }
+        if (limit_ > 0 && (size_t)limit_ * len_ <= work_mem_) {
+            top_n();
+        } else {
+            sort_all();
+        }
+        if (runs_.empty()) {
+            is_end_ = order_.empty();
+        } else {
+            begin_merge();
+        }
+    }
+
+    void nextTuple() override {
+        assert(!is_end());
+        num_emitted_++;
+        if (limit_ >= 0 && num_emitted_ >= (size_t)limit_) {
+            is_end_ = true;
+            return;
+        }
+        if (runs_.empty()) {
+            is_end_ = ++pos_ >= order_.size();
+        } else {
+            next_merge();
+        }
+    }
+
+    bool is_end() const override { return is_end_; }
+
+    std::unique_ptr<RmRecord> Next() override {
+        assert(!is_end());
+        if (runs_.empty()) {
+            return std::make_unique<RmRecord>(len_, &buf_[order_[pos_] * len_]);
+        }
+        return std::make_unique<RmRecord>(len_, curr_.data());
+    }
+
+    void feed(const std::map<TabCol, Value> &feed_dict) override {
+        throw InternalError("Cannot feed a sort node");
+    }
+
+    Rid &rid() override { return _abstract_rid; }
+
+   private:
+    int compare(const char *a, const char *b) const {
+        for (auto &order_col : order_cols_) {
+            auto &col = order_col.first;
+            int cmp = ix_compare(a + col.offset, b + col.offset, col.type, col.len);
+            if (cmp != 0) {
+                return order_col.second ? -cmp : cmp;
+            }
+        }
+        return 0;
+    }
+
+    const char *row(size_t idx) const { return &buf_[idx * len_]; }
+
+    void append_row(const RmRecord &rec) { buf_.insert(buf_.end(), rec.data, rec.data + len_); }
+
+    /**
+     * @brief 用有界的大顶堆保留前limit_条记录，堆顶是当前保留记录中最"大"的一条
+     */
+    void top_n() {
+        auto less = [&](size_t x, size_t y) { return compare(row(x), row(y)) < 0; };
+        std::vector<size_t> heap;
+        for (prev_->beginTuple(); !prev_->is_end(); prev_->nextTuple()) {
+            auto rec = prev_->Next();
+            if (heap.size() < (size_t)limit_) {
+                append_row(*rec);
+                heap.push_back(heap.size());
+                std::push_heap(heap.begin(), heap.end(), less);
+            } else if (compare(rec->data, row(heap.front())) < 0) {
+                // 新记录比堆顶小，替换堆顶所在的槽位
+                std::pop_heap(heap.begin(), heap.end(), less);
+                memcpy(&buf_[heap.back() * len_], rec->data, len_);
+                std::push_heap(heap.begin(), heap.end(), less);
+            }
+        }
+        std::sort_heap(heap.begin(), heap.end(), less);
+        order_ = std::move(heap);
+    }
+
+    /**
+     * @brief 读取全部记录并排序，内存超出work_mem_时溢出有序run到临时文件
+     */
+    void sort_all() {
+        for (prev_->beginTuple(); !prev_->is_end(); prev_->nextTuple()) {
+            auto rec = prev_->Next();
+            if (buf_.size() + len_ > work_mem_) {
+                spill_run();
+            }
+            append_row(*rec);
+        }
+        sort_buffer();
+        if (!runs_.empty() && !buf_.empty()) {
+            spill_run();
+        }
+    }
+
+    void sort_buffer() {
+        order_.resize(buf_.size() / len_);
+        for (size_t i = 0; i < order_.size(); i++) {
+            order_[i] = i;
+        }
+        std::stable_sort(order_.begin(), order_.end(),
+                         [&](size_t x, size_t y) { return compare(row(x), row(y)) < 0; });
+    }
+
+    void spill_run() {
+        sort_buffer();
+        std::FILE *file = std::tmpfile();
+        if (file == nullptr) {
+            throw UnixError();
+        }
+        for (size_t idx : order_) {
+            if (std::fwrite(row(idx), 1, len_, file) != len_) {
+                std::fclose(file);
+                throw UnixError();
+            }
+        }
+        std::rewind(file);
+        runs_.push_back({file, std::vector<char>(len_)});
+        buf_.clear();
+        order_.clear();
+    }
+
+    bool read_run(SortRun &run) { return std::fread(run.curr.data(), 1, len_, run.file) == len_; }
+
+    // 归并堆的比较函数：堆顶为当前最小的run
+    bool heap_greater(size_t x, size_t y) const {
+        int cmp = compare(runs_[x].curr.data(), runs_[y].curr.data());
+        return cmp != 0 ? cmp > 0 : x > y;
+    }
+
+    void begin_merge() {
+        heap_.clear();
+        curr_.resize(len_);
+        auto greater = [&](size_t x, size_t y) { return heap_greater(x, y); };
+        for (size_t i = 0; i < runs_.size(); i++) {
+            if (read_run(runs_[i])) {
+                heap_.push_back(i);
+                std::push_heap(heap_.begin(), heap_.end(), greater);
+            }
+        }
+        pop_merge();
+    }
+
+    void next_merge() { pop_merge(); }
+
+    void pop_merge() {
+        if (heap_.empty()) {
+            is_end_ = true;
+            return;
+        }
+        auto greater = [&](size_t x, size_t y) { return heap_greater(x, y); };
+        std::pop_heap(heap_.begin(), heap_.end(), greater);
+        size_t run_idx = heap_.back();
+        heap_.pop_back();
+        memcpy(curr_.data(), runs_[run_idx].curr.data(), len_);
+        if (read_run(runs_[run_idx])) {
+            heap_.push_back(run_idx);
+            std::push_heap(heap_.begin(), heap_.end(), greater);
+        }
+        is_end_ = false;
+    }
+
+    void clear_runs() {
+        for (auto &run : runs_) {
+            std::fclose(run.file);
+        }
+        runs_.clear();
+        heap_.clear();
+    }
+};
@@ -0,0 +1,130 @@
+#include "executor_sort.h"
+
+#include <random>
+
+#include "executor_limit.h"
+#include "gtest/gtest.h"
+
+/**
+ * @brief 测试用的子算子，依次输出内存中的记录
+ * 记录格式: (a INT, b CHAR(8))
+ */
+class VectorExecutor : public AbstractExecutor {
+   private:
+    std::vector<ColMeta> cols_;
+    std::vector<std::pair<int, std::string>> rows_;
+    size_t pos_ = 0;
+
+   public:
+    explicit VectorExecutor(std::vector<std::pair<int, std::string>> rows) : rows_(std::move(rows)) {
+        cols_.push_back({.tab_name = "t", .name = "a", .type = TYPE_INT, .len = sizeof(int), .offset = 0, .index = false});
+        cols_.push_back({.tab_name = "t", .name = "b", .type = TYPE_STRING, .len = 8, .offset = sizeof(int), .index = false});
+    }
+
+    size_t tupleLen() const override { return sizeof(int) + 8; }
+
+    const std::vector<ColMeta> &cols() const override { return cols_; }
+
+    void beginTuple() override { pos_ = 0; }
+
+    void nextTuple() override { pos_++; }
+
+    bool is_end() const override { return pos_ >= rows_.size(); }
+
+    std::unique_ptr<RmRecord> Next() override {
+        auto rec = std::make_unique<RmRecord>(tupleLen());
+        memset(rec->data, 0, tupleLen());
+        *(int *)rec->data = rows_[pos_].first;
+        memcpy(rec->data + sizeof(int), rows_[pos_].second.c_str(), rows_[pos_].second.size());
+        return rec;
+    }
+
+    Rid &rid() override { return _abstract_rid; }
+};
+
+static std::vector<std::pair<int, std::string>> collect(AbstractExecutor *exec) {
+    std::vector<std::pair<int, std::string>> res;
+    for (exec->beginTuple(); !exec->is_end(); exec->nextTuple()) {
+        auto rec = exec->Next();
+        res.emplace_back(*(int *)rec->data, std::string(rec->data + sizeof(int)));
+    }
+    return res;
+}
+
+static std::vector<std::pair<int, std::string>> make_rows(int num_rows) {
+    std::mt19937 rng(0);
+    std::vector<std::pair<int, std::string>> rows;
+    for (int i = 0; i < num_rows; i++) {
+        rows.emplace_back(rng() % 100, std::to_string(i));
+    }
+    return rows;
+}
+
+static std::vector<std::pair<int, std::string>> expected(std::vector<std::pair<int, std::string>> rows, bool is_desc,
+                                                         int limit) {
+    std::stable_sort(rows.begin(), rows.end(), [&](const auto &x, const auto &y) {
+        return is_desc ? x.first > y.first : x.first < y.first;
+    });
+    if (limit >= 0 && (size_t)limit < rows.size()) {
+        rows.resize(limit);
+    }
+    return rows;
+}
+
+const std::vector<OrderByCol> ORDER_A_ASC = {{.col = {.tab_name = "t", .col_name = "a"}, .is_desc = false}};
+const std::vector<OrderByCol> ORDER_A_DESC = {{.col = {.tab_name = "t", .col_name = "a"}, .is_desc = true}};
+
+// 全部记录放得进work_mem, 内存中排序, 相同键保持输入顺序
+TEST(SortExecutorTest, InMemorySort) {
+    auto rows = make_rows(1000);
+    SortExecutor sort(std::make_unique<VectorExecutor>(rows), ORDER_A_ASC, -1, SORT_WORK_MEM);
+    EXPECT_EQ(collect(&sort), expected(rows, false, -1));
+
+    SortExecutor sort_desc(std::make_unique<VectorExecutor>(rows), ORDER_A_DESC, -1, SORT_WORK_MEM);
+    EXPECT_EQ(collect(&sort_desc), expected(rows, true, -1));
+}
+
+// work_mem只够放下少量记录, 需要溢出多个run并归并
+TEST(SortExecutorTest, ExternalMergeSort) {
+    auto rows = make_rows(5000);
+    size_t work_mem = 64 * (sizeof(int) + 8);
+    SortExecutor sort(std::make_unique<VectorExecutor>(rows), ORDER_A_ASC, -1, work_mem);
+    EXPECT_EQ(collect(&sort), expected(rows, false, -1));
+
+    SortExecutor sort_desc(std::make_unique<VectorExecutor>(rows), ORDER_A_DESC, 100, work_mem / 2);
+    EXPECT_EQ(collect(&sort_desc), expected(rows, true, 100));
+}
+
+// 小LIMIT使用有界堆
+TEST(SortExecutorTest, TopN) {
+    auto rows = make_rows(5000);
+    for (int limit : {0, 1, 10, 4999, 5000, 6000}) {
+        SortExecutor sort(std::make_unique<VectorExecutor>(rows), ORDER_A_ASC, limit, SORT_WORK_MEM);
+        auto res = collect(&sort);
+        auto exp = expected(rows, false, limit);
+        // 有界堆不保证相同键的顺序, 只比较排序键
+        ASSERT_EQ(res.size(), exp.size());
+        for (size_t i = 0; i < res.size(); i++) {
+            EXPECT_EQ(res[i].first, exp[i].first);
+        }
+    }
+}
+
+TEST(SortExecutorTest, MultiColumn) {
+    std::vector<std::pair<int, std::string>> rows = {{2, "b"}, {1, "c"}, {2, "a"}, {1, "a"}, {2, "c"}};
+    std::vector<OrderByCol> order_cols = {{.col = {.tab_name = "t", .col_name = "a"}, .is_desc = true},
+                                          {.col = {.tab_name = "t", .col_name = "b"}, .is_desc = false}};
+    SortExecutor sort(std::make_unique<VectorExecutor>(rows), order_cols, -1, SORT_WORK_MEM);
+    std::vector<std::pair<int, std::string>> exp = {{2, "a"}, {2, "b"}, {2, "c"}, {1, "a"}, {1, "c"}};
+    EXPECT_EQ(collect(&sort), exp);
+}
+
+TEST(LimitExecutorTest, Limit) {
+    auto rows = make_rows(100);
+    for (int limit : {0, 1, 50, 100, 200}) {
+        LimitExecutor limit_exec(std::make_unique<VectorExecutor>(rows), limit);
+        auto exp = rows;
+        exp.resize(std::min<size_t>(limit, rows.size()));
+        EXPECT_EQ(collect(&limit_exec), exp);
+    }
+}
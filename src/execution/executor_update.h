@@ -9,7 +9,7 @@ class UpdateExecutor : public AbstractExecutor {
    private:
     TabMeta tab_;
     std::vector<Condition> conds_;
-    RmFileHandle *fh_;
+    std::shared_ptr<RmFileHandle> fh_;
     std::vector<Rid> rids_;
     std::string tab_name_;
     std::vector<SetClause> set_clauses_;
@@ -22,14 +22,14 @@ class UpdateExecutor : public AbstractExecutor {
         tab_name_ = tab_name;
         set_clauses_ = set_clauses;
         tab_ = sm_manager_->db_.get_table(tab_name);
-        fh_ = sm_manager_->fhs_.at(tab_name).get();
+        fh_ = sm_manager_->get_file_handle(tab_name);
         conds_ = conds;
         rids_ = rids;
         context_ = context;
     }
     std::unique_ptr<RmRecord> Next() override {
         // Get all necessary index files
-        std::vector<IxIndexHandle *> ihs(tab_.cols.size(), nullptr);
+        std::vector<std::shared_ptr<IxIndexHandle>> ihs(tab_.cols.size());
         std::vector<std::pair<bool,Value>> values(tab_.cols.size());
         for(auto i:values)i.first=false;
         for (auto &set_clause : set_clauses_) {
@@ -38,7 +38,7 @@ class UpdateExecutor : public AbstractExecutor {
                 size_t lhs_col_idx = lhs_col - tab_.cols.begin();
                 // lab3 task3 Todo
                 // 获取需要的索引句柄,填充vector ihs
-                ihs[lhs_col_idx]=sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_,lhs_col_idx)).get();
+                ihs[lhs_col_idx]=sm_manager_->get_index_handle(tab_name_,lhs_col_idx);
                 // lab3 task3 Todo end
             }
             for(int i=0;i<tab_.cols.size();i++){
@@ -17,10 +17,11 @@ const char *help_info =
     "  DROP TABLE table_name\n"
     "  CREATE INDEX table_name (column_name)\n"
     "  DROP INDEX table_name (column_name)\n"
+    "  ANALYZE table_name\n"
     "  INSERT INTO table_name VALUES (value [, value ...])\n"
     "  DELETE FROM table_name [WHERE where_clause]\n"
     "  UPDATE table_name SET column_name = value [, column_name = value ...] [WHERE where_clause]\n"
-    "  SELECT selector FROM table_name [WHERE where_clause]\n"
+    "  SELECT selector FROM table_name [WHERE where_clause] [ORDER BY order_item [, order_item ...]] [LIMIT n]\n"
     "type:\n"
     "  {INT | FLOAT | CHAR(n)}\n"
     "where_clause:\n"
@@ -32,7 +33,9 @@ const char *help_info =
     "op:\n"
     "  {= | <> | < | > | <= | >=}\n"
     "selector:\n"
-    "  {* | column [, column ...]}\n";
+    "  {* | column [, column ...]}\n"
+    "order_item:\n"
+    "  column [ASC | DESC]\n";
 
 class InterpForTest {
    private:
@@ -45,8 +48,9 @@ class InterpForTest {
     void interp_sql(const std::shared_ptr<ast::TreeNode> &root, Context *context) {
         if (auto x = std::dynamic_pointer_cast<ast::Help>(root)) {
             // help;
-            memcpy(context->data_send_ + *(context->offset_), help_info, strlen(help_info));
-            *(context->offset_) = strlen(help_info);
+            if (context->writer_ != nullptr) {
+                context->writer_->write(help_info, strlen(help_info));
+            }
         } else if (auto x = std::dynamic_pointer_cast<ast::ShowTables>(root)) {
             // show tables;
             sm_manager_->show_tables(context);
@@ -87,14 +91,23 @@ class InterpForTest {
 
             sm_manager_->drop_index(x->tab_name, x->col_name, context);
 
+        } else if (auto x = std::dynamic_pointer_cast<ast::AnalyzeTable>(root)) {
+            // analyze;
+
+            sm_manager_->analyze_table(x->tab_name, context);
+
         } else if (auto x = std::dynamic_pointer_cast<ast::InsertStmt>(root)) {
             // insert;
-            std::vector<Value> values;
-            for (auto &sv_val : x->vals) {
-                values.push_back(interp_sv_value(sv_val));
+            std::vector<std::vector<Value>> rows;
+            for (auto &sv_row : x->rows) {
+                std::vector<Value> values;
+                for (auto &sv_val : sv_row) {
+                    values.push_back(interp_sv_value(sv_val));
+                }
+                rows.push_back(std::move(values));
             }
 
-            ql_manager_->insert_into(x->tab_name, values, context);
+            ql_manager_->insert_into(x->tab_name, rows, context);
 
         } else if (auto x = std::dynamic_pointer_cast<ast::DeleteStmt>(root)) {
             // delete;
@@ -122,8 +135,14 @@ class InterpForTest {
                 TabCol sel_col = {.tab_name = sv_sel_col->tab_name, .col_name = sv_sel_col->col_name};
                 sel_cols.push_back(sel_col);
             }
+            std::vector<OrderByCol> order_cols;
+            for (auto &sv_order : x->orders) {
+                OrderByCol order_col = {.col = {.tab_name = sv_order->col->tab_name, .col_name = sv_order->col->col_name},
+                                        .is_desc = sv_order->is_desc};
+                order_cols.push_back(order_col);
+            }
 
-            ql_manager_->select_from(sel_cols, x->tabs, conds, context);
+            ql_manager_->select_from(sel_cols, x->tabs, conds, order_cols, x->limit, context);
 
         } else {
             throw InternalError("Unexpected AST root");
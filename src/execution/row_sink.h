@@ -0,0 +1,99 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/context.h"
+#include "net/protocol.h"
+#include "record/rm_defs.h"
+#include "record_printer.h"
+#include "system/sm_meta.h"
+
+/**
+ * @brief select结果的输出方式
+ */
+class RowSink {
+   public:
+    virtual ~RowSink() = default;
+
+    virtual void send_header(const std::vector<ColMeta> &cols, const std::vector<std::string> &captions,
+                             Context *context) = 0;
+
+    virtual void send_row(const RmRecord &rec, const std::vector<ColMeta> &cols, Context *context) = 0;
+
+    virtual void send_footer(size_t num_rec, Context *context) = 0;
+};
+
+/**
+ * @brief 以文本表格输出到context->writer_
+ */
+class TextRowSink : public RowSink {
+   public:
+    void send_header(const std::vector<ColMeta> &cols, const std::vector<std::string> &captions,
+                     Context *context) override {
+        printer_ = std::make_unique<RecordPrinter>(captions.size());
+        printer_->print_separator(context);
+        printer_->print_record(captions, context);
+        printer_->print_separator(context);
+    }
+
+    void send_row(const RmRecord &rec, const std::vector<ColMeta> &cols, Context *context) override {
+        std::vector<std::string> columns;
+        for (auto &col : cols) {
+            std::string col_str;
+            char *rec_buf = rec.data + col.offset;
+            if (col.type == TYPE_INT) {
+                col_str = std::to_string(*(int *)rec_buf);
+            } else if (col.type == TYPE_FLOAT) {
+                col_str = std::to_string(*(float *)rec_buf);
+            } else if (col.type == TYPE_STRING) {
+                col_str = std::string((char *)rec_buf, col.len);
+                col_str.resize(strlen(col_str.c_str()));
+            }
+            columns.push_back(col_str);
+        }
+        printer_->print_record(columns, context);
+    }
+
+    void send_footer(size_t num_rec, Context *context) override {
+        printer_->print_separator(context);
+        RecordPrinter::print_record_count(num_rec, context);
+    }
+
+   private:
+    std::unique_ptr<RecordPrinter> printer_;
+};
+
+/**
+ * @brief 以二进制协议的ROW_DESC/DATA_ROW/COMPLETE消息输出, 记录不经过格式化直接发送
+ */
+class BinaryRowSink : public RowSink {
+   public:
+    explicit BinaryRowSink(ResultWriter *writer) : writer_(writer) {}
+
+    void send_header(const std::vector<ColMeta> &cols, const std::vector<std::string> &captions,
+                     Context *context) override {
+        protocol::MessageBuilder msg(protocol::MSG_ROW_DESC);
+        msg.put_u16(cols.size());
+        for (size_t i = 0; i < cols.size(); i++) {
+            msg.put_u8(cols[i].type).put_u32(cols[i].len).put_str(captions[i]);
+        }
+        writer_->write(msg.build());
+    }
+
+    void send_row(const RmRecord &rec, const std::vector<ColMeta> &cols, Context *context) override {
+        protocol::MessageBuilder msg(protocol::MSG_DATA_ROW);
+        msg.put(rec.data, rec.size);
+        writer_->write(msg.build());
+    }
+
+    void send_footer(size_t num_rec, Context *context) override {
+        protocol::MessageBuilder msg(protocol::MSG_COMPLETE);
+        msg.put_u64(num_rec);
+        writer_->write(msg.build());
+    }
+
+   private:
+    ResultWriter *writer_;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "common/context.h"
+
+/**
+ * @brief 快照读的扫描算子在堆文件或索引扫描结束后的补充扫描
+ * @details 堆文件和索引中只有记录的最新状态, 快照中存在但之后被删除, 或者被更新后索引键已经变化的记录扫描不到.
+ * 这些记录在版本存储中一定有旧版本: 主扫描时用visit记下访问过的rid, 主扫描结束后调用start,
+ * 再按rid顺序检查版本存储中主扫描没有访问过的记录
+ */
+class SnapshotScanTail {
+   public:
+    explicit SnapshotScanTail(int num_records_per_page) : num_records_per_page_(num_records_per_page) {}
+
+    void reset() {
+        visited_.clear();
+        rids_.clear();
+        pos_ = 0;
+        started_ = false;
+    }
+
+    void visit(const Rid &rid) {
+        size_t idx = (size_t)rid.page_no * num_records_per_page_ + rid.slot_no;
+        if (idx >= visited_.size()) {
+            visited_.resize(idx + 1);
+        }
+        visited_[idx] = true;
+    }
+
+    void start(VersionStore *version_store, int tab_id) {
+        started_ = true;
+        pos_ = 0;
+        rids_ = version_store->get_rids(tab_id);
+        rids_.erase(std::remove_if(rids_.begin(), rids_.end(),
+                                   [&](const Rid &rid) {
+                                       size_t idx = (size_t)rid.page_no * num_records_per_page_ + rid.slot_no;
+                                       return idx < visited_.size() && visited_[idx];
+                                   }),
+                    rids_.end());
+        std::sort(rids_.begin(), rids_.end(), [](const Rid &a, const Rid &b) {
+            return a.page_no != b.page_no ? a.page_no < b.page_no : a.slot_no < b.slot_no;
+        });
+    }
+
+    bool started() const { return started_; }
+
+    bool is_end() const { return pos_ >= rids_.size(); }
+
+    const Rid &rid() const { return rids_[pos_]; }
+
+    void next() { pos_++; }
+
+   private:
+    int num_records_per_page_;
+    std::vector<bool> visited_;  // 按page_no * num_records_per_page + slot_no下标
+    std::vector<Rid> rids_;
+    size_t pos_ = 0;
+    bool started_ = false;
+};
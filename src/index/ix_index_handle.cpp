@@ -1,4 +1,5 @@
 #include "ix_index_handle.h"
+#include <algorithm>
 #include <queue>
 #include "ix_scan.h"
 //#define Tree_level_lock 1
@@ -25,8 +26,10 @@ IxIndexHandle::IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffe
     : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager), fd_(fd) {
     // init file_hdr_
     disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, (char *)&file_hdr_, sizeof(file_hdr_));
-    // disk_manager管理的fd对应的文件中，设置从原来编号+1开始分配page_no
-    disk_manager_->set_fd2pageno(fd, disk_manager_->get_fd2pageno(fd) + 1);
+    // disk_manager管理的fd对应的文件中，从文件末尾开始分配page_no
+    // 删除结点不回收页面, num_pages不是已经分配的页数; 关闭时所有页面都已写回, 文件长度就是已经分配的页数
+    int file_pages = disk_manager_->GetFileSize(disk_manager_->GetFileName(fd)) / PAGE_SIZE;
+    disk_manager_->set_fd2pageno(fd, std::max(file_pages, IX_INIT_NUM_PAGES));
 }
 bool IxIndexHandle::correct_whole_tree(){
     std::queue<int> q;
@@ -23,6 +23,12 @@ class IxIndexHandle {
    public:
     IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd);
 
+    ~IxIndexHandle() {
+        for (auto &entry : lock_map) {
+            delete entry.second;
+        }
+    }
+
     // for search
     bool GetValue(const char *key, std::vector<Rid> *result, Transaction *transaction);
 
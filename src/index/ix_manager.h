@@ -112,8 +112,8 @@ class IxManager {
 
     void close_index(const IxIndexHandle *ih) {
         disk_manager_->write_page(ih->fd_, IX_FILE_HDR_PAGE, (const char *)&ih->file_hdr_, sizeof(ih->file_hdr_));
-        // 缓冲区的所有页刷到磁盘，注意这句话必须写在close_file前面
-        buffer_pool_manager_->FlushAllPages(ih->fd_);
+        // 缓冲区的所有页刷到磁盘并移出缓冲池，注意这句话必须写在close_file前面, 关闭后fd可能被其他文件重新使用
+        buffer_pool_manager_->DiscardAllPages(ih->fd_);
         disk_manager_->close_file(ih->fd_);
     }
 };
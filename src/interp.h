@@ -1,10 +1,12 @@
 #pragma once
 
-#include <map>
+#include <atomic>
+#include <chrono>
 
 #include "errors.h"
 #include "execution/execution.h"
 #include "parser/parser.h"
+#include "plan_cache.h"
 #include "system/sm.h"
 #include "common/context.h"
 #include "transaction/transaction_manager.h"
@@ -16,10 +18,14 @@ const char *help_info = "Supported SQL syntax:\n"
                    "  DROP TABLE table_name\n"
                    "  CREATE INDEX table_name (column_name)\n"
                    "  DROP INDEX table_name (column_name)\n"
-                   "  INSERT INTO table_name VALUES (value [, value ...])\n"
+                   "  ANALYZE table_name\n"
+                   "  INSERT INTO table_name VALUES (value [, value ...]) [, (value [, value ...]) ...]\n"
+                   "  LOAD DATA 'file_name' INTO table_name\n"
                    "  DELETE FROM table_name [WHERE where_clause]\n"
                    "  UPDATE table_name SET column_name = value [, column_name = value ...] [WHERE where_clause]\n"
-                   "  SELECT selector FROM table_name [WHERE where_clause]\n"
+                   "  SELECT selector FROM table_name [WHERE where_clause] [ORDER BY order_item [, order_item ...]] [LIMIT n]\n"
+                   "  BEGIN [ISOLATION LEVEL {READ UNCOMMITTED | READ COMMITTED | REPEATABLE READ | SERIALIZABLE}]\n"
+                   "  {COMMIT | ABORT | ROLLBACK}\n"
                    "type:\n"
                    "  {INT | FLOAT | CHAR(n)}\n"
                    "where_clause:\n"
@@ -31,42 +37,132 @@ const char *help_info = "Supported SQL syntax:\n"
                    "op:\n"
                    "  {= | <> | < | > | <= | >=}\n"
                    "selector:\n"
-                   "  {* | column [, column ...]}\n";
+                   "  {* | column [, column ...]}\n"
+                   "order_item:\n"
+                   "  column [ASC | DESC]\n";
 
 class Interp {
    private:
     SmManager *sm_manager_;
     QlManager *ql_manager_;
     TransactionManager *txn_mgr_;
+    PlanCache plan_cache_;
 
    public:
     Interp(SmManager *sm_manager, QlManager *ql_manager, TransactionManager *txn_mgr) 
         : sm_manager_(sm_manager), ql_manager_(ql_manager), txn_mgr_(txn_mgr) {}
 
-    void SetTransaction(txn_id_t *txn_id, Context *context) {
+    IsolationLevel to_isolation_level(ast::SvIsolationLevel level) {
+        switch (level) {
+            case ast::SV_READ_UNCOMMITTED:
+                return IsolationLevel::READ_UNCOMMITTED;
+            case ast::SV_READ_COMMITTED:
+                return IsolationLevel::READ_COMMITTED;
+            case ast::SV_REPEATABLE_READ:
+                return IsolationLevel::REPEATABLE_READ;
+            case ast::SV_SERIALIZABLE:
+                return IsolationLevel::SERIALIZABLE;
+            default:
+                return txn_mgr_->GetDefaultIsolationLevel();
+        }
+    }
+
+    // 会话的上一个事务已经结束时释放它, 事务对象留给下一个Begin复用
+    void ReleaseTransaction(txn_id_t txn_id) {
+        auto txn = txn_mgr_->GetTransaction(txn_id);
+        if (txn != nullptr &&
+            (txn->GetState() == TransactionState::COMMITTED || txn->GetState() == TransactionState::ABORTED)) {
+            txn_mgr_->Release(txn);
+        }
+    }
+
+    /**
+     * @brief 取得会话当前的事务, 没有进行中的事务时为这条语句开始一个autocommit事务
+     * @param read_only 语句是否只读, 只读语句的autocommit事务走只读事务的快速路径
+     */
+    void SetTransaction(txn_id_t *txn_id, Context *context, bool read_only = false) {
         context->txn_ = txn_mgr_->GetTransaction(*txn_id);
             if(context->txn_ == nullptr || context->txn_->GetState() == TransactionState::COMMITTED ||
                 context->txn_->GetState() == TransactionState::ABORTED) {
-                context->txn_ = txn_mgr_->Begin(nullptr, context->log_mgr_);
+                ReleaseTransaction(*txn_id);
+                context->txn_ = read_only ? txn_mgr_->BeginReadOnly(context->log_mgr_)
+                                          : txn_mgr_->Begin(nullptr, context->log_mgr_);
                 *txn_id = context->txn_->GetTransactionId();
                 context->txn_->SetTxnMode(false);
+            } else {
+                // 显式事务的下一条语句可能由另一个工作线程执行
+                context->txn_->SetThreadId(std::this_thread::get_id());
+                if (context->txn_->GetIsolationLevel() == IsolationLevel::READ_COMMITTED) {
+                    // READ_COMMITTED的每条语句使用新的快照
+                    txn_mgr_->RefreshSnapshot(context->txn_);
+                }
+            }
+    }
+
+    /**
+     * @brief 执行一条sql
+     * @details DML语句先去掉字面量, 在计划缓存中查找; 命中时直接以字面量为参数执行, 省去语法分析和计划生成.
+     *          select按字面量的值估计选择率, 值的选择率和缓存的计划相差较多时重新生成计划
+     * @return 有语法错误时返回false
+     */
+    bool interp_sql(const std::string &sql, txn_id_t *txn_id, Context *context) {
+        std::string normalized;
+        std::vector<std::shared_ptr<ast::Value>> literals;
+        if (!ast::normalize_dml(sql, &normalized, &literals)) {
+            std::shared_ptr<ast::TreeNode> root;
+            if (!ast::parse(sql, &root)) {
+                return false;
+            }
+            if (root != nullptr) {
+                interp_sql(root, txn_id, context);
+            }
+            return true;
+        }
+        std::vector<Value> params;
+        params.reserve(literals.size());
+        for (auto &literal : literals) {
+            params.push_back(interp_sv_value(literal));
+        }
+        uint64_t catalog_version = sm_manager_->get_catalog_version();
+        auto stmt = plan_cache_.get(normalized, catalog_version);
+        if (stmt == nullptr) {
+            auto start = std::chrono::steady_clock::now();
+            std::shared_ptr<ast::TreeNode> root;
+            if (!ast::parse(normalized, &root)) {
+                return false;
+            }
+            stmt = prepare(root);
+            if (std::dynamic_pointer_cast<ast::SelectStmt>(root)) {
+                stmt->plan = ql_manager_->plan_select(stmt->sel_cols, stmt->tab_names, stmt->conds, stmt->order_cols,
+                                                      stmt->limit, &params);
             }
+            auto plan_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+            // 多元组的insert很少以相同的元组个数重复出现, 不占用缓存
+            if (stmt->rows.size() <= 1) {
+                plan_cache_.put(normalized, stmt, catalog_version, plan_ns.count());
+            }
+        }
+        execute(*stmt, params, txn_id, context);
+        return true;
     }
 
+    PlanCache::Stats plan_cache_stats() { return plan_cache_.stats(); }
+
     void interp_sql(const std::shared_ptr<ast::TreeNode> &root, txn_id_t *txn_id, Context *context) {
         if (auto x = std::dynamic_pointer_cast<ast::Help>(root)) {
             // help;
-            memcpy(context->data_send_ + *(context->offset_), help_info, strlen(help_info));
-            *(context->offset_) = strlen(help_info);
+            if (context->writer_ != nullptr) {
+                context->writer_->write(help_info, strlen(help_info));
+            }
         } else if (auto x = std::dynamic_pointer_cast<ast::ShowTables>(root)) {
             // show tables;
-            SetTransaction(txn_id, context);
+            SetTransaction(txn_id, context, true);
             sm_manager_->show_tables(context);
             if(context->txn_->GetTxnMode() == false)
                 txn_mgr_->Commit(context->txn_, context->log_mgr_);
         } else if (auto x = std::dynamic_pointer_cast<ast::DescTable>(root)) {
             // desc table;
-            SetTransaction(txn_id, context);
+            SetTransaction(txn_id, context, true);
             sm_manager_->desc_table(x->tab_name, context);
             if(context->txn_->GetTxnMode() == false)
                 txn_mgr_->Commit(context->txn_, context->log_mgr_);
@@ -105,84 +201,215 @@ class Interp {
             sm_manager_->drop_index(x->tab_name, x->col_name, context);
             if(context->txn_->GetTxnMode() == false)
                 txn_mgr_->Commit(context->txn_, context->log_mgr_);
-        } else if (auto x = std::dynamic_pointer_cast<ast::InsertStmt>(root)) {
-            // insert;
-            std::vector<Value> values;
-            for (auto &sv_val : x->vals) {
-                values.push_back(interp_sv_value(sv_val));
-            }
-            SetTransaction(txn_id, context);
-            ql_manager_->insert_into(x->tab_name, values, context);
-            if(context->txn_->GetTxnMode() == false)
-                txn_mgr_->Commit(context->txn_, context->log_mgr_);
-        } else if (auto x = std::dynamic_pointer_cast<ast::DeleteStmt>(root)) {
-            // delete;
-            std::vector<Condition> conds = interp_where_clause(x->conds);
-            SetTransaction(txn_id, context);
-            ql_manager_->delete_from(x->tab_name, conds, context);
+        } else if (auto x = std::dynamic_pointer_cast<ast::AnalyzeTable>(root)) {
+            // analyze;
+            SetTransaction(txn_id, context, true);
+            sm_manager_->analyze_table(x->tab_name, context);
             if(context->txn_->GetTxnMode() == false)
                 txn_mgr_->Commit(context->txn_, context->log_mgr_);
-        } else if (auto x = std::dynamic_pointer_cast<ast::UpdateStmt>(root)) {
-            // update;
-            std::vector<Condition> conds = interp_where_clause(x->conds);
-            std::vector<SetClause> set_clauses;
-            for (auto &sv_set_clause : x->set_clauses) {
-                SetClause set_clause = {.lhs = {.tab_name = "", .col_name = sv_set_clause->col_name},
-                                        .rhs = interp_sv_value(sv_set_clause->val)};
-                set_clauses.push_back(set_clause);
-            }
+        } else if (auto x = std::dynamic_pointer_cast<ast::LoadData>(root)) {
+            // load data;
             SetTransaction(txn_id, context);
-            ql_manager_->update_set(x->tab_name, set_clauses, conds, context);
-            if(context->txn_->GetTxnMode() == false)
-                txn_mgr_->Commit(context->txn_, context->log_mgr_);
-        } else if (auto x = std::dynamic_pointer_cast<ast::SelectStmt>(root)) {
-            // select;
-            std::vector<Condition> conds = interp_where_clause(x->conds);
-            std::vector<TabCol> sel_cols;
-            for (auto &sv_sel_col : x->cols) {
-                TabCol sel_col = {.tab_name = sv_sel_col->tab_name, .col_name = sv_sel_col->col_name};
-                sel_cols.push_back(sel_col);
+            size_t num_loaded = ql_manager_->load_data(x->file_name, x->tab_name, context);
+            if (context->writer_ != nullptr) {
+                context->writer_->write("Loaded " + std::to_string(num_loaded) + " record(s)\n");
             }
-            SetTransaction(txn_id, context);
-            ql_manager_->select_from(sel_cols, x->tabs, conds, context);
             if(context->txn_->GetTxnMode() == false)
                 txn_mgr_->Commit(context->txn_, context->log_mgr_);
+        } else if (std::dynamic_pointer_cast<ast::InsertStmt>(root) || std::dynamic_pointer_cast<ast::DeleteStmt>(root) ||
+                   std::dynamic_pointer_cast<ast::UpdateStmt>(root) || std::dynamic_pointer_cast<ast::SelectStmt>(root)) {
+            // insert; delete; update; select;
+            auto stmt = prepare(root);
+            execute(*stmt, {}, txn_id, context);
         } else if (auto x = std::dynamic_pointer_cast<ast::TxnBegin>(root)) {
             // begin;
-            context->txn_ = txn_mgr_->Begin(nullptr, context->log_mgr_);
+            ReleaseTransaction(*txn_id);
+            context->txn_ = txn_mgr_->Begin(nullptr, context->log_mgr_, to_isolation_level(x->isolation_level));
 
             *txn_id = context->txn_->GetTransactionId();
             context->txn_->SetTxnMode(true);
         } else if (auto x = std::dynamic_pointer_cast<ast::TxnAbort>(root)) {
             // abort;
             context->txn_ = txn_mgr_->GetTransaction(*txn_id);
-            txn_mgr_->Abort(context->txn_, context->log_mgr_);
+            // 事务可能已经因为死锁等原因被回滚
+            if (context->txn_ != nullptr) {
+                txn_mgr_->Abort(context->txn_, context->log_mgr_);
+            }
         } else if (auto x = std::dynamic_pointer_cast<ast::TxnCommit>(root)) {
             // commit;
             context->txn_ = txn_mgr_->GetTransaction(*txn_id);
-            txn_mgr_->Commit(context->txn_, context->log_mgr_);
+            // 事务可能已经因为死锁等原因被回滚
+            if (context->txn_ != nullptr) {
+                txn_mgr_->Commit(context->txn_, context->log_mgr_);
+            }
         } else if (auto x = std::dynamic_pointer_cast<ast::TxnRollback>(root)) {
             // rollback;
             context->txn_ = txn_mgr_->GetTransaction(*txn_id);
-            txn_mgr_->Abort(context->txn_, context->log_mgr_);
+            // 事务可能已经因为死锁等原因被回滚
+            if (context->txn_ != nullptr) {
+                txn_mgr_->Abort(context->txn_, context->log_mgr_);
+            }
         } else {
             throw InternalError("Unexpected AST root");
         }
     }
 
+    /**
+     * @brief 预编译一条DML语句, 给其中的参数编号
+     */
+    std::shared_ptr<PreparedStmt> prepare(const std::shared_ptr<ast::TreeNode> &root) {
+        auto stmt = std::make_shared<PreparedStmt>();
+        stmt->root = root;
+        if (auto x = std::dynamic_pointer_cast<ast::InsertStmt>(root)) {
+            for (auto &sv_row : x->rows) {
+                for (auto &sv_val : sv_row) {
+                    number_param(sv_val, &stmt->num_params);
+                }
+            }
+            stmt->tab_name = x->tab_name;
+            for (auto &sv_row : x->rows) {
+                std::vector<Value> values;
+                for (auto &sv_val : sv_row) {
+                    values.push_back(interp_sv_value(sv_val));
+                }
+                stmt->rows.push_back(std::move(values));
+            }
+        } else if (auto x = std::dynamic_pointer_cast<ast::DeleteStmt>(root)) {
+            number_where_clause(x->conds, &stmt->num_params);
+            stmt->tab_name = x->tab_name;
+            stmt->conds = interp_where_clause(x->conds);
+        } else if (auto x = std::dynamic_pointer_cast<ast::UpdateStmt>(root)) {
+            for (auto &sv_set_clause : x->set_clauses) {
+                number_param(sv_set_clause->val, &stmt->num_params);
+            }
+            number_where_clause(x->conds, &stmt->num_params);
+            stmt->tab_name = x->tab_name;
+            for (auto &sv_set_clause : x->set_clauses) {
+                SetClause set_clause = {.lhs = {.tab_name = "", .col_name = sv_set_clause->col_name},
+                                        .rhs = interp_sv_value(sv_set_clause->val)};
+                stmt->set_clauses.push_back(set_clause);
+            }
+            stmt->conds = interp_where_clause(x->conds);
+        } else if (auto x = std::dynamic_pointer_cast<ast::SelectStmt>(root)) {
+            number_where_clause(x->conds, &stmt->num_params);
+            stmt->conds = interp_where_clause(x->conds);
+            for (auto &sv_sel_col : x->cols) {
+                TabCol sel_col = {.tab_name = sv_sel_col->tab_name, .col_name = sv_sel_col->col_name};
+                stmt->sel_cols.push_back(sel_col);
+            }
+            for (auto &sv_order : x->orders) {
+                OrderByCol order_col = {.col = {.tab_name = sv_order->col->tab_name, .col_name = sv_order->col->col_name},
+                                        .is_desc = sv_order->is_desc};
+                stmt->order_cols.push_back(order_col);
+            }
+            stmt->tab_names = x->tabs;
+            stmt->limit = x->limit;
+        } else {
+            throw StatementNotPreparableError();
+        }
+        return stmt;
+    }
+
+    /**
+     * @brief 绑定参数执行预编译的语句
+     * @param params 参数值, 个数必须和语句中的参数个数一致
+     */
+    void execute(PreparedStmt &stmt, const std::vector<Value> &params, txn_id_t *txn_id, Context *context) {
+        if (params.size() != stmt.num_params) {
+            throw InvalidParamCountError(stmt.num_params, params.size());
+        }
+        if (std::dynamic_pointer_cast<ast::InsertStmt>(stmt.root)) {
+            std::vector<std::vector<Value>> rows = stmt.rows;
+            for (auto &values : rows) {
+                for (auto &val : values) {
+                    val = bind_param(val, params);
+                }
+            }
+            SetTransaction(txn_id, context);
+            ql_manager_->insert_into(stmt.tab_name, std::move(rows), context);
+        } else if (std::dynamic_pointer_cast<ast::DeleteStmt>(stmt.root)) {
+            SetTransaction(txn_id, context);
+            ql_manager_->delete_from(stmt.tab_name, bind_where_clause(stmt.conds, params), context);
+        } else if (std::dynamic_pointer_cast<ast::UpdateStmt>(stmt.root)) {
+            std::vector<SetClause> set_clauses = stmt.set_clauses;
+            for (auto &set_clause : set_clauses) {
+                set_clause.rhs = bind_param(set_clause.rhs, params);
+            }
+            SetTransaction(txn_id, context);
+            ql_manager_->update_set(stmt.tab_name, set_clauses, bind_where_clause(stmt.conds, params), context);
+        } else {
+            // 表结构或索引变化, 或者用到的表重新收集了统计信息后, 缓存的计划可能已经失效;
+            // 参数值估计的选择率和生成计划时相差较多时, 按这次的参数值重新生成计划
+            auto plan = std::atomic_load(&stmt.plan);
+            if (plan == nullptr || !plan->is_valid(sm_manager_->get_catalog_version()) ||
+                !ql_manager_->plan_fits_params(*plan, params)) {
+                plan = ql_manager_->plan_select(stmt.sel_cols, stmt.tab_names, stmt.conds, stmt.order_cols, stmt.limit,
+                                                &params);
+                std::atomic_store(&stmt.plan, plan);
+            }
+            SetTransaction(txn_id, context, true);
+            ql_manager_->execute_select(*plan, params, context);
+        }
+        if(context->txn_->GetTxnMode() == false)
+            txn_mgr_->Commit(context->txn_, context->log_mgr_);
+    }
+
    private:
+    void number_param(const std::shared_ptr<ast::Value> &sv_val, size_t *num_params) {
+        if (auto param = std::dynamic_pointer_cast<ast::Param>(sv_val)) {
+            param->idx = (*num_params)++;
+        }
+    }
+
+    void number_where_clause(const std::vector<std::shared_ptr<ast::BinaryExpr>> &sv_conds, size_t *num_params) {
+        for (auto &expr : sv_conds) {
+            if (auto rhs_val = std::dynamic_pointer_cast<ast::Value>(expr->rhs)) {
+                number_param(rhs_val, num_params);
+            }
+        }
+    }
+
+    Value bind_param(const Value &val, const std::vector<Value> &params) {
+        return val.param_idx >= 0 ? params[val.param_idx] : val;
+    }
+
+    std::vector<Condition> bind_where_clause(std::vector<Condition> conds, const std::vector<Value> &params) {
+        for (auto &cond : conds) {
+            if (cond.is_rhs_val) {
+                cond.rhs_val = bind_param(cond.rhs_val, params);
+            }
+        }
+        return conds;
+    }
+
     ColType interp_sv_type(ast::SvType sv_type) {
-        std::map<ast::SvType, ColType> m = {
-            {ast::SV_TYPE_INT, TYPE_INT}, {ast::SV_TYPE_FLOAT, TYPE_FLOAT}, {ast::SV_TYPE_STRING, TYPE_STRING}};
-        return m.at(sv_type);
+        switch (sv_type) {
+            case ast::SV_TYPE_INT:
+                return TYPE_INT;
+            case ast::SV_TYPE_FLOAT:
+                return TYPE_FLOAT;
+            case ast::SV_TYPE_STRING:
+                return TYPE_STRING;
+        }
+        throw InternalError("Unexpected sv type");
     }
 
     CompOp interp_sv_comp_op(ast::SvCompOp op) {
-        std::map<ast::SvCompOp, CompOp> m = {
-            {ast::SV_OP_EQ, OP_EQ}, {ast::SV_OP_NE, OP_NE}, {ast::SV_OP_LT, OP_LT},
-            {ast::SV_OP_GT, OP_GT}, {ast::SV_OP_LE, OP_LE}, {ast::SV_OP_GE, OP_GE},
-        };
-        return m.at(op);
+        switch (op) {
+            case ast::SV_OP_EQ:
+                return OP_EQ;
+            case ast::SV_OP_NE:
+                return OP_NE;
+            case ast::SV_OP_LT:
+                return OP_LT;
+            case ast::SV_OP_GT:
+                return OP_GT;
+            case ast::SV_OP_LE:
+                return OP_LE;
+            case ast::SV_OP_GE:
+                return OP_GE;
+        }
+        throw InternalError("Unexpected sv comp op");
     }
 
     Value interp_sv_value(const std::shared_ptr<ast::Value> &sv_val) {
@@ -193,6 +420,10 @@ class Interp {
             val.set_float(float_lit->val);
         } else if (auto str_lit = std::dynamic_pointer_cast<ast::StringLit>(sv_val)) {
             val.set_str(str_lit->val);
+        } else if (auto param = std::dynamic_pointer_cast<ast::Param>(sv_val)) {
+            // 参数的类型在绑定时确定
+            val.type = TYPE_INT;
+            val.param_idx = param->idx;
         } else {
             throw InternalError("Unexpected sv value type");
         }
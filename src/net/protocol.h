@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/**
+ * @brief 二进制协议
+ * @details 客户端连接后先发送4字节的PROTOCOL_MAGIC, 服务端原样返回后进入二进制协议; 否则按文本协议处理
+ * (每个请求是以'\0'结尾的sql, 结果是以'\0'结尾的文本). 文本结果分块发送, 语句在一部分结果已经发出后出错时,
+ * 结果的最后一行以TEXT_RESULT_ABORTED开头, 客户端应当丢弃本次已经收到的结果.
+ * 之后双方都以消息为单位通信: [u32 长度][u8 消息类型][消息体], 长度包括消息类型和消息体, 所有整数都是小端序.
+ *
+ * 客户端消息:
+ *   QUERY    str sql                                    直接执行一条sql
+ *   PREPARE  str sql                                    预编译一条sql, 其中的值可以是参数占位符'?'
+ *   EXECUTE  u32 stmt_id, u16 参数个数, 参数...         绑定参数执行预编译的语句
+ *   CLOSE    u32 stmt_id                                释放预编译的语句
+ *   参数: u8 类型(ColType), 之后是i32 / f32 / u32长度+字节
+ *
+ * 服务端消息, 每个请求的响应都以READY结束:
+ *   ROW_DESC u16 列数, 每列: u8 类型(ColType), u32 长度, str 列名
+ *   DATA_ROW 一条记录的原始字节, 各列按ROW_DESC的顺序和长度排列
+ *   COMPLETE u64 记录数
+ *   PREPARED u32 stmt_id, u16 参数个数
+ *   TEXT     str 文本输出(如help, show tables)
+ *   ERROR    str 错误信息, 本次请求的结果还没有发出任何消息
+ *   ABORTED  str 错误信息, 本次请求的一部分结果(如ROW_DESC和若干DATA_ROW)已经发出, 客户端应当丢弃它们
+ *   READY
+ * 消息体中的str均为u32长度+字节
+ * 结果攒满一块(RESULT_CHUNK_SIZE)才发送, 较小的结果在出错时整体替换为ERROR, 只有大结果可能收到ABORTED
+ */
+namespace protocol {
+
+static constexpr char PROTOCOL_MAGIC[4] = {'\xFF', 'R', 'B', 'P'};
+
+// 客户端消息类型
+static constexpr char MSG_QUERY = 'Q';
+static constexpr char MSG_PREPARE = 'P';
+static constexpr char MSG_EXECUTE = 'X';
+static constexpr char MSG_CLOSE = 'C';
+
+// 服务端消息类型
+static constexpr char MSG_ROW_DESC = 'T';
+static constexpr char MSG_DATA_ROW = 'D';
+static constexpr char MSG_COMPLETE = 'O';
+static constexpr char MSG_PREPARED = 'S';
+static constexpr char MSG_TEXT = 'M';
+static constexpr char MSG_ERROR = 'E';
+static constexpr char MSG_ABORTED = 'A';
+static constexpr char MSG_READY = 'Z';
+
+static constexpr size_t FRAME_HEADER_SIZE = sizeof(uint32_t);
+
+// 文本协议中标志结果不完整的行首
+static constexpr char TEXT_RESULT_ABORTED[] = "Result aborted: ";
+
+/**
+ * @brief 构造一条消息
+ */
+class MessageBuilder {
+   public:
+    explicit MessageBuilder(char type) : buf_(FRAME_HEADER_SIZE, '\0') { buf_.push_back(type); }
+
+    MessageBuilder &put_u8(uint8_t val) { return put(&val, sizeof(val)); }
+    MessageBuilder &put_u16(uint16_t val) { return put(&val, sizeof(val)); }
+    MessageBuilder &put_u32(uint32_t val) { return put(&val, sizeof(val)); }
+    MessageBuilder &put_u64(uint64_t val) { return put(&val, sizeof(val)); }
+    MessageBuilder &put_i32(int32_t val) { return put(&val, sizeof(val)); }
+    MessageBuilder &put_f32(float val) { return put(&val, sizeof(val)); }
+    MessageBuilder &put_str(const std::string &str) {
+        put_u32(str.size());
+        return put(str.data(), str.size());
+    }
+    MessageBuilder &put(const void *data, size_t len) {
+        buf_.append((const char *)data, len);
+        return *this;
+    }
+
+    /**
+     * @brief 填好长度后返回整条消息
+     */
+    const std::string &build() {
+        uint32_t len = buf_.size() - FRAME_HEADER_SIZE;
+        memcpy(&buf_[0], &len, sizeof(len));
+        return buf_;
+    }
+
+   private:
+    std::string buf_;
+};
+
+/**
+ * @brief 解析一条消息的消息体; 数据不足时good()返回false
+ */
+class MessageReader {
+   public:
+    MessageReader(const char *data, size_t len) : data_(data), len_(len) {}
+
+    uint8_t get_u8() { return get<uint8_t>(); }
+    uint16_t get_u16() { return get<uint16_t>(); }
+    uint32_t get_u32() { return get<uint32_t>(); }
+    uint64_t get_u64() { return get<uint64_t>(); }
+    int32_t get_i32() { return get<int32_t>(); }
+    float get_f32() { return get<float>(); }
+    std::string get_str() {
+        uint32_t len = get_u32();
+        if (!good_ || len_ - pos_ < len) {
+            good_ = false;
+            return "";
+        }
+        std::string str(data_ + pos_, len);
+        pos_ += len;
+        return str;
+    }
+
+    bool good() const { return good_; }
+
+    bool at_end() const { return pos_ == len_; }
+
+   private:
+    template <typename T>
+    T get() {
+        T val{};
+        if (!good_ || len_ - pos_ < sizeof(T)) {
+            good_ = false;
+            return val;
+        }
+        memcpy(&val, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return val;
+    }
+
+    const char *data_;
+    size_t len_;
+    size_t pos_ = 0;
+    bool good_ = true;
+};
+
+/**
+ * @brief 读取消息头中的长度, buf中至少要有FRAME_HEADER_SIZE字节
+ */
+inline uint32_t frame_body_size(const std::string &buf) {
+    uint32_t len;
+    memcpy(&len, buf.data(), sizeof(len));
+    return len;
+}
+
+/**
+ * @brief 判断buf开头是否是一条完整的消息, 是则返回消息长度(包括长度字段), 否则返回0
+ */
+inline size_t complete_frame_size(const std::string &buf) {
+    if (buf.size() < FRAME_HEADER_SIZE) {
+        return 0;
+    }
+    uint32_t len = frame_body_size(buf);
+    return buf.size() - FRAME_HEADER_SIZE >= len ? FRAME_HEADER_SIZE + len : 0;
+}
+
+}  // namespace protocol
@@ -0,0 +1,49 @@
+#include "net/protocol.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+// 构造的消息可以被完整地解析回来
+TEST(ProtocolTest, BuildAndReadMessage) {
+    std::string frame = protocol::MessageBuilder(protocol::MSG_EXECUTE)
+                            .put_u32(42)
+                            .put_u16(3)
+                            .put_u8(7)
+                            .put_i32(-5)
+                            .put_f32(2.5)
+                            .put_str("hello")
+                            .put_u64(1ULL << 40)
+                            .build();
+    ASSERT_EQ(protocol::complete_frame_size(frame), frame.size());
+    ASSERT_EQ(protocol::frame_body_size(frame), frame.size() - protocol::FRAME_HEADER_SIZE);
+    ASSERT_EQ(frame[protocol::FRAME_HEADER_SIZE], protocol::MSG_EXECUTE);
+
+    size_t body = protocol::FRAME_HEADER_SIZE + 1;
+    protocol::MessageReader reader(frame.data() + body, frame.size() - body);
+    EXPECT_EQ(reader.get_u32(), 42u);
+    EXPECT_EQ(reader.get_u16(), 3);
+    EXPECT_EQ(reader.get_u8(), 7);
+    EXPECT_EQ(reader.get_i32(), -5);
+    EXPECT_EQ(reader.get_f32(), 2.5);
+    EXPECT_EQ(reader.get_str(), "hello");
+    EXPECT_EQ(reader.get_u64(), 1ULL << 40);
+    EXPECT_TRUE(reader.good());
+    EXPECT_TRUE(reader.at_end());
+}
+
+// 不完整的消息不会被当作一条请求, 越界读取使reader失效
+TEST(ProtocolTest, IncompleteMessage) {
+    std::string frame = protocol::MessageBuilder(protocol::MSG_QUERY).put_str("select * from t;").build();
+    EXPECT_EQ(protocol::complete_frame_size(frame.substr(0, 2)), 0u);
+    EXPECT_EQ(protocol::complete_frame_size(frame.substr(0, frame.size() - 1)), 0u);
+    EXPECT_EQ(protocol::complete_frame_size(frame + "xyz"), frame.size());
+
+    // 字符串长度超出消息体
+    size_t body = protocol::FRAME_HEADER_SIZE + 1;
+    protocol::MessageReader reader(frame.data() + body, frame.size() - body - 1);
+    EXPECT_EQ(reader.get_str(), "");
+    EXPECT_FALSE(reader.good());
+    EXPECT_EQ(reader.get_u8(), 0);
+    EXPECT_FALSE(reader.good());
+}
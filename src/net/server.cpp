@@ -0,0 +1,290 @@
+#include "net/server.h"
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+
+#include "errors.h"
+#include "net/protocol.h"
+
+static constexpr int MAX_EVENTS = 256;       // 每次epoll_wait最多返回的事件数
+static constexpr size_t RECV_BUFFER_SIZE = 8192;
+
+Server::Server(int port, RequestHandler handler, size_t num_workers, size_t max_connections,
+               size_t max_blocked_workers)
+    : handler_(std::move(handler)), max_connections_(max_connections), pool_(num_workers, max_blocked_workers) {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);  // ipv4,TCP
+    if (listen_fd_ == -1) {
+        throw UnixError();
+    }
+    int val = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val));
+
+    struct sockaddr_in s_addr_in {};
+    s_addr_in.sin_family = AF_INET;
+    s_addr_in.sin_addr.s_addr = htonl(INADDR_ANY);
+    s_addr_in.sin_port = htons(port);
+    if (bind(listen_fd_, (struct sockaddr *)(&s_addr_in), sizeof(s_addr_in)) == -1 ||
+        listen(listen_fd_, SOMAXCONN) == -1) {
+        close(listen_fd_);
+        throw UnixError();
+    }
+
+    spare_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ == -1 || event_fd_ == -1) {
+        throw UnixError();
+    }
+    struct epoll_event ev {};
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev);
+    ev.data.fd = event_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &ev);
+}
+
+Server::~Server() {
+    pool_.shutdown();
+    for (auto &entry : conns_) {
+        close(entry.first);
+    }
+    conns_.clear();
+    close(event_fd_);
+    close(epoll_fd_);
+    close(listen_fd_);
+    if (spare_fd_ != -1) {
+        close(spare_fd_);
+    }
+}
+
+void Server::run() {
+    struct epoll_event events[MAX_EVENTS];
+    while (true) {
+        int n = epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw UnixError();
+        }
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == event_fd_) {
+                return;
+            } else if (fd == listen_fd_) {
+                accept_connections();
+            } else {
+                on_readable(fd);
+            }
+        }
+    }
+}
+
+void Server::stop() {
+    uint64_t one = 1;
+    // eventfd的write是async-signal-safe的
+    ssize_t ret = write(event_fd_, &one, sizeof(one));
+    (void)ret;
+}
+
+size_t Server::num_connections() {
+    std::lock_guard<std::mutex> lock(latch_);
+    return conns_.size();
+}
+
+void Server::accept_connections() {
+    while (true) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if ((errno == EMFILE || errno == ENFILE) && reject_connection()) {
+                continue;
+            }
+            // EAGAIN: 已经没有待accept的连接; 其他错误等下次事件再试
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cout << "Accept error: " << strerror(errno) << std::endl;
+            }
+            return;
+        }
+        // 连接上的读写使用阻塞方式: 事件循环只在可读时读取, 工作线程发送结果时由socket提供背压
+        int val = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(val));
+
+        std::lock_guard<std::mutex> lock(latch_);
+        if (conns_.size() >= max_connections_) {
+            static const char msg[] = "Error: Too many connections\n";
+            send(fd, msg, sizeof(msg), MSG_NOSIGNAL | MSG_DONTWAIT);  // 包括结尾的'\0'
+            close(fd);
+            continue;
+        }
+        auto conn = std::make_unique<Connection>(fd);
+        struct epoll_event ev {};
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            close(fd);
+            continue;
+        }
+        conns_[fd] = std::move(conn);
+    }
+}
+
+/**
+ * @brief fd耗尽时拒绝一个等待accept的连接
+ * @details 连接留在队列中时监听fd一直可读, 事件循环会不停地重试accept. 先关闭预留的fd腾出位置,
+ * accept后立即关闭这个连接, 再重新预留
+ * @return 是否拒绝了一个连接, 返回false时没有预留的fd
+ */
+bool Server::reject_connection() {
+    if (spare_fd_ == -1) {
+        return false;
+    }
+    close(spare_fd_);
+    int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd != -1) {
+        static const char msg[] = "Error: Too many open files\n";
+        send(fd, msg, sizeof(msg), MSG_NOSIGNAL | MSG_DONTWAIT);  // 包括结尾的'\0'
+        close(fd);
+    }
+    spare_fd_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    std::cout << "Rejected a connection: too many open files" << std::endl;
+    return fd != -1;
+}
+
+void Server::on_readable(int fd) {
+    Connection *conn;
+    {
+        std::lock_guard<std::mutex> lock(latch_);
+        auto it = conns_.find(fd);
+        if (it == conns_.end()) {
+            return;
+        }
+        conn = it->second.get();
+    }
+    // EPOLLONESHOT保证在重新注册之前只有当前线程访问conn
+    char buf[RECV_BUFFER_SIZE];
+    ssize_t len = read(fd, buf, sizeof(buf));
+    if (len <= 0) {
+        if (len == -1 && errno == EINTR) {
+            rearm(conn);
+        } else {
+            close_connection(fd);
+        }
+        return;
+    }
+    conn->recv_buf_.append(buf, len);
+    if (conn->protocol_ == Connection::Protocol::UNKNOWN && !detect_protocol(conn)) {
+        return;
+    }
+    bool has_request;
+    size_t request_size;
+    if (conn->is_binary()) {
+        size_t frame_size = protocol::complete_frame_size(conn->recv_buf_);
+        has_request = frame_size != 0;
+        request_size = conn->recv_buf_.size() < protocol::FRAME_HEADER_SIZE
+                           ? 0
+                           : protocol::frame_body_size(conn->recv_buf_);
+    } else {
+        has_request = conn->recv_buf_.find('\0') != std::string::npos;
+        request_size = conn->recv_buf_.size();
+    }
+    if (has_request) {
+        pool_.submit([this, conn] { process(conn); });
+    } else if (request_size > MAX_REQUEST_SIZE) {
+        std::cout << "Request from client " << fd << " is too large" << std::endl;
+        close_connection(fd);
+    } else {
+        rearm(conn);
+    }
+}
+
+/**
+ * @brief 根据连接上的第一个字节判断协议, 二进制协议需要先完成握手
+ * @return 是否已经确定了协议; 返回false时连接已经被重新注册或关闭
+ */
+bool Server::detect_protocol(Connection *conn) {
+    auto &buf = conn->recv_buf_;
+    if (buf[0] != protocol::PROTOCOL_MAGIC[0]) {
+        conn->protocol_ = Connection::Protocol::TEXT;
+        return true;
+    }
+    if (buf.size() < sizeof(protocol::PROTOCOL_MAGIC)) {
+        rearm(conn);
+        return false;
+    }
+    if (memcmp(buf.data(), protocol::PROTOCOL_MAGIC, sizeof(protocol::PROTOCOL_MAGIC)) != 0 ||
+        send(conn->fd(), protocol::PROTOCOL_MAGIC, sizeof(protocol::PROTOCOL_MAGIC), MSG_NOSIGNAL) == -1) {
+        close_connection(conn->fd());
+        return false;
+    }
+    conn->protocol_ = Connection::Protocol::BINARY;
+    buf.erase(0, sizeof(protocol::PROTOCOL_MAGIC));
+    return true;
+}
+
+/**
+ * @brief 从接收缓冲区中取出一个完整的请求
+ */
+bool Server::next_request(Connection *conn, std::string *request) {
+    auto &buf = conn->recv_buf_;
+    if (conn->is_binary()) {
+        size_t frame_size = protocol::complete_frame_size(buf);
+        if (frame_size == 0) {
+            return false;
+        }
+        request->assign(buf, protocol::FRAME_HEADER_SIZE, frame_size - protocol::FRAME_HEADER_SIZE);
+        buf.erase(0, frame_size);
+        return true;
+    }
+    size_t end = buf.find('\0');
+    if (end == std::string::npos) {
+        return false;
+    }
+    request->assign(buf, 0, end);
+    buf.erase(0, end + 1);
+    return true;
+}
+
+void Server::process(Connection *conn) {
+    // 依次执行已收到的所有完整请求
+    std::string request;
+    while (next_request(conn, &request)) {
+        if (!conn->is_binary() && request == "exit") {
+            std::cout << "Client exit." << std::endl;
+            close_connection(conn->fd());
+            return;
+        }
+        if (!handler_(conn, request)) {
+            close_connection(conn->fd());
+            return;
+        }
+    }
+    rearm(conn);
+}
+
+void Server::rearm(Connection *conn) {
+    struct epoll_event ev {};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.fd = conn->fd();
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn->fd(), &ev) == -1) {
+        close_connection(conn->fd());
+    }
+}
+
+void Server::close_connection(int fd) {
+    // 持有latch_直到close, 避免fd被新连接复用时和旧连接混淆
+    std::lock_guard<std::mutex> lock(latch_);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    conns_.erase(fd);
+    close(fd);
+}
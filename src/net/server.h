@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "common/config.h"
+#include "common/result_writer.h"
+#include "common/thread_pool.h"
+
+/**
+ * @brief 一个客户端连接
+ * @details 同一连接同一时刻最多只有一个请求在执行, 请求按到达顺序依次执行
+ */
+class Connection {
+   public:
+    explicit Connection(int fd) : fd_(fd), writer_(fd) {}
+
+    int fd() const { return fd_; }
+
+    ResultWriter &writer() { return writer_; }
+
+    // 是否使用二进制协议(见net/protocol.h)
+    bool is_binary() const { return protocol_ == Protocol::BINARY; }
+
+    /**
+     * @brief 上层在连接上保存的状态, 如预编译的语句
+     */
+    struct State {
+        virtual ~State() = default;
+    };
+
+    txn_id_t txn_id_ = INVALID_TXN_ID;  // 该连接最近一个事务的id
+    std::unique_ptr<State> state_;
+
+   private:
+    friend class Server;
+
+    enum class Protocol { UNKNOWN, TEXT, BINARY };
+
+    int fd_;
+    ResultWriter writer_;
+    Protocol protocol_ = Protocol::UNKNOWN;  // 由连接上收到的第一个字节决定
+    std::string recv_buf_;  // 已收到但还没有执行的数据
+};
+
+/**
+ * @brief 处理一个请求, 结果通过conn->writer()发送; 返回false时关闭连接
+ * @details 文本协议的请求是去掉结尾'\0'的sql, 二进制协议的请求是去掉长度字段的一条消息
+ */
+using RequestHandler = std::function<bool(Connection *conn, const std::string &request)>;
+
+/**
+ * @brief 基于epoll的服务端网络前端
+ * @details 事件循环线程负责accept和读取请求, 收到完整请求后交给固定大小的线程池执行.
+ * 连接注册为EPOLLONESHOT: 请求执行期间不再监听该连接, 执行完后重新注册
+ */
+class Server {
+   public:
+    /**
+     * @param port 监听端口
+     * @param handler 请求处理函数
+     * @param num_workers 工作线程数, 为0时取CPU核数
+     * @param max_connections 最大连接数, 超出时新连接收到错误信息后被关闭
+     * @param max_blocked_workers 工作线程等待锁时最多临时增加的线程数, 见ThreadPool
+     */
+    Server(int port, RequestHandler handler, size_t num_workers = 0, size_t max_connections = MAX_CONNECTIONS,
+           size_t max_blocked_workers = MAX_BLOCKED_WORKERS);
+
+    ~Server();
+
+    /**
+     * @brief 运行事件循环, 直到stop()被调用
+     */
+    void run();
+
+    /**
+     * @brief 通知事件循环退出, 可以在信号处理函数中调用
+     */
+    void stop();
+
+    size_t num_connections();
+
+   private:
+    void accept_connections();
+
+    bool reject_connection();
+
+    void on_readable(int fd);
+
+    bool detect_protocol(Connection *conn);
+
+    bool next_request(Connection *conn, std::string *request);
+
+    void process(Connection *conn);
+
+    void rearm(Connection *conn);
+
+    void close_connection(int fd);
+
+    int listen_fd_;
+    int epoll_fd_;
+    int event_fd_;  // 用于唤醒事件循环
+    int spare_fd_;  // 预留的fd, fd耗尽时关闭它来accept并拒绝新连接
+    RequestHandler handler_;
+    size_t max_connections_;
+    ThreadPool pool_;
+
+    std::mutex latch_;  // 保护conns_
+    std::unordered_map<int, std::unique_ptr<Connection>> conns_;
+};
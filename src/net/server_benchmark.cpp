@@ -0,0 +1,144 @@
+/**
+ * @brief 服务端压测工具: 分别用10, 100, 1000个连接并发发送请求, 统计QPS和延迟
+ * @details 用法: server_benchmark [host port [sql]]
+ * 不指定host和port时在进程内启动一个Server, 请求处理函数返回一个固定的小结果集, 只测网络前端和线程池的开销;
+ * 指定时压测已经运行的rucbase服务端
+ */
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "net/server.h"
+
+static constexpr int BENCHMARK_PORT = 8766;
+static constexpr int BENCHMARK_SECONDS = 3;
+
+static int connect_server(const char *host, int port) {
+    struct hostent *server_host = gethostbyname(host);
+    if (server_host == nullptr) {
+        return -1;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr = *((struct in_addr *)server_host->h_addr);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        close(fd);
+        return -1;
+    }
+    int val = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &val, sizeof(val));
+    return fd;
+}
+
+// 发送一个请求并读完以'\0'结尾的结果
+static bool round_trip(int fd, const std::string &sql) {
+    if (send(fd, sql.c_str(), sql.size() + 1, MSG_NOSIGNAL) != (ssize_t)sql.size() + 1) {
+        return false;
+    }
+    char buf[8192];
+    while (true) {
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        if (len <= 0) {
+            return false;
+        }
+        if (memchr(buf, '\0', len) != nullptr) {
+            return true;
+        }
+    }
+}
+
+static void run_benchmark(const char *host, int port, const std::string &sql, int num_conns) {
+    std::atomic<bool> stop{false};
+    std::atomic<int> failed{0};
+    std::vector<std::vector<int64_t>> latencies(num_conns);  // 每个连接各自记录延迟(us)
+    std::vector<std::thread> clients;
+    for (int i = 0; i < num_conns; i++) {
+        clients.emplace_back([&, i] {
+            int fd = connect_server(host, port);
+            if (fd == -1) {
+                failed++;
+                return;
+            }
+            while (!stop) {
+                auto start = std::chrono::steady_clock::now();
+                if (!round_trip(fd, sql)) {
+                    failed++;
+                    break;
+                }
+                auto end = std::chrono::steady_clock::now();
+                latencies[i].push_back(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+            }
+            close(fd);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(BENCHMARK_SECONDS));
+    stop = true;
+    for (auto &client : clients) {
+        client.join();
+    }
+
+    std::vector<int64_t> all;
+    for (auto &lat : latencies) {
+        all.insert(all.end(), lat.begin(), lat.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all.empty() ? 0 : all[std::min(all.size() - 1, (size_t)(p * all.size()))]; };
+    std::cout << "connections: " << num_conns << "\trequests: " << all.size()
+              << "\tQPS: " << all.size() / BENCHMARK_SECONDS << "\tp50: " << percentile(0.5)
+              << " us\tp99: " << percentile(0.99) << " us\tfailed: " << failed << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    // 1000个连接在进程内需要2000多个fd
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    const char *host = "127.0.0.1";
+    int port = BENCHMARK_PORT;
+    std::string sql = "select * from t;";
+    std::unique_ptr<Server> server;
+    std::thread server_thread;
+    if (argc >= 3) {
+        host = argv[1];
+        port = atoi(argv[2]);
+        if (argc >= 4) {
+            sql = argv[3];
+        }
+    } else {
+        server = std::make_unique<Server>(port, [](Connection *conn, const std::string &request) {
+            static const std::string result =
+                "+------------------+\n|               id |\n+------------------+\n|                1 |\n"
+                "+------------------+\nTotal record(s): 1\n";
+            conn->writer().write(result);
+            conn->writer().finish();
+            return true;
+        });
+        server_thread = std::thread([&] { server->run(); });
+    }
+
+    for (int num_conns : {10, 100, 1000}) {
+        run_benchmark(host, port, sql, num_conns);
+    }
+
+    if (server != nullptr) {
+        server->stop();
+        server_thread.join();
+    }
+    return 0;
+}
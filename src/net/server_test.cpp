@@ -0,0 +1,290 @@
+#include "net/server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "interp.h"
+
+const std::string TEST_DB_NAME = "ServerTestDB";
+static constexpr int TEST_PORT = 18765;
+
+/**
+ * @brief 在真实的服务端上通过文本协议执行sql, 请求由大小为1的线程池执行
+ */
+class ServerTest : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+    std::unique_ptr<QlManager> ql_manager_;
+    std::unique_ptr<LogManager> log_manager_;
+    std::unique_ptr<LockManager> lock_manager_;
+    std::unique_ptr<TransactionManager> txn_manager_;
+    std::unique_ptr<Interp> interp_;
+    std::unique_ptr<Server> server_;
+    std::thread event_loop_;
+
+    void SetUp() override {
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+        ql_manager_ = std::make_unique<QlManager>(sm_manager_.get());
+        log_manager_ = std::make_unique<LogManager>(disk_manager_.get());
+        log_manager_->SetLogMode(false);
+        lock_manager_ = std::make_unique<LockManager>();
+        txn_manager_ = std::make_unique<TransactionManager>(lock_manager_.get(), sm_manager_.get());
+        interp_ = std::make_unique<Interp>(sm_manager_.get(), ql_manager_.get(), txn_manager_.get());
+        if (sm_manager_->is_dir(TEST_DB_NAME)) {
+            sm_manager_->drop_db(TEST_DB_NAME);
+        }
+        sm_manager_->create_db(TEST_DB_NAME);
+        sm_manager_->open_db(TEST_DB_NAME);
+
+        start_server(MAX_BLOCKED_WORKERS);
+    }
+
+    // 启动大小为1的线程池的服务端, 等待锁时最多临时增加max_blocked_workers个线程
+    void start_server(size_t max_blocked_workers) {
+        auto handler = [this](Connection *conn, const std::string &request) {
+            Context context(lock_manager_.get(), log_manager_.get(), nullptr, &conn->writer());
+            try {
+                interp_->interp_sql(request, &conn->txn_id_, &context);
+            } catch (TransactionAbortException &e) {
+                conn->writer().discard();
+                conn->writer().write(e.GetInfo());
+                txn_manager_->Abort(context.txn_, log_manager_.get());
+            }
+            conn->writer().finish();
+            return true;
+        };
+        server_ = std::make_unique<Server>(TEST_PORT, handler, 1, MAX_CONNECTIONS, max_blocked_workers);
+        event_loop_ = std::thread([this] { server_->run(); });
+    }
+
+    void stop_server() {
+        server_->stop();
+        event_loop_.join();
+        server_.reset();
+    }
+
+    void TearDown() override {
+        stop_server();
+        sm_manager_->close_db();
+        sm_manager_->drop_db(TEST_DB_NAME);
+    }
+
+    // 连接服务端, 接收超时为timeout_sec秒; fd不为-1时使用已经创建的socket
+    static int connect_server(int timeout_sec, int fd = -1) {
+        if (fd == -1) {
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+        }
+        struct sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(TEST_PORT);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        EXPECT_EQ(connect(fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+        struct timeval tv {};
+        tv.tv_sec = timeout_sec;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        return fd;
+    }
+
+    static void send_sql(int fd, const std::string &sql) {
+        ASSERT_EQ(send(fd, sql.c_str(), sql.size() + 1, MSG_NOSIGNAL), (ssize_t)sql.size() + 1);
+    }
+
+    // 读取一次请求的结果, 直到'\0'; 超时返回"<timeout>"
+    static std::string recv_result(int fd) {
+        std::string res;
+        char buf[1024];
+        while (true) {
+            ssize_t len = recv(fd, buf, sizeof(buf), 0);
+            if (len <= 0) {
+                return "<timeout>";
+            }
+            char *end = (char *)memchr(buf, '\0', len);
+            res.append(buf, end == nullptr ? len : end - buf);
+            if (end != nullptr) {
+                return res;
+            }
+        }
+    }
+
+    static std::string exec(int fd, const std::string &sql) {
+        send_sql(fd, sql);
+        return recv_result(fd);
+    }
+
+    static size_t num_threads() {
+        size_t num = 0;
+        for (auto &entry : std::filesystem::directory_iterator("/proc/self/task")) {
+            (void)entry;
+            num++;
+        }
+        return num;
+    }
+};
+
+// 两个连接争用同一行, 等待锁的请求不能占住唯一的工作线程, 持有锁的事务仍然可以提交
+TEST_F(ServerTest, LockWaitDoesNotBlockPool) {
+    int a = connect_server(10);
+    int b = connect_server(10);
+    exec(a, "create table t (id int, val int);");
+    exec(a, "insert into t values (1, 0);");
+
+    exec(a, "begin;");
+    exec(a, "update t set val = 1 where id = 1;");
+    // b的请求等待a的行锁
+    send_sql(b, "update t set val = 2 where id = 1;");
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // 新连接和a的COMMIT仍然能被执行
+    int c = connect_server(10);
+    EXPECT_NE(exec(c, "show tables;"), "<timeout>");
+    EXPECT_EQ(exec(a, "commit;"), "");
+    // a提交后b获得锁并完成更新
+    EXPECT_EQ(recv_result(b), "");
+    std::string res = exec(c, "select val from t;");
+    EXPECT_NE(res.find(" 2 |"), std::string::npos) << res;
+
+    close(a);
+    close(b);
+    close(c);
+}
+
+// 持有锁的事务一直不提交时, 等待者超时后被abort, 服务端可以正常关闭
+TEST_F(ServerTest, LockWaitTimeout) {
+    auto saved_timeout = lock_wait_timeout;
+    lock_wait_timeout = std::chrono::milliseconds(500);
+    int a = connect_server(10);
+    int b = connect_server(10);
+    exec(a, "create table t (id int, val int);");
+    exec(a, "insert into t values (1, 0);");
+
+    exec(a, "begin;");
+    exec(a, "update t set val = 1 where id = 1;");
+    std::string res = exec(b, "update t set val = 2 where id = 1;");
+    EXPECT_NE(res.find("waited too long for a lock"), std::string::npos) << res;
+    EXPECT_EQ(exec(a, "commit;"), "");
+
+    close(a);
+    close(b);
+    lock_wait_timeout = saved_timeout;
+}
+
+// 文本协议的select按字面量的值选择扫描方式: 键逆序插入, 顺序扫描按插入顺序输出, 索引扫描按键的顺序输出
+TEST_F(ServerTest, AnalyzeChangesAccessPathOfLiteral) {
+    int a = connect_server(10);
+    exec(a, "create table t (id int, val int);");
+    exec(a, "create index t (id);");
+    std::string insert = "insert into t values ";
+    for (int id = 100; id >= 1; id--) {
+        insert += "(" + std::to_string(id) + ", 0)" + (id > 1 ? ", " : ";");
+    }
+    EXPECT_EQ(exec(a, insert), "");
+    auto row = [](int id) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "| %16d |", id);
+        return std::string(buf);
+    };
+
+    // 没有统计信息时总是使用索引
+    std::string res = exec(a, "select id from t where id >= 1;");
+    EXPECT_LT(res.find(row(1)), res.find(row(100))) << res;
+    // 统计信息表明条件选中所有记录, 改为顺序扫描
+    EXPECT_NE(exec(a, "analyze t;"), "<timeout>");
+    res = exec(a, "select id from t where id >= 1;");
+    EXPECT_LT(res.find(row(100)), res.find(row(1))) << res;
+    // 同一语句换成选择率低的字面量, 不沿用缓存中顺序扫描的计划
+    res = exec(a, "select id from t where id >= 96;");
+    EXPECT_LT(res.find(row(96)), res.find(row(100))) << res;
+    EXPECT_EQ(res.find(row(95)), std::string::npos) << res;
+
+    close(a);
+}
+
+// 等待锁的请求临时增加的线程数有上限, 达到上限后请求排队, 等待超时的请求被abort后排队的请求继续执行
+TEST_F(ServerTest, BlockedWorkersAreCapped) {
+    stop_server();
+    start_server(1);
+    auto saved_timeout = lock_wait_timeout;
+    lock_wait_timeout = std::chrono::milliseconds(500);
+    int a = connect_server(10);
+    exec(a, "create table t (id int, val int);");
+    exec(a, "insert into t values (1, 0);");
+    exec(a, "begin;");
+    exec(a, "update t set val = 1 where id = 1;");
+    size_t threads_before = num_threads();
+
+    // 三个请求等待a的行锁, 只有第一个能让线程池增加线程
+    int waiters[3];
+    for (int &fd : waiters) {
+        fd = connect_server(10);
+        send_sql(fd, "update t set val = 2 where id = 1;");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_EQ(num_threads(), threads_before + 1);
+
+    for (int fd : waiters) {
+        std::string res = recv_result(fd);
+        EXPECT_NE(res.find("waited too long for a lock"), std::string::npos) << res;
+    }
+    EXPECT_EQ(exec(a, "commit;"), "");
+
+    close(a);
+    for (int fd : waiters) {
+        close(fd);
+    }
+    lock_wait_timeout = saved_timeout;
+}
+
+// 进程的fd耗尽时新连接被拒绝, 事件循环不会因为监听fd一直可读而空转
+TEST_F(ServerTest, RejectConnectionWhenOutOfFds) {
+    // 先创建好客户端的socket, fd耗尽后只有服务端的accept失败
+    int clients[4];
+    for (int &fd : clients) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+    }
+    struct rlimit saved_limit;
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &saved_limit), 0);
+    struct rlimit limit = saved_limit;
+    limit.rlim_cur = clients[3] + 1;
+    ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &limit), 0);
+
+    struct rusage usage_before;
+    getrusage(RUSAGE_SELF, &usage_before);
+    for (int fd : clients) {
+        connect_server(10, fd);
+        EXPECT_EQ(recv_result(fd), "Error: Too many open files\n");
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    struct rusage usage_after;
+    getrusage(RUSAGE_SELF, &usage_after);
+    auto cpu_us = [](const struct rusage &usage) {
+        return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000L + usage.ru_utime.tv_usec +
+               usage.ru_stime.tv_usec;
+    };
+    EXPECT_LT(cpu_us(usage_after) - cpu_us(usage_before), 200000L);
+
+    for (int fd : clients) {
+        close(fd);
+    }
+    ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &saved_limit), 0);
+    int fd = connect_server(10);
+    EXPECT_EQ(exec(fd, "create table t (id int);"), "");
+    close(fd);
+}
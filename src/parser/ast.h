@@ -14,6 +14,10 @@ enum SvCompOp {
     SV_OP_EQ, SV_OP_NE, SV_OP_LT, SV_OP_GT, SV_OP_LE, SV_OP_GE
 };
 
+enum SvIsolationLevel {
+    SV_ISOLATION_DEFAULT, SV_READ_UNCOMMITTED, SV_READ_COMMITTED, SV_REPEATABLE_READ, SV_SERIALIZABLE
+};
+
 // Base class for tree nodes
 struct TreeNode {
     virtual ~TreeNode() = default;  // enable polymorphism
@@ -26,6 +30,9 @@ struct ShowTables : public TreeNode {
 };
 
 struct TxnBegin : public TreeNode {
+    SvIsolationLevel isolation_level;  // 没有指定时为SV_ISOLATION_DEFAULT
+
+    TxnBegin(SvIsolationLevel isolation_level_ = SV_ISOLATION_DEFAULT) : isolation_level(isolation_level_) {}
 };
 
 struct TxnCommit : public TreeNode {
@@ -91,6 +98,12 @@ struct DropIndex : public TreeNode {
             tab_name(std::move(tab_name_)), col_name(std::move(col_name_)) {}
 };
 
+struct AnalyzeTable : public TreeNode {
+    std::string tab_name;
+
+    AnalyzeTable(std::string tab_name_) : tab_name(std::move(tab_name_)) {}
+};
+
 struct Expr : public TreeNode {
 };
 
@@ -115,6 +128,11 @@ struct StringLit : public Value {
     StringLit(std::string val_) : val(std::move(val_)) {}
 };
 
+// Parameter placeholder `?` of a prepared statement
+struct Param : public Value {
+    int idx = -1;  // position of the parameter in the statement, numbered after parsing
+};
+
 struct Col : public Expr {
     std::string tab_name;
     std::string col_name;
@@ -140,12 +158,27 @@ struct BinaryExpr : public TreeNode {
             lhs(std::move(lhs_)), op(op_), rhs(std::move(rhs_)) {}
 };
 
+struct OrderBy : public TreeNode {
+    std::shared_ptr<Col> col;
+    bool is_desc;
+
+    OrderBy(std::shared_ptr<Col> col_, bool is_desc_) : col(std::move(col_)), is_desc(is_desc_) {}
+};
+
 struct InsertStmt : public TreeNode {
     std::string tab_name;
-    std::vector<std::shared_ptr<Value>> vals;
+    std::vector<std::vector<std::shared_ptr<Value>>> rows;  // VALUES后的每个元组
+
+    InsertStmt(std::string tab_name_, std::vector<std::vector<std::shared_ptr<Value>>> rows_) :
+            tab_name(std::move(tab_name_)), rows(std::move(rows_)) {}
+};
+
+struct LoadData : public TreeNode {
+    std::string file_name;
+    std::string tab_name;
 
-    InsertStmt(std::string tab_name_, std::vector<std::shared_ptr<Value>> vals_) :
-            tab_name(std::move(tab_name_)), vals(std::move(vals_)) {}
+    LoadData(std::string file_name_, std::string tab_name_) :
+            file_name(std::move(file_name_)), tab_name(std::move(tab_name_)) {}
 };
 
 struct DeleteStmt : public TreeNode {
@@ -171,17 +204,23 @@ struct SelectStmt : public TreeNode {
     std::vector<std::shared_ptr<Col>> cols;
     std::vector<std::string> tabs;
     std::vector<std::shared_ptr<BinaryExpr>> conds;
+    std::vector<std::shared_ptr<OrderBy>> orders;
+    int limit;  // -1 if there is no LIMIT clause
 
     SelectStmt(std::vector<std::shared_ptr<Col>> cols_,
                std::vector<std::string> tabs_,
-               std::vector<std::shared_ptr<BinaryExpr>> conds_) :
-            cols(std::move(cols_)), tabs(std::move(tabs_)), conds(std::move(conds_)) {}
+               std::vector<std::shared_ptr<BinaryExpr>> conds_,
+               std::vector<std::shared_ptr<OrderBy>> orders_ = {},
+               int limit_ = -1) :
+            cols(std::move(cols_)), tabs(std::move(tabs_)), conds(std::move(conds_)),
+            orders(std::move(orders_)), limit(limit_) {}
 };
 
 // Semantic value
 struct SemValue {
     int sv_int;
     float sv_float;
+    bool sv_bool;
     std::string sv_str;
     std::vector<std::string> sv_strs;
 
@@ -189,6 +228,8 @@ struct SemValue {
 
     SvCompOp sv_comp_op;
 
+    SvIsolationLevel sv_isolation_level;
+
     std::shared_ptr<TypeLen> sv_type_len;
 
     std::shared_ptr<Field> sv_field;
@@ -198,6 +239,7 @@ struct SemValue {
 
     std::shared_ptr<Value> sv_val;
     std::vector<std::shared_ptr<Value>> sv_vals;
+    std::vector<std::vector<std::shared_ptr<Value>>> sv_val_rows;
 
     std::shared_ptr<Col> sv_col;
     std::vector<std::shared_ptr<Col>> sv_cols;
@@ -207,9 +249,10 @@ struct SemValue {
 
     std::shared_ptr<BinaryExpr> sv_cond;
     std::vector<std::shared_ptr<BinaryExpr>> sv_conds;
-};
 
-extern std::shared_ptr<ast::TreeNode> parse_tree;
+    std::shared_ptr<OrderBy> sv_order;
+    std::vector<std::shared_ptr<OrderBy>> sv_orders;
+};
 
 }
 
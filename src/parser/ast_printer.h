@@ -88,6 +88,9 @@ private:
             std::cout << "DROP_INDEX\n";
             print_val(x->tab_name, offset);
             print_val(x->col_name, offset);
+        } else if (auto x = std::dynamic_pointer_cast<AnalyzeTable>(node)) {
+            std::cout << "ANALYZE\n";
+            print_val(x->tab_name, offset);
         } else if (auto x = std::dynamic_pointer_cast<ColDef>(node)) {
             std::cout << "COL_DEF\n";
             print_val(x->col_name, offset);
@@ -109,6 +112,9 @@ private:
         } else if (auto x = std::dynamic_pointer_cast<StringLit>(node)) {
             std::cout << "STRING_LIT\n";
             print_val(x->val, offset);
+        } else if (auto x = std::dynamic_pointer_cast<Param>(node)) {
+            std::cout << "PARAM\n";
+            print_val(x->idx, offset);
         } else if (auto x = std::dynamic_pointer_cast<SetClause>(node)) {
             std::cout << "SET_CLAUSE\n";
             print_val(x->col_name, offset);
@@ -118,10 +124,20 @@ private:
             print_node(x->lhs, offset);
             print_val(op2str(x->op), offset);
             print_node(x->rhs, offset);
+        } else if (auto x = std::dynamic_pointer_cast<OrderBy>(node)) {
+            std::cout << "ORDER_BY\n";
+            print_node(x->col, offset);
+            print_val(x->is_desc ? "DESC" : "ASC", offset);
         } else if (auto x = std::dynamic_pointer_cast<InsertStmt>(node)) {
             std::cout << "INSERT\n";
             print_val(x->tab_name, offset);
-            print_node_list(x->vals, offset);
+            for (auto &row : x->rows) {
+                print_node_list(row, offset);
+            }
+        } else if (auto x = std::dynamic_pointer_cast<LoadData>(node)) {
+            std::cout << "LOAD_DATA\n";
+            print_val(x->file_name, offset);
+            print_val(x->tab_name, offset);
         } else if (auto x = std::dynamic_pointer_cast<DeleteStmt>(node)) {
             std::cout << "DELETE\n";
             print_val(x->tab_name, offset);
@@ -136,8 +152,11 @@ private:
             print_node_list(x->cols, offset);
             print_val_list(x->tabs, offset);
             print_node_list(x->conds, offset);
+            print_node_list(x->orders, offset);
+            print_val(x->limit, offset);
         } else if (auto x = std::dynamic_pointer_cast<TxnBegin>(node)) {
             std::cout << "BEGIN\n";
+            print_val(x->isolation_level, offset);
         } else if (auto x = std::dynamic_pointer_cast<TxnCommit>(node)) {
             std::cout << "COMMIT\n";
         } else if (auto x = std::dynamic_pointer_cast<TxnAbort>(node)) {
@@ -0,0 +1,156 @@
+#include "lexer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <unordered_map>
+
+namespace ast {
+
+// 关键字, 使用大写匹配
+static const std::unordered_map<std::string, int> keywords = {
+    {"SHOW", SHOW},     {"BEGIN", TXN_BEGIN}, {"COMMIT", TXN_COMMIT}, {"ABORT", TXN_ABORT}, {"ROLLBACK", TXN_ROLLBACK},
+    {"TABLES", TABLES}, {"CREATE", CREATE},   {"TABLE", TABLE},       {"DROP", DROP},       {"DESC", DESC},
+    {"INSERT", INSERT}, {"INTO", INTO},       {"VALUES", VALUES},     {"DELETE", DELETE},   {"FROM", FROM},
+    {"WHERE", WHERE},   {"UPDATE", UPDATE},   {"SET", SET},           {"SELECT", SELECT},   {"INT", INT},
+    {"CHAR", CHAR},     {"FLOAT", FLOAT},     {"INDEX", INDEX},       {"AND", AND},         {"JOIN", JOIN},
+    {"EXIT", EXIT},     {"HELP", HELP},       {"ORDER", ORDER},       {"BY", BY},           {"ASC", ASC},
+    {"LIMIT", LIMIT},   {"LOAD", LOAD},       {"DATA", DATA},         {"ISOLATION", ISOLATION},
+    {"LEVEL", LEVEL},   {"READ", READ},       {"COMMITTED", COMMITTED}, {"UNCOMMITTED", UNCOMMITTED},
+    {"REPEATABLE", REPEATABLE}, {"SERIALIZABLE", SERIALIZABLE}, {"ANALYZE", ANALYZE},
+};
+
+static bool is_alpha(char c) { return isalpha((unsigned char)c); }
+
+static bool is_digit(char c) { return isdigit((unsigned char)c); }
+
+static bool is_single_op(char c) {
+    switch (c) {
+        case ';':
+        case '(':
+        case ')':
+        case ',':
+        case '*':
+        case '=':
+        case '>':
+        case '<':
+        case '.':
+        case '?':
+            return true;
+        default:
+            return false;
+    }
+}
+
+void Lexer::advance(size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (sql_[pos_ + i] == '\n') {
+            line_++;
+            column_ = 1;
+        } else {
+            column_++;
+        }
+    }
+    pos_ += len;
+}
+
+int Lexer::next(YYSTYPE *yylval, YYLTYPE *yylloc) {
+    const size_t size = sql_.size();
+    while (pos_ < size) {
+        yylloc->first_line = line_;
+        yylloc->first_column = column_;
+        token_start_ = pos_;
+        const char *p = sql_.c_str() + pos_;
+        size_t len = 0;   // 当前token的长度
+        int token = -1;   // -1表示跳过当前的文本
+        if (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+            // white space and new line
+            len = 1;
+        } else if (p[0] == '/' && p[1] == '*') {
+            // block comment
+            size_t end = sql_.find("*/", pos_ + 2);
+            if (end == std::string::npos) {
+                // 注释没有结束: 报告错误, 之后和到达输入结尾一样处理
+                std::cerr << "Lexer Error: unterminated comment" << std::endl;
+                has_error_ = true;
+                advance(size - pos_);
+                yylloc->last_line = line_;
+                yylloc->last_column = column_;
+                return T_EOF;
+            }
+            len = end + 2 - pos_;
+        } else if (p[0] == '-' && p[1] == '-') {
+            // single line comment
+            size_t end = sql_.find('\n', pos_);
+            len = (end == std::string::npos ? size : end) - pos_;
+        } else if (is_alpha(*p)) {
+            // keyword or identifier
+            len = 1;
+            while (is_alpha(p[len]) || is_digit(p[len]) || p[len] == '_') {
+                len++;
+            }
+            std::string word(p, len);
+            std::string upper = word;
+            std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+            auto it = keywords.find(upper);
+            if (it != keywords.end()) {
+                token = it->second;
+            } else {
+                yylval->sv_str = std::move(word);
+                token = IDENTIFIER;
+            }
+        } else if (is_digit(*p) || ((*p == '+' || *p == '-') && is_digit(p[1]))) {
+            // int or float literal
+            len = 1;
+            while (is_digit(p[len])) {
+                len++;
+            }
+            if (p[len] == '.') {
+                len++;
+                while (is_digit(p[len])) {
+                    len++;
+                }
+                yylval->sv_float = atof(std::string(p, len).c_str());
+                token = VALUE_FLOAT;
+            } else {
+                yylval->sv_int = atoi(std::string(p, len).c_str());
+                token = VALUE_INT;
+            }
+        } else if (*p == '\'' && sql_.find('\'', pos_ + 1) != std::string::npos) {
+            // string literal
+            size_t end = sql_.find('\'', pos_ + 1);
+            len = end + 1 - pos_;
+            yylval->sv_str = std::string(p + 1, len - 2);
+            token = VALUE_STRING;
+        } else if (p[0] == '>' && p[1] == '=') {
+            len = 2;
+            token = GEQ;
+        } else if (p[0] == '<' && p[1] == '=') {
+            len = 2;
+            token = LEQ;
+        } else if (p[0] == '<' && p[1] == '>') {
+            len = 2;
+            token = NEQ;
+        } else if (is_single_op(*p)) {
+            len = 1;
+            token = *p;
+        } else {
+            // unexpected char
+            std::cerr << "Lexer Error: unexpected character " << *p << std::endl;
+            has_error_ = true;
+            len = 1;
+        }
+        advance(len);
+        yylloc->last_line = line_;
+        yylloc->last_column = column_;
+        if (token != -1) {
+            return token;
+        }
+    }
+    return T_EOF;
+}
+
+}  // namespace ast
+
+int yylex(YYSTYPE *yylval, YYLTYPE *yylloc, ast::Lexer *lexer) { return lexer->next(yylval, yylloc); }
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast.h"
+#include "yacc.tab.h"
+
+namespace ast {
+
+/**
+ * @brief 可重入的词法分析器
+ * @details 所有状态都保存在实例中, 每次解析使用一个独立的实例, 多个线程可以同时解析.
+ * 关键字不区分大小写, 支持块注释和单行注释
+ */
+class Lexer {
+   public:
+    explicit Lexer(const std::string &sql) : sql_(sql) {}
+
+    /**
+     * @brief 读取下一个token, 到达结尾时返回T_EOF
+     */
+    int next(YYSTYPE *yylval, YYLTYPE *yylloc);
+
+    // 最近一次读出的token的原始文本
+    std::string token_text() const { return sql_.substr(token_start_, pos_ - token_start_); }
+
+    // 是否遇到过无法识别的字符
+    bool has_error() const { return has_error_; }
+
+    /**
+     * @brief 解析栈超过YYINITDEPTH后由yyoverflow换成的更大的栈, 随这次解析的Lexer一起释放
+     */
+    struct ParserStacks {
+        std::unique_ptr<char[]> states;  // 状态栈, 元素类型yy_state_t只在yacc.tab.cpp中可见, 按字节保存
+        std::vector<YYSTYPE> values;
+        std::vector<YYLTYPE> locations;
+    };
+
+    ParserStacks &parser_stacks() { return parser_stacks_; }
+
+   private:
+    // 前进len个字符, 同时更新当前的行号和列号
+    void advance(size_t len);
+
+    const std::string &sql_;
+    size_t pos_ = 0;
+    int line_ = 1;
+    int column_ = 1;
+    size_t token_start_ = 0;
+    bool has_error_ = false;
+    ParserStacks parser_stacks_;
+};
+
+}  // namespace ast
+
+int yylex(YYSTYPE *yylval, YYLTYPE *yylloc, ast::Lexer *lexer);
@@ -0,0 +1,53 @@
+#include "parser_defs.h"
+
+#include <algorithm>
+
+#include "lexer.h"
+
+namespace ast {
+
+bool parse(const std::string &sql, std::shared_ptr<TreeNode> *tree) {
+    Lexer lexer(sql);
+    *tree = nullptr;
+    return yyparse(&lexer, tree) == 0;
+}
+
+bool normalize_dml(const std::string &sql, std::string *normalized, std::vector<std::shared_ptr<Value>> *literals) {
+    Lexer lexer(sql);
+    YYSTYPE val;
+    YYLTYPE loc = {1, 1, 1, 1};
+    normalized->clear();
+    literals->clear();
+    int prev = 0;
+    for (int token = lexer.next(&val, &loc); token != T_EOF; prev = token, token = lexer.next(&val, &loc)) {
+        if (token == 0 || lexer.has_error()) {
+            return false;
+        }
+        if (prev == 0 && token != SELECT && token != INSERT && token != DELETE && token != UPDATE) {
+            return false;
+        }
+        if (!normalized->empty()) {
+            normalized->push_back(' ');
+        }
+        if ((token == VALUE_INT && prev != LIMIT) || token == VALUE_FLOAT || token == VALUE_STRING) {
+            if (token == VALUE_INT) {
+                literals->push_back(std::make_shared<IntLit>(val.sv_int));
+            } else if (token == VALUE_FLOAT) {
+                literals->push_back(std::make_shared<FloatLit>(val.sv_float));
+            } else {
+                literals->push_back(std::make_shared<StringLit>(val.sv_str));
+            }
+            normalized->push_back('?');
+        } else {
+            std::string text = lexer.token_text();
+            if (token != IDENTIFIER) {
+                std::transform(text.begin(), text.end(), text.begin(), ::toupper);
+            }
+            normalized->append(text);
+        }
+    }
+    // 最后一个token之后的错误(如没有结束的注释)也交给完整的语法分析处理
+    return prev != 0 && !lexer.has_error();
+}
+
+}  // namespace ast
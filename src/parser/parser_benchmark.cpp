@@ -0,0 +1,78 @@
+/**
+ * @brief 语法分析吞吐量测试: 分别用1, 2, 4, ...个线程并发解析sql, 统计每秒解析的语句数
+ * @details 用法: parser_benchmark [max_threads]
+ * 每个线程数下先用一把全局锁串行解析(相当于不可重入的分析器), 再无锁并发解析, 对比两者的吞吐量
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parser.h"
+
+static constexpr int BENCHMARK_MILLISECONDS = 1000;
+
+static const std::vector<std::string> statements = {
+    "select * from t;",
+    "select id, name, score from student where id > 100 and score >= 60.5 order by score desc limit 10;",
+    "select student.name, grade.score from student, grade where student.id = grade.sid and grade.cid = 3;",
+    "insert into student values (1024, 'alice', 98.5);",
+    "update student set name = 'bob', score = 75.0 where id = 1024;",
+    "delete from grade where sid = 1024 and cid <> 7;",
+    "create table course (id int, name char(32), credit float);",
+    "/* comment */ select name from course -- trailing comment\n where credit <= 4.0;",
+};
+
+static uint64_t run_benchmark(int num_threads, bool serialized) {
+    std::mutex latch;
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> total{0};
+    std::atomic<int> failed{0};
+    std::vector<std::thread> workers;
+    for (int i = 0; i < num_threads; i++) {
+        workers.emplace_back([&, i] {
+            uint64_t count = 0;
+            size_t next = i;
+            while (!stop) {
+                std::shared_ptr<ast::TreeNode> tree;
+                bool ok;
+                if (serialized) {
+                    std::lock_guard<std::mutex> lock(latch);
+                    ok = ast::parse(statements[next % statements.size()], &tree);
+                } else {
+                    ok = ast::parse(statements[next % statements.size()], &tree);
+                }
+                if (!ok || tree == nullptr) {
+                    failed++;
+                }
+                next++;
+                count++;
+            }
+            total += count;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCHMARK_MILLISECONDS));
+    stop = true;
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    if (failed > 0) {
+        std::cerr << failed << " statements failed to parse" << std::endl;
+    }
+    return total * 1000 / BENCHMARK_MILLISECONDS;
+}
+
+int main(int argc, char *argv[]) {
+    int max_threads = argc >= 2 ? atoi(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+    for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+        uint64_t serialized = run_benchmark(num_threads, true);
+        uint64_t concurrent = run_benchmark(num_threads, false);
+        std::cout << "threads: " << num_threads << "\tserialized: " << serialized
+                  << " stmt/s\tconcurrent: " << concurrent << " stmt/s" << std::endl;
+    }
+    return 0;
+}
@@ -1,11 +1,32 @@
 #pragma once
 
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast.h"
 #include "defs.h"
 
-int yyparse();
+namespace ast {
 
-typedef struct yy_buffer_state *YY_BUFFER_STATE;
+/**
+ * @brief 解析一条sql语句
+ * @details 每次调用使用独立的词法和语法分析状态, 可以被多个线程同时调用
+ * @param sql sql语句
+ * @param[out] tree 语法树, sql为exit或空语句时为nullptr
+ * @return 没有语法错误时返回true
+ */
+bool parse(const std::string &sql, std::shared_ptr<TreeNode> *tree);
 
-YY_BUFFER_STATE yy_scan_string(const char *str);
+/**
+ * @brief 把一条select/insert/delete/update语句中的字面量替换成参数占位符'?'
+ * @details 关键字转换为大写, token之间用一个空格分隔, 注释被去掉, 因此只有字面量不同的语句得到相同的结果.
+ * LIMIT后的整数不是值, 保留在结果中
+ * @param sql sql语句
+ * @param[out] normalized 替换后的sql
+ * @param[out] literals 按出现顺序排列的字面量
+ * @return sql不是DML语句或者有词法错误时返回false
+ */
+bool normalize_dml(const std::string &sql, std::string *normalized, std::vector<std::shared_ptr<Value>> *literals);
 
-void yy_delete_buffer(YY_BUFFER_STATE buffer);
+}  // namespace ast
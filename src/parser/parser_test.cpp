@@ -0,0 +1,174 @@
+#include "parser.h"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lexer.h"
+
+// 依次读出sql中的所有token
+static std::vector<int> tokenize(const std::string &sql, std::vector<YYSTYPE> *vals = nullptr) {
+    ast::Lexer lexer(sql);
+    std::vector<int> tokens;
+    YYSTYPE val;
+    YYLTYPE loc = {1, 1, 1, 1};
+    int token;
+    while ((token = lexer.next(&val, &loc)) != T_EOF && token != 0) {
+        tokens.push_back(token);
+        if (vals != nullptr) {
+            vals->push_back(val);
+        }
+    }
+    return tokens;
+}
+
+// 关键字不区分大小写, 标识符保留原样, 注释和空白被跳过
+TEST(ParserTest, LexKeywordsAndIdentifiers) {
+    std::vector<YYSTYPE> vals;
+    auto tokens = tokenize("SeLeCt Name_1 /* comment */ from\n\tT -- comment\n;", &vals);
+    ASSERT_EQ(tokens, (std::vector<int>{SELECT, IDENTIFIER, FROM, IDENTIFIER, ';'}));
+    EXPECT_EQ(vals[1].sv_str, "Name_1");
+    EXPECT_EQ(vals[3].sv_str, "T");
+}
+
+// 没有结束的块注释和其他输入结尾一样返回T_EOF, 同时报告错误
+TEST(ParserTest, LexUnterminatedComment) {
+    std::string sql = "select /* comment";
+    ast::Lexer lexer(sql);
+    YYSTYPE val;
+    YYLTYPE loc = {1, 1, 1, 1};
+    EXPECT_EQ(lexer.next(&val, &loc), SELECT);
+    EXPECT_FALSE(lexer.has_error());
+    EXPECT_EQ(lexer.next(&val, &loc), T_EOF);
+    EXPECT_TRUE(lexer.has_error());
+    EXPECT_EQ(lexer.next(&val, &loc), T_EOF);
+
+    std::string normalized;
+    std::vector<std::shared_ptr<ast::Value>> literals;
+    EXPECT_FALSE(ast::normalize_dml("select * from t where a = 1; /* comment", &normalized, &literals));
+}
+
+TEST(ParserTest, LexLiteralsAndOperators) {
+    std::vector<YYSTYPE> vals;
+    auto tokens = tokenize("-12 3.5 7. 'a b' >= <= <> < > = ?", &vals);
+    ASSERT_EQ(tokens, (std::vector<int>{VALUE_INT, VALUE_FLOAT, VALUE_FLOAT, VALUE_STRING, GEQ, LEQ, NEQ, '<', '>',
+                                        '=', '?'}));
+    EXPECT_EQ(vals[0].sv_int, -12);
+    EXPECT_FLOAT_EQ(vals[1].sv_float, 3.5);
+    EXPECT_FLOAT_EQ(vals[2].sv_float, 7);
+    EXPECT_EQ(vals[3].sv_str, "a b");
+}
+
+TEST(ParserTest, ParseStatements) {
+    std::shared_ptr<ast::TreeNode> tree;
+    ASSERT_TRUE(ast::parse("select a, t.b from t where a > 1 order by b desc limit 5;", &tree));
+    auto select = std::dynamic_pointer_cast<ast::SelectStmt>(tree);
+    ASSERT_NE(select, nullptr);
+    EXPECT_EQ(select->cols.size(), 2);
+    EXPECT_EQ(select->cols[1]->tab_name, "t");
+    EXPECT_EQ(select->conds.size(), 1);
+    EXPECT_EQ(select->limit, 5);
+
+    ASSERT_TRUE(ast::parse("analyze t;", &tree));
+    auto analyze = std::dynamic_pointer_cast<ast::AnalyzeTable>(tree);
+    ASSERT_NE(analyze, nullptr);
+    EXPECT_EQ(analyze->tab_name, "t");
+
+    ASSERT_TRUE(ast::parse("exit", &tree));
+    EXPECT_EQ(tree, nullptr);
+    EXPECT_FALSE(ast::parse("select from;", &tree));
+    EXPECT_FALSE(ast::parse("select * from t /* unterminated", &tree));
+}
+
+// insert可以带多个元组, LOAD DATA指定文件名和表名
+TEST(ParserTest, ParseInsertRowsAndLoadData) {
+    std::shared_ptr<ast::TreeNode> tree;
+    ASSERT_TRUE(ast::parse("insert into t values (1, 'a'), (2, 'b'), (?, ?);", &tree));
+    auto insert = std::dynamic_pointer_cast<ast::InsertStmt>(tree);
+    ASSERT_NE(insert, nullptr);
+    ASSERT_EQ(insert->rows.size(), 3);
+    EXPECT_EQ(insert->rows[1].size(), 2);
+    EXPECT_EQ(std::dynamic_pointer_cast<ast::IntLit>(insert->rows[1][0])->val, 2);
+    EXPECT_NE(std::dynamic_pointer_cast<ast::Param>(insert->rows[2][1]), nullptr);
+    EXPECT_FALSE(ast::parse("insert into t values (1), ;", &tree));
+
+    // 解析栈的深度和元组个数无关
+    std::string sql = "insert into t values (0, 'a')";
+    for (int i = 1; i < 5000; i++) {
+        sql += ", (" + std::to_string(i) + ", 'a')";
+    }
+    ASSERT_TRUE(ast::parse(sql + ";", &tree));
+    EXPECT_EQ(std::dynamic_pointer_cast<ast::InsertStmt>(tree)->rows.size(), 5000);
+
+    ASSERT_TRUE(ast::parse("load data '/tmp/t.csv' into t;", &tree));
+    auto load = std::dynamic_pointer_cast<ast::LoadData>(tree);
+    ASSERT_NE(load, nullptr);
+    EXPECT_EQ(load->file_name, "/tmp/t.csv");
+    EXPECT_EQ(load->tab_name, "t");
+}
+
+TEST(ParserTest, ParseBeginIsolationLevel) {
+    std::shared_ptr<ast::TreeNode> tree;
+    ASSERT_TRUE(ast::parse("begin;", &tree));
+    EXPECT_EQ(std::dynamic_pointer_cast<ast::TxnBegin>(tree)->isolation_level, ast::SV_ISOLATION_DEFAULT);
+    ASSERT_TRUE(ast::parse("begin isolation level repeatable read;", &tree));
+    EXPECT_EQ(std::dynamic_pointer_cast<ast::TxnBegin>(tree)->isolation_level, ast::SV_REPEATABLE_READ);
+    ASSERT_TRUE(ast::parse("BEGIN ISOLATION LEVEL READ COMMITTED;", &tree));
+    EXPECT_EQ(std::dynamic_pointer_cast<ast::TxnBegin>(tree)->isolation_level, ast::SV_READ_COMMITTED);
+    ASSERT_TRUE(ast::parse("begin isolation level read uncommitted;", &tree));
+    EXPECT_EQ(std::dynamic_pointer_cast<ast::TxnBegin>(tree)->isolation_level, ast::SV_READ_UNCOMMITTED);
+    ASSERT_TRUE(ast::parse("begin isolation level serializable;", &tree));
+    EXPECT_EQ(std::dynamic_pointer_cast<ast::TxnBegin>(tree)->isolation_level, ast::SV_SERIALIZABLE);
+    EXPECT_FALSE(ast::parse("begin isolation level read;", &tree));
+}
+
+// 只有字面量不同的DML语句得到相同的结果, LIMIT的值和非DML语句不参与替换
+TEST(ParserTest, NormalizeDml) {
+    std::string normalized;
+    std::vector<std::shared_ptr<ast::Value>> literals;
+    ASSERT_TRUE(ast::normalize_dml("select * from T where a = 1 and b > 'x' /* c */ limit 10;", &normalized, &literals));
+    EXPECT_EQ(normalized, "SELECT * FROM T WHERE a = ? AND b > ? LIMIT 10 ;");
+    ASSERT_EQ(literals.size(), 2);
+    EXPECT_EQ(std::dynamic_pointer_cast<ast::IntLit>(literals[0])->val, 1);
+    EXPECT_EQ(std::dynamic_pointer_cast<ast::StringLit>(literals[1])->val, "x");
+
+    std::string other;
+    ASSERT_TRUE(ast::normalize_dml("SELECT  *\nFROM T WHERE a=-7 AND b>'yy' LIMIT 10;", &other, &literals));
+    EXPECT_EQ(other, normalized);
+
+    ASSERT_TRUE(ast::normalize_dml("insert into t values (1, 2.5, 'a');", &normalized, &literals));
+    EXPECT_EQ(normalized, "INSERT INTO t VALUES ( ? , ? , ? ) ;");
+    EXPECT_NE(std::dynamic_pointer_cast<ast::FloatLit>(literals[1]), nullptr);
+
+    EXPECT_FALSE(ast::normalize_dml("create table t (a int);", &normalized, &literals));
+    EXPECT_FALSE(ast::normalize_dml("select * from t where a = #;", &normalized, &literals));
+    EXPECT_FALSE(ast::normalize_dml("", &normalized, &literals));
+}
+
+// 多个线程同时解析不同的语句, 结果互不干扰
+TEST(ParserTest, ConcurrentParse) {
+    const int num_threads = 8;
+    const int num_iters = 2000;
+    std::vector<std::thread> threads;
+    std::vector<int> errors(num_threads, 0);
+    for (int i = 0; i < num_threads; i++) {
+        threads.emplace_back([&, i] {
+            std::string tab_name = "tab" + std::to_string(i);
+            std::string sql = "insert into " + tab_name + " values (" + std::to_string(i) + ", 'x');";
+            for (int j = 0; j < num_iters; j++) {
+                std::shared_ptr<ast::TreeNode> tree;
+                auto insert = ast::parse(sql, &tree) ? std::dynamic_pointer_cast<ast::InsertStmt>(tree) : nullptr;
+                if (insert == nullptr || insert->tab_name != tab_name ||
+                    std::dynamic_pointer_cast<ast::IntLit>(insert->rows[0][0])->val != i) {
+                    errors[i]++;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    for (int i = 0; i < num_threads; i++) {
+        EXPECT_EQ(errors[i], 0);
+    }
+}
@@ -1,8 +1,8 @@
-/* A Bison parser, made by GNU Bison 3.5.1.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
 /* Bison implementation for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2020 Free Software Foundation,
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
    Inc.
 
    This program is free software: you can redistribute it and/or modify
@@ -16,7 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -34,6 +34,10 @@
 /* C LALR(1) parser skeleton written by Richard Stallman, by
    simplifying the original so-called "semantic" parser.  */
 
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
+
 /* All symbols defined below should begin with yy or YY, to avoid
    infringing on user name space.  This should be done even for local
    variables, as they might otherwise be expanded by user macros.
@@ -41,14 +45,11 @@
    define necessary library symbols; they are noted "INFRINGES ON
    USER NAME SPACE" below.  */
 
-/* Undocumented macros, especially those whose name start with YY_,
-   are private implementation details.  Do not rely on them.  */
-
-/* Identify Bison output.  */
-#define YYBISON 1
+/* Identify Bison output, and Bison version.  */
+#define YYBISON 30802
 
-/* Bison version.  */
-#define YYBISON_VERSION "3.5.1"
+/* Bison version string.  */
+#define YYBISON_VERSION "3.8.2"
 
 /* Skeleton name.  */
 #define YYSKELETON_NAME "yacc.c"
@@ -66,22 +67,60 @@
 
 
 /* First part of user prologue.  */
-#line 1 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+#line 11 "yacc.y"
+
+// SemValue is not trivially copyable, so bison cannot relocate the stacks by itself, and the initial
+// stacks are constructed on every call. The grammar is left recursive and stays shallow, so start with
+// 64 entries, and let grow_stacks() move them to larger stacks up to bison's default YYMAXDEPTH
+#define YYINITDEPTH 64
+#define yyoverflow(msg, ss, ss_size, vs, vs_size, ls, ls_size, stacksize)                                  \
+    grow_stacks(&yylloc, lexer, result, msg, ss, vs, ls, (ss_size) / YYSIZEOF(**(ss)), stacksize,        \
+                YY_CAST(YYPTRDIFF_T, YYMAXDEPTH))
 
 #include "ast.h"
+#include "lexer.h"
 #include "yacc.tab.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <memory>
 
-int yylex(YYSTYPE *yylval, YYLTYPE *yylloc);
-
-void yyerror(YYLTYPE *locp, const char* s) {
+void yyerror(YYLTYPE *locp, ast::Lexer *lexer, std::shared_ptr<ast::TreeNode> *result, const char* s) {
     std::cerr << "Parser Error at line " << locp->first_line << " column " << locp->first_column << ": " << s << std::endl;
 }
 
+/**
+ * @brief yyoverflow: 把三个栈中的size个元素移动到两倍大小的新栈中, 新栈由lexer持有
+ * @details 已经达到max_depth时报告错误并保持stacksize不变, bison随后中止解析
+ */
+template <typename State, typename Size>
+void grow_stacks(YYLTYPE *locp, ast::Lexer *lexer, std::shared_ptr<ast::TreeNode> *result, const char *msg,
+                 State **ss, YYSTYPE **vs, YYLTYPE **ls, Size size, Size *stacksize, Size max_depth) {
+    if (*stacksize >= max_depth) {
+        yyerror(locp, lexer, result, msg);
+        return;
+    }
+    Size new_size = std::min(*stacksize * 2, max_depth);
+    auto &stacks = lexer->parser_stacks();
+    std::unique_ptr<char[]> states(new char[new_size * sizeof(State)]);
+    memcpy(states.get(), *ss, size * sizeof(State));
+    std::vector<YYSTYPE> values(new_size);
+    std::move(*vs, *vs + size, values.begin());
+    std::vector<YYLTYPE> locations(*ls, *ls + size);
+    locations.resize(new_size);
+    // 旧栈可能就是上一次增长得到的栈, 元素都已经移走后再替换
+    stacks.states = std::move(states);
+    stacks.values.swap(values);
+    stacks.locations.swap(locations);
+    *ss = reinterpret_cast<State *>(stacks.states.get());
+    *vs = stacks.values.data();
+    *ls = stacks.locations.data();
+    *stacksize = new_size;
+}
+
 using namespace ast;
 
-#line 85 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 124 "yacc.tab.cpp"
 
 # ifndef YY_CAST
 #  ifdef __cplusplus
@@ -104,92 +143,111 @@ using namespace ast;
 #  endif
 # endif
 
-/* Enabling verbose error messages.  */
-#ifdef YYERROR_VERBOSE
-# undef YYERROR_VERBOSE
-# define YYERROR_VERBOSE 1
-#else
-# define YYERROR_VERBOSE 1
-#endif
-
-/* Use api.header.include to #include this header
-   instead of duplicating it here.  */
-#ifndef YY_YY_HOME_AARON_RUCDEKE_RUCBASE_SRC_PARSER_YACC_TAB_H_INCLUDED
-# define YY_YY_HOME_AARON_RUCDEKE_RUCBASE_SRC_PARSER_YACC_TAB_H_INCLUDED
-/* Debug traces.  */
-#ifndef YYDEBUG
-# define YYDEBUG 0
-#endif
-#if YYDEBUG
-extern int yydebug;
-#endif
-
-/* Token type.  */
-#ifndef YYTOKENTYPE
-# define YYTOKENTYPE
-  enum yytokentype
-  {
-    SHOW = 258,
-    TABLES = 259,
-    CREATE = 260,
-    TABLE = 261,
-    DROP = 262,
-    DESC = 263,
-    INSERT = 264,
-    INTO = 265,
-    VALUES = 266,
-    DELETE = 267,
-    FROM = 268,
-    WHERE = 269,
-    UPDATE = 270,
-    SET = 271,
-    SELECT = 272,
-    INT = 273,
-    CHAR = 274,
-    FLOAT = 275,
-    INDEX = 276,
-    AND = 277,
-    JOIN = 278,
-    EXIT = 279,
-    HELP = 280,
-    TXN_BEGIN = 281,
-    TXN_COMMIT = 282,
-    TXN_ABORT = 283,
-    TXN_ROLLBACK = 284,
-    LEQ = 285,
-    NEQ = 286,
-    GEQ = 287,
-    T_EOF = 288,
-    IDENTIFIER = 289,
-    VALUE_STRING = 290,
-    VALUE_INT = 291,
-    VALUE_FLOAT = 292
-  };
-#endif
-
-/* Value type.  */
-
-/* Location type.  */
-#if ! defined YYLTYPE && ! defined YYLTYPE_IS_DECLARED
-typedef struct YYLTYPE YYLTYPE;
-struct YYLTYPE
+#include "yacc.tab.h"
+/* Symbol kind.  */
+enum yysymbol_kind_t
 {
-  int first_line;
-  int first_column;
-  int last_line;
-  int last_column;
+  YYSYMBOL_YYEMPTY = -2,
+  YYSYMBOL_YYEOF = 0,                      /* "end of file"  */
+  YYSYMBOL_YYerror = 1,                    /* error  */
+  YYSYMBOL_YYUNDEF = 2,                    /* "invalid token"  */
+  YYSYMBOL_SHOW = 3,                       /* SHOW  */
+  YYSYMBOL_TABLES = 4,                     /* TABLES  */
+  YYSYMBOL_CREATE = 5,                     /* CREATE  */
+  YYSYMBOL_TABLE = 6,                      /* TABLE  */
+  YYSYMBOL_DROP = 7,                       /* DROP  */
+  YYSYMBOL_DESC = 8,                       /* DESC  */
+  YYSYMBOL_INSERT = 9,                     /* INSERT  */
+  YYSYMBOL_INTO = 10,                      /* INTO  */
+  YYSYMBOL_VALUES = 11,                    /* VALUES  */
+  YYSYMBOL_DELETE = 12,                    /* DELETE  */
+  YYSYMBOL_FROM = 13,                      /* FROM  */
+  YYSYMBOL_WHERE = 14,                     /* WHERE  */
+  YYSYMBOL_UPDATE = 15,                    /* UPDATE  */
+  YYSYMBOL_SET = 16,                       /* SET  */
+  YYSYMBOL_SELECT = 17,                    /* SELECT  */
+  YYSYMBOL_INT = 18,                       /* INT  */
+  YYSYMBOL_CHAR = 19,                      /* CHAR  */
+  YYSYMBOL_FLOAT = 20,                     /* FLOAT  */
+  YYSYMBOL_INDEX = 21,                     /* INDEX  */
+  YYSYMBOL_AND = 22,                       /* AND  */
+  YYSYMBOL_JOIN = 23,                      /* JOIN  */
+  YYSYMBOL_EXIT = 24,                      /* EXIT  */
+  YYSYMBOL_HELP = 25,                      /* HELP  */
+  YYSYMBOL_TXN_BEGIN = 26,                 /* TXN_BEGIN  */
+  YYSYMBOL_TXN_COMMIT = 27,                /* TXN_COMMIT  */
+  YYSYMBOL_TXN_ABORT = 28,                 /* TXN_ABORT  */
+  YYSYMBOL_TXN_ROLLBACK = 29,              /* TXN_ROLLBACK  */
+  YYSYMBOL_ORDER = 30,                     /* ORDER  */
+  YYSYMBOL_BY = 31,                        /* BY  */
+  YYSYMBOL_ASC = 32,                       /* ASC  */
+  YYSYMBOL_LIMIT = 33,                     /* LIMIT  */
+  YYSYMBOL_LOAD = 34,                      /* LOAD  */
+  YYSYMBOL_DATA = 35,                      /* DATA  */
+  YYSYMBOL_ISOLATION = 36,                 /* ISOLATION  */
+  YYSYMBOL_LEVEL = 37,                     /* LEVEL  */
+  YYSYMBOL_READ = 38,                      /* READ  */
+  YYSYMBOL_COMMITTED = 39,                 /* COMMITTED  */
+  YYSYMBOL_UNCOMMITTED = 40,               /* UNCOMMITTED  */
+  YYSYMBOL_REPEATABLE = 41,                /* REPEATABLE  */
+  YYSYMBOL_SERIALIZABLE = 42,              /* SERIALIZABLE  */
+  YYSYMBOL_ANALYZE = 43,                   /* ANALYZE  */
+  YYSYMBOL_LEQ = 44,                       /* LEQ  */
+  YYSYMBOL_NEQ = 45,                       /* NEQ  */
+  YYSYMBOL_GEQ = 46,                       /* GEQ  */
+  YYSYMBOL_T_EOF = 47,                     /* T_EOF  */
+  YYSYMBOL_IDENTIFIER = 48,                /* IDENTIFIER  */
+  YYSYMBOL_VALUE_STRING = 49,              /* VALUE_STRING  */
+  YYSYMBOL_VALUE_INT = 50,                 /* VALUE_INT  */
+  YYSYMBOL_VALUE_FLOAT = 51,               /* VALUE_FLOAT  */
+  YYSYMBOL_52_ = 52,                       /* ';'  */
+  YYSYMBOL_53_ = 53,                       /* '('  */
+  YYSYMBOL_54_ = 54,                       /* ')'  */
+  YYSYMBOL_55_ = 55,                       /* ','  */
+  YYSYMBOL_56_ = 56,                       /* '?'  */
+  YYSYMBOL_57_ = 57,                       /* '.'  */
+  YYSYMBOL_58_ = 58,                       /* '='  */
+  YYSYMBOL_59_ = 59,                       /* '<'  */
+  YYSYMBOL_60_ = 60,                       /* '>'  */
+  YYSYMBOL_61_ = 61,                       /* '*'  */
+  YYSYMBOL_YYACCEPT = 62,                  /* $accept  */
+  YYSYMBOL_start = 63,                     /* start  */
+  YYSYMBOL_stmt = 64,                      /* stmt  */
+  YYSYMBOL_txnStmt = 65,                   /* txnStmt  */
+  YYSYMBOL_optIsolationLevel = 66,         /* optIsolationLevel  */
+  YYSYMBOL_isolationLevel = 67,            /* isolationLevel  */
+  YYSYMBOL_dbStmt = 68,                    /* dbStmt  */
+  YYSYMBOL_ddl = 69,                       /* ddl  */
+  YYSYMBOL_dml = 70,                       /* dml  */
+  YYSYMBOL_fieldList = 71,                 /* fieldList  */
+  YYSYMBOL_field = 72,                     /* field  */
+  YYSYMBOL_type = 73,                      /* type  */
+  YYSYMBOL_valueRows = 74,                 /* valueRows  */
+  YYSYMBOL_valueList = 75,                 /* valueList  */
+  YYSYMBOL_value = 76,                     /* value  */
+  YYSYMBOL_condition = 77,                 /* condition  */
+  YYSYMBOL_optWhereClause = 78,            /* optWhereClause  */
+  YYSYMBOL_whereClause = 79,               /* whereClause  */
+  YYSYMBOL_optOrderClause = 80,            /* optOrderClause  */
+  YYSYMBOL_orderList = 81,                 /* orderList  */
+  YYSYMBOL_orderItem = 82,                 /* orderItem  */
+  YYSYMBOL_optOrderDir = 83,               /* optOrderDir  */
+  YYSYMBOL_optLimitClause = 84,            /* optLimitClause  */
+  YYSYMBOL_col = 85,                       /* col  */
+  YYSYMBOL_colList = 86,                   /* colList  */
+  YYSYMBOL_op = 87,                        /* op  */
+  YYSYMBOL_expr = 88,                      /* expr  */
+  YYSYMBOL_setClauses = 89,                /* setClauses  */
+  YYSYMBOL_setClause = 90,                 /* setClause  */
+  YYSYMBOL_selector = 91,                  /* selector  */
+  YYSYMBOL_tableList = 92,                 /* tableList  */
+  YYSYMBOL_tbName = 93,                    /* tbName  */
+  YYSYMBOL_colName = 94                    /* colName  */
 };
-# define YYLTYPE_IS_DECLARED 1
-# define YYLTYPE_IS_TRIVIAL 1
-#endif
+typedef enum yysymbol_kind_t yysymbol_kind_t;
 
 
 
-int yyparse (void);
-
-#endif /* !YY_YY_HOME_AARON_RUCDEKE_RUCBASE_SRC_PARSER_YACC_TAB_H_INCLUDED  */
-
-
 
 #ifdef short
 # undef short
@@ -228,6 +286,18 @@ typedef int_least16_t yytype_int16;
 typedef short yytype_int16;
 #endif
 
+/* Work around bug in HP-UX 11.23, which defines these macros
+   incorrectly for preprocessor constants.  This workaround can likely
+   be removed in 2023, as HPE has promised support for HP-UX 11.23
+   (aka HP-UX 11i v2) only through the end of 2022; see Table 2 of
+   <https://h20195.www2.hpe.com/V2/getpdf.aspx/4AA4-7673ENW.pdf>.  */
+#ifdef __hpux
+# undef UINT_LEAST8_MAX
+# undef UINT_LEAST16_MAX
+# define UINT_LEAST8_MAX 255
+# define UINT_LEAST16_MAX 65535
+#endif
+
 #if defined __UINT_LEAST8_MAX__ && __UINT_LEAST8_MAX__ <= __INT_MAX__
 typedef __UINT_LEAST8_TYPE__ yytype_uint8;
 #elif (!defined __UINT_LEAST8_MAX__ && defined YY_STDINT_H \
@@ -287,8 +357,9 @@ typedef int yytype_uint16;
 
 #define YYSIZEOF(X) YY_CAST (YYPTRDIFF_T, sizeof (X))
 
+
 /* Stored state numbers (used for stacks). */
-typedef yytype_int8 yy_state_t;
+typedef yytype_uint8 yy_state_t;
 
 /* State numbers in computations.  */
 typedef int yy_state_fast_t;
@@ -305,6 +376,7 @@ typedef int yy_state_fast_t;
 # endif
 #endif
 
+
 #ifndef YY_ATTRIBUTE_PURE
 # if defined __GNUC__ && 2 < __GNUC__ + (96 <= __GNUC_MINOR__)
 #  define YY_ATTRIBUTE_PURE __attribute__ ((__pure__))
@@ -323,17 +395,23 @@ typedef int yy_state_fast_t;
 
 /* Suppress unused-variable warnings by "using" E.  */
 #if ! defined lint || defined __GNUC__
-# define YYUSE(E) ((void) (E))
+# define YY_USE(E) ((void) (E))
 #else
-# define YYUSE(E) /* empty */
+# define YY_USE(E) /* empty */
 #endif
 
-#if defined __GNUC__ && ! defined __ICC && 407 <= __GNUC__ * 100 + __GNUC_MINOR__
 /* Suppress an incorrect diagnostic about yylval being uninitialized.  */
-# define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                            \
+#if defined __GNUC__ && ! defined __ICC && 406 <= __GNUC__ * 100 + __GNUC_MINOR__
+# if __GNUC__ * 100 + __GNUC_MINOR__ < 407
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
+    _Pragma ("GCC diagnostic push")                                     \
+    _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")
+# else
+#  define YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN                           \
     _Pragma ("GCC diagnostic push")                                     \
     _Pragma ("GCC diagnostic ignored \"-Wuninitialized\"")              \
     _Pragma ("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+# endif
 # define YY_IGNORE_MAYBE_UNINITIALIZED_END      \
     _Pragma ("GCC diagnostic pop")
 #else
@@ -362,7 +440,7 @@ typedef int yy_state_fast_t;
 
 #define YY_ASSERT(E) ((void) (0 && (E)))
 
-#if ! defined yyoverflow || YYERROR_VERBOSE
+#if 1
 
 /* The parser invokes alloca or malloc; define the necessary symbols.  */
 
@@ -427,8 +505,7 @@ void free (void *); /* INFRINGES ON USER NAME SPACE */
 #   endif
 #  endif
 # endif
-#endif /* ! defined yyoverflow || YYERROR_VERBOSE */
-
+#endif /* 1 */
 
 #if (! defined yyoverflow \
      && (! defined __cplusplus \
@@ -494,27 +571,29 @@ union yyalloc
 #endif /* !YYCOPY_NEEDED */
 
 /* YYFINAL -- State number of the termination state.  */
-#define YYFINAL  39
+#define YYFINAL  45
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   100
+#define YYLAST   140
 
 /* YYNTOKENS -- Number of terminals.  */
-#define YYNTOKENS  47
+#define YYNTOKENS  62
 /* YYNNTS -- Number of nonterminals.  */
-#define YYNNTS  25
+#define YYNNTS  33
 /* YYNRULES -- Number of rules.  */
-#define YYNRULES  61
+#define YYNRULES  82
 /* YYNSTATES -- Number of states.  */
-#define YYNSTATES  116
+#define YYNSTATES  153
 
-#define YYUNDEFTOK  2
-#define YYMAXUTOK   292
+/* YYMAXUTOK -- Last valid token kind.  */
+#define YYMAXUTOK   306
 
 
 /* YYTRANSLATE(TOKEN-NUM) -- Symbol number corresponding to TOKEN-NUM
    as returned by yylex, with out-of-bounds checking.  */
-#define YYTRANSLATE(YYX)                                                \
-  (0 <= (YYX) && (YYX) <= YYMAXUTOK ? yytranslate[YYX] : YYUNDEFTOK)
+#define YYTRANSLATE(YYX)                                \
+  (0 <= (YYX) && (YYX) <= YYMAXUTOK                     \
+   ? YY_CAST (yysymbol_kind_t, yytranslate[YYX])        \
+   : YYSYMBOL_YYUNDEF)
 
 /* YYTRANSLATE[TOKEN-NUM] -- Symbol number corresponding to TOKEN-NUM
    as returned by yylex.  */
@@ -524,9 +603,9 @@ static const yytype_int8 yytranslate[] =
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
-      39,    40,    46,     2,    41,     2,    42,     2,     2,     2,
-       2,     2,     2,     2,     2,     2,     2,     2,     2,    38,
-      44,    43,    45,     2,     2,     2,     2,     2,     2,     2,
+      53,    54,    61,     2,    55,     2,    57,     2,     2,     2,
+       2,     2,     2,     2,     2,     2,     2,     2,     2,    52,
+      59,    58,    60,    56,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
        2,     2,     2,     2,     2,     2,     2,     2,     2,     2,
@@ -549,202 +628,236 @@ static const yytype_int8 yytranslate[] =
        5,     6,     7,     8,     9,    10,    11,    12,    13,    14,
       15,    16,    17,    18,    19,    20,    21,    22,    23,    24,
       25,    26,    27,    28,    29,    30,    31,    32,    33,    34,
-      35,    36,    37
+      35,    36,    37,    38,    39,    40,    41,    42,    43,    44,
+      45,    46,    47,    48,    49,    50,    51
 };
 
 #if YYDEBUG
-  /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
+/* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
 static const yytype_int16 yyrline[] =
 {
-       0,    54,    54,    59,    64,    69,    77,    78,    79,    80,
-      84,    88,    92,    96,   103,   110,   114,   118,   122,   126,
-     133,   137,   141,   145,   152,   156,   163,   170,   174,   178,
-     185,   189,   196,   200,   204,   211,   218,   219,   226,   230,
-     237,   241,   248,   252,   259,   263,   267,   271,   275,   279,
-     286,   290,   297,   301,   308,   315,   319,   323,   327,   331,
-     337,   339
+       0,   112,   112,   117,   122,   127,   135,   136,   137,   138,
+     142,   146,   150,   154,   162,   165,   172,   176,   180,   184,
+     191,   198,   202,   206,   210,   214,   218,   225,   229,   233,
+     237,   241,   248,   252,   259,   266,   270,   274,   281,   285,
+     292,   296,   303,   307,   311,   315,   322,   329,   330,   337,
+     341,   348,   349,   356,   360,   367,   375,   378,   382,   390,
+     393,   400,   404,   411,   415,   422,   426,   430,   434,   438,
+     442,   449,   453,   460,   464,   471,   478,   482,   486,   490,
+     494,   500,   502
 };
 #endif
 
-#if YYDEBUG || YYERROR_VERBOSE || 1
+/** Accessing symbol of state STATE.  */
+#define YY_ACCESSING_SYMBOL(State) YY_CAST (yysymbol_kind_t, yystos[State])
+
+#if 1
+/* The user-facing name of the symbol whose (internal) number is
+   YYSYMBOL.  No bounds checking.  */
+static const char *yysymbol_name (yysymbol_kind_t yysymbol) YY_ATTRIBUTE_UNUSED;
+
 /* YYTNAME[SYMBOL-NUM] -- String name of the symbol SYMBOL-NUM.
    First, the terminals, then, starting at YYNTOKENS, nonterminals.  */
 static const char *const yytname[] =
 {
-  "$end", "error", "$undefined", "SHOW", "TABLES", "CREATE", "TABLE",
-  "DROP", "DESC", "INSERT", "INTO", "VALUES", "DELETE", "FROM", "WHERE",
-  "UPDATE", "SET", "SELECT", "INT", "CHAR", "FLOAT", "INDEX", "AND",
-  "JOIN", "EXIT", "HELP", "TXN_BEGIN", "TXN_COMMIT", "TXN_ABORT",
-  "TXN_ROLLBACK", "LEQ", "NEQ", "GEQ", "T_EOF", "IDENTIFIER",
-  "VALUE_STRING", "VALUE_INT", "VALUE_FLOAT", "';'", "'('", "')'", "','",
-  "'.'", "'='", "'<'", "'>'", "'*'", "$accept", "start", "stmt", "txnStmt",
-  "dbStmt", "ddl", "dml", "fieldList", "field", "type", "valueList",
-  "value", "condition", "optWhereClause", "whereClause", "col", "colList",
-  "op", "expr", "setClauses", "setClause", "selector", "tableList",
-  "tbName", "colName", YY_NULLPTR
+  "\"end of file\"", "error", "\"invalid token\"", "SHOW", "TABLES",
+  "CREATE", "TABLE", "DROP", "DESC", "INSERT", "INTO", "VALUES", "DELETE",
+  "FROM", "WHERE", "UPDATE", "SET", "SELECT", "INT", "CHAR", "FLOAT",
+  "INDEX", "AND", "JOIN", "EXIT", "HELP", "TXN_BEGIN", "TXN_COMMIT",
+  "TXN_ABORT", "TXN_ROLLBACK", "ORDER", "BY", "ASC", "LIMIT", "LOAD",
+  "DATA", "ISOLATION", "LEVEL", "READ", "COMMITTED", "UNCOMMITTED",
+  "REPEATABLE", "SERIALIZABLE", "ANALYZE", "LEQ", "NEQ", "GEQ", "T_EOF",
+  "IDENTIFIER", "VALUE_STRING", "VALUE_INT", "VALUE_FLOAT", "';'", "'('",
+  "')'", "','", "'?'", "'.'", "'='", "'<'", "'>'", "'*'", "$accept",
+  "start", "stmt", "txnStmt", "optIsolationLevel", "isolationLevel",
+  "dbStmt", "ddl", "dml", "fieldList", "field", "type", "valueRows",
+  "valueList", "value", "condition", "optWhereClause", "whereClause",
+  "optOrderClause", "orderList", "orderItem", "optOrderDir",
+  "optLimitClause", "col", "colList", "op", "expr", "setClauses",
+  "setClause", "selector", "tableList", "tbName", "colName", YY_NULLPTR
 };
-#endif
 
-# ifdef YYPRINT
-/* YYTOKNUM[NUM] -- (External) token number corresponding to the
-   (internal) symbol number NUM (which must be that of a token).  */
-static const yytype_int16 yytoknum[] =
+static const char *
+yysymbol_name (yysymbol_kind_t yysymbol)
 {
-       0,   256,   257,   258,   259,   260,   261,   262,   263,   264,
-     265,   266,   267,   268,   269,   270,   271,   272,   273,   274,
-     275,   276,   277,   278,   279,   280,   281,   282,   283,   284,
-     285,   286,   287,   288,   289,   290,   291,   292,    59,    40,
-      41,    44,    46,    61,    60,    62,    42
-};
-# endif
+  return yytname[yysymbol];
+}
+#endif
 
-#define YYPACT_NINF (-68)
+#define YYPACT_NINF (-80)
 
 #define yypact_value_is_default(Yyn) \
   ((Yyn) == YYPACT_NINF)
 
-#define YYTABLE_NINF (-61)
+#define YYTABLE_NINF (-82)
 
 #define yytable_value_is_error(Yyn) \
   0
 
-  /* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
-     STATE-NUM.  */
+/* YYPACT[STATE-NUM] -- Index in YYTABLE of the portion describing
+   STATE-NUM.  */
 static const yytype_int8 yypact[] =
 {
-      40,    34,     7,    10,   -20,    29,    37,   -20,    -2,   -68,
-     -68,   -68,   -68,   -68,   -68,   -68,    42,    13,   -68,   -68,
-     -68,   -68,   -68,   -20,   -20,   -20,   -20,   -68,   -68,   -20,
-     -20,    38,    11,   -68,   -68,    15,    49,    21,   -68,   -68,
-     -68,    41,    43,   -68,    44,    68,    67,    50,    51,   -20,
-      50,    50,    50,    50,    47,    51,   -68,   -68,    -4,   -68,
-      45,   -68,   -11,   -68,   -68,   -16,   -68,    -1,    53,    54,
-      35,   -68,    65,    46,    50,   -68,    35,   -20,   -20,   -68,
-     -68,    50,   -68,    56,   -68,   -68,   -68,   -68,   -68,   -68,
-     -68,    -6,   -68,    51,   -68,   -68,   -68,   -68,   -68,   -68,
-      24,   -68,   -68,   -68,   -68,   -68,    60,   -68,    35,   -68,
-     -68,   -68,   -68,    57,   -68,   -68
+      51,     3,    14,    15,   -21,    30,    32,   -21,   -22,   -80,
+     -80,    11,   -80,   -80,   -80,    18,   -21,   -80,    57,    10,
+     -80,   -80,   -80,   -80,   -80,   -21,   -21,   -21,   -21,   -80,
+     -80,   -21,   -21,    54,    12,   -80,   -80,    28,    71,    29,
+     -80,    50,   -80,    44,   -80,   -80,   -80,    42,    43,   -80,
+      46,    56,    90,    58,    59,   -21,    58,    23,    95,    58,
+      58,    58,    60,    59,   -80,   -80,     0,   -80,    61,   -80,
+     -11,   -80,   -80,   -24,    72,   -80,   -80,   -21,   -12,   -80,
+      53,    55,    62,    41,    63,   -80,    89,   -27,    58,   -80,
+      41,   -21,   -21,    84,   -80,   -80,   -80,   -80,   -80,    58,
+     -80,    64,   -80,   -80,   -80,   -80,   -80,   -80,   -80,   -80,
+      -5,   -80,    67,    59,   -80,   -80,   -80,   -80,   -80,   -80,
+      52,   -80,   -80,   -80,   -80,    91,    82,   -80,    73,   -80,
+      41,    41,   -80,   -80,   -80,   -80,    59,    74,   -80,    75,
+     -80,    27,    66,   -80,    -2,   -80,   -80,   -80,    59,   -80,
+     -80,   -80,   -80
 };
 
-  /* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
-     Performed when YYTABLE does not specify something else to do.  Zero
-     means the default is an error.  */
+/* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
+   Performed when YYTABLE does not specify something else to do.  Zero
+   means the default is an error.  */
 static const yytype_int8 yydefact[] =
 {
        0,     0,     0,     0,     0,     0,     0,     0,     0,     4,
-       3,    10,    11,    12,    13,     5,     0,     0,     9,     6,
-       7,     8,    14,     0,     0,     0,     0,    60,    17,     0,
-       0,     0,    61,    55,    42,    56,     0,     0,    41,     1,
-       2,     0,     0,    16,     0,     0,    36,     0,     0,     0,
-       0,     0,     0,     0,     0,     0,    21,    61,    36,    52,
-       0,    43,    36,    57,    40,     0,    24,     0,     0,     0,
-       0,    38,    37,     0,     0,    22,     0,     0,     0,    23,
-      15,     0,    27,     0,    29,    26,    18,    19,    34,    32,
-      33,     0,    30,     0,    48,    47,    49,    44,    45,    46,
-       0,    53,    54,    59,    58,    25,     0,    20,     0,    39,
-      50,    51,    35,     0,    31,    28
+       3,    14,    11,    12,    13,     0,     0,     5,     0,     0,
+       9,     6,     7,     8,    20,     0,     0,     0,     0,    81,
+      23,     0,     0,     0,    82,    76,    63,    77,     0,     0,
+      62,     0,    10,     0,    26,     1,     2,     0,     0,    22,
+       0,     0,    47,     0,     0,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,    29,    82,    47,    73,     0,    64,
+      47,    78,    61,     0,     0,    19,    15,     0,     0,    32,
+       0,     0,     0,     0,    27,    49,    48,     0,     0,    30,
+       0,     0,     0,    51,    17,    16,    18,    28,    21,     0,
+      35,     0,    37,    34,    24,    25,    44,    42,    43,    45,
+       0,    40,     0,     0,    69,    68,    70,    65,    66,    67,
+       0,    74,    75,    80,    79,     0,    59,    33,     0,    38,
+       0,     0,    50,    71,    72,    46,     0,     0,    31,     0,
+      41,     0,    52,    53,    56,    60,    36,    39,     0,    58,
+      57,    55,    54
 };
 
-  /* YYPGOTO[NTERM-NUM].  */
+/* YYPGOTO[NTERM-NUM].  */
 static const yytype_int8 yypgoto[] =
 {
-     -68,   -68,   -68,   -68,   -68,   -68,   -68,   -68,    17,   -68,
-     -68,   -67,     6,   -47,   -68,    -8,   -68,   -68,   -68,   -68,
-      26,   -68,   -68,    -3,   -45
+     -80,   -80,   -80,   -80,   -80,   -80,   -80,   -80,   -80,   -80,
+      26,   -80,   -80,    -4,   -79,    13,   -32,   -80,   -80,   -80,
+     -18,   -80,   -80,    -8,   -80,   -80,   -80,   -80,    45,   -80,
+     -80,    -3,   -51
 };
 
-  /* YYDEFGOTO[NTERM-NUM].  */
-static const yytype_int8 yydefgoto[] =
+/* YYDEFGOTO[NTERM-NUM].  */
+static const yytype_uint8 yydefgoto[] =
 {
-      -1,    16,    17,    18,    19,    20,    21,    65,    66,    85,
-      91,    92,    71,    56,    72,    73,    35,   100,   112,    58,
-      59,    36,    62,    37,    38
+       0,    18,    19,    20,    42,    76,    21,    22,    23,    78,
+      79,   103,    84,   110,   111,    85,    64,    86,   126,   142,
+     143,   151,   138,    87,    37,   120,   135,    66,    67,    38,
+      70,    39,    40
 };
 
-  /* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
-     positive, shift that token.  If negative, reduce the rule whose
-     number is the opposite.  If YYTABLE_NINF, syntax error.  */
-static const yytype_int8 yytable[] =
+/* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
+   positive, shift that token.  If negative, reduce the rule whose
+   number is the opposite.  If YYTABLE_NINF, syntax error.  */
+static const yytype_int16 yytable[] =
 {
-      34,    28,    60,    55,    31,    64,    67,    68,    69,   102,
-      55,    75,    77,    23,    27,    79,    25,    82,    83,    84,
-      41,    42,    43,    44,    80,    81,    45,    46,    24,    60,
-      78,    26,    32,   110,   107,   108,    67,    74,    22,    29,
-      61,   114,    39,     1,    33,     2,    63,     3,     4,     5,
-      30,    40,     6,   -60,    47,     7,    48,     8,    32,    88,
-      89,    90,    49,    50,     9,    10,    11,    12,    13,    14,
-      88,    89,    90,    15,   103,   104,    94,    95,    96,    54,
-      51,    55,    52,    53,    57,    32,    70,    93,    76,    97,
-      98,    99,   111,    86,    87,   106,   113,   115,   105,   109,
-     101
+      36,    30,    68,    63,    33,    72,   149,    24,    80,    81,
+      82,   122,    91,    44,    63,    94,    95,   114,   115,   116,
+      25,    27,    47,    48,    49,    50,    34,    29,    51,    52,
+     150,   117,   118,   119,    89,    26,    28,    68,    93,    35,
+      31,   133,    98,    99,    92,    32,    69,    41,    80,   129,
+     130,   140,    71,    43,     1,    88,     2,    45,     3,     4,
+       5,    73,    46,     6,    74,    75,     7,    62,     8,   -81,
+      53,   100,   101,   102,    97,     9,    10,    11,    12,    13,
+      14,   147,   130,    54,    55,    15,    56,    57,   123,   124,
+     106,   107,   108,    58,    16,    59,    60,   109,    17,    61,
+      34,   106,   107,   108,    63,    77,    65,    34,   109,   104,
+      96,   113,   134,    83,   125,   137,   105,   128,   112,    90,
+     131,   148,   136,   139,   145,   127,   132,   141,   144,   146,
+     152,     0,     0,   121,     0,     0,     0,     0,     0,     0,
+     144
 };
 
-static const yytype_int8 yycheck[] =
+static const yytype_int16 yycheck[] =
 {
-       8,     4,    47,    14,     7,    50,    51,    52,    53,    76,
-      14,    58,    23,     6,    34,    62,     6,    18,    19,    20,
-      23,    24,    25,    26,    40,    41,    29,    30,    21,    74,
-      41,    21,    34,   100,    40,    41,    81,    41,     4,    10,
-      48,   108,     0,     3,    46,     5,    49,     7,     8,     9,
-      13,    38,    12,    42,    16,    15,    41,    17,    34,    35,
-      36,    37,    13,    42,    24,    25,    26,    27,    28,    29,
-      35,    36,    37,    33,    77,    78,    30,    31,    32,    11,
-      39,    14,    39,    39,    34,    34,    39,    22,    43,    43,
-      44,    45,   100,    40,    40,    39,    36,    40,    81,    93,
-      74
+       8,     4,    53,    14,     7,    56,     8,     4,    59,    60,
+      61,    90,    23,    16,    14,    39,    40,    44,    45,    46,
+       6,     6,    25,    26,    27,    28,    48,    48,    31,    32,
+      32,    58,    59,    60,    66,    21,    21,    88,    70,    61,
+      10,   120,    54,    55,    55,    13,    54,    36,    99,    54,
+      55,   130,    55,    35,     3,    55,     5,     0,     7,     8,
+       9,    38,    52,    12,    41,    42,    15,    11,    17,    57,
+      16,    18,    19,    20,    77,    24,    25,    26,    27,    28,
+      29,    54,    55,    55,    13,    34,    57,    37,    91,    92,
+      49,    50,    51,    49,    43,    53,    53,    56,    47,    53,
+      48,    49,    50,    51,    14,    10,    48,    48,    56,    54,
+      38,    22,   120,    53,    30,    33,    54,    53,    55,    58,
+      53,    55,    31,    50,    50,    99,   113,   131,   136,    54,
+     148,    -1,    -1,    88,    -1,    -1,    -1,    -1,    -1,    -1,
+     148
 };
 
-  /* YYSTOS[STATE-NUM] -- The (internal number of the) accessing
-     symbol of state STATE-NUM.  */
+/* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
+   state STATE-NUM.  */
 static const yytype_int8 yystos[] =
 {
        0,     3,     5,     7,     8,     9,    12,    15,    17,    24,
-      25,    26,    27,    28,    29,    33,    48,    49,    50,    51,
-      52,    53,     4,     6,    21,     6,    21,    34,    70,    10,
-      13,    70,    34,    46,    62,    63,    68,    70,    71,     0,
-      38,    70,    70,    70,    70,    70,    70,    16,    41,    13,
-      42,    39,    39,    39,    11,    14,    60,    34,    66,    67,
-      71,    62,    69,    70,    71,    54,    55,    71,    71,    71,
-      39,    59,    61,    62,    41,    60,    43,    23,    41,    60,
-      40,    41,    18,    19,    20,    56,    40,    40,    35,    36,
-      37,    57,    58,    22,    30,    31,    32,    43,    44,    45,
-      64,    67,    58,    70,    70,    55,    39,    40,    41,    59,
-      58,    62,    65,    36,    58,    40
+      25,    26,    27,    28,    29,    34,    43,    47,    63,    64,
+      65,    68,    69,    70,     4,     6,    21,     6,    21,    48,
+      93,    10,    13,    93,    48,    61,    85,    86,    91,    93,
+      94,    36,    66,    35,    93,     0,    52,    93,    93,    93,
+      93,    93,    93,    16,    55,    13,    57,    37,    49,    53,
+      53,    53,    11,    14,    78,    48,    89,    90,    94,    85,
+      92,    93,    94,    38,    41,    42,    67,    10,    71,    72,
+      94,    94,    94,    53,    74,    77,    79,    85,    55,    78,
+      58,    23,    55,    78,    39,    40,    38,    93,    54,    55,
+      18,    19,    20,    73,    54,    54,    49,    50,    51,    56,
+      75,    76,    55,    22,    44,    45,    46,    58,    59,    60,
+      87,    90,    76,    93,    93,    30,    80,    72,    53,    54,
+      55,    53,    77,    76,    85,    88,    31,    33,    84,    50,
+      76,    75,    81,    82,    85,    50,    54,    54,    55,     8,
+      32,    83,    82
 };
 
-  /* YYR1[YYN] -- Symbol number of symbol that rule YYN derives.  */
+/* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr1[] =
 {
-       0,    47,    48,    48,    48,    48,    49,    49,    49,    49,
-      50,    50,    50,    50,    51,    52,    52,    52,    52,    52,
-      53,    53,    53,    53,    54,    54,    55,    56,    56,    56,
-      57,    57,    58,    58,    58,    59,    60,    60,    61,    61,
-      62,    62,    63,    63,    64,    64,    64,    64,    64,    64,
-      65,    65,    66,    66,    67,    68,    68,    69,    69,    69,
-      70,    71
+       0,    62,    63,    63,    63,    63,    64,    64,    64,    64,
+      65,    65,    65,    65,    66,    66,    67,    67,    67,    67,
+      68,    69,    69,    69,    69,    69,    69,    70,    70,    70,
+      70,    70,    71,    71,    72,    73,    73,    73,    74,    74,
+      75,    75,    76,    76,    76,    76,    77,    78,    78,    79,
+      79,    80,    80,    81,    81,    82,    83,    83,    83,    84,
+      84,    85,    85,    86,    86,    87,    87,    87,    87,    87,
+      87,    88,    88,    89,    89,    90,    91,    91,    92,    92,
+      92,    93,    94
 };
 
-  /* YYR2[YYN] -- Number of symbols on the right hand side of rule YYN.  */
+/* YYR2[RULE-NUM] -- Number of symbols on the right-hand side of rule RULE-NUM.  */
 static const yytype_int8 yyr2[] =
 {
        0,     2,     2,     1,     1,     1,     1,     1,     1,     1,
-       1,     1,     1,     1,     2,     6,     3,     2,     6,     6,
-       7,     4,     5,     5,     1,     3,     2,     1,     4,     1,
-       1,     3,     1,     1,     1,     3,     0,     2,     1,     3,
-       3,     1,     1,     3,     1,     1,     1,     1,     1,     1,
-       1,     1,     1,     3,     3,     1,     1,     1,     3,     3,
-       1,     1
+       2,     1,     1,     1,     0,     3,     2,     2,     2,     1,
+       2,     6,     3,     2,     6,     6,     2,     5,     5,     4,
+       5,     7,     1,     3,     2,     1,     4,     1,     3,     5,
+       1,     3,     1,     1,     1,     1,     3,     0,     2,     1,
+       3,     0,     3,     1,     3,     2,     0,     1,     1,     0,
+       2,     3,     1,     1,     3,     1,     1,     1,     1,     1,
+       1,     1,     1,     1,     3,     3,     1,     1,     1,     3,
+       3,     1,     1
 };
 
 
+enum { YYENOMEM = -2 };
+
 #define yyerrok         (yyerrstatus = 0)
 #define yyclearin       (yychar = YYEMPTY)
-#define YYEMPTY         (-2)
-#define YYEOF           0
 
 #define YYACCEPT        goto yyacceptlab
 #define YYABORT         goto yyabortlab
 #define YYERROR         goto yyerrorlab
+#define YYNOMEM         goto yyexhaustedlab
 
 
 #define YYRECOVERING()  (!!yyerrstatus)
@@ -761,15 +874,14 @@ static const yytype_int8 yyr2[] =
       }                                                           \
     else                                                          \
       {                                                           \
-        yyerror (&yylloc, YY_("syntax error: cannot back up")); \
+        yyerror (&yylloc, lexer, result, YY_("syntax error: cannot back up")); \
         YYERROR;                                                  \
       }                                                           \
   while (0)
 
-/* Error token number */
-#define YYTERROR        1
-#define YYERRCODE       256
-
+/* Backward compatibility with an undocumented macro.
+   Use YYerror or YYUNDEF. */
+#define YYERRCODE YYUNDEF
 
 /* YYLLOC_DEFAULT -- Set CURRENT to span from RHS[1] to RHS[N].
    If N is 0, then set CURRENT to the empty location which ends
@@ -813,12 +925,19 @@ do {                                            \
 } while (0)
 
 
-/* YY_LOCATION_PRINT -- Print the location on the stream.
+/* YYLOCATION_PRINT -- Print the location on the stream.
    This macro was not mandated originally: define only if we know
    we won't break user code: when these are the locations we know.  */
 
-#ifndef YY_LOCATION_PRINT
-# if defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL
+# ifndef YYLOCATION_PRINT
+
+#  if defined YY_LOCATION_PRINT
+
+   /* Temporary convenience wrapper in case some people defined the
+      undocumented and private YY_LOCATION_PRINT macros.  */
+#   define YYLOCATION_PRINT(File, Loc)  YY_LOCATION_PRINT(File, *(Loc))
+
+#  elif defined YYLTYPE_IS_TRIVIAL && YYLTYPE_IS_TRIVIAL
 
 /* Print *YYLOCP on YYO.  Private, do not rely on its existence. */
 
@@ -846,24 +965,32 @@ yy_location_print_ (FILE *yyo, YYLTYPE const * const yylocp)
         res += YYFPRINTF (yyo, "-%d", end_col);
     }
   return res;
- }
+}
 
-#  define YY_LOCATION_PRINT(File, Loc)          \
-  yy_location_print_ (File, &(Loc))
+#   define YYLOCATION_PRINT  yy_location_print_
 
-# else
-#  define YY_LOCATION_PRINT(File, Loc) ((void) 0)
-# endif
-#endif
+    /* Temporary convenience wrapper in case some people defined the
+       undocumented and private YY_LOCATION_PRINT macros.  */
+#   define YY_LOCATION_PRINT(File, Loc)  YYLOCATION_PRINT(File, &(Loc))
+
+#  else
+
+#   define YYLOCATION_PRINT(File, Loc) ((void) 0)
+    /* Temporary convenience wrapper in case some people defined the
+       undocumented and private YY_LOCATION_PRINT macros.  */
+#   define YY_LOCATION_PRINT  YYLOCATION_PRINT
+
+#  endif
+# endif /* !defined YYLOCATION_PRINT */
 
 
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)                    \
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)                    \
 do {                                                                      \
   if (yydebug)                                                            \
     {                                                                     \
       YYFPRINTF (stderr, "%s ", Title);                                   \
       yy_symbol_print (stderr,                                            \
-                  Type, Value, Location); \
+                  Kind, Value, Location, lexer, result); \
       YYFPRINTF (stderr, "\n");                                           \
     }                                                                     \
 } while (0)
@@ -874,19 +1001,18 @@ do {                                                                      \
 `-----------------------------------*/
 
 static void
-yy_symbol_value_print (FILE *yyo, int yytype, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp)
+yy_symbol_value_print (FILE *yyo,
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp, ast::Lexer *lexer, std::shared_ptr<ast::TreeNode> *result)
 {
   FILE *yyoutput = yyo;
-  YYUSE (yyoutput);
-  YYUSE (yylocationp);
+  YY_USE (yyoutput);
+  YY_USE (yylocationp);
+  YY_USE (lexer);
+  YY_USE (result);
   if (!yyvaluep)
     return;
-# ifdef YYPRINT
-  if (yytype < YYNTOKENS)
-    YYPRINT (yyo, yytoknum[yytype], *yyvaluep);
-# endif
   YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
-  YYUSE (yytype);
+  YY_USE (yykind);
   YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
 
@@ -896,14 +1022,15 @@ yy_symbol_value_print (FILE *yyo, int yytype, YYSTYPE const * const yyvaluep, YY
 `---------------------------*/
 
 static void
-yy_symbol_print (FILE *yyo, int yytype, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp)
+yy_symbol_print (FILE *yyo,
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, YYLTYPE const * const yylocationp, ast::Lexer *lexer, std::shared_ptr<ast::TreeNode> *result)
 {
   YYFPRINTF (yyo, "%s %s (",
-             yytype < YYNTOKENS ? "token" : "nterm", yytname[yytype]);
+             yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
 
-  YY_LOCATION_PRINT (yyo, *yylocationp);
+  YYLOCATION_PRINT (yyo, yylocationp);
   YYFPRINTF (yyo, ": ");
-  yy_symbol_value_print (yyo, yytype, yyvaluep, yylocationp);
+  yy_symbol_value_print (yyo, yykind, yyvaluep, yylocationp, lexer, result);
   YYFPRINTF (yyo, ")");
 }
 
@@ -936,7 +1063,8 @@ do {                                                            \
 `------------------------------------------------*/
 
 static void
-yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp, YYLTYPE *yylsp, int yyrule)
+yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp, YYLTYPE *yylsp,
+                 int yyrule, ast::Lexer *lexer, std::shared_ptr<ast::TreeNode> *result)
 {
   int yylno = yyrline[yyrule];
   int yynrhs = yyr2[yyrule];
@@ -948,9 +1076,9 @@ yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp, YYLTYPE *yylsp, int yyrule)
     {
       YYFPRINTF (stderr, "   $%d = ", yyi + 1);
       yy_symbol_print (stderr,
-                       yystos[+yyssp[yyi + 1 - yynrhs]],
-                       &yyvsp[(yyi + 1) - (yynrhs)]
-                       , &(yylsp[(yyi + 1) - (yynrhs)])                       );
+                       YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
+                       &yyvsp[(yyi + 1) - (yynrhs)],
+                       &(yylsp[(yyi + 1) - (yynrhs)]), lexer, result);
       YYFPRINTF (stderr, "\n");
     }
 }
@@ -958,15 +1086,15 @@ yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp, YYLTYPE *yylsp, int yyrule)
 # define YY_REDUCE_PRINT(Rule)          \
 do {                                    \
   if (yydebug)                          \
-    yy_reduce_print (yyssp, yyvsp, yylsp, Rule); \
+    yy_reduce_print (yyssp, yyvsp, yylsp, Rule, lexer, result); \
 } while (0)
 
 /* Nonzero means print parse trace.  It is left uninitialized so that
    multiple parsers can coexist.  */
 int yydebug;
 #else /* !YYDEBUG */
-# define YYDPRINTF(Args)
-# define YY_SYMBOL_PRINT(Title, Type, Value, Location)
+# define YYDPRINTF(Args) ((void) 0)
+# define YY_SYMBOL_PRINT(Title, Kind, Value, Location)
 # define YY_STACK_PRINT(Bottom, Top)
 # define YY_REDUCE_PRINT(Rule)
 #endif /* !YYDEBUG */
@@ -989,12 +1117,61 @@ int yydebug;
 #endif
 
 
-#if YYERROR_VERBOSE
+/* Context of a parse error.  */
+typedef struct
+{
+  yy_state_t *yyssp;
+  yysymbol_kind_t yytoken;
+  YYLTYPE *yylloc;
+} yypcontext_t;
+
+/* Put in YYARG at most YYARGN of the expected tokens given the
+   current YYCTX, and return the number of tokens stored in YYARG.  If
+   YYARG is null, return the number of expected tokens (guaranteed to
+   be less than YYNTOKENS).  Return YYENOMEM on memory exhaustion.
+   Return 0 if there are more than YYARGN expected tokens, yet fill
+   YYARG up to YYARGN. */
+static int
+yypcontext_expected_tokens (const yypcontext_t *yyctx,
+                            yysymbol_kind_t yyarg[], int yyargn)
+{
+  /* Actual size of YYARG. */
+  int yycount = 0;
+  int yyn = yypact[+*yyctx->yyssp];
+  if (!yypact_value_is_default (yyn))
+    {
+      /* Start YYX at -YYN if negative to avoid negative indexes in
+         YYCHECK.  In other words, skip the first -YYN actions for
+         this state because they are default actions.  */
+      int yyxbegin = yyn < 0 ? -yyn : 0;
+      /* Stay within bounds of both yycheck and yytname.  */
+      int yychecklim = YYLAST - yyn + 1;
+      int yyxend = yychecklim < YYNTOKENS ? yychecklim : YYNTOKENS;
+      int yyx;
+      for (yyx = yyxbegin; yyx < yyxend; ++yyx)
+        if (yycheck[yyx + yyn] == yyx && yyx != YYSYMBOL_YYerror
+            && !yytable_value_is_error (yytable[yyx + yyn]))
+          {
+            if (!yyarg)
+              ++yycount;
+            else if (yycount == yyargn)
+              return 0;
+            else
+              yyarg[yycount++] = YY_CAST (yysymbol_kind_t, yyx);
+          }
+    }
+  if (yyarg && yycount == 0 && 0 < yyargn)
+    yyarg[0] = YYSYMBOL_YYEMPTY;
+  return yycount;
+}
 
-# ifndef yystrlen
-#  if defined __GLIBC__ && defined _STRING_H
-#   define yystrlen(S) (YY_CAST (YYPTRDIFF_T, strlen (S)))
-#  else
+
+
+
+#ifndef yystrlen
+# if defined __GLIBC__ && defined _STRING_H
+#  define yystrlen(S) (YY_CAST (YYPTRDIFF_T, strlen (S)))
+# else
 /* Return the length of YYSTR.  */
 static YYPTRDIFF_T
 yystrlen (const char *yystr)
@@ -1004,13 +1181,13 @@ yystrlen (const char *yystr)
     continue;
   return yylen;
 }
-#  endif
 # endif
+#endif
 
-# ifndef yystpcpy
-#  if defined __GLIBC__ && defined _STRING_H && defined _GNU_SOURCE
-#   define yystpcpy stpcpy
-#  else
+#ifndef yystpcpy
+# if defined __GLIBC__ && defined _STRING_H && defined _GNU_SOURCE
+#  define yystpcpy stpcpy
+# else
 /* Copy YYSRC to YYDEST, returning the address of the terminating '\0' in
    YYDEST.  */
 static char *
@@ -1024,10 +1201,10 @@ yystpcpy (char *yydest, const char *yysrc)
 
   return yyd - 1;
 }
-#  endif
 # endif
+#endif
 
-# ifndef yytnamerr
+#ifndef yytnamerr
 /* Copy to YYRES the contents of YYSTR after stripping away unnecessary
    quotes and backslashes, so that it's suitable for yyerror.  The
    heuristic is that double-quoting is unnecessary unless the string
@@ -1042,7 +1219,6 @@ yytnamerr (char *yyres, const char *yystr)
     {
       YYPTRDIFF_T yyn = 0;
       char const *yyp = yystr;
-
       for (;;)
         switch (*++yyp)
           {
@@ -1076,31 +1252,15 @@ yytnamerr (char *yyres, const char *yystr)
   else
     return yystrlen (yystr);
 }
-# endif
+#endif
 
-/* Copy into *YYMSG, which is of size *YYMSG_ALLOC, an error message
-   about the unexpected token YYTOKEN for the state stack whose top is
-   YYSSP.
 
-   Return 0 if *YYMSG was successfully written.  Return 1 if *YYMSG is
-   not large enough to hold the message.  In that case, also set
-   *YYMSG_ALLOC to the required number of bytes.  Return 2 if the
-   required number of bytes is too large to store.  */
 static int
-yysyntax_error (YYPTRDIFF_T *yymsg_alloc, char **yymsg,
-                yy_state_t *yyssp, int yytoken)
+yy_syntax_error_arguments (const yypcontext_t *yyctx,
+                           yysymbol_kind_t yyarg[], int yyargn)
 {
-  enum { YYERROR_VERBOSE_ARGS_MAXIMUM = 5 };
-  /* Internationalized format string. */
-  const char *yyformat = YY_NULLPTR;
-  /* Arguments of yyformat: reported tokens (one for the "unexpected",
-     one per "expected"). */
-  char const *yyarg[YYERROR_VERBOSE_ARGS_MAXIMUM];
   /* Actual size of YYARG. */
   int yycount = 0;
-  /* Cumulated lengths of YYARG.  */
-  YYPTRDIFF_T yysize = 0;
-
   /* There are many possibilities here to consider:
      - If this state is a consistent state with a default action, then
        the only way this function was invoked is if the default action
@@ -1124,52 +1284,54 @@ yysyntax_error (YYPTRDIFF_T *yymsg_alloc, char **yymsg,
        one exception: it will still contain any token that will not be
        accepted due to an error action in a later state.
   */
-  if (yytoken != YYEMPTY)
-    {
-      int yyn = yypact[+*yyssp];
-      YYPTRDIFF_T yysize0 = yytnamerr (YY_NULLPTR, yytname[yytoken]);
-      yysize = yysize0;
-      yyarg[yycount++] = yytname[yytoken];
-      if (!yypact_value_is_default (yyn))
-        {
-          /* Start YYX at -YYN if negative to avoid negative indexes in
-             YYCHECK.  In other words, skip the first -YYN actions for
-             this state because they are default actions.  */
-          int yyxbegin = yyn < 0 ? -yyn : 0;
-          /* Stay within bounds of both yycheck and yytname.  */
-          int yychecklim = YYLAST - yyn + 1;
-          int yyxend = yychecklim < YYNTOKENS ? yychecklim : YYNTOKENS;
-          int yyx;
-
-          for (yyx = yyxbegin; yyx < yyxend; ++yyx)
-            if (yycheck[yyx + yyn] == yyx && yyx != YYTERROR
-                && !yytable_value_is_error (yytable[yyx + yyn]))
-              {
-                if (yycount == YYERROR_VERBOSE_ARGS_MAXIMUM)
-                  {
-                    yycount = 1;
-                    yysize = yysize0;
-                    break;
-                  }
-                yyarg[yycount++] = yytname[yyx];
-                {
-                  YYPTRDIFF_T yysize1
-                    = yysize + yytnamerr (YY_NULLPTR, yytname[yyx]);
-                  if (yysize <= yysize1 && yysize1 <= YYSTACK_ALLOC_MAXIMUM)
-                    yysize = yysize1;
-                  else
-                    return 2;
-                }
-              }
-        }
+  if (yyctx->yytoken != YYSYMBOL_YYEMPTY)
+    {
+      int yyn;
+      if (yyarg)
+        yyarg[yycount] = yyctx->yytoken;
+      ++yycount;
+      yyn = yypcontext_expected_tokens (yyctx,
+                                        yyarg ? yyarg + 1 : yyarg, yyargn - 1);
+      if (yyn == YYENOMEM)
+        return YYENOMEM;
+      else
+        yycount += yyn;
     }
+  return yycount;
+}
+
+/* Copy into *YYMSG, which is of size *YYMSG_ALLOC, an error message
+   about the unexpected token YYTOKEN for the state stack whose top is
+   YYSSP.
+
+   Return 0 if *YYMSG was successfully written.  Return -1 if *YYMSG is
+   not large enough to hold the message.  In that case, also set
+   *YYMSG_ALLOC to the required number of bytes.  Return YYENOMEM if the
+   required number of bytes is too large to store.  */
+static int
+yysyntax_error (YYPTRDIFF_T *yymsg_alloc, char **yymsg,
+                const yypcontext_t *yyctx)
+{
+  enum { YYARGS_MAX = 5 };
+  /* Internationalized format string. */
+  const char *yyformat = YY_NULLPTR;
+  /* Arguments of yyformat: reported tokens (one for the "unexpected",
+     one per "expected"). */
+  yysymbol_kind_t yyarg[YYARGS_MAX];
+  /* Cumulated lengths of YYARG.  */
+  YYPTRDIFF_T yysize = 0;
+
+  /* Actual size of YYARG. */
+  int yycount = yy_syntax_error_arguments (yyctx, yyarg, YYARGS_MAX);
+  if (yycount == YYENOMEM)
+    return YYENOMEM;
 
   switch (yycount)
     {
-# define YYCASE_(N, S)                      \
+#define YYCASE_(N, S)                       \
       case N:                               \
         yyformat = S;                       \
-      break
+        break
     default: /* Avoid compiler warnings. */
       YYCASE_(0, YY_("syntax error"));
       YYCASE_(1, YY_("syntax error, unexpected %s"));
@@ -1177,17 +1339,23 @@ yysyntax_error (YYPTRDIFF_T *yymsg_alloc, char **yymsg,
       YYCASE_(3, YY_("syntax error, unexpected %s, expecting %s or %s"));
       YYCASE_(4, YY_("syntax error, unexpected %s, expecting %s or %s or %s"));
       YYCASE_(5, YY_("syntax error, unexpected %s, expecting %s or %s or %s or %s"));
-# undef YYCASE_
+#undef YYCASE_
     }
 
+  /* Compute error message size.  Don't count the "%s"s, but reserve
+     room for the terminator.  */
+  yysize = yystrlen (yyformat) - 2 * yycount + 1;
   {
-    /* Don't count the "%s"s in the final size, but reserve room for
-       the terminator.  */
-    YYPTRDIFF_T yysize1 = yysize + (yystrlen (yyformat) - 2 * yycount) + 1;
-    if (yysize <= yysize1 && yysize1 <= YYSTACK_ALLOC_MAXIMUM)
-      yysize = yysize1;
-    else
-      return 2;
+    int yyi;
+    for (yyi = 0; yyi < yycount; ++yyi)
+      {
+        YYPTRDIFF_T yysize1
+          = yysize + yytnamerr (YY_NULLPTR, yytname[yyarg[yyi]]);
+        if (yysize <= yysize1 && yysize1 <= YYSTACK_ALLOC_MAXIMUM)
+          yysize = yysize1;
+        else
+          return YYENOMEM;
+      }
   }
 
   if (*yymsg_alloc < yysize)
@@ -1196,7 +1364,7 @@ yysyntax_error (YYPTRDIFF_T *yymsg_alloc, char **yymsg,
       if (! (yysize <= *yymsg_alloc
              && *yymsg_alloc <= YYSTACK_ALLOC_MAXIMUM))
         *yymsg_alloc = YYSTACK_ALLOC_MAXIMUM;
-      return 1;
+      return -1;
     }
 
   /* Avoid sprintf, as that infringes on the user's name space.
@@ -1208,7 +1376,7 @@ yysyntax_error (YYPTRDIFF_T *yymsg_alloc, char **yymsg,
     while ((*yyp = *yyformat) != '\0')
       if (*yyp == '%' && yyformat[1] == 's' && yyi < yycount)
         {
-          yyp += yytnamerr (yyp, yyarg[yyi++]);
+          yyp += yytnamerr (yyp, yytname[yyarg[yyi++]]);
           yyformat += 2;
         }
       else
@@ -1219,37 +1387,42 @@ yysyntax_error (YYPTRDIFF_T *yymsg_alloc, char **yymsg,
   }
   return 0;
 }
-#endif /* YYERROR_VERBOSE */
+
 
 /*-----------------------------------------------.
 | Release the memory associated to this symbol.  |
 `-----------------------------------------------*/
 
 static void
-yydestruct (const char *yymsg, int yytype, YYSTYPE *yyvaluep, YYLTYPE *yylocationp)
+yydestruct (const char *yymsg,
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep, YYLTYPE *yylocationp, ast::Lexer *lexer, std::shared_ptr<ast::TreeNode> *result)
 {
-  YYUSE (yyvaluep);
-  YYUSE (yylocationp);
+  YY_USE (yyvaluep);
+  YY_USE (yylocationp);
+  YY_USE (lexer);
+  YY_USE (result);
   if (!yymsg)
     yymsg = "Deleting";
-  YY_SYMBOL_PRINT (yymsg, yytype, yyvaluep, yylocationp);
+  YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
 
   YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
-  YYUSE (yytype);
+  YY_USE (yykind);
   YY_IGNORE_MAYBE_UNINITIALIZED_END
 }
 
 
 
 
+
+
 /*----------.
 | yyparse.  |
 `----------*/
 
 int
-yyparse (void)
+yyparse (ast::Lexer *lexer, std::shared_ptr<ast::TreeNode> *result)
 {
-/* The lookahead symbol.  */
+/* Lookahead token kind.  */
 int yychar;
 
 
@@ -1268,55 +1441,50 @@ static YYLTYPE yyloc_default
 YYLTYPE yylloc = yyloc_default;
 
     /* Number of syntax errors so far.  */
-    int yynerrs;
+    int yynerrs = 0;
 
-    yy_state_fast_t yystate;
+    yy_state_fast_t yystate = 0;
     /* Number of tokens to shift before error messages enabled.  */
-    int yyerrstatus;
+    int yyerrstatus = 0;
 
-    /* The stacks and their tools:
-       'yyss': related to states.
-       'yyvs': related to semantic values.
-       'yyls': related to locations.
-
-       Refer to the stacks through separate pointers, to allow yyoverflow
+    /* Refer to the stacks through separate pointers, to allow yyoverflow
        to reallocate them elsewhere.  */
 
-    /* The state stack.  */
+    /* Their size.  */
+    YYPTRDIFF_T yystacksize = YYINITDEPTH;
+
+    /* The state stack: array, bottom, top.  */
     yy_state_t yyssa[YYINITDEPTH];
-    yy_state_t *yyss;
-    yy_state_t *yyssp;
+    yy_state_t *yyss = yyssa;
+    yy_state_t *yyssp = yyss;
 
-    /* The semantic value stack.  */
+    /* The semantic value stack: array, bottom, top.  */
     YYSTYPE yyvsa[YYINITDEPTH];
-    YYSTYPE *yyvs;
-    YYSTYPE *yyvsp;
+    YYSTYPE *yyvs = yyvsa;
+    YYSTYPE *yyvsp = yyvs;
 
-    /* The location stack.  */
+    /* The location stack: array, bottom, top.  */
     YYLTYPE yylsa[YYINITDEPTH];
-    YYLTYPE *yyls;
-    YYLTYPE *yylsp;
-
-    /* The locations where the error started and ended.  */
-    YYLTYPE yyerror_range[3];
-
-    YYPTRDIFF_T yystacksize;
+    YYLTYPE *yyls = yylsa;
+    YYLTYPE *yylsp = yyls;
 
   int yyn;
+  /* The return value of yyparse.  */
   int yyresult;
-  /* Lookahead token as an internal (translated) token number.  */
-  int yytoken = 0;
+  /* Lookahead symbol kind.  */
+  yysymbol_kind_t yytoken = YYSYMBOL_YYEMPTY;
   /* The variables used to return semantic value and location from the
      action routines.  */
   YYSTYPE yyval;
   YYLTYPE yyloc;
 
-#if YYERROR_VERBOSE
+  /* The locations where the error started and ended.  */
+  YYLTYPE yyerror_range[3];
+
   /* Buffer for error messages, and its allocated size.  */
   char yymsgbuf[128];
   char *yymsg = yymsgbuf;
   YYPTRDIFF_T yymsg_alloc = sizeof yymsgbuf;
-#endif
 
 #define YYPOPSTACK(N)   (yyvsp -= (N), yyssp -= (N), yylsp -= (N))
 
@@ -1324,17 +1492,10 @@ YYLTYPE yylloc = yyloc_default;
      Keep to zero when no symbol should be popped.  */
   int yylen = 0;
 
-  yyssp = yyss = yyssa;
-  yyvsp = yyvs = yyvsa;
-  yylsp = yyls = yylsa;
-  yystacksize = YYINITDEPTH;
-
   YYDPRINTF ((stderr, "Starting parse\n"));
 
-  yystate = 0;
-  yyerrstatus = 0;
-  yynerrs = 0;
   yychar = YYEMPTY; /* Cause a token to be read.  */
+
   yylsp[0] = yylloc;
   goto yysetstate;
 
@@ -1357,10 +1518,11 @@ yysetstate:
   YY_IGNORE_USELESS_CAST_BEGIN
   *yyssp = YY_CAST (yy_state_t, yystate);
   YY_IGNORE_USELESS_CAST_END
+  YY_STACK_PRINT (yyss, yyssp);
 
   if (yyss + yystacksize - 1 <= yyssp)
 #if !defined yyoverflow && !defined YYSTACK_RELOCATE
-    goto yyexhaustedlab;
+    YYNOMEM;
 #else
     {
       /* Get the current used size of the three stacks, in elements.  */
@@ -1391,7 +1553,7 @@ yysetstate:
 # else /* defined YYSTACK_RELOCATE */
       /* Extend the stack our own way.  */
       if (YYMAXDEPTH <= yystacksize)
-        goto yyexhaustedlab;
+        YYNOMEM;
       yystacksize *= 2;
       if (YYMAXDEPTH < yystacksize)
         yystacksize = YYMAXDEPTH;
@@ -1402,11 +1564,11 @@ yysetstate:
           YY_CAST (union yyalloc *,
                    YYSTACK_ALLOC (YY_CAST (YYSIZE_T, YYSTACK_BYTES (yystacksize))));
         if (! yyptr)
-          goto yyexhaustedlab;
+          YYNOMEM;
         YYSTACK_RELOCATE (yyss_alloc, yyss);
         YYSTACK_RELOCATE (yyvs_alloc, yyvs);
         YYSTACK_RELOCATE (yyls_alloc, yyls);
-# undef YYSTACK_RELOCATE
+#  undef YYSTACK_RELOCATE
         if (yyss1 != yyssa)
           YYSTACK_FREE (yyss1);
       }
@@ -1426,6 +1588,7 @@ yysetstate:
     }
 #endif /* !defined yyoverflow && !defined YYSTACK_RELOCATE */
 
+
   if (yystate == YYFINAL)
     YYACCEPT;
 
@@ -1446,18 +1609,30 @@ yybackup:
 
   /* Not known => get a lookahead token if don't already have one.  */
 
-  /* YYCHAR is either YYEMPTY or YYEOF or a valid lookahead symbol.  */
+  /* YYCHAR is either empty, or end-of-input, or a valid lookahead.  */
   if (yychar == YYEMPTY)
     {
-      YYDPRINTF ((stderr, "Reading a token: "));
-      yychar = yylex (&yylval, &yylloc);
+      YYDPRINTF ((stderr, "Reading a token\n"));
+      yychar = yylex (&yylval, &yylloc, lexer);
     }
 
   if (yychar <= YYEOF)
     {
-      yychar = yytoken = YYEOF;
+      yychar = YYEOF;
+      yytoken = YYSYMBOL_YYEOF;
       YYDPRINTF ((stderr, "Now at end of input.\n"));
     }
+  else if (yychar == YYerror)
+    {
+      /* The scanner already issued an error message, process directly
+         to error recovery.  But do not keep the error token as
+         lookahead, it is too special and may lead us to an endless
+         loop in error recovery. */
+      yychar = YYUNDEF;
+      yytoken = YYSYMBOL_YYerror;
+      yyerror_range[1] = yylloc;
+      goto yyerrlab1;
+    }
   else
     {
       yytoken = YYTRANSLATE (yychar);
@@ -1529,434 +1704,600 @@ yyreduce:
   YY_REDUCE_PRINT (yyn);
   switch (yyn)
     {
-  case 2:
-#line 55 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 2: /* start: stmt ';'  */
+#line 113 "yacc.y"
     {
-        parse_tree = (yyvsp[-1].sv_node);
+        *result = (yyvsp[-1].sv_node);
         YYACCEPT;
     }
-#line 1539 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1714 "yacc.tab.cpp"
     break;
 
-  case 3:
-#line 60 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 3: /* start: HELP  */
+#line 118 "yacc.y"
     {
-        parse_tree = std::make_shared<Help>();
+        *result = std::make_shared<Help>();
         YYACCEPT;
     }
-#line 1548 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1723 "yacc.tab.cpp"
     break;
 
-  case 4:
-#line 65 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 4: /* start: EXIT  */
+#line 123 "yacc.y"
     {
-        parse_tree = nullptr;
+        *result = nullptr;
         YYACCEPT;
     }
-#line 1557 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1732 "yacc.tab.cpp"
     break;
 
-  case 5:
-#line 70 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 5: /* start: T_EOF  */
+#line 128 "yacc.y"
     {
-        parse_tree = nullptr;
+        *result = nullptr;
         YYACCEPT;
     }
-#line 1566 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1741 "yacc.tab.cpp"
     break;
 
-  case 10:
-#line 85 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 10: /* txnStmt: TXN_BEGIN optIsolationLevel  */
+#line 143 "yacc.y"
     {
-        (yyval.sv_node) = std::make_shared<TxnBegin>();
+        (yyval.sv_node) = std::make_shared<TxnBegin>((yyvsp[0].sv_isolation_level));
     }
-#line 1574 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1749 "yacc.tab.cpp"
     break;
 
-  case 11:
-#line 89 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 11: /* txnStmt: TXN_COMMIT  */
+#line 147 "yacc.y"
     {
         (yyval.sv_node) = std::make_shared<TxnCommit>();
     }
-#line 1582 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1757 "yacc.tab.cpp"
     break;
 
-  case 12:
-#line 93 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 12: /* txnStmt: TXN_ABORT  */
+#line 151 "yacc.y"
     {
         (yyval.sv_node) = std::make_shared<TxnAbort>();
     }
-#line 1590 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1765 "yacc.tab.cpp"
     break;
 
-  case 13:
-#line 97 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 13: /* txnStmt: TXN_ROLLBACK  */
+#line 155 "yacc.y"
     {
         (yyval.sv_node) = std::make_shared<TxnRollback>();
     }
-#line 1598 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1773 "yacc.tab.cpp"
+    break;
+
+  case 14: /* optIsolationLevel: %empty  */
+#line 162 "yacc.y"
+    {
+        (yyval.sv_isolation_level) = SV_ISOLATION_DEFAULT;
+    }
+#line 1781 "yacc.tab.cpp"
+    break;
+
+  case 15: /* optIsolationLevel: ISOLATION LEVEL isolationLevel  */
+#line 166 "yacc.y"
+    {
+        (yyval.sv_isolation_level) = (yyvsp[0].sv_isolation_level);
+    }
+#line 1789 "yacc.tab.cpp"
+    break;
+
+  case 16: /* isolationLevel: READ UNCOMMITTED  */
+#line 173 "yacc.y"
+    {
+        (yyval.sv_isolation_level) = SV_READ_UNCOMMITTED;
+    }
+#line 1797 "yacc.tab.cpp"
+    break;
+
+  case 17: /* isolationLevel: READ COMMITTED  */
+#line 177 "yacc.y"
+    {
+        (yyval.sv_isolation_level) = SV_READ_COMMITTED;
+    }
+#line 1805 "yacc.tab.cpp"
+    break;
+
+  case 18: /* isolationLevel: REPEATABLE READ  */
+#line 181 "yacc.y"
+    {
+        (yyval.sv_isolation_level) = SV_REPEATABLE_READ;
+    }
+#line 1813 "yacc.tab.cpp"
     break;
 
-  case 14:
-#line 104 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 19: /* isolationLevel: SERIALIZABLE  */
+#line 185 "yacc.y"
+    {
+        (yyval.sv_isolation_level) = SV_SERIALIZABLE;
+    }
+#line 1821 "yacc.tab.cpp"
+    break;
+
+  case 20: /* dbStmt: SHOW TABLES  */
+#line 192 "yacc.y"
     {
         (yyval.sv_node) = std::make_shared<ShowTables>();
     }
-#line 1606 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1829 "yacc.tab.cpp"
     break;
 
-  case 15:
-#line 111 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 21: /* ddl: CREATE TABLE tbName '(' fieldList ')'  */
+#line 199 "yacc.y"
     {
         (yyval.sv_node) = std::make_shared<CreateTable>((yyvsp[-3].sv_str), (yyvsp[-1].sv_fields));
     }
-#line 1614 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1837 "yacc.tab.cpp"
     break;
 
-  case 16:
-#line 115 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 22: /* ddl: DROP TABLE tbName  */
+#line 203 "yacc.y"
     {
         (yyval.sv_node) = std::make_shared<DropTable>((yyvsp[0].sv_str));
     }
-#line 1622 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1845 "yacc.tab.cpp"
     break;
 
-  case 17:
-#line 119 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 23: /* ddl: DESC tbName  */
+#line 207 "yacc.y"
     {
         (yyval.sv_node) = std::make_shared<DescTable>((yyvsp[0].sv_str));
     }
-#line 1630 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1853 "yacc.tab.cpp"
     break;
 
-  case 18:
-#line 123 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 24: /* ddl: CREATE INDEX tbName '(' colName ')'  */
+#line 211 "yacc.y"
     {
         (yyval.sv_node) = std::make_shared<CreateIndex>((yyvsp[-3].sv_str), (yyvsp[-1].sv_str));
     }
-#line 1638 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1861 "yacc.tab.cpp"
     break;
 
-  case 19:
-#line 127 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 25: /* ddl: DROP INDEX tbName '(' colName ')'  */
+#line 215 "yacc.y"
     {
         (yyval.sv_node) = std::make_shared<DropIndex>((yyvsp[-3].sv_str), (yyvsp[-1].sv_str));
     }
-#line 1646 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1869 "yacc.tab.cpp"
+    break;
+
+  case 26: /* ddl: ANALYZE tbName  */
+#line 219 "yacc.y"
+    {
+        (yyval.sv_node) = std::make_shared<AnalyzeTable>((yyvsp[0].sv_str));
+    }
+#line 1877 "yacc.tab.cpp"
     break;
 
-  case 20:
-#line 134 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 27: /* dml: INSERT INTO tbName VALUES valueRows  */
+#line 226 "yacc.y"
     {
-        (yyval.sv_node) = std::make_shared<InsertStmt>((yyvsp[-4].sv_str), (yyvsp[-1].sv_vals));
+        (yyval.sv_node) = std::make_shared<InsertStmt>((yyvsp[-2].sv_str), (yyvsp[0].sv_val_rows));
     }
-#line 1654 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1885 "yacc.tab.cpp"
     break;
 
-  case 21:
-#line 138 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 28: /* dml: LOAD DATA VALUE_STRING INTO tbName  */
+#line 230 "yacc.y"
+    {
+        (yyval.sv_node) = std::make_shared<LoadData>((yyvsp[-2].sv_str), (yyvsp[0].sv_str));
+    }
+#line 1893 "yacc.tab.cpp"
+    break;
+
+  case 29: /* dml: DELETE FROM tbName optWhereClause  */
+#line 234 "yacc.y"
     {
         (yyval.sv_node) = std::make_shared<DeleteStmt>((yyvsp[-1].sv_str), (yyvsp[0].sv_conds));
     }
-#line 1662 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1901 "yacc.tab.cpp"
     break;
 
-  case 22:
-#line 142 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 30: /* dml: UPDATE tbName SET setClauses optWhereClause  */
+#line 238 "yacc.y"
     {
         (yyval.sv_node) = std::make_shared<UpdateStmt>((yyvsp[-3].sv_str), (yyvsp[-1].sv_set_clauses), (yyvsp[0].sv_conds));
     }
-#line 1670 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1909 "yacc.tab.cpp"
     break;
 
-  case 23:
-#line 146 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 31: /* dml: SELECT selector FROM tableList optWhereClause optOrderClause optLimitClause  */
+#line 242 "yacc.y"
     {
-        (yyval.sv_node) = std::make_shared<SelectStmt>((yyvsp[-3].sv_cols), (yyvsp[-1].sv_strs), (yyvsp[0].sv_conds));
+        (yyval.sv_node) = std::make_shared<SelectStmt>((yyvsp[-5].sv_cols), (yyvsp[-3].sv_strs), (yyvsp[-2].sv_conds), (yyvsp[-1].sv_orders), (yyvsp[0].sv_int));
     }
-#line 1678 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1917 "yacc.tab.cpp"
     break;
 
-  case 24:
-#line 153 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 32: /* fieldList: field  */
+#line 249 "yacc.y"
     {
         (yyval.sv_fields) = std::vector<std::shared_ptr<Field>>{(yyvsp[0].sv_field)};
     }
-#line 1686 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1925 "yacc.tab.cpp"
     break;
 
-  case 25:
-#line 157 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 33: /* fieldList: fieldList ',' field  */
+#line 253 "yacc.y"
     {
         (yyval.sv_fields).push_back((yyvsp[0].sv_field));
     }
-#line 1694 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1933 "yacc.tab.cpp"
     break;
 
-  case 26:
-#line 164 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 34: /* field: colName type  */
+#line 260 "yacc.y"
     {
         (yyval.sv_field) = std::make_shared<ColDef>((yyvsp[-1].sv_str), (yyvsp[0].sv_type_len));
     }
-#line 1702 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1941 "yacc.tab.cpp"
     break;
 
-  case 27:
-#line 171 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 35: /* type: INT  */
+#line 267 "yacc.y"
     {
         (yyval.sv_type_len) = std::make_shared<TypeLen>(SV_TYPE_INT, sizeof(int));
     }
-#line 1710 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1949 "yacc.tab.cpp"
     break;
 
-  case 28:
-#line 175 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 36: /* type: CHAR '(' VALUE_INT ')'  */
+#line 271 "yacc.y"
     {
         (yyval.sv_type_len) = std::make_shared<TypeLen>(SV_TYPE_STRING, (yyvsp[-1].sv_int));
     }
-#line 1718 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1957 "yacc.tab.cpp"
     break;
 
-  case 29:
-#line 179 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 37: /* type: FLOAT  */
+#line 275 "yacc.y"
     {
         (yyval.sv_type_len) = std::make_shared<TypeLen>(SV_TYPE_FLOAT, sizeof(float));
     }
-#line 1726 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1965 "yacc.tab.cpp"
+    break;
+
+  case 38: /* valueRows: '(' valueList ')'  */
+#line 282 "yacc.y"
+    {
+        (yyval.sv_val_rows) = std::vector<std::vector<std::shared_ptr<Value>>>{(yyvsp[-1].sv_vals)};
+    }
+#line 1973 "yacc.tab.cpp"
     break;
 
-  case 30:
-#line 186 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 39: /* valueRows: valueRows ',' '(' valueList ')'  */
+#line 286 "yacc.y"
+    {
+        (yyval.sv_val_rows).push_back((yyvsp[-1].sv_vals));
+    }
+#line 1981 "yacc.tab.cpp"
+    break;
+
+  case 40: /* valueList: value  */
+#line 293 "yacc.y"
     {
         (yyval.sv_vals) = std::vector<std::shared_ptr<Value>>{(yyvsp[0].sv_val)};
     }
-#line 1734 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1989 "yacc.tab.cpp"
     break;
 
-  case 31:
-#line 190 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 41: /* valueList: valueList ',' value  */
+#line 297 "yacc.y"
     {
         (yyval.sv_vals).push_back((yyvsp[0].sv_val));
     }
-#line 1742 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 1997 "yacc.tab.cpp"
     break;
 
-  case 32:
-#line 197 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 42: /* value: VALUE_INT  */
+#line 304 "yacc.y"
     {
         (yyval.sv_val) = std::make_shared<IntLit>((yyvsp[0].sv_int));
     }
-#line 1750 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2005 "yacc.tab.cpp"
     break;
 
-  case 33:
-#line 201 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 43: /* value: VALUE_FLOAT  */
+#line 308 "yacc.y"
     {
         (yyval.sv_val) = std::make_shared<FloatLit>((yyvsp[0].sv_float));
     }
-#line 1758 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2013 "yacc.tab.cpp"
     break;
 
-  case 34:
-#line 205 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 44: /* value: VALUE_STRING  */
+#line 312 "yacc.y"
     {
         (yyval.sv_val) = std::make_shared<StringLit>((yyvsp[0].sv_str));
     }
-#line 1766 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2021 "yacc.tab.cpp"
+    break;
+
+  case 45: /* value: '?'  */
+#line 316 "yacc.y"
+    {
+        (yyval.sv_val) = std::make_shared<Param>();
+    }
+#line 2029 "yacc.tab.cpp"
     break;
 
-  case 35:
-#line 212 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 46: /* condition: col op expr  */
+#line 323 "yacc.y"
     {
         (yyval.sv_cond) = std::make_shared<BinaryExpr>((yyvsp[-2].sv_col), (yyvsp[-1].sv_comp_op), (yyvsp[0].sv_expr));
     }
-#line 1774 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2037 "yacc.tab.cpp"
     break;
 
-  case 36:
-#line 218 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 47: /* optWhereClause: %empty  */
+#line 329 "yacc.y"
                       { /* ignore*/ }
-#line 1780 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2043 "yacc.tab.cpp"
     break;
 
-  case 37:
-#line 220 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 48: /* optWhereClause: WHERE whereClause  */
+#line 331 "yacc.y"
     {
         (yyval.sv_conds) = (yyvsp[0].sv_conds);
     }
-#line 1788 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2051 "yacc.tab.cpp"
     break;
 
-  case 38:
-#line 227 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 49: /* whereClause: condition  */
+#line 338 "yacc.y"
     {
         (yyval.sv_conds) = std::vector<std::shared_ptr<BinaryExpr>>{(yyvsp[0].sv_cond)};
     }
-#line 1796 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2059 "yacc.tab.cpp"
     break;
 
-  case 39:
-#line 231 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 50: /* whereClause: whereClause AND condition  */
+#line 342 "yacc.y"
     {
         (yyval.sv_conds).push_back((yyvsp[0].sv_cond));
     }
-#line 1804 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2067 "yacc.tab.cpp"
+    break;
+
+  case 51: /* optOrderClause: %empty  */
+#line 348 "yacc.y"
+                      { /* ignore*/ }
+#line 2073 "yacc.tab.cpp"
+    break;
+
+  case 52: /* optOrderClause: ORDER BY orderList  */
+#line 350 "yacc.y"
+    {
+        (yyval.sv_orders) = (yyvsp[0].sv_orders);
+    }
+#line 2081 "yacc.tab.cpp"
+    break;
+
+  case 53: /* orderList: orderItem  */
+#line 357 "yacc.y"
+    {
+        (yyval.sv_orders) = std::vector<std::shared_ptr<OrderBy>>{(yyvsp[0].sv_order)};
+    }
+#line 2089 "yacc.tab.cpp"
+    break;
+
+  case 54: /* orderList: orderList ',' orderItem  */
+#line 361 "yacc.y"
+    {
+        (yyval.sv_orders).push_back((yyvsp[0].sv_order));
+    }
+#line 2097 "yacc.tab.cpp"
+    break;
+
+  case 55: /* orderItem: col optOrderDir  */
+#line 368 "yacc.y"
+    {
+        (yyval.sv_order) = std::make_shared<OrderBy>((yyvsp[-1].sv_col), (yyvsp[0].sv_bool));
+    }
+#line 2105 "yacc.tab.cpp"
+    break;
+
+  case 56: /* optOrderDir: %empty  */
+#line 375 "yacc.y"
+    {
+        (yyval.sv_bool) = false;
+    }
+#line 2113 "yacc.tab.cpp"
+    break;
+
+  case 57: /* optOrderDir: ASC  */
+#line 379 "yacc.y"
+    {
+        (yyval.sv_bool) = false;
+    }
+#line 2121 "yacc.tab.cpp"
     break;
 
-  case 40:
-#line 238 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 58: /* optOrderDir: DESC  */
+#line 383 "yacc.y"
+    {
+        (yyval.sv_bool) = true;
+    }
+#line 2129 "yacc.tab.cpp"
+    break;
+
+  case 59: /* optLimitClause: %empty  */
+#line 390 "yacc.y"
+    {
+        (yyval.sv_int) = -1;
+    }
+#line 2137 "yacc.tab.cpp"
+    break;
+
+  case 60: /* optLimitClause: LIMIT VALUE_INT  */
+#line 394 "yacc.y"
+    {
+        (yyval.sv_int) = (yyvsp[0].sv_int);
+    }
+#line 2145 "yacc.tab.cpp"
+    break;
+
+  case 61: /* col: tbName '.' colName  */
+#line 401 "yacc.y"
     {
         (yyval.sv_col) = std::make_shared<Col>((yyvsp[-2].sv_str), (yyvsp[0].sv_str));
     }
-#line 1812 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2153 "yacc.tab.cpp"
     break;
 
-  case 41:
-#line 242 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 62: /* col: colName  */
+#line 405 "yacc.y"
     {
         (yyval.sv_col) = std::make_shared<Col>("", (yyvsp[0].sv_str));
     }
-#line 1820 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2161 "yacc.tab.cpp"
     break;
 
-  case 42:
-#line 249 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 63: /* colList: col  */
+#line 412 "yacc.y"
     {
         (yyval.sv_cols) = std::vector<std::shared_ptr<Col>>{(yyvsp[0].sv_col)};
     }
-#line 1828 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2169 "yacc.tab.cpp"
     break;
 
-  case 43:
-#line 253 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 64: /* colList: colList ',' col  */
+#line 416 "yacc.y"
     {
         (yyval.sv_cols).push_back((yyvsp[0].sv_col));
     }
-#line 1836 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2177 "yacc.tab.cpp"
     break;
 
-  case 44:
-#line 260 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 65: /* op: '='  */
+#line 423 "yacc.y"
     {
         (yyval.sv_comp_op) = SV_OP_EQ;
     }
-#line 1844 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2185 "yacc.tab.cpp"
     break;
 
-  case 45:
-#line 264 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 66: /* op: '<'  */
+#line 427 "yacc.y"
     {
         (yyval.sv_comp_op) = SV_OP_LT;
     }
-#line 1852 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2193 "yacc.tab.cpp"
     break;
 
-  case 46:
-#line 268 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 67: /* op: '>'  */
+#line 431 "yacc.y"
     {
         (yyval.sv_comp_op) = SV_OP_GT;
     }
-#line 1860 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2201 "yacc.tab.cpp"
     break;
 
-  case 47:
-#line 272 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 68: /* op: NEQ  */
+#line 435 "yacc.y"
     {
         (yyval.sv_comp_op) = SV_OP_NE;
     }
-#line 1868 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2209 "yacc.tab.cpp"
     break;
 
-  case 48:
-#line 276 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 69: /* op: LEQ  */
+#line 439 "yacc.y"
     {
         (yyval.sv_comp_op) = SV_OP_LE;
     }
-#line 1876 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2217 "yacc.tab.cpp"
     break;
 
-  case 49:
-#line 280 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 70: /* op: GEQ  */
+#line 443 "yacc.y"
     {
         (yyval.sv_comp_op) = SV_OP_GE;
     }
-#line 1884 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2225 "yacc.tab.cpp"
     break;
 
-  case 50:
-#line 287 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 71: /* expr: value  */
+#line 450 "yacc.y"
     {
         (yyval.sv_expr) = std::static_pointer_cast<Expr>((yyvsp[0].sv_val));
     }
-#line 1892 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2233 "yacc.tab.cpp"
     break;
 
-  case 51:
-#line 291 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 72: /* expr: col  */
+#line 454 "yacc.y"
     {
         (yyval.sv_expr) = std::static_pointer_cast<Expr>((yyvsp[0].sv_col));
     }
-#line 1900 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2241 "yacc.tab.cpp"
     break;
 
-  case 52:
-#line 298 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 73: /* setClauses: setClause  */
+#line 461 "yacc.y"
     {
         (yyval.sv_set_clauses) = std::vector<std::shared_ptr<SetClause>>{(yyvsp[0].sv_set_clause)};
     }
-#line 1908 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2249 "yacc.tab.cpp"
     break;
 
-  case 53:
-#line 302 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 74: /* setClauses: setClauses ',' setClause  */
+#line 465 "yacc.y"
     {
         (yyval.sv_set_clauses).push_back((yyvsp[0].sv_set_clause));
     }
-#line 1916 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2257 "yacc.tab.cpp"
     break;
 
-  case 54:
-#line 309 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 75: /* setClause: colName '=' value  */
+#line 472 "yacc.y"
     {
         (yyval.sv_set_clause) = std::make_shared<SetClause>((yyvsp[-2].sv_str), (yyvsp[0].sv_val));
     }
-#line 1924 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2265 "yacc.tab.cpp"
     break;
 
-  case 55:
-#line 316 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 76: /* selector: '*'  */
+#line 479 "yacc.y"
     {
         (yyval.sv_cols) = {};
     }
-#line 1932 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2273 "yacc.tab.cpp"
     break;
 
-  case 57:
-#line 324 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 78: /* tableList: tbName  */
+#line 487 "yacc.y"
     {
         (yyval.sv_strs) = std::vector<std::string>{(yyvsp[0].sv_str)};
     }
-#line 1940 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2281 "yacc.tab.cpp"
     break;
 
-  case 58:
-#line 328 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 79: /* tableList: tableList ',' tbName  */
+#line 491 "yacc.y"
     {
         (yyval.sv_strs).push_back((yyvsp[0].sv_str));
     }
-#line 1948 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2289 "yacc.tab.cpp"
     break;
 
-  case 59:
-#line 332 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+  case 80: /* tableList: tableList JOIN tbName  */
+#line 495 "yacc.y"
     {
         (yyval.sv_strs).push_back((yyvsp[0].sv_str));
     }
-#line 1956 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2297 "yacc.tab.cpp"
     break;
 
 
-#line 1960 "/home/aaron/rucdeke/rucbase/src/parser/yacc.tab.cpp"
+#line 2301 "yacc.tab.cpp"
 
       default: break;
     }
@@ -1971,11 +2312,10 @@ yyreduce:
      case of YYERROR or YYBACKUP, subsequent parser actions might lead
      to an incorrect destructor call or verbose syntax error message
      before the lookahead is translated.  */
-  YY_SYMBOL_PRINT ("-> $$ =", yyr1[yyn], &yyval, &yyloc);
+  YY_SYMBOL_PRINT ("-> $$ =", YY_CAST (yysymbol_kind_t, yyr1[yyn]), &yyval, &yyloc);
 
   YYPOPSTACK (yylen);
   yylen = 0;
-  YY_STACK_PRINT (yyss, yyssp);
 
   *++yyvsp = yyval;
   *++yylsp = yyloc;
@@ -2000,50 +2340,45 @@ yyreduce:
 yyerrlab:
   /* Make sure we have latest lookahead translation.  See comments at
      user semantic actions for why this is necessary.  */
-  yytoken = yychar == YYEMPTY ? YYEMPTY : YYTRANSLATE (yychar);
-
+  yytoken = yychar == YYEMPTY ? YYSYMBOL_YYEMPTY : YYTRANSLATE (yychar);
   /* If not already recovering from an error, report this error.  */
   if (!yyerrstatus)
     {
       ++yynerrs;
-#if ! YYERROR_VERBOSE
-      yyerror (&yylloc, YY_("syntax error"));
-#else
-# define YYSYNTAX_ERROR yysyntax_error (&yymsg_alloc, &yymsg, \
-                                        yyssp, yytoken)
       {
+        yypcontext_t yyctx
+          = {yyssp, yytoken, &yylloc};
         char const *yymsgp = YY_("syntax error");
         int yysyntax_error_status;
-        yysyntax_error_status = YYSYNTAX_ERROR;
+        yysyntax_error_status = yysyntax_error (&yymsg_alloc, &yymsg, &yyctx);
         if (yysyntax_error_status == 0)
           yymsgp = yymsg;
-        else if (yysyntax_error_status == 1)
+        else if (yysyntax_error_status == -1)
           {
             if (yymsg != yymsgbuf)
               YYSTACK_FREE (yymsg);
-            yymsg = YY_CAST (char *, YYSTACK_ALLOC (YY_CAST (YYSIZE_T, yymsg_alloc)));
-            if (!yymsg)
+            yymsg = YY_CAST (char *,
+                             YYSTACK_ALLOC (YY_CAST (YYSIZE_T, yymsg_alloc)));
+            if (yymsg)
               {
-                yymsg = yymsgbuf;
-                yymsg_alloc = sizeof yymsgbuf;
-                yysyntax_error_status = 2;
+                yysyntax_error_status
+                  = yysyntax_error (&yymsg_alloc, &yymsg, &yyctx);
+                yymsgp = yymsg;
               }
             else
               {
-                yysyntax_error_status = YYSYNTAX_ERROR;
-                yymsgp = yymsg;
+                yymsg = yymsgbuf;
+                yymsg_alloc = sizeof yymsgbuf;
+                yysyntax_error_status = YYENOMEM;
               }
           }
-        yyerror (&yylloc, yymsgp);
-        if (yysyntax_error_status == 2)
-          goto yyexhaustedlab;
+        yyerror (&yylloc, lexer, result, yymsgp);
+        if (yysyntax_error_status == YYENOMEM)
+          YYNOMEM;
       }
-# undef YYSYNTAX_ERROR
-#endif
     }
 
   yyerror_range[1] = yylloc;
-
   if (yyerrstatus == 3)
     {
       /* If just tried and failed to reuse lookahead token after an
@@ -2058,7 +2393,7 @@ yyerrlab:
       else
         {
           yydestruct ("Error: discarding",
-                      yytoken, &yylval, &yylloc);
+                      yytoken, &yylval, &yylloc, lexer, result);
           yychar = YYEMPTY;
         }
     }
@@ -2076,6 +2411,7 @@ yyerrorlab:
      label yyerrorlab therefore never appears in user code.  */
   if (0)
     YYERROR;
+  ++yynerrs;
 
   /* Do not reclaim the symbols of the rule whose action triggered
      this YYERROR.  */
@@ -2092,13 +2428,14 @@ yyerrorlab:
 yyerrlab1:
   yyerrstatus = 3;      /* Each real token shifted decrements this.  */
 
+  /* Pop stack until we find a state that shifts the error token.  */
   for (;;)
     {
       yyn = yypact[yystate];
       if (!yypact_value_is_default (yyn))
         {
-          yyn += YYTERROR;
-          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYTERROR)
+          yyn += YYSYMBOL_YYerror;
+          if (0 <= yyn && yyn <= YYLAST && yycheck[yyn] == YYSYMBOL_YYerror)
             {
               yyn = yytable[yyn];
               if (0 < yyn)
@@ -2112,7 +2449,7 @@ yyerrlab1:
 
       yyerror_range[1] = *yylsp;
       yydestruct ("Error: popping",
-                  yystos[yystate], yyvsp, yylsp);
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp, yylsp, lexer, result);
       YYPOPSTACK (1);
       yystate = *yyssp;
       YY_STACK_PRINT (yyss, yyssp);
@@ -2123,13 +2460,11 @@ yyerrlab1:
   YY_IGNORE_MAYBE_UNINITIALIZED_END
 
   yyerror_range[2] = yylloc;
-  /* Using YYLLOC is tempting, but would change the location of
-     the lookahead.  YYLOC is available though.  */
-  YYLLOC_DEFAULT (yyloc, yyerror_range, 2);
-  *++yylsp = yyloc;
+  ++yylsp;
+  YYLLOC_DEFAULT (*yylsp, yyerror_range, 2);
 
   /* Shift the error token.  */
-  YY_SYMBOL_PRINT ("Shifting", yystos[yyn], yyvsp, yylsp);
+  YY_SYMBOL_PRINT ("Shifting", YY_ACCESSING_SYMBOL (yyn), yyvsp, yylsp);
 
   yystate = yyn;
   goto yynewstate;
@@ -2140,7 +2475,7 @@ yyerrlab1:
 `-------------------------------------*/
 yyacceptlab:
   yyresult = 0;
-  goto yyreturn;
+  goto yyreturnlab;
 
 
 /*-----------------------------------.
@@ -2148,31 +2483,29 @@ yyacceptlab:
 `-----------------------------------*/
 yyabortlab:
   yyresult = 1;
-  goto yyreturn;
+  goto yyreturnlab;
 
 
-#if !defined yyoverflow || YYERROR_VERBOSE
-/*-------------------------------------------------.
-| yyexhaustedlab -- memory exhaustion comes here.  |
-`-------------------------------------------------*/
+/*-----------------------------------------------------------.
+| yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
+`-----------------------------------------------------------*/
 yyexhaustedlab:
-  yyerror (&yylloc, YY_("memory exhausted"));
+  yyerror (&yylloc, lexer, result, YY_("memory exhausted"));
   yyresult = 2;
-  /* Fall through.  */
-#endif
+  goto yyreturnlab;
 
 
-/*-----------------------------------------------------.
-| yyreturn -- parsing is finished, return the result.  |
-`-----------------------------------------------------*/
-yyreturn:
+/*----------------------------------------------------------.
+| yyreturnlab -- parsing is finished, clean up and return.  |
+`----------------------------------------------------------*/
+yyreturnlab:
   if (yychar != YYEMPTY)
     {
       /* Make sure we have latest lookahead translation.  See comments at
          user semantic actions for why this is necessary.  */
       yytoken = YYTRANSLATE (yychar);
       yydestruct ("Cleanup: discarding lookahead",
-                  yytoken, &yylval, &yylloc);
+                  yytoken, &yylval, &yylloc, lexer, result);
     }
   /* Do not reclaim the symbols of the rule whose action triggered
      this YYABORT or YYACCEPT.  */
@@ -2181,18 +2514,17 @@ yyreturn:
   while (yyssp != yyss)
     {
       yydestruct ("Cleanup: popping",
-                  yystos[+*yyssp], yyvsp, yylsp);
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp, yylsp, lexer, result);
       YYPOPSTACK (1);
     }
 #ifndef yyoverflow
   if (yyss != yyssa)
     YYSTACK_FREE (yyss);
 #endif
-#if YYERROR_VERBOSE
   if (yymsg != yymsgbuf)
     YYSTACK_FREE (yymsg);
-#endif
   return yyresult;
 }
-#line 340 "/home/aaron/rucdeke/rucbase/src/parser/yacc.y"
+
+#line 503 "yacc.y"
 
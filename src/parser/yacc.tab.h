@@ -1,8 +1,8 @@
-/* A Bison parser, made by GNU Bison 3.5.1.  */
+/* A Bison parser, made by GNU Bison 3.8.2.  */
 
 /* Bison interface for Yacc-like parsers in C
 
-   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2020 Free Software Foundation,
+   Copyright (C) 1984, 1989-1990, 2000-2015, 2018-2021 Free Software Foundation,
    Inc.
 
    This program is free software: you can redistribute it and/or modify
@@ -16,7 +16,7 @@
    GNU General Public License for more details.
 
    You should have received a copy of the GNU General Public License
-   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.  */
 
 /* As a special exception, you may create a larger work that contains
    part or all of the Bison parser skeleton and distribute that work
@@ -31,11 +31,12 @@
    This special exception was added by the Free Software Foundation in
    version 2.2 of Bison.  */
 
-/* Undocumented macros, especially those whose name start with YY_,
-   are private implementation details.  Do not rely on them.  */
+/* DO NOT RELY ON FEATURES THAT ARE NOT DOCUMENTED in the manual,
+   especially those whose name start with YY_ or yy_.  They are
+   private implementation details that can be changed or removed.  */
 
-#ifndef YY_YY_HOME_AARON_RUCDEKE_RUCBASE_SRC_PARSER_YACC_TAB_H_INCLUDED
-# define YY_YY_HOME_AARON_RUCDEKE_RUCBASE_SRC_PARSER_YACC_TAB_H_INCLUDED
+#ifndef YY_YY_YACC_TAB_H_INCLUDED
+# define YY_YY_YACC_TAB_H_INCLUDED
 /* Debug traces.  */
 #ifndef YYDEBUG
 # define YYDEBUG 0
@@ -43,48 +44,79 @@
 #if YYDEBUG
 extern int yydebug;
 #endif
+/* "%code requires" blocks.  */
+#line 1 "yacc.y"
 
-/* Token type.  */
+#include <memory>
+
+#include "ast.h"
+
+namespace ast {
+class Lexer;
+}
+
+#line 59 "yacc.tab.h"
+
+/* Token kinds.  */
 #ifndef YYTOKENTYPE
 # define YYTOKENTYPE
   enum yytokentype
   {
-    SHOW = 258,
-    TABLES = 259,
-    CREATE = 260,
-    TABLE = 261,
-    DROP = 262,
-    DESC = 263,
-    INSERT = 264,
-    INTO = 265,
-    VALUES = 266,
-    DELETE = 267,
-    FROM = 268,
-    WHERE = 269,
-    UPDATE = 270,
-    SET = 271,
-    SELECT = 272,
-    INT = 273,
-    CHAR = 274,
-    FLOAT = 275,
-    INDEX = 276,
-    AND = 277,
-    JOIN = 278,
-    EXIT = 279,
-    HELP = 280,
-    TXN_BEGIN = 281,
-    TXN_COMMIT = 282,
-    TXN_ABORT = 283,
-    TXN_ROLLBACK = 284,
-    LEQ = 285,
-    NEQ = 286,
-    GEQ = 287,
-    T_EOF = 288,
-    IDENTIFIER = 289,
-    VALUE_STRING = 290,
-    VALUE_INT = 291,
-    VALUE_FLOAT = 292
+    YYEMPTY = -2,
+    YYEOF = 0,                     /* "end of file"  */
+    YYerror = 256,                 /* error  */
+    YYUNDEF = 257,                 /* "invalid token"  */
+    SHOW = 258,                    /* SHOW  */
+    TABLES = 259,                  /* TABLES  */
+    CREATE = 260,                  /* CREATE  */
+    TABLE = 261,                   /* TABLE  */
+    DROP = 262,                    /* DROP  */
+    DESC = 263,                    /* DESC  */
+    INSERT = 264,                  /* INSERT  */
+    INTO = 265,                    /* INTO  */
+    VALUES = 266,                  /* VALUES  */
+    DELETE = 267,                  /* DELETE  */
+    FROM = 268,                    /* FROM  */
+    WHERE = 269,                   /* WHERE  */
+    UPDATE = 270,                  /* UPDATE  */
+    SET = 271,                     /* SET  */
+    SELECT = 272,                  /* SELECT  */
+    INT = 273,                     /* INT  */
+    CHAR = 274,                    /* CHAR  */
+    FLOAT = 275,                   /* FLOAT  */
+    INDEX = 276,                   /* INDEX  */
+    AND = 277,                     /* AND  */
+    JOIN = 278,                    /* JOIN  */
+    EXIT = 279,                    /* EXIT  */
+    HELP = 280,                    /* HELP  */
+    TXN_BEGIN = 281,               /* TXN_BEGIN  */
+    TXN_COMMIT = 282,              /* TXN_COMMIT  */
+    TXN_ABORT = 283,               /* TXN_ABORT  */
+    TXN_ROLLBACK = 284,            /* TXN_ROLLBACK  */
+    ORDER = 285,                   /* ORDER  */
+    BY = 286,                      /* BY  */
+    ASC = 287,                     /* ASC  */
+    LIMIT = 288,                   /* LIMIT  */
+    LOAD = 289,                    /* LOAD  */
+    DATA = 290,                    /* DATA  */
+    ISOLATION = 291,               /* ISOLATION  */
+    LEVEL = 292,                   /* LEVEL  */
+    READ = 293,                    /* READ  */
+    COMMITTED = 294,               /* COMMITTED  */
+    UNCOMMITTED = 295,             /* UNCOMMITTED  */
+    REPEATABLE = 296,              /* REPEATABLE  */
+    SERIALIZABLE = 297,            /* SERIALIZABLE  */
+    ANALYZE = 298,                 /* ANALYZE  */
+    LEQ = 299,                     /* LEQ  */
+    NEQ = 300,                     /* NEQ  */
+    GEQ = 301,                     /* GEQ  */
+    T_EOF = 302,                   /* T_EOF  */
+    IDENTIFIER = 303,              /* IDENTIFIER  */
+    VALUE_STRING = 304,            /* VALUE_STRING  */
+    VALUE_INT = 305,               /* VALUE_INT  */
+    VALUE_FLOAT = 306              /* VALUE_FLOAT  */
   };
+  typedef enum yytokentype yytoken_kind_t;
 #endif
 
 /* Value type.  */
@@ -105,6 +137,8 @@ struct YYLTYPE
 
 
 
-int yyparse (void);
 
-#endif /* !YY_YY_HOME_AARON_RUCDEKE_RUCBASE_SRC_PARSER_YACC_TAB_H_INCLUDED  */
+int yyparse (ast::Lexer *lexer, std::shared_ptr<ast::TreeNode> *result);
+
+
+#endif /* !YY_YY_YACC_TAB_H_INCLUDED  */
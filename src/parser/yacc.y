@@ -1,20 +1,71 @@
+%code requires {
+#include <memory>
+
+#include "ast.h"
+
+namespace ast {
+class Lexer;
+}
+}
+
 %{
+// SemValue is not trivially copyable, so bison cannot relocate the stacks by itself, and the initial
+// stacks are constructed on every call. The grammar is left recursive and stays shallow, so start with
+// 64 entries, and let grow_stacks() move them to larger stacks up to bison's default YYMAXDEPTH
+#define YYINITDEPTH 64
+#define yyoverflow(msg, ss, ss_size, vs, vs_size, ls, ls_size, stacksize)                                  \
+    grow_stacks(&yylloc, lexer, result, msg, ss, vs, ls, (ss_size) / YYSIZEOF(**(ss)), stacksize,        \
+                YY_CAST(YYPTRDIFF_T, YYMAXDEPTH))
+
 #include "ast.h"
+#include "lexer.h"
 #include "yacc.tab.h"
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <memory>
 
-int yylex(YYSTYPE *yylval, YYLTYPE *yylloc);
-
-void yyerror(YYLTYPE *locp, const char* s) {
+void yyerror(YYLTYPE *locp, ast::Lexer *lexer, std::shared_ptr<ast::TreeNode> *result, const char* s) {
     std::cerr << "Parser Error at line " << locp->first_line << " column " << locp->first_column << ": " << s << std::endl;
 }
 
+/**
+ * @brief yyoverflow: 把三个栈中的size个元素移动到两倍大小的新栈中, 新栈由lexer持有
+ * @details 已经达到max_depth时报告错误并保持stacksize不变, bison随后中止解析
+ */
+template <typename State, typename Size>
+void grow_stacks(YYLTYPE *locp, ast::Lexer *lexer, std::shared_ptr<ast::TreeNode> *result, const char *msg,
+                 State **ss, YYSTYPE **vs, YYLTYPE **ls, Size size, Size *stacksize, Size max_depth) {
+    if (*stacksize >= max_depth) {
+        yyerror(locp, lexer, result, msg);
+        return;
+    }
+    Size new_size = std::min(*stacksize * 2, max_depth);
+    auto &stacks = lexer->parser_stacks();
+    std::unique_ptr<char[]> states(new char[new_size * sizeof(State)]);
+    memcpy(states.get(), *ss, size * sizeof(State));
+    std::vector<YYSTYPE> values(new_size);
+    std::move(*vs, *vs + size, values.begin());
+    std::vector<YYLTYPE> locations(*ls, *ls + size);
+    locations.resize(new_size);
+    // 旧栈可能就是上一次增长得到的栈, 元素都已经移走后再替换
+    stacks.states = std::move(states);
+    stacks.values.swap(values);
+    stacks.locations.swap(locations);
+    *ss = reinterpret_cast<State *>(stacks.states.get());
+    *vs = stacks.values.data();
+    *ls = stacks.locations.data();
+    *stacksize = new_size;
+}
+
 using namespace ast;
 %}
 
 // request a pure (reentrant) parser
 %define api.pure full
+// the scanner state and the result are passed in, so that parsing needs no global state
+%param {ast::Lexer *lexer}
+%parse-param {std::shared_ptr<ast::TreeNode> *result}
 // enable location in error handler
 %locations
 // enable verbose syntax error message
@@ -23,6 +74,7 @@ using namespace ast;
 // keywords
 %token SHOW TABLES CREATE TABLE DROP DESC INSERT INTO VALUES DELETE FROM
 WHERE UPDATE SET SELECT INT CHAR FLOAT INDEX AND JOIN EXIT HELP TXN_BEGIN TXN_COMMIT TXN_ABORT TXN_ROLLBACK
+ORDER BY ASC LIMIT LOAD DATA ISOLATION LEVEL READ COMMITTED UNCOMMITTED REPEATABLE SERIALIZABLE ANALYZE
 // non-keywords
 %token LEQ NEQ GEQ T_EOF
 
@@ -40,6 +92,7 @@ WHERE UPDATE SET SELECT INT CHAR FLOAT INDEX AND JOIN EXIT HELP TXN_BEGIN TXN_CO
 %type <sv_expr> expr
 %type <sv_val> value
 %type <sv_vals> valueList
+%type <sv_val_rows> valueRows
 %type <sv_str> tbName colName
 %type <sv_strs> tableList
 %type <sv_col> col
@@ -48,27 +101,32 @@ WHERE UPDATE SET SELECT INT CHAR FLOAT INDEX AND JOIN EXIT HELP TXN_BEGIN TXN_CO
 %type <sv_set_clauses> setClauses
 %type <sv_cond> condition
 %type <sv_conds> whereClause optWhereClause
+%type <sv_order> orderItem
+%type <sv_orders> orderList optOrderClause
+%type <sv_bool> optOrderDir
+%type <sv_int> optLimitClause
+%type <sv_isolation_level> optIsolationLevel isolationLevel
 
 %%
 start:
         stmt ';'
     {
-        parse_tree = $1;
+        *result = $1;
         YYACCEPT;
     }
     |   HELP
     {
-        parse_tree = std::make_shared<Help>();
+        *result = std::make_shared<Help>();
         YYACCEPT;
     }
     |   EXIT
     {
-        parse_tree = nullptr;
+        *result = nullptr;
         YYACCEPT;
     }
     |   T_EOF
     {
-        parse_tree = nullptr;
+        *result = nullptr;
         YYACCEPT;
     }
     ;
@@ -81,9 +139,9 @@ stmt:
     ;
 
 txnStmt:
-        TXN_BEGIN
+        TXN_BEGIN optIsolationLevel
     {
-        $$ = std::make_shared<TxnBegin>();
+        $$ = std::make_shared<TxnBegin>($2);
     }
     |   TXN_COMMIT
     {
@@ -99,6 +157,36 @@ txnStmt:
     }
     ;
 
+optIsolationLevel:
+        /* epsilon */
+    {
+        $$ = SV_ISOLATION_DEFAULT;
+    }
+    |   ISOLATION LEVEL isolationLevel
+    {
+        $$ = $3;
+    }
+    ;
+
+isolationLevel:
+        READ UNCOMMITTED
+    {
+        $$ = SV_READ_UNCOMMITTED;
+    }
+    |   READ COMMITTED
+    {
+        $$ = SV_READ_COMMITTED;
+    }
+    |   REPEATABLE READ
+    {
+        $$ = SV_REPEATABLE_READ;
+    }
+    |   SERIALIZABLE
+    {
+        $$ = SV_SERIALIZABLE;
+    }
+    ;
+
 dbStmt:
         SHOW TABLES
     {
@@ -127,12 +215,20 @@ ddl:
     {
         $$ = std::make_shared<DropIndex>($3, $5);
     }
+    |   ANALYZE tbName
+    {
+        $$ = std::make_shared<AnalyzeTable>($2);
+    }
     ;
 
 dml:
-        INSERT INTO tbName VALUES '(' valueList ')'
+        INSERT INTO tbName VALUES valueRows
+    {
+        $$ = std::make_shared<InsertStmt>($3, $5);
+    }
+    |   LOAD DATA VALUE_STRING INTO tbName
     {
-        $$ = std::make_shared<InsertStmt>($3, $6);
+        $$ = std::make_shared<LoadData>($3, $5);
     }
     |   DELETE FROM tbName optWhereClause
     {
@@ -142,9 +238,9 @@ dml:
     {
         $$ = std::make_shared<UpdateStmt>($2, $4, $5);
     }
-    |   SELECT selector FROM tableList optWhereClause
+    |   SELECT selector FROM tableList optWhereClause optOrderClause optLimitClause
     {
-        $$ = std::make_shared<SelectStmt>($2, $4, $5);
+        $$ = std::make_shared<SelectStmt>($2, $4, $5, $6, $7);
     }
     ;
 
@@ -181,6 +277,17 @@ type:
     }
     ;
 
+valueRows:
+        '(' valueList ')'
+    {
+        $$ = std::vector<std::vector<std::shared_ptr<Value>>>{$2};
+    }
+    |   valueRows ',' '(' valueList ')'
+    {
+        $$.push_back($4);
+    }
+    ;
+
 valueList:
         value
     {
@@ -205,6 +312,10 @@ value:
     {
         $$ = std::make_shared<StringLit>($1);
     }
+    |   '?'
+    {
+        $$ = std::make_shared<Param>();
+    }
     ;
 
 condition:
@@ -233,6 +344,58 @@ whereClause:
     }
     ;
 
+optOrderClause:
+        /* epsilon */ { /* ignore*/ }
+    |   ORDER BY orderList
+    {
+        $$ = $3;
+    }
+    ;
+
+orderList:
+        orderItem
+    {
+        $$ = std::vector<std::shared_ptr<OrderBy>>{$1};
+    }
+    |   orderList ',' orderItem
+    {
+        $$.push_back($3);
+    }
+    ;
+
+orderItem:
+        col optOrderDir
+    {
+        $$ = std::make_shared<OrderBy>($1, $2);
+    }
+    ;
+
+optOrderDir:
+        /* epsilon */
+    {
+        $$ = false;
+    }
+    |   ASC
+    {
+        $$ = false;
+    }
+    |   DESC
+    {
+        $$ = true;
+    }
+    ;
+
+optLimitClause:
+        /* epsilon */
+    {
+        $$ = -1;
+    }
+    |   LIMIT VALUE_INT
+    {
+        $$ = $2;
+    }
+    ;
+
 col:
         tbName '.' colName
     {
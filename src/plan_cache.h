@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+#include "execution/execution_manager.h"
+#include "parser/ast.h"
+
+/**
+ * @brief 预编译的语句, 只支持select/insert/delete/update
+ * @details 值可以是参数占位符'?', 按在sql中出现的顺序从0开始编号.
+ * select的计划在第一次执行时生成并缓存, catalog版本或者用到的表的统计信息变化后重新生成; 计划通过std::atomic_load/store访问,
+ * 同一个语句可以被多个线程同时执行
+ */
+struct PreparedStmt {
+    std::shared_ptr<ast::TreeNode> root;
+    size_t num_params = 0;
+    std::string tab_name;                 // insert/delete/update的目标表
+    std::vector<std::vector<Value>> rows; // insert
+    std::vector<SetClause> set_clauses;   // update
+    std::vector<Condition> conds;         // delete/update/select
+    std::vector<TabCol> sel_cols;         // select
+    std::vector<std::string> tab_names;   // select
+    std::vector<OrderByCol> order_cols;   // select
+    int limit = -1;                       // select
+    std::shared_ptr<SelectPlan> plan;     // select
+};
+
+/**
+ * @brief 服务端共享的计划缓存, 以去掉字面量后的sql为key, 按LRU淘汰
+ * @details 每个条目记录生成时的catalog版本, 建表/删表/建删索引后版本变化, 旧条目在下次查找时被丢弃
+ */
+class PlanCache {
+   public:
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t saved_ns;  // 命中时省去的语法分析和计划生成时间
+        size_t size;
+    };
+
+    explicit PlanCache(size_t capacity = PLAN_CACHE_SIZE) : capacity_(capacity) {}
+
+    /**
+     * @brief 查找key对应的语句, 没有找到或者条目已经过期时返回nullptr
+     * @param catalog_version 当前的catalog版本
+     */
+    std::shared_ptr<PreparedStmt> get(const std::string &key, uint64_t catalog_version) {
+        std::lock_guard<std::mutex> lock(latch_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) {
+            misses_++;
+            return nullptr;
+        }
+        if (it->second->catalog_version != catalog_version) {
+            lru_.erase(it->second);
+            entries_.erase(it);
+            misses_++;
+            return nullptr;
+        }
+        // 移到LRU链表头部
+        lru_.splice(lru_.begin(), lru_, it->second);
+        hits_++;
+        saved_ns_ += it->second->plan_ns;
+        return it->second->stmt;
+    }
+
+    /**
+     * @brief 插入一个条目, 缓存满时淘汰最久没有使用的条目
+     * @param plan_ns 生成该语句花费的时间
+     */
+    void put(const std::string &key, std::shared_ptr<PreparedStmt> stmt, uint64_t catalog_version, uint64_t plan_ns) {
+        std::lock_guard<std::mutex> lock(latch_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            lru_.erase(it->second);
+            entries_.erase(it);
+        }
+        lru_.push_front({key, std::move(stmt), catalog_version, plan_ns});
+        entries_[key] = lru_.begin();
+        if (entries_.size() > capacity_) {
+            entries_.erase(lru_.back().key);
+            lru_.pop_back();
+        }
+    }
+
+    Stats stats() {
+        std::lock_guard<std::mutex> lock(latch_);
+        return {hits_, misses_, saved_ns_, entries_.size()};
+    }
+
+   private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<PreparedStmt> stmt;
+        uint64_t catalog_version;
+        uint64_t plan_ns;
+    };
+
+    size_t capacity_;
+    std::mutex latch_;
+    std::list<Entry> lru_;  // 头部是最近使用的条目
+    std::unordered_map<std::string, std::list<Entry>::iterator> entries_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t saved_ns_ = 0;
+};
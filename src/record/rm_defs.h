@@ -17,6 +17,7 @@ struct RmFileHdr {
     int num_records_per_page;  // 每个page最多能存储的元组个数
     int first_free_page_no;    // 文件中当前第一个可用的page no（初始化为-1）
     int bitmap_size;           // bitmap大小
+    int tab_id;                // 表的编号, 日志, 锁和版本链中用它代替表名和fd
 };
 
 // record page header（RmFileHandle::create_page函数进行初始化）
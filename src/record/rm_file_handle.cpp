@@ -1,5 +1,7 @@
 #include "rm_file_handle.h"
 
+#include <algorithm>
+
 /**
  * @brief 由Rid得到指向RmRecord的指针
  *
@@ -10,13 +12,32 @@ std::unique_ptr<RmRecord> RmFileHandle::get_record(const Rid &rid, Context *cont
     // Todo:
     // 1. 获取指定记录所在的page handle
     // 2. 初始化一个指向RmRecord的指针（赋值其内部的data和size）
-    context->lock_mgr_->LockSharedOnRecord(context->txn_,rid,fd_);
+    // 快照读不加读锁, 在页面的读latch下复制记录, 再由版本存储找到快照可见的版本;
+    // 读未提交(如ANALYZE)也不加读锁, 同样在读latch下复制, 不会读到写了一半的记录;
+    // 不读快照的只读事务已经持有表级读锁
+    bool snapshot_read = context->version_store_ != nullptr && context->txn_->IsSnapshotRead();
+    bool read_uncommitted = context->txn_->GetIsolationLevel() == IsolationLevel::READ_UNCOMMITTED;
+    if (!snapshot_read && !context->txn_->IsReadOnly() && !read_uncommitted) {
+        context->lock_mgr_->LockSharedOnRecord(context->txn_,rid,file_hdr_.tab_id);
+    }
+    bool latch = snapshot_read || read_uncommitted;
     int page_no=rid.page_no;
     int slot_no=rid.slot_no;
     auto page_handle=fetch_page_handle(page_no);
     auto new_record=std::make_unique<RmRecord> (file_hdr_.record_size);
+    if (latch) {
+        page_handle.page->RLatch();
+    }
+    bool exists = Bitmap::is_set(page_handle.bitmap, slot_no);
     memcpy(new_record->data,page_handle.get_slot(slot_no),file_hdr_.record_size);
+    if (latch) {
+        page_handle.page->RUnlatch();
+    }
+    buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), false);
     new_record->size=file_hdr_.record_size;
+    if (snapshot_read) {
+        return context->version_store_->read(file_hdr_.tab_id, rid, exists ? std::move(new_record) : nullptr, context->txn_);
+    }
     return new_record;
 }
 
@@ -27,18 +48,30 @@ std::unique_ptr<RmRecord> RmFileHandle::get_record(const Rid &rid, Context *cont
  * @return Rid 插入记录的位置
  */
 Rid RmFileHandle::insert_record(char *buf, Context *context) {
-    // Todo:
-    // 1. 获取当前未满的page handle
-    // 2. 在page handle中找到空闲slot位置
-    // 3. 将buf复制到空闲slot位置
-    // 4. 更新page_handle.page_hdr中的数据结构
-    // 注意考虑插入一条记录后页面已满的情况，需要更新file_hdr_.first_free_page_no
-    auto page_handle=create_page_handle();
-    int free_slot=Bitmap::first_bit(0,page_handle.bitmap,file_hdr_.num_records_per_page);
-    memcpy(page_handle.get_slot(free_slot),buf,file_hdr_.record_size);
-    Bitmap::set(page_handle.bitmap,free_slot);
-    if(++page_handle.page_hdr->num_records==file_hdr_.num_records_per_page)file_hdr_.first_free_page_no=page_handle.page_hdr->next_free_page_no;
-    return Rid{page_handle.page->GetPageId().page_no, free_slot};
+    return insert_records(buf, 1, context)[0];
+}
+
+/**
+ * @brief 批量插入多条记录
+ * @details 先依次填满空闲链表上的页面, 剩下的记录写入新分配的页面. 新页面的page_no是连续的,
+ * 除最后一页外都被整页写满, 不会留在空闲链表中
+ *
+ * @param buf 连续存放的num_records条记录, 每条长度为record_size
+ * @return std::vector<Rid> 每条记录的插入位置, 与buf中的顺序一致
+ */
+std::vector<Rid> RmFileHandle::insert_records(const char *buf, size_t num_records, Context *context) {
+    std::vector<Rid> rids;
+    rids.reserve(num_records);
+    size_t next = 0;
+    while (next < num_records) {
+        RmPageHandle page_handle = create_page_handle();
+        if (page_handle.page == nullptr) {
+            throw InternalError("Buffer pool is full");
+        }
+        next += fill_page(page_handle, buf + next * file_hdr_.record_size, num_records - next, &rids, context);
+        buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), true);
+    }
+    return rids;
 }
 
 /**
@@ -51,13 +84,22 @@ void RmFileHandle::delete_record(const Rid &rid, Context *context) {
     // 1. 获取指定记录所在的page handle
     // 2. 更新page_handle.page_hdr中的数据结构
     // 注意考虑删除一条记录后页面未满的情况，需要调用release_page_handle()
-    context->lock_mgr_->LockExclusiveOnRecord(context->txn_,rid,fd_);
+    context->lock_mgr_->LockExclusiveOnRecord(context->txn_,rid,file_hdr_.tab_id);
     int page_no=rid.page_no;
     int slot_no=rid.slot_no;
     auto page_handle=fetch_page_handle(page_no);
-    if(slot_no>=file_hdr_.num_records_per_page||!Bitmap::is_set(page_handle.bitmap,slot_no))throw RecordNotFoundError(page_no,slot_no);
+    page_handle.page->WLatch();
+    if(slot_no>=file_hdr_.num_records_per_page||!Bitmap::is_set(page_handle.bitmap,slot_no)){
+        page_handle.page->WUnlatch();
+        buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), false);
+        throw RecordNotFoundError(page_no,slot_no);
+    }
+    add_version(rid, page_handle.get_slot(slot_no), context);
+    append_log(LogRecordType::DELETE, rid, page_handle.get_slot(slot_no), nullptr, page_handle.page, context);
     Bitmap::reset(page_handle.bitmap,slot_no);
     if(page_handle.page_hdr->num_records--==file_hdr_.num_records_per_page)release_page_handle(page_handle);
+    page_handle.page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), true);
 }
 
 /**
@@ -70,11 +112,16 @@ void RmFileHandle::update_record(const Rid &rid, char *buf, Context *context) {
     // Todo:
     // 1. 获取指定记录所在的page handle
     // 2. 更新记录
-    context->lock_mgr_->LockExclusiveOnRecord(context->txn_,rid,fd_);
+    context->lock_mgr_->LockExclusiveOnRecord(context->txn_,rid,file_hdr_.tab_id);
     int page_no=rid.page_no;
     int slot_no=rid.slot_no;
     auto page_handle=fetch_page_handle(page_no);
+    page_handle.page->WLatch();
+    add_version(rid, page_handle.get_slot(slot_no), context);
+    append_log(LogRecordType::UPDATE, rid, page_handle.get_slot(slot_no), buf, page_handle.page, context);
     memcpy(page_handle.get_slot(slot_no),buf,file_hdr_.record_size);
+    page_handle.page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), true);
 }
 
 /** -- 以下为辅助函数 -- */
@@ -113,6 +160,7 @@ RmPageHandle RmFileHandle::create_new_page_handle() {
     assert(file_hdr_.first_free_page_no==-1);
     res.page_hdr->next_free_page_no=file_hdr_.first_free_page_no;//page_hdr
     res.page_hdr->num_records=0;
+    page->SetPageLsn(INVALID_LSN);  // 新页面上还没有任何日志对应的修改
     file_hdr_.first_free_page_no=pageid.page_no;//file_hdr_
     file_hdr_.num_pages++;
     res.page=page;//page
@@ -156,6 +204,56 @@ void RmFileHandle::release_page_handle(RmPageHandle &page_handle) {
     file_hdr_.first_free_page_no=page_handle.page->GetPageId().page_no;
 }
 
+/**
+ * @brief 把记录写入一个未满页面的空闲slot, 直到页面写满或者记录用完
+ * @details 持有页面的写锁, 只扫描一遍bitmap: 整字节已满的部分8个slot一起跳过,
+ * 连续的空闲slot用一次memcpy写入. num_records和空闲链表在最后更新一次, 释放写锁前为新记录登记版本并写日志
+ *
+ * @return int 写入的记录数
+ */
+int RmFileHandle::fill_page(RmPageHandle &page_handle, const char *buf, size_t num_records, std::vector<Rid> *rids,
+                            Context *context) {
+    const int num_slots = file_hdr_.num_records_per_page;
+    const int record_size = file_hdr_.record_size;
+    const int page_no = page_handle.page->GetPageId().page_no;
+    int filled = 0;
+    page_handle.page->WLatch();
+    int slot_no = 0;
+    while (slot_no < num_slots && (size_t)filled < num_records) {
+        if (slot_no % BITMAP_WIDTH == 0 && (unsigned char)page_handle.bitmap[slot_no / BITMAP_WIDTH] == 0xffu) {
+            slot_no += BITMAP_WIDTH;
+            continue;
+        }
+        if (Bitmap::is_set(page_handle.bitmap, slot_no)) {
+            slot_no++;
+            continue;
+        }
+        // [slot_no, run_end)是一段连续的空闲slot
+        int run_end = slot_no + 1;
+        while (run_end < num_slots && (size_t)(filled + run_end - slot_no) < num_records &&
+               !Bitmap::is_set(page_handle.bitmap, run_end)) {
+            run_end++;
+        }
+        memcpy(page_handle.get_slot(slot_no), buf + (size_t)filled * record_size,
+               (size_t)(run_end - slot_no) * record_size);
+        for (; slot_no < run_end; slot_no++) {
+            Bitmap::set(page_handle.bitmap, slot_no);
+            rids->push_back(Rid{page_no, slot_no});
+            filled++;
+        }
+    }
+    page_handle.page_hdr->num_records += filled;
+    if (page_handle.page_hdr->num_records == num_slots) {
+        file_hdr_.first_free_page_no = page_handle.page_hdr->next_free_page_no;
+    }
+    for (auto it = rids->end() - filled; it != rids->end(); ++it) {
+        add_version(*it, nullptr, context);
+        append_log(LogRecordType::INSERT, *it, nullptr, page_handle.get_slot(it->slot_no), page_handle.page, context);
+    }
+    page_handle.page->WUnlatch();
+    return filled;
+}
+
 /**
  * @brief 用于事务的rollback操作
  *
@@ -178,3 +276,134 @@ void RmFileHandle::insert_record(const Rid &rid, char *buf) {
 
     buffer_pool_manager_->UnpinPage(pageHandle.page->GetPageId(), true);
 }
+
+/**
+ * @brief 修改记录前在版本存储中保存修改前的记录, 调用者持有页面的写锁
+ *
+ * @param before 修改前的记录, 插入时为nullptr
+ */
+void RmFileHandle::add_version(const Rid &rid, const char *before, Context *context) {
+    if (context != nullptr && context->version_store_ != nullptr) {
+        context->version_store_->add_version(file_hdr_.tab_id, rid, before, file_hdr_.record_size, context->txn_);
+    }
+}
+
+/**
+ * @brief 开启日志时为事务对记录的修改追加一条日志, 并更新事务的prev_lsn和页面的page_lsn, 调用者持有页面的写锁
+ * @details 事务的第一条修改日志之前先追加BEGIN日志, 没有修改过数据的事务不写日志
+ *
+ * @param before 修改前的记录, 插入时为nullptr
+ * @param after 修改后的记录, 删除时为nullptr
+ */
+void RmFileHandle::append_log(LogRecordType log_type, const Rid &rid, const char *before, const char *after,
+                              Page *page, Context *context) {
+    if (context == nullptr || context->txn_ == nullptr || context->log_mgr_ == nullptr ||
+        !context->log_mgr_->GetLogMode()) {
+        return;
+    }
+    Transaction *txn = context->txn_;
+    // 先记下不大于之后日志lsn的rec_lsn和first_lsn, 并发的检查点不会漏掉这次修改需要的日志
+    page->SetRecLsn(context->log_mgr_->GetNextLsn());
+    if (txn->GetPrevLsn() == INVALID_LSN) {
+        txn->SetFirstLsn(context->log_mgr_->GetNextLsn());
+        LogRecord begin_log(txn->GetTransactionId(), INVALID_LSN, LogRecordType::BEGIN);
+        txn->SetPrevLsn(context->log_mgr_->AppendLogRecord(&begin_log));
+        txn->SetFirstLsn(txn->GetPrevLsn());
+    }
+    int record_size = file_hdr_.record_size;
+    lsn_t lsn;
+    if (log_type == LogRecordType::UPDATE) {
+        LogRecord log(txn->GetTransactionId(), txn->GetPrevLsn(), log_type, rid,
+                      RmRecord(record_size, const_cast<char *>(before)), RmRecord(record_size, const_cast<char *>(after)),
+                      file_hdr_.tab_id);
+        lsn = context->log_mgr_->AppendLogRecord(&log);
+    } else {
+        const char *data = log_type == LogRecordType::INSERT ? after : before;
+        LogRecord log(txn->GetTransactionId(), txn->GetPrevLsn(), log_type, rid,
+                      RmRecord(record_size, const_cast<char *>(data)), file_hdr_.tab_id);
+        lsn = context->log_mgr_->AppendLogRecord(&log);
+    }
+    txn->SetPrevLsn(lsn);
+    page->SetPageLsn(lsn);
+}
+
+void RmFileHandle::recover_pages(int page_no) {
+    // 故障前被换出的页面已经写入文件, 这些页面可能不在num_pages之内
+    int file_pages = disk_manager_->GetFileSize(tab_name_) / PAGE_SIZE;
+    int num_pages = std::max({file_hdr_.num_pages, file_pages, disk_manager_->get_fd2pageno(fd_)});
+    disk_manager_->set_fd2pageno(fd_, num_pages);
+    while (num_pages <= page_no) {
+        PageId page_id = {fd_, INVALID_PAGE_ID};
+        Page *page = buffer_pool_manager_->NewPage(&page_id);
+        if (page == nullptr) {
+            throw InternalError("Buffer pool is full");
+        }
+        RmPageHandle page_handle(&file_hdr_, page);
+        page_handle.page_hdr->next_free_page_no = RM_NO_PAGE;
+        page_handle.page_hdr->num_records = 0;
+        Bitmap::init(page_handle.bitmap, file_hdr_.bitmap_size);
+        page->SetPageLsn(INVALID_LSN);
+        buffer_pool_manager_->UnpinPage(page_id, true);
+        num_pages++;
+    }
+    file_hdr_.num_pages = num_pages;
+}
+
+bool RmFileHandle::recover_record(const Rid &rid, const char *buf, lsn_t lsn) {
+    RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+    page_handle.page->WLatch();
+    // 页面已经包含这条日志的修改
+    bool redo = page_handle.page->GetPageLsn() < lsn;
+    if (redo) {
+        bool exists = Bitmap::is_set(page_handle.bitmap, rid.slot_no);
+        if (buf != nullptr) {
+            memcpy(page_handle.get_slot(rid.slot_no), buf, file_hdr_.record_size);
+            if (!exists) {
+                Bitmap::set(page_handle.bitmap, rid.slot_no);
+                page_handle.page_hdr->num_records++;
+            }
+        } else if (exists) {
+            Bitmap::reset(page_handle.bitmap, rid.slot_no);
+            page_handle.page_hdr->num_records--;
+        }
+        page_handle.page->SetPageLsn(lsn);
+        page_handle.page->SetRecLsn(lsn);
+    }
+    page_handle.page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), redo);
+    return redo;
+}
+
+bool RmFileHandle::recover_update(const Rid &rid, LogRecord &update_log, lsn_t lsn) {
+    RmPageHandle page_handle = fetch_page_handle(rid.page_no);
+    page_handle.page->WLatch();
+    // 同一页面上的日志按lsn顺序重做, 页面中的记录是这条日志修改之前的内容
+    bool redo = page_handle.page->GetPageLsn() < lsn;
+    if (redo) {
+        update_log.RedoUpdate(page_handle.get_slot(rid.slot_no));
+        page_handle.page->SetPageLsn(lsn);
+        page_handle.page->SetRecLsn(lsn);
+    }
+    page_handle.page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), redo);
+    return redo;
+}
+
+void RmFileHandle::recover_free_list() {
+    // 按页号从小到大链接未满的页面
+    int next_free_page_no = RM_NO_PAGE;
+    for (int page_no = file_hdr_.num_pages - 1; page_no >= RM_FIRST_RECORD_PAGE; page_no--) {
+        RmPageHandle page_handle = fetch_page_handle(page_no);
+        int num_records = 0;
+        for (int slot_no = 0; slot_no < file_hdr_.num_records_per_page; slot_no++) {
+            num_records += Bitmap::is_set(page_handle.bitmap, slot_no);
+        }
+        page_handle.page_hdr->num_records = num_records;
+        if (num_records < file_hdr_.num_records_per_page) {
+            page_handle.page_hdr->next_free_page_no = next_free_page_no;
+            next_free_page_no = page_no;
+        }
+        buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), true);
+    }
+    file_hdr_.first_free_page_no = next_free_page_no;
+}
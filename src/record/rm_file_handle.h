@@ -3,6 +3,7 @@
 #include <assert.h>
 
 #include <memory>
+#include <vector>
 
 #include "bitmap.h"
 #include "common/context.h"
@@ -44,6 +45,7 @@ class RmFileHandle {      // TableHeap
      * 在page_handle中有page_hdr.free_page_no存第一个可用(未满)的page_no
      * */
     RmFileHdr file_hdr_;
+    std::string tab_name_;  // 记录文件的路径
 
    public:
     RmFileHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd)
@@ -54,6 +56,7 @@ class RmFileHandle {      // TableHeap
         disk_manager_->read_page(fd, RM_FILE_HDR_PAGE, (char *)&file_hdr_, sizeof(file_hdr_));
         // disk_manager管理的fd对应的文件中，设置从file_hdr_.num_pages开始分配page_no
         disk_manager_->set_fd2pageno(fd, file_hdr_.num_pages);
+        tab_name_ = disk_manager_->GetFileName(fd);
     }
 
     DISALLOW_COPY(RmFileHandle);
@@ -61,17 +64,23 @@ class RmFileHandle {      // TableHeap
     // RmFileHandle &operator=(const RmFileHandle &other) = delete;
 
     RmFileHdr get_file_hdr() { return file_hdr_; }
+
+    int GetTabId() { return file_hdr_.tab_id; }
     int GetFd() { return fd_; }
 
     bool is_record(const Rid &rid) const {
         RmPageHandle page_handle = fetch_page_handle(rid.page_no);
-        return Bitmap::is_set(page_handle.bitmap, rid.slot_no);  // page的slot_no位置上是否有record
+        bool exists = Bitmap::is_set(page_handle.bitmap, rid.slot_no);  // page的slot_no位置上是否有record
+        buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), false);
+        return exists;
     }
 
     std::unique_ptr<RmRecord> get_record(const Rid &rid, Context *context) const;
 
     Rid insert_record(char *buf, Context *context);
 
+    std::vector<Rid> insert_records(const char *buf, size_t num_records, Context *context);
+
     void insert_record(const Rid &rid, char *buf);
 
     void delete_record(const Rid &rid, Context *context);
@@ -82,8 +91,37 @@ class RmFileHandle {      // TableHeap
 
     RmPageHandle fetch_page_handle(int page_no) const;
 
+    // 以下用于故障恢复, 调用时没有其他线程访问这个文件; 不同页面上的recover_record可以并发执行
+
+    // 分配page_no及之前的所有页面, 故障前file_hdr_没有写回磁盘, 其中的num_pages可能小于实际的页面数
+    void recover_pages(int page_no);
+
+    /**
+     * @brief 页面的page_lsn小于lsn时, 把rid处的记录恢复为buf并把page_lsn设为lsn
+     * @param buf 恢复后的记录, nullptr表示删除rid处的记录
+     * @return 是否修改了页面
+     */
+    bool recover_record(const Rid &rid, const char *buf, lsn_t lsn);
+
+    /**
+     * @brief 页面的page_lsn小于lsn时, 把UPDATE日志update_log中修改的字节区间写入rid处的记录并把page_lsn设为lsn
+     * @return 是否修改了页面
+     */
+    bool recover_update(const Rid &rid, LogRecord &update_log, lsn_t lsn);
+
+    // 根据各个页面中的记录数重建file_hdr_中的空闲页面链表
+    void recover_free_list();
+
    private:
     RmPageHandle create_page_handle();
 
     void release_page_handle(RmPageHandle &page_handle);
+
+    int fill_page(RmPageHandle &page_handle, const char *buf, size_t num_records, std::vector<Rid> *rids,
+                  Context *context);
+
+    void add_version(const Rid &rid, const char *before, Context *context);
+
+    void append_log(LogRecordType log_type, const Rid &rid, const char *before, const char *after, Page *page,
+                    Context *context);
 };
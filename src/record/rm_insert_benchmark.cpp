@@ -0,0 +1,69 @@
+/**
+ * @brief 记录插入吞吐量测试: 对比逐条insert_record, 按批insert_records和纯memcpy的速度
+ * @details 用法: rm_insert_benchmark [num_records [record_size]]
+ * 每种方式写入一个新文件, 统计每秒插入的记录数; memcpy只把记录复制到一块连续内存, 作为上限参考
+ */
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "rm.h"
+
+static constexpr size_t BATCH_SIZE = 1024;
+static const std::string FILE_NAME = "rm_insert_benchmark.tmp";
+
+template <typename F>
+static double records_per_second(size_t num_records, F &&insert) {
+    auto start = std::chrono::steady_clock::now();
+    insert();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return num_records / elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+    size_t num_records = argc >= 2 ? atol(argv[1]) : 1000000;
+    int record_size = argc >= 3 ? atoi(argv[2]) : 64;
+    std::vector<char> records(num_records * record_size);
+    for (size_t i = 0; i < records.size(); i++) {
+        records[i] = (char)i;
+    }
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+
+    // 在新文件上执行insert, 结束后删除文件
+    auto run = [&](const std::string &name, auto &&insert) {
+        if (disk_manager->is_file(FILE_NAME)) {
+            disk_manager->destroy_file(FILE_NAME);
+        }
+        rm_manager->create_file(FILE_NAME, record_size);
+        auto file_handle = rm_manager->open_file(FILE_NAME);
+        double rate = records_per_second(num_records, [&] { insert(file_handle.get()); });
+        std::cout << name << ":\t" << (uint64_t)rate << " records/s" << std::endl;
+        rm_manager->close_file(file_handle.get());
+        rm_manager->destroy_file(FILE_NAME);
+    };
+
+    run("insert_record", [&](RmFileHandle *file_handle) {
+        for (size_t i = 0; i < num_records; i++) {
+            file_handle->insert_record(records.data() + i * record_size, nullptr);
+        }
+    });
+    run("insert_records", [&](RmFileHandle *file_handle) {
+        for (size_t i = 0; i < num_records; i += BATCH_SIZE) {
+            file_handle->insert_records(records.data() + i * record_size, std::min(BATCH_SIZE, num_records - i),
+                                        nullptr);
+        }
+    });
+    std::vector<char> copy(records.size());
+    double rate = records_per_second(num_records, [&] {
+        for (size_t i = 0; i < num_records; i++) {
+            memcpy(copy.data() + i * record_size, records.data() + i * record_size, record_size);
+        }
+    });
+    std::cout << "memcpy:\t\t" << (uint64_t)rate << " records/s" << std::endl;
+    return 0;
+}
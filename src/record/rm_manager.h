@@ -17,7 +17,7 @@ class RmManager {
     RmManager(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager)
         : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager) {}
 
-    void create_file(const std::string &filename, int record_size) {
+    void create_file(const std::string &filename, int record_size, int tab_id = 0) {
         if (record_size < 1 || record_size > RM_MAX_RECORD_SIZE) {
             throw InvalidRecordSizeError(record_size);
         }
@@ -29,6 +29,7 @@ class RmManager {
         file_hdr.record_size = record_size;
         file_hdr.num_pages = 1;
         file_hdr.first_free_page_no = RM_NO_PAGE;
+        file_hdr.tab_id = tab_id;
         // We have: sizeof(hdr) + (n + 7) / 8 + n * record_size <= PAGE_SIZE
         file_hdr.num_records_per_page =
             (BITMAP_WIDTH * (PAGE_SIZE - 1 - (int)sizeof(RmFileHdr)) + 1) / (1 + record_size * BITMAP_WIDTH);
@@ -51,8 +52,8 @@ class RmManager {
     void close_file(const RmFileHandle *file_handle) {
         disk_manager_->write_page(file_handle->fd_, RM_FILE_HDR_PAGE, (char *)&file_handle->file_hdr_,
                                   sizeof(file_handle->file_hdr_));
-        // 缓冲区的所有页刷到磁盘，注意这句话必须写在close_file前面
-        buffer_pool_manager_->FlushAllPages(file_handle->fd_);
+        // 缓冲区的所有页刷到磁盘并移出缓冲池，注意这句话必须写在close_file前面, 关闭后fd可能被其他文件重新使用
+        buffer_pool_manager_->DiscardAllPages(file_handle->fd_);
         disk_manager_->close_file(file_handle->fd_);
     }
 };
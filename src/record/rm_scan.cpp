@@ -1,5 +1,7 @@
 #include "rm_scan.h"
 
+#include <cassert>
+
 #include "rm_file_handle.h"
 
 /**
@@ -16,6 +18,14 @@ RmScan::RmScan(const RmFileHandle *file_handle) : file_handle_(file_handle) {
     next();
 }
 
+RmScan::RmScan(const RmFileHandle *file_handle, std::vector<int> page_nos)
+    : file_handle_(file_handle), page_nos_(std::move(page_nos)) {
+    assert(!page_nos_.empty());
+    rid_.page_no = page_nos_[0];
+    rid_.slot_no = -1;
+    next();
+}
+
 /**
  * @brief 找到文件中下一个存放了记录的位置
  */
@@ -25,21 +35,34 @@ void RmScan::next() {
 
     if(is_end())return;
     while(1){
-        int pos=Bitmap::next_bit(1,file_handle_->fetch_page_handle(rid_.page_no).bitmap,file_handle_->file_hdr_.num_records_per_page,rid_.slot_no);
+        RmPageHandle page_handle=file_handle_->fetch_page_handle(rid_.page_no);
+        int pos=Bitmap::next_bit(1,page_handle.bitmap,file_handle_->file_hdr_.num_records_per_page,rid_.slot_no);
+        file_handle_->buffer_pool_manager_->UnpinPage(page_handle.page->GetPageId(), false);
         if(file_handle_->file_hdr_.num_records_per_page!=pos){
             rid_.slot_no=pos;
             return;
         }
         rid_.slot_no=-1;
-        if(++rid_.page_no>=file_handle_->file_hdr_.num_pages)return;
+        rid_.page_no=next_page_no();
+        if(is_end())return;
     }
 }
 
+int RmScan::next_page_no() {
+    if (page_nos_.empty()) {
+        return rid_.page_no + 1;
+    }
+    return ++page_idx_ < page_nos_.size() ? page_nos_[page_idx_] : file_handle_->file_hdr_.num_pages;
+}
+
 /**
  * @brief ​ 判断是否到达文件末尾
  */
 bool RmScan::is_end() const {
     // Todo: 修改返回值
+    if (!page_nos_.empty()) {
+        return page_idx_ == page_nos_.size();
+    }
     return(rid_.page_no==file_handle_->file_hdr_.num_pages);
 }
 
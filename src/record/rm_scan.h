@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "rm_defs.h"
 
 class RmFileHandle;
@@ -7,12 +9,24 @@ class RmFileHandle;
 class RmScan : public RecScan {
     const RmFileHandle *file_handle_;
     Rid rid_;
+    std::vector<int> page_nos_;  // 只扫描这些页面(升序), 为空时扫描所有页面
+    size_t page_idx_ = 0;        // 当前页面在page_nos_中的下标
 public:
     RmScan(const RmFileHandle *file_handle);
 
+    /**
+     * @brief 只扫描page_nos中的页面, 用于抽样
+     * @param page_nos 升序的数据页编号, 不能为空
+     */
+    RmScan(const RmFileHandle *file_handle, std::vector<int> page_nos);
+
     void next() override;
 
     bool is_end() const override;
 
     Rid rid() const override;
+
+private:
+    // 当前页面之后要扫描的页面, 没有时返回num_pages
+    int next_page_no();
 };
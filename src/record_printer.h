@@ -19,12 +19,10 @@ public:
         for (size_t i = 0; i < num_cols; i++) {
             // std::cout << '+' << std::string(COL_WIDTH + 2, '-');
             std::string str = "+" + std::string(COL_WIDTH + 2, '-');
-            memcpy(context->data_send_ + *(context->offset_), str.c_str(), str.length());
-            *(context->offset_) = *(context->offset_) + str.length();
+            write(str, context);
         }
         std::string str = "+\n";
-        memcpy(context->data_send_ + *(context->offset_), str.c_str(), str.length());
-        *(context->offset_) = *(context->offset_) + str.length();
+        write(str, context);
         // std::cout << "+\n";
     }
 
@@ -37,19 +35,23 @@ public:
             // std::cout << "| " << std::setw(COL_WIDTH) << col << ' ';
             std::stringstream ss;
             ss << "| " << std::setw(COL_WIDTH) << col << " ";
-            memcpy(context->data_send_ + *(context->offset_), ss.str().c_str(), ss.str().length());
-            *(context->offset_) = *(context->offset_) + ss.str().length();
+            write(ss.str(), context);
         }
         // std::cout << "|\n";
         std::string str = "|\n";
-        memcpy(context->data_send_ + *(context->offset_), str.c_str(), str.length());
-        *(context->offset_) = *(context->offset_) + str.length();
+        write(str, context);
     }
 
     static void print_record_count(size_t num_rec, Context *context) {
         // std::cout << "Total record(s): " << num_rec << '\n';
         std::string str = "Total record(s): " + std::to_string(num_rec) + '\n';
-        memcpy(context->data_send_ + *(context->offset_), str.c_str(), str.length());
-        *(context->offset_) = *(context->offset_) + str.length();
+        write(str, context);
+    }
+
+private:
+    static void write(const std::string &str, Context *context) {
+        if (context->writer_ != nullptr) {
+            context->writer_->write(str);
+        }
     }
 };
@@ -1,5 +1,134 @@
 #include "checkpoint.h"
 
-void CheckpointManager::BeginCheckpoint() {}
+#include <algorithm>
 
-void CheckpointManager::EndCheckpoint() {}
\ No newline at end of file
+std::chrono::seconds checkpoint_interval = CHECKPOINT_INTERVAL;
+
+void CheckpointManager::BeginCheckpoint() {
+    std::lock_guard<std::mutex> lock(latch_);
+    // 日志的这个偏移量之后包含了BEGIN_CHECKPOINT及之后的所有日志
+    int64_t offset = log_manager_->GetPersistentLogEnd();
+    LogRecord begin_log(INVALID_TXN_ID, INVALID_LSN, LogRecordType::BEGIN_CHECKPOINT);
+    begin_lsn_ = log_manager_->AppendLogRecord(&begin_log);
+    positions_.push_back({begin_lsn_, offset});
+}
+
+void CheckpointManager::EndCheckpoint() {
+    std::lock_guard<std::mutex> lock(latch_);
+    // 上一个检查点开始之前就变脏的页面写回磁盘, 否则一直没有被换出的热点页面让日志无法截断
+    if (positions_.size() >= 2) {
+        FlushPagesBefore(positions_[positions_.size() - 2].lsn);
+    }
+
+    // 事务在追加BEGIN日志之前就设置了first_lsn, 读取时还没有设置的事务的日志都在BEGIN_CHECKPOINT之后.
+    // 已经结束并且COMMIT/ABORT日志已经写入磁盘的事务不再需要它的日志, 即使会话还没有释放它
+    lsn_t min_lsn = begin_lsn_;
+    std::vector<std::pair<txn_id_t, lsn_t>> active_txns;
+    txn_manager_->txn_map.for_each([&](Transaction *txn) {
+        TransactionState state = txn->GetState();
+        bool finished = state == TransactionState::COMMITTED || state == TransactionState::ABORTED;
+        lsn_t first_lsn = txn->GetFirstLsn();
+        if (first_lsn != INVALID_LSN && !(finished && txn->GetPrevLsn() <= log_manager_->GetPersistentLsn())) {
+            active_txns.emplace_back(txn->GetTransactionId(), txn->GetPrevLsn());
+            min_lsn = std::min(min_lsn, first_lsn);
+        }
+    });
+
+    // 页面在修改之前就设置了rec_lsn, 读取时还是干净的页面之后的修改的日志都在BEGIN_CHECKPOINT之后
+    std::map<std::string, std::vector<std::pair<page_id_t, lsn_t>>> dirty_pages;
+    for (auto &[page_id, rec_lsn] : buffer_pool_manager_->GetDirtyPages()) {
+        min_lsn = std::min(min_lsn, rec_lsn);
+        try {
+            dirty_pages[disk_manager_->GetFileName(page_id.fd)].emplace_back(page_id.page_no, rec_lsn);
+        } catch (FileNotOpenError &) {
+            // 表已经被删除
+        }
+    }
+
+    LogRecord end_log(begin_lsn_, std::move(active_txns), std::move(dirty_pages));
+    log_manager_->AppendLogRecord(&end_log);
+    log_manager_->WakeUpFlushThread(nullptr);
+    TruncateLog(min_lsn);
+    num_checkpoints_++;
+}
+
+void CheckpointManager::CreateCheckpoint() {
+    BeginCheckpoint();
+    EndCheckpoint();
+}
+
+void CheckpointManager::FlushPagesBefore(lsn_t lsn) {
+    for (auto &[page_id, rec_lsn] : buffer_pool_manager_->GetDirtyPages()) {
+        if (rec_lsn >= lsn) {
+            continue;
+        }
+        // 固定文件, 写回期间文件不会被关闭, fd不会分配给其他文件; 读取脏页表之后文件可能已经关闭, fd属于其他文件,
+        // 这时写回的是那个文件的页面, 它的日志同样会先写盘
+        buffer_pool_manager_->PinFile(page_id.fd);
+        // 页面已经被淘汰或者随文件的关闭移出缓冲池时已经写回, 不从磁盘读入
+        Page *page = buffer_pool_manager_->PinPage(page_id);
+        if (page != nullptr) {
+            // 持有读锁时页面不会被修改, 写回的是一个完整的版本; FlushPage先等待页面的修改的日志写盘
+            page->RLatch();
+            if (page->GetRecLsn() != INVALID_LSN && page->GetRecLsn() < lsn) {
+                buffer_pool_manager_->FlushPage(page_id);
+            }
+            page->RUnlatch();
+            buffer_pool_manager_->UnpinPage(page_id, false);
+        }
+        buffer_pool_manager_->UnpinFile(page_id.fd);
+    }
+}
+
+void CheckpointManager::TruncateLog(lsn_t lsn) {
+    // 最后一个lsn不大于lsn的位置
+    size_t num = 0;
+    while (num < positions_.size() && positions_[num].lsn <= lsn) {
+        num++;
+    }
+    if (num == 0) {
+        return;
+    }
+    positions_.erase(positions_.begin(), positions_.begin() + num - 1);
+    int64_t offset = positions_.front().offset;
+    int64_t begin = disk_manager_->GetLogBegin();
+    if (offset <= begin) {
+        return;
+    }
+    disk_manager_->RecycleLog(offset);
+    truncated_bytes_ += offset - begin;
+}
+
+void CheckpointManager::RunCheckpointThread() {
+    std::lock_guard<std::mutex> guard(checkpoint_thread_latch_);
+    if (enable_checkpoint_thread_) {
+        return;
+    }
+    enable_checkpoint_thread_ = true;
+    checkpoint_thread_ = std::thread([this] {
+        std::unique_lock<std::mutex> lock(checkpoint_thread_latch_);
+        while (!checkpoint_thread_cv_.wait_for(lock, checkpoint_interval,
+                                               [this] { return !enable_checkpoint_thread_; })) {
+            lock.unlock();
+            CreateCheckpoint();
+            lock.lock();
+        }
+    });
+}
+
+void CheckpointManager::StopCheckpointThread() {
+    {
+        std::lock_guard<std::mutex> guard(checkpoint_thread_latch_);
+        if (!enable_checkpoint_thread_) {
+            return;
+        }
+        enable_checkpoint_thread_ = false;
+    }
+    checkpoint_thread_cv_.notify_one();
+    checkpoint_thread_.join();
+}
+
+CheckpointManager::CheckpointStats CheckpointManager::checkpoint_stats() {
+    std::lock_guard<std::mutex> lock(latch_);
+    return {num_checkpoints_, truncated_bytes_};
+}
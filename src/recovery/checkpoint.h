@@ -1,21 +1,78 @@
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #include "transaction/transaction_manager.h"
 
+/**
+ * @brief 模糊检查点, 执行时不阻塞事务
+ * @details BeginCheckpoint追加BEGIN_CHECKPOINT日志; EndCheckpoint先把上一个检查点开始之前就已经变脏的页面写回磁盘,
+ * 再读取活动事务表(事务的最后一条日志的lsn)和脏页表(页面的rec_lsn), 追加END_CHECKPOINT日志并写盘.
+ * 此后故障恢复只需要min(脏页的rec_lsn, 活动事务的BEGIN日志的lsn, BEGIN_CHECKPOINT的lsn)及之后的日志.
+ * 每个检查点开始时记下日志末尾的偏移量, 日志只在这些位置上截断, 一般保留最近两个检查点以来的日志;
+ * 截断时DiskManager回收完全在截断位置之前的段文件
+ */
 class CheckpointManager {
    public:
-    CheckpointManager(TransactionManager * txn_manager, LogManager *log_manager,
-                      BufferPoolManager *buffer_pool_manager)
-        : txn_manager_(txn_manager), log_manager_(log_manager),
-          buffer_pool_manager_(buffer_pool_manager){}
+    CheckpointManager(TransactionManager *txn_manager, LogManager *log_manager, BufferPoolManager *buffer_pool_manager,
+                      DiskManager *disk_manager)
+        : txn_manager_(txn_manager),
+          log_manager_(log_manager),
+          buffer_pool_manager_(buffer_pool_manager),
+          disk_manager_(disk_manager) {}
 
-    ~CheckpointManager() = default;
+    ~CheckpointManager() { StopCheckpointThread(); }
 
+    // BeginCheckpoint和EndCheckpoint成对调用, 同一时间只能有一个检查点
     void BeginCheckpoint();
     void EndCheckpoint();
 
+    // 执行一次完整的检查点
+    void CreateCheckpoint();
+
+    /**
+     * @brief 启动后台线程, 每隔checkpoint_interval执行一次检查点
+     */
+    void RunCheckpointThread();
+
+    void StopCheckpointThread();
+
+    struct CheckpointStats {
+        uint64_t checkpoints;      // 完成的检查点个数
+        uint64_t truncated_bytes;  // 从日志开头丢弃的字节数
+    };
+
+    CheckpointStats checkpoint_stats();
+
    private:
+    // 日志中offset之后的部分包含了lsn及之后的所有日志
+    struct LogPosition {
+        lsn_t lsn;
+        int64_t offset;
+    };
+
+    // 把rec_lsn小于lsn的脏页写回磁盘, 写回之前保证页面的修改的日志已经写入磁盘
+    void FlushPagesBefore(lsn_t lsn);
+
+    // 截掉日志中lsn之前的日志
+    void TruncateLog(lsn_t lsn);
+
     TransactionManager *txn_manager_;
     LogManager *log_manager_;
     BufferPoolManager *buffer_pool_manager_;
-};
\ No newline at end of file
+    DiskManager *disk_manager_;
+
+    std::mutex latch_;                   // 保护以下成员
+    lsn_t begin_lsn_ = INVALID_LSN;      // 当前检查点的BEGIN_CHECKPOINT的lsn
+    std::deque<LogPosition> positions_;  // 各个检查点开始时的日志位置, 按lsn从小到大排列
+    uint64_t num_checkpoints_ = 0;
+    uint64_t truncated_bytes_ = 0;
+
+    std::thread checkpoint_thread_;
+    std::mutex checkpoint_thread_latch_;
+    std::condition_variable checkpoint_thread_cv_;  // 停止检查点线程时唤醒它
+    bool enable_checkpoint_thread_ = false;
+};
@@ -0,0 +1,232 @@
+#include "log_block.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#include "common/config.h"
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;       // 最短的匹配
+constexpr size_t LAST_LITERALS = 5;   // 块的最后几个字节总是作为字面量
+constexpr size_t MATCH_LIMIT = 12;    // 离结尾不到这么多字节时不再查找匹配
+constexpr size_t MAX_OFFSET = 65535;  // 匹配的偏移量用两个字节表示
+constexpr int HASH_BITS = 12;
+constexpr uint32_t NO_POSITION = UINT32_MAX;
+
+inline uint32_t Read32(const char *p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t Hash(uint32_t sequence) { return (sequence * 2654435761u) >> (32 - HASH_BITS); }
+
+// 按LZ4的格式写出压缩数据, 超出capacity时返回false
+class SequenceWriter {
+   public:
+    SequenceWriter(char *dst, size_t capacity) : dst_(dst), capacity_(capacity) {}
+
+    /**
+     * @brief 写出一个序列: 字面量和之后的匹配
+     * @param match_len 为0时只有字面量, 是最后一个序列
+     */
+    bool Write(const char *literals, size_t literal_len, size_t offset, size_t match_len) {
+        size_t match_code = match_len == 0 ? 0 : match_len - MIN_MATCH;
+        uint8_t token = static_cast<uint8_t>((std::min<size_t>(literal_len, 15) << 4) | std::min<size_t>(match_code, 15));
+        if (!Put(token) || (literal_len >= 15 && !PutLength(literal_len - 15))) {
+            return false;
+        }
+        if (literal_len > capacity_ - size_) {
+            return false;
+        }
+        std::memcpy(dst_ + size_, literals, literal_len);
+        size_ += literal_len;
+        if (match_len == 0) {
+            return true;
+        }
+        return Put(static_cast<uint8_t>(offset & 0xff)) && Put(static_cast<uint8_t>(offset >> 8)) &&
+               (match_code < 15 || PutLength(match_code - 15));
+    }
+
+    size_t size() const { return size_; }
+
+   private:
+    bool Put(uint8_t byte) {
+        if (size_ >= capacity_) {
+            return false;
+        }
+        dst_[size_++] = static_cast<char>(byte);
+        return true;
+    }
+
+    // 长度超过15的部分: 若干个255, 最后一个字节小于255
+    bool PutLength(size_t len) {
+        for (; len >= 255; len -= 255) {
+            if (!Put(255)) {
+                return false;
+            }
+        }
+        return Put(static_cast<uint8_t>(len));
+    }
+
+    char *dst_;
+    size_t capacity_;
+    size_t size_ = 0;
+};
+
+// 读出token之后的扩展长度, 加到len上
+inline bool ReadLength(const char *src, size_t size, size_t &ip, size_t &len) {
+    uint8_t byte;
+    do {
+        if (ip >= size) {
+            return false;
+        }
+        byte = static_cast<uint8_t>(src[ip++]);
+        len += byte;
+    } while (byte == 255);
+    return true;
+}
+
+}  // namespace
+
+/**
+ * 贪心的LZ77: 用前4个字节的哈希找到上一个相同的位置, 匹配上时向后和向前尽量延长
+ */
+size_t LogBlock::Compress(const char *src, size_t size, char *dst, size_t capacity) {
+    SequenceWriter writer(dst, capacity);
+    size_t anchor = 0;
+    if (size >= MATCH_LIMIT) {
+        std::array<uint32_t, 1 << HASH_BITS> table;
+        table.fill(NO_POSITION);
+        size_t limit = size - MATCH_LIMIT;
+        size_t match_end = size - LAST_LITERALS;
+        size_t ip = 0;
+        while (ip <= limit) {
+            uint32_t sequence = Read32(src + ip);
+            uint32_t &entry = table[Hash(sequence)];
+            size_t ref = entry;
+            entry = static_cast<uint32_t>(ip);
+            if (ref == NO_POSITION || ip - ref > MAX_OFFSET || Read32(src + ref) != sequence) {
+                ip++;
+                continue;
+            }
+            size_t len = MIN_MATCH;
+            while (ip + len < match_end && src[ref + len] == src[ip + len]) {
+                len++;
+            }
+            while (ip > anchor && ref > 0 && src[ip - 1] == src[ref - 1]) {
+                ip--;
+                ref--;
+                len++;
+            }
+            if (!writer.Write(src + anchor, ip - anchor, ip - ref, len)) {
+                return 0;
+            }
+            ip += len;
+            anchor = ip;
+        }
+    }
+    if (!writer.Write(src + anchor, size - anchor, 0, 0)) {
+        return 0;
+    }
+    return writer.size();
+}
+
+bool LogBlock::Decompress(const char *src, size_t size, char *dst, size_t raw_size) {
+    size_t ip = 0;
+    size_t op = 0;
+    while (ip < size) {
+        uint8_t token = static_cast<uint8_t>(src[ip++]);
+        size_t literal_len = token >> 4;
+        if (literal_len == 15 && !ReadLength(src, size, ip, literal_len)) {
+            return false;
+        }
+        if (literal_len > size - ip || literal_len > raw_size - op) {
+            return false;
+        }
+        std::memcpy(dst + op, src + ip, literal_len);
+        ip += literal_len;
+        op += literal_len;
+        if (ip == size) {
+            break;
+        }
+        if (size - ip < 2) {
+            return false;
+        }
+        size_t offset = static_cast<uint8_t>(src[ip]) | (static_cast<size_t>(static_cast<uint8_t>(src[ip + 1])) << 8);
+        ip += 2;
+        size_t match_len = token & 15;
+        if (match_len == 15 && !ReadLength(src, size, ip, match_len)) {
+            return false;
+        }
+        match_len += MIN_MATCH;
+        if (offset == 0 || offset > op || match_len > raw_size - op) {
+            return false;
+        }
+        // 匹配可以和要写的位置重叠, 逐字节复制
+        for (size_t i = 0; i < match_len; i++, op++) {
+            dst[op] = dst[op - offset];
+        }
+    }
+    return op == raw_size;
+}
+
+void LogBlock::Encode(const char *data, size_t size, bool compress, std::vector<char> &out) {
+    size_t pos = 0;
+    while (pos < size) {
+        // 块只在日志的边界上切分
+        size_t end = pos;
+        while (end < size && end - pos < BLOCK_SIZE) {
+            int32_t record_size;
+            std::memcpy(&record_size, data + end, sizeof(record_size));
+            assert(record_size > 0);
+            end += record_size;
+        }
+        assert(end <= size);
+        Header header;
+        header.raw_size = static_cast<uint32_t>(end - pos);
+        header.stored_size = header.raw_size;
+        size_t start = out.size();
+        out.resize(start + HEADER_SIZE + header.raw_size);
+        char *stored = out.data() + start + HEADER_SIZE;
+        if (compress) {
+            // 压缩后没有变小时存原始的日志
+            size_t compressed = Compress(data + pos, header.raw_size, stored, header.raw_size - 1);
+            if (compressed > 0) {
+                header.stored_size = static_cast<uint32_t>(compressed);
+            }
+        }
+        if (header.stored_size == header.raw_size) {
+            std::memcpy(stored, data + pos, header.raw_size);
+        }
+        header.checksum = Checksum(header, stored);
+        std::memcpy(out.data() + start, &header, HEADER_SIZE);
+        out.resize(start + HEADER_SIZE + header.stored_size);
+        pos = end;
+    }
+}
+
+bool LogBlock::ReadHeader(const char *src, size_t len, Header &header) {
+    if (len < static_cast<size_t>(HEADER_SIZE)) {
+        return false;
+    }
+    std::memcpy(&header, src, HEADER_SIZE);
+    // 一个块不会超过LogManager的缓冲区
+    return header.raw_size > 0 && header.stored_size <= header.raw_size &&
+           header.raw_size <= static_cast<uint32_t>(LOG_BUFFER_SIZE);
+}
+
+bool LogBlock::Decode(const char *src, const Header &header, std::vector<char> &raw) {
+    const char *stored = src + HEADER_SIZE;
+    if (Checksum(header, stored) != header.checksum) {
+        return false;
+    }
+    raw.resize(header.raw_size);
+    if (header.stored_size == header.raw_size) {
+        std::memcpy(raw.data(), stored, header.raw_size);
+        return true;
+    }
+    return Decompress(stored, header.stored_size, raw.data(), header.raw_size);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "common/crc32.h"
+
+/**
+ * @brief 日志块, LogManager每次把flush_buffer_中的日志编码成若干个块写入磁盘
+ * @details 每个块由若干条完整的日志组成, 日志达到BLOCK_SIZE后开始一个新的块:
+ * -----------------------------------------------------
+ * | raw_size | stored_size | checksum | stored_data |
+ * -----------------------------------------------------
+ * stored_size小于raw_size时stored_data是按LZ4块格式压缩的日志, 否则就是原始的日志.
+ * checksum是raw_size, stored_size和stored_data的CRC-32, 没有写完整的块不会被读出.
+ * 段文件预分配时填的是0, raw_size为0表示日志到此结束
+ */
+class LogBlock {
+   public:
+    struct Header {
+        uint32_t raw_size;     // 块中日志的字节数
+        uint32_t stored_size;  // 块头之后存放的字节数
+        uint32_t checksum;
+    };
+
+    static constexpr int HEADER_SIZE = sizeof(Header);
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    /**
+     * @brief 把data中size字节的日志编码成块追加到out之后
+     * @param compress 为false时只加块头, 不压缩
+     */
+    static void Encode(const char *data, size_t size, bool compress, std::vector<char> &out);
+
+    /**
+     * @brief 从src中读出块头
+     * @param len src中可读的字节数
+     * @return 块头不完整, 是日志结束的标志或者大小不合理时返回false
+     */
+    static bool ReadHeader(const char *src, size_t len, Header &header);
+
+    /**
+     * @brief 校验并解码src开头的整个块, 块中的日志放在raw中
+     * @return 校验和错误或者压缩的数据无法解码时返回false
+     */
+    static bool Decode(const char *src, const Header &header, std::vector<char> &raw);
+
+    /**
+     * @brief LZ4块格式压缩, 输出超过capacity时返回0
+     */
+    static size_t Compress(const char *src, size_t size, char *dst, size_t capacity);
+
+    /**
+     * @brief 解压Compress的输出, 解压后恰好是raw_size字节时返回true; 会检查所有的长度和偏移量, 不会越界
+     */
+    static bool Decompress(const char *src, size_t size, char *dst, size_t raw_size);
+
+   private:
+    static uint32_t Checksum(const Header &header, const char *stored) {
+        uint32_t crc = Crc32(0, reinterpret_cast<const char *>(&header), offsetof(Header, checksum));
+        return Crc32(crc, stored, header.stored_size);
+    }
+};
@@ -8,3 +8,6 @@
 #include <chrono>
 
 static constexpr std::chrono::duration<int64_t> FLUSH_TIMEOUT = std::chrono::seconds(1);
+static constexpr std::chrono::microseconds GROUP_COMMIT_DELAY = std::chrono::microseconds(0);
+static constexpr std::chrono::seconds CHECKPOINT_INTERVAL = std::chrono::seconds(30);
+static constexpr int64_t LOG_READ_SIZE = 1024 * 1024;  // 故障恢复时每次从日志中读取的字节数
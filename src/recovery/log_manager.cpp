@@ -1,17 +1,63 @@
 #include "log_manager.h"
 
+#include <algorithm>
 #include <sstream>
 
+std::atomic<bool> enable_logging(true);
+
+std::chrono::duration<int64_t> log_timeout = FLUSH_TIMEOUT;
+
+std::chrono::microseconds group_commit_delay = GROUP_COMMIT_DELAY;
+
+std::atomic<bool> log_compression(true);
+
 /**
  * 开启日志刷新线程
+ * 线程每隔log_timeout, 或者被AppendLogRecord/WakeUpFlushThread/WaitForCommit唤醒时, 把flush_buffer_写入磁盘;
+ * 超时或者因为提交被唤醒时flush_buffer_为空, 先交换log_buffer_和flush_buffer_
  */
 void LogManager::RunFlushThread() {
-    // Todo:
-    // 1. 如果系统未开启日志功能，则不能开启日志刷新线程（通过log_mode_判断）
-    // 2. 开启一个新线程，用来把flush_buffer_中的内容刷新到磁盘当中
-    // 3. 在刷新之前，需要判断当前线程由于哪种原因被唤醒，如果是time_out唤醒，则需要交换log_buffer和flush_buffer
-    // 4.  刷新之后需要更新flush_buffer的偏移量、persistent_lsn_等信息
+    if (!log_mode_ || flush_thread_ != nullptr) {
+        return;
+    }
+    stop_flush_thread_ = false;
+    flush_thread_ = new std::thread([this] {
+        std::unique_lock<std::mutex> lock(latch_);
+        while (true) {
+            cv_.wait_for(lock, log_timeout, [this] {
+                return flush_buffer_write_offset_ > 0 || stop_flush_thread_ || commit_lsn_ > persistent_lsn_;
+            });
+            if (flush_buffer_write_offset_ == 0) {
+                if (commit_lsn_ > persistent_lsn_ && group_commit_delay.count() > 0 && !stop_flush_thread_) {
+                    // 等待更多的事务提交, 和它们的日志一起写盘
+                    cv_.wait_for(lock, group_commit_delay,
+                                 [this] { return flush_buffer_write_offset_ > 0 || stop_flush_thread_; });
+                }
+                if (flush_buffer_write_offset_ == 0) {
+                    SwapBuffer();
+                }
+            }
+            FlushBuffer(lock);
+            if (stop_flush_thread_ && (state_.load() & OFFSET_MASK) == 0) {
+                break;
+            }
+        }
+    });
+}
 
+void LogManager::StopFlushThread() {
+    if (flush_thread_ == nullptr) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(latch_);
+        stop_flush_thread_ = true;
+    }
+    cv_.notify_one();
+    flush_thread_->join();
+    delete flush_thread_;
+    flush_thread_ = nullptr;
+    log_mode_ = false;
 }
 
 /**
@@ -21,27 +67,131 @@ void LogManager::RunFlushThread() {
 void LogManager::WakeUpFlushThread(std::promise<void> *p) {
     {
         std::unique_lock<std::mutex> lock(latch_);
+        WaitFlushBufferEmpty(lock);
         SwapBuffer();
-        SetPromise(p);
+        lsn_t target = flush_lsn_;
+        if (flush_thread_ == nullptr) {
+            FlushBuffer(lock);
+        } else {
+            cv_.notify_one();
+            // 等待的过程中flush_thread_可能已经写完了之后的缓冲区
+            flush_done_cv_.wait(lock, [&] { return persistent_lsn_ >= target; });
+        }
     }
 
-    cv_.notify_one();
+    if (p != nullptr) {
+        p->set_value();
+    }
+}
+
+void LogManager::WaitForCommit(lsn_t lsn) {
+    std::unique_lock<std::mutex> lock(latch_);
+    num_commits_++;
+    WaitPersistent(lock, lsn);
+}
+
+void LogManager::WaitForFlush(lsn_t lsn) {
+    std::unique_lock<std::mutex> lock(latch_);
+    WaitPersistent(lock, lsn);
+}
+
+void LogManager::RequestFlush(lsn_t lsn) {
+    std::lock_guard<std::mutex> lock(latch_);
+    if (flush_thread_ != nullptr && lsn > persistent_lsn_ && lsn > commit_lsn_) {
+        commit_lsn_ = lsn;
+        cv_.notify_one();
+    }
+}
 
-    // waiting for flush_done
-    if (promise != nullptr) {
-        promise->get_future().wait();
+void LogManager::WaitPersistent(std::unique_lock<std::mutex> &lock, lsn_t lsn) {
+    if (persistent_lsn_ >= lsn) {
+        return;
     }
+    if (flush_thread_ == nullptr) {
+        WaitFlushBufferEmpty(lock);
+        if (persistent_lsn_ < lsn) {
+            SwapBuffer();
+            FlushBuffer(lock);
+        }
+        return;
+    }
+    if (lsn > commit_lsn_) {
+        commit_lsn_ = lsn;
+        cv_.notify_one();
+    }
+    flush_done_cv_.wait(lock, [&] { return persistent_lsn_ >= lsn; });
+}
 
-    SetPromise(nullptr);
+void LogManager::SetNextLsn(lsn_t next_lsn) {
+    std::lock_guard<std::mutex> lock(latch_);
+    assert((state_.load() & OFFSET_MASK) == 0 && flush_buffer_write_offset_ == 0);
+    state_.store(static_cast<uint64_t>(next_lsn) << 32);
+    flush_lsn_ = next_lsn - 1;
+    persistent_lsn_ = next_lsn - 1;
+}
+
+int64_t LogManager::GetPersistentLogEnd() {
+    std::unique_lock<std::mutex> lock(latch_);
+    WaitFlushBufferEmpty(lock);
+    return disk_manager_->GetLogEnd();
+}
+
+LogManager::GroupCommitStats LogManager::group_commit_stats() {
+    std::lock_guard<std::mutex> lock(latch_);
+    return {num_commits_, num_syncs_};
+}
+
+LogManager::LogVolumeStats LogManager::log_volume_stats() {
+    std::lock_guard<std::mutex> lock(latch_);
+    return {record_bytes_, written_bytes_};
 }
 
 /**
  * 辅助函数，交换log_buffer_和flush_buffer_及其相关信息
  */
 void LogManager::SwapBuffer() {
+    assert(flush_buffer_write_offset_ == 0);
+    // 置上SEALED之后不会再分配新的空间, 等待已经分配了空间的日志写完
+    uint64_t state = state_.fetch_or(SEALED);
+    size_t offset = state & OFFSET_MASK;
+    while (buffer_written_.load() != offset) {
+        std::this_thread::yield();
+    }
     std::swap(log_buffer_, flush_buffer_);
-    std::swap(log_buffer_write_offset_, flush_buffer_write_offset_);
-    flush_lsn_ = next_lsn_ - 1;
+    flush_buffer_write_offset_ = offset;
+    flush_lsn_ = static_cast<lsn_t>(state >> 32) - 1;
+    buffer_written_.store(0);
+    state_.store(state & ~(SEALED | OFFSET_MASK));
+}
+
+void LogManager::WaitFlushBufferEmpty(std::unique_lock<std::mutex> &lock) {
+    if (flush_thread_ == nullptr) {
+        FlushBuffer(lock);
+    } else {
+        flush_done_cv_.wait(lock, [this] { return flush_buffer_write_offset_ == 0; });
+    }
+}
+
+void LogManager::FlushBuffer(std::unique_lock<std::mutex> &lock) {
+    size_t size = flush_buffer_write_offset_;
+    lsn_t lsn = flush_lsn_;
+    if (size > 0) {
+        // 交换缓冲区需要等flush_buffer_为空, 写磁盘时其他线程不会访问flush_buffer_
+        lock.unlock();
+        encode_buffer_.clear();
+        LogBlock::Encode(flush_buffer_, size, log_compression, encode_buffer_);
+        disk_manager_->WriteLog(encode_buffer_.data(), encode_buffer_.size());
+        disk_manager_->SyncLog();
+        lock.lock();
+        num_syncs_++;
+        record_bytes_ += size;
+        written_bytes_ += encode_buffer_.size();
+    }
+    if (lsn > persistent_lsn_) {
+        persistent_lsn_ = lsn;
+    }
+    flush_buffer_write_offset_ = 0;
+    flush_done_cv_.notify_all();
 }
 
 /**
@@ -50,11 +200,35 @@ void LogManager::SwapBuffer() {
  * @return 返回该日志的日志序列号
  */
 lsn_t LogManager::AppendLogRecord(LogRecord *log_record) {
-    // Todo:
-    // 1. 获取互斥锁latch_
-    // 2. 判断log_buffer_中是否还存在足够的剩余空间，如果空间不足，需要交换log_buffer_和flush_buffer_，唤醒日志刷新线程
-    // 3. 为该日志分配日志序列号
-    // 4. 把该日志写入到log_buffer_中
-
+    uint64_t size = log_record->size_;
+    if (size > static_cast<uint64_t>(LOG_BUFFER_SIZE)) {
+        throw InternalError("LogManager::AppendLogRecord: log record is larger than the log buffer");
+    }
+    // 一次CAS同时分配日志序列号和log_buffer_中的空间
+    uint64_t state = state_.load();
+    while (true) {
+        if (state & SEALED) {
+            std::this_thread::yield();
+            state = state_.load();
+            continue;
+        }
+        if ((state & OFFSET_MASK) + size > static_cast<uint64_t>(LOG_BUFFER_SIZE)) {
+            // log_buffer_空间不足, 等flush_buffer_写完后交换, 唤醒日志刷新线程
+            std::unique_lock<std::mutex> lock(latch_);
+            WaitFlushBufferEmpty(lock);
+            if ((state_.load() & OFFSET_MASK) + size > static_cast<uint64_t>(LOG_BUFFER_SIZE)) {
+                SwapBuffer();
+                cv_.notify_one();
+            }
+            state = state_.load();
+            continue;
+        }
+        if (state_.compare_exchange_weak(state, state + (1ULL << 32) + size)) {
+            break;
+        }
+    }
+    log_record->lsn_ = static_cast<lsn_t>(state >> 32);
+    log_record->Serialize(log_buffer_ + (state & OFFSET_MASK));
+    buffer_written_.fetch_add(size);
     return log_record->lsn_;
-}
\ No newline at end of file
+}
@@ -5,16 +5,26 @@
 #include <mutex>
 #include <condition_variable>
 #include <future>
+#include <atomic>
 
 /**
  * TODO: PROBLEM{ if the log_record.size is large than the page_size }
  */
 
+/**
+ * @brief 日志管理器, 负责把日志追加到log_buffer_并由flush_thread_写入磁盘
+ * @details 追加日志不加latch_: 日志序列号和log_buffer_中的偏移量放在同一个64位原子变量state_中
+ * (高32位是下一个lsn, 低32位是写入偏移量), 一次CAS同时分配lsn和写入空间, 各线程再并行地把日志序列化到
+ * 自己分配到的空间中. 交换缓冲区时先置上SEALED标志阻止新的分配, 等已经分配的空间都写完(buffer_written_
+ * 等于偏移量)后再交换log_buffer_和flush_buffer_, 所以磁盘上的日志按lsn顺序连续存放.
+ * 提交的事务通过WaitForCommit实现组提交: 登记自己的COMMIT日志的lsn后等待, flush_thread_最多再等
+ * group_commit_delay让更多事务加入, 然后把当前所有日志一次写盘并同步, 唤醒所有等待的事务.
+ * 写盘时flush_buffer_被编码成日志块(见LogBlock), log_compression开启时块内的日志被压缩
+ */
 class LogManager{
 public:
 
     explicit LogManager(DiskManager *disk_manager) {
-        next_lsn_ = 0;
         flush_lsn_ = INVALID_LSN;
         persistent_lsn_ = INVALID_LSN;
         log_buffer_ = new char[LOG_BUFFER_SIZE];
@@ -25,6 +35,9 @@ public:
     }
 
     ~LogManager() {
+        if (flush_thread_ != nullptr) {
+            StopFlushThread();
+        }
         delete[] log_buffer_;
         delete[] flush_buffer_;
         log_buffer_ = nullptr;
@@ -36,48 +49,110 @@ public:
      * @brief create the flush_thread to flush the log records into disk
      */
     void RunFlushThread();
-    void StopFlushThread() { log_mode_ = false; flush_thread_->join(); delete flush_thread_; }
+    /**
+     * @brief 停止flush_thread_, 停止前把log_buffer_中剩余的日志都写入磁盘
+     */
+    void StopFlushThread();
     /**
      * @brief swap the log_buffer and flush_buffer in order to flush records into disk
+     * 调用者持有latch_, 并且flush_buffer_已经为空
      */
     void SwapBuffer();
     /**
      * @brief provided for bufferpool
      * when bufferpool wants to force the flush, it can call this function
+     * 返回时调用前追加的日志都已经写入磁盘, p不为空时再通过p通知调用者
      */
     void WakeUpFlushThread(std::promise<void> *p);
 
     lsn_t AppendLogRecord(LogRecord * log_record);
 
+    /**
+     * @brief 组提交: 等待直到lsn及之前的日志都已经写入磁盘
+     * @param lsn 事务的COMMIT日志的lsn
+     */
+    void WaitForCommit(lsn_t lsn);
+
+    /**
+     * @brief 等待直到lsn及之前的日志都已经写入磁盘, 缓冲池写回页面之前调用
+     */
+    void WaitForFlush(lsn_t lsn);
+
+    /**
+     * @brief 请求日志刷新线程把lsn及之前的日志写入磁盘, 不等待写盘完成
+     * 缓冲池遇到page_lsn还没有写盘的脏页时调用, 之后再淘汰这些页面时不用等待日志
+     */
+    void RequestFlush(lsn_t lsn);
+
+    struct GroupCommitStats {
+        uint64_t commits;  // 调用WaitForCommit的次数
+        uint64_t syncs;    // 日志文件同步到磁盘的次数
+    };
+
+    GroupCommitStats group_commit_stats();
+
+    struct LogVolumeStats {
+        uint64_t record_bytes;   // 写盘的日志本身的字节数
+        uint64_t written_bytes;  // 编码成日志块后实际写入磁盘的字节数
+    };
+
+    LogVolumeStats log_volume_stats();
+
     inline bool GetLogMode() { return log_mode_; }
     inline void SetLogMode(bool log_mode) { log_mode_ = log_mode; }
-    inline lsn_t GetNextLsn() { return next_lsn_; }
+    inline lsn_t GetNextLsn() { return static_cast<lsn_t>(state_.load() >> 32); }
+    /**
+     * @brief 故障恢复读完日志后设置下一个lsn, 之后的日志接在已有日志之后, lsn继续递增
+     * 调用时还没有追加过日志
+     */
+    void SetNextLsn(lsn_t next_lsn);
+    /**
+     * @brief 等正在写盘的日志写完后返回日志末尾的偏移量, 这个偏移量一定是某条日志的开头
+     * 检查点在追加BEGIN_CHECKPOINT之前调用, 这个偏移量之后的日志包含了lsn不小于BEGIN_CHECKPOINT的所有日志
+     */
+    int64_t GetPersistentLogEnd();
     inline lsn_t GetFlushLsn() { return flush_lsn_; }
     inline char * GetLogBuffer() { return log_buffer_; }
     inline lsn_t GetPersistentLsn() { return persistent_lsn_; }
-    inline void SetPromise(std::promise<void> *p) { promise = p; }
 
 private:
+    static constexpr uint64_t SEALED = 1ULL << 31;       // state_低32位中的标志位, 表示log_buffer_正在被交换
+    static constexpr uint64_t OFFSET_MASK = SEALED - 1;  // state_低32位中的写入偏移量
+
+    // 等待flush_thread_把flush_buffer_写入磁盘, 调用者持有latch_
+    void WaitFlushBufferEmpty(std::unique_lock<std::mutex> &lock);
+
+    // 把flush_buffer_写入磁盘并同步, 然后清空flush_buffer_; 调用者持有latch_, 写磁盘时释放
+    void FlushBuffer(std::unique_lock<std::mutex> &lock);
+
+    // 等待直到lsn及之前的日志都已经写入磁盘, 调用者持有latch_
+    void WaitPersistent(std::unique_lock<std::mutex> &lock, lsn_t lsn);
+
     bool log_mode_{false};   // 标识系统是否开启日志功能，默认开启日志功能，如果不开启日志功能，需要设置该变量为false
 
     char *log_buffer_; // 用来暂时存储系统运行过程中添加的日志; append log_record into log_buffer
     char *flush_buffer_; // 用来暂时存储需要刷新到磁盘中的日志; flush the logs in flush_buffer into disk file
+    std::vector<char> encode_buffer_; // flush_buffer_编码成的日志块, 和flush_buffer_一样只在写盘时使用
 
-    std::atomic<lsn_t> next_lsn_; // 用于分发日志序列号; next lsn in the system
+    std::atomic<uint64_t> state_{0}; // 高32位是下一个lsn, 低32位是log_buffer_的偏移量和SEALED标志
+    std::atomic<size_t> buffer_written_{0}; // log_buffer_中已经写完的字节数
     std::atomic<lsn_t> persistent_lsn_; // 已经刷新到磁盘中的最后一条日志的日志序列号; the last persistent lsn
     lsn_t flush_lsn_; // flush_buffer_中最后一条日志的日志记录号; the last lsn in the flush_buffer
 
-    size_t log_buffer_write_offset_ = 0; // log_buffer_的偏移量
     size_t flush_buffer_write_offset_ = 0; // flush_buffer_的偏移量
 
-    std::thread *flush_thread_; // 日志刷新线程
+    std::thread *flush_thread_ = nullptr; // 日志刷新线程
+    bool stop_flush_thread_ = false;       // 由latch_保护
+    lsn_t commit_lsn_ = INVALID_LSN;       // 提交的事务和缓冲池等待写盘的最大lsn, 由latch_保护
+    uint64_t num_commits_ = 0;             // 由latch_保护
+    uint64_t num_syncs_ = 0;               // 由latch_保护
+    uint64_t record_bytes_ = 0;            // 由latch_保护
+    uint64_t written_bytes_ = 0;           // 由latch_保护
 
-    std::mutex latch_; // 互斥锁，用于log_buffer_的互斥访问
+    std::mutex latch_; // 互斥锁，用于交换缓冲区和flush_buffer_的互斥访问
 
     std::condition_variable cv_; // 条件变量，用于flush_thread的唤醒; to notify the flush_thread
-
-    // used to notify the WakeUpFlushThread() that the log records have been flushed into the disk
-    std::promise<void> *promise; // 主动唤醒flush_thread_，强制要求刷新日志
+    std::condition_variable flush_done_cv_; // flush_buffer_写入磁盘后通知等待的线程
 
     DiskManager *disk_manager_;
-};
\ No newline at end of file
+};
@@ -0,0 +1,119 @@
+/**
+ * @brief 日志追加吞吐量测试: 分别用1, 2, 4, ...个线程并发追加INSERT日志, 统计每秒追加的日志数和字节数
+ * @details 用法: log_manager_benchmark [max_threads [num_records [record_size]]]
+ * 每轮共追加num_records条日志, 平均分给各个线程; 日志刷新线程在后台写盘, 计时包括最后一次WakeUpFlushThread,
+ * 即所有日志都已经写入磁盘. 日志写在当前目录的段文件中, 每轮开始前清空
+ * group commit: 每个线程循环执行BEGIN, INSERT, COMMIT并等待COMMIT日志写盘, 对每个group_commit_delay
+ * 统计每秒提交的事务数, 每次fsync平均提交的事务数和提交的平均延迟
+ */
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "log_manager.h"
+
+static constexpr int BENCHMARK_MILLISECONDS = 1000;
+static constexpr int TABLE_ID = 1;
+static const std::vector<std::chrono::microseconds> GROUP_COMMIT_DELAYS = {
+    std::chrono::microseconds(0), std::chrono::microseconds(100), std::chrono::microseconds(1000)};
+
+static void truncate_log(DiskManager *disk_manager) { disk_manager->SetLogEnd(disk_manager->GetLogBegin()); }
+
+static void run_group_commit(DiskManager *disk_manager, int num_threads, int record_size) {
+    truncate_log(disk_manager);
+    LogManager log_manager(disk_manager);
+    log_manager.SetLogMode(true);
+    log_manager.RunFlushThread();
+    std::vector<char> record(record_size, 'x');
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> total_latency_us{0};
+    std::vector<std::thread> workers;
+    for (int i = 0; i < num_threads; i++) {
+        workers.emplace_back([&, i] {
+            RmRecord tuple(record_size, record.data());
+            uint64_t latency_us = 0;
+            for (int j = 0; !stop; j++) {
+                txn_id_t txn_id = j * num_threads + i;
+                LogRecord begin_log(txn_id, INVALID_LSN, LogRecordType::BEGIN);
+                lsn_t lsn = log_manager.AppendLogRecord(&begin_log);
+                LogRecord insert_log(txn_id, lsn, LogRecordType::INSERT, Rid{1, j}, tuple, TABLE_ID);
+                lsn = log_manager.AppendLogRecord(&insert_log);
+                LogRecord commit_log(txn_id, lsn, LogRecordType::COMMIT);
+                auto start = std::chrono::steady_clock::now();
+                log_manager.WaitForCommit(log_manager.AppendLogRecord(&commit_log));
+                latency_us += std::chrono::duration_cast<std::chrono::microseconds>(
+                                  std::chrono::steady_clock::now() - start).count();
+            }
+            total_latency_us += latency_us;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCHMARK_MILLISECONDS));
+    stop = true;
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    log_manager.StopFlushThread();
+    auto stats = log_manager.group_commit_stats();
+    std::cout << "  " << num_threads << " threads:\t" << stats.commits * 1000 / BENCHMARK_MILLISECONDS
+              << " commits/s\t" << (stats.syncs == 0 ? 0.0 : (double)stats.commits / stats.syncs)
+              << " commits/fsync\t" << (stats.commits == 0 ? 0 : total_latency_us / stats.commits)
+              << " us/commit" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    int max_threads = argc >= 2 ? atoi(argv[1]) : 8;
+    size_t num_records = argc >= 3 ? atol(argv[2]) : 1000000;
+    int record_size = argc >= 4 ? atoi(argv[3]) : 64;
+    std::vector<char> record(record_size, 'x');
+
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto log_manager = std::make_unique<LogManager>(disk_manager.get());
+    log_manager->SetLogMode(true);
+    log_manager->RunFlushThread();
+
+    std::cout << "append:" << std::endl;
+    for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+        truncate_log(disk_manager.get());
+        size_t per_thread = num_records / num_threads;
+        std::atomic<uint64_t> bytes{0};
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (int i = 0; i < num_threads; i++) {
+            workers.emplace_back([&, i] {
+                RmRecord tuple(record_size, record.data());
+                uint64_t written = 0;
+                lsn_t prev_lsn = INVALID_LSN;
+                for (size_t j = 0; j < per_thread; j++) {
+                    LogRecord log_record(i, prev_lsn, LogRecordType::INSERT, Rid{1, (int)j}, tuple, TABLE_ID);
+                    prev_lsn = log_manager->AppendLogRecord(&log_record);
+                    written += log_record.GetSize();
+                }
+                bytes += written;
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        log_manager->WakeUpFlushThread(nullptr);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        uint64_t total = per_thread * num_threads;
+        std::cout << "  " << num_threads << " threads:\t" << (uint64_t)(total / elapsed.count()) << " records/s\t"
+                  << (uint64_t)(bytes / elapsed.count() / (1 << 20)) << " MB/s" << std::endl;
+    }
+
+    log_manager->StopFlushThread();
+    log_manager.reset();
+
+    for (auto delay : GROUP_COMMIT_DELAYS) {
+        group_commit_delay = delay;
+        std::cout << "group commit, delay " << delay.count() << " us:" << std::endl;
+        for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+            run_group_commit(disk_manager.get(), num_threads, record_size);
+        }
+    }
+
+    disk_manager->DestroyLog();
+    return 0;
+}
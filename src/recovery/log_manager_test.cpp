@@ -0,0 +1,284 @@
+#include "log_manager.h"
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+const std::string TEST_DIR = "LogManagerTestDir";
+const int TEST_TABLE_ID = 1;
+
+/**
+ * 日志管理器的测试. 日志写在TEST_DIR下的段文件中, 测试结束后删除
+ */
+class LogManagerTest : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<LogManager> log_manager_;
+
+   public:
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        if (disk_manager_->is_dir(TEST_DIR)) {
+            disk_manager_->destroy_dir(TEST_DIR);
+        }
+        disk_manager_->create_dir(TEST_DIR);
+        ASSERT_EQ(chdir(TEST_DIR.c_str()), 0);
+        log_manager_ = std::make_unique<LogManager>(disk_manager_.get());
+        log_manager_->SetLogMode(true);
+    }
+
+    void TearDown() override {
+        log_manager_.reset();
+        disk_manager_.reset();
+        ASSERT_EQ(chdir(".."), 0);
+        disk_manager_->destroy_dir(TEST_DIR);
+    }
+
+    // 读出已经写入的所有日志块中的日志
+    std::vector<std::unique_ptr<LogRecord>> read_log() {
+        std::vector<std::unique_ptr<LogRecord>> log_records;
+        int64_t begin = disk_manager_->GetLogBegin();
+        std::vector<char> buf(disk_manager_->GetLogEnd() - begin);
+        EXPECT_EQ(disk_manager_->ReadLog(buf.data(), buf.size(), begin), static_cast<int64_t>(buf.size()));
+        size_t pos = 0;
+        std::vector<char> block;
+        LogBlock::Header header;
+        while (LogBlock::ReadHeader(buf.data() + pos, buf.size() - pos, header)) {
+            EXPECT_LE(pos + LogBlock::HEADER_SIZE + header.stored_size, buf.size());
+            EXPECT_TRUE(LogBlock::Decode(buf.data() + pos, header, block));
+            pos += LogBlock::HEADER_SIZE + header.stored_size;
+            size_t block_pos = 0;
+            while (block_pos < block.size()) {
+                auto log_record = std::make_unique<LogRecord>();
+                EXPECT_TRUE(log_record->Deserialize(block.data() + block_pos, block.size() - block_pos));
+                if (log_record->GetSize() <= 0) {
+                    break;
+                }
+                block_pos += log_record->GetSize();
+                log_records.push_back(std::move(log_record));
+            }
+            EXPECT_EQ(block_pos, block.size());
+        }
+        EXPECT_EQ(pos, buf.size());
+        return log_records;
+    }
+};
+
+TEST_F(LogManagerTest, SerializeRoundTrip) {
+    // 只有开头的3个字节和结尾的1个字节不同
+    char old_data[64] = "old_val, followed by bytes that the update does not change, 1";
+    char new_data[64] = "new_val, followed by bytes that the update does not change, 2";
+    LogRecord update_log(3, 7, LogRecordType::UPDATE, Rid{2, 5}, RmRecord(64, old_data), RmRecord(64, new_data),
+                         TEST_TABLE_ID);
+    EXPECT_LT(update_log.GetSize(), 64);
+    std::vector<char> buf(update_log.GetSize());
+    update_log.Serialize(buf.data());
+
+    LogRecord log_record;
+    ASSERT_TRUE(log_record.Deserialize(buf.data(), buf.size()));
+    EXPECT_EQ(log_record.GetLogRecordType(), LogRecordType::UPDATE);
+    EXPECT_EQ(log_record.GetTxnId(), 3);
+    EXPECT_EQ(log_record.GetPrevLsn(), 7);
+    EXPECT_EQ(log_record.GetUpdateRid().page_no, 2);
+    EXPECT_EQ(log_record.GetUpdateRid().slot_no, 5);
+    EXPECT_EQ(log_record.GetUpdateSize(), 64);
+    EXPECT_EQ(log_record.GetTableId(), TEST_TABLE_ID);
+    char data[64];
+    memcpy(data, old_data, 64);
+    log_record.RedoUpdate(data);
+    EXPECT_EQ(memcmp(data, new_data, 64), 0);
+    log_record.UndoUpdate(data);
+    EXPECT_EQ(memcmp(data, old_data, 64), 0);
+
+    // 撤销这条日志的日志把修改后的记录改回修改前的记录
+    LogRecord undo_log(3, 8, log_record);
+    EXPECT_EQ(undo_log.GetSize(), log_record.GetSize());
+    memcpy(data, new_data, 64);
+    undo_log.RedoUpdate(data);
+    EXPECT_EQ(memcmp(data, old_data, 64), 0);
+
+    // 不完整的日志不能被读出
+    LogRecord partial;
+    EXPECT_FALSE(partial.Deserialize(buf.data(), buf.size() - 1));
+
+    // 只写了一部分, 后面是以前的内容的日志校验和不对
+    buf[buf.size() - 1] ^= 1;
+    LogRecord torn;
+    EXPECT_FALSE(torn.Deserialize(buf.data(), buf.size()));
+}
+
+TEST_F(LogManagerTest, BlockCompression) {
+    std::vector<char> records;
+    for (int i = 0; i < 2000; i++) {
+        std::vector<char> data(40, static_cast<char>(i % 7));
+        LogRecord log_record(1, i - 1, LogRecordType::INSERT, Rid{1, i}, RmRecord(data.size(), data.data()),
+                             TEST_TABLE_ID);
+        records.resize(records.size() + log_record.GetSize());
+        log_record.Serialize(records.data() + records.size() - log_record.GetSize());
+    }
+    // 块在日志的边界上切分, 解码后按顺序拼起来就是原来的日志
+    auto decode = [](const std::vector<char> &encoded) {
+        std::vector<char> raw;
+        std::vector<char> block;
+        size_t pos = 0;
+        LogBlock::Header header;
+        while (LogBlock::ReadHeader(encoded.data() + pos, encoded.size() - pos, header)) {
+            EXPECT_TRUE(LogBlock::Decode(encoded.data() + pos, header, block));
+            raw.insert(raw.end(), block.begin(), block.end());
+            pos += LogBlock::HEADER_SIZE + header.stored_size;
+        }
+        EXPECT_EQ(pos, encoded.size());
+        return raw;
+    };
+    std::vector<char> compressed;
+    LogBlock::Encode(records.data(), records.size(), true, compressed);
+    EXPECT_LT(compressed.size(), records.size() / 2);
+    EXPECT_EQ(decode(compressed), records);
+    std::vector<char> uncompressed;
+    LogBlock::Encode(records.data(), records.size(), false, uncompressed);
+    EXPECT_GT(uncompressed.size(), records.size());
+    EXPECT_EQ(decode(uncompressed), records);
+
+    // 校验和不对的块不能被读出
+    LogBlock::Header header;
+    ASSERT_TRUE(LogBlock::ReadHeader(compressed.data(), compressed.size(), header));
+    std::vector<char> block;
+    compressed[LogBlock::HEADER_SIZE + header.stored_size / 2] ^= 1;
+    EXPECT_FALSE(LogBlock::Decode(compressed.data(), header, block));
+
+    // 截断的压缩数据不会越界, 随机的内容压缩后不会变小
+    std::vector<char> dst(records.size());
+    size_t size = LogBlock::Compress(records.data(), records.size(), dst.data(), dst.size());
+    ASSERT_GT(size, 0);
+    EXPECT_FALSE(LogBlock::Decompress(dst.data(), size, block.data(), 0));
+    block.resize(records.size());
+    EXPECT_FALSE(LogBlock::Decompress(dst.data(), size / 2, block.data(), block.size()));
+    EXPECT_TRUE(LogBlock::Decompress(dst.data(), size, block.data(), block.size()));
+    EXPECT_EQ(block, records);
+    std::vector<char> random(64 * 1024);
+    for (auto &c : random) {
+        c = static_cast<char>(rand());
+    }
+    EXPECT_EQ(LogBlock::Compress(random.data(), random.size(), dst.data(), random.size() - 1), 0);
+}
+
+TEST_F(LogManagerTest, ConcurrentAppend) {
+    const int num_threads = 4;
+    const int num_records = 2000;
+    log_manager_->RunFlushThread();
+    std::vector<std::vector<lsn_t>> lsns(num_threads);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < num_threads; i++) {
+        workers.emplace_back([&, i] {
+            lsn_t prev_lsn = INVALID_LSN;
+            for (int j = 0; j < num_records; j++) {
+                // 每个线程写不同长度的记录, 内容是记录在线程中的序号
+                std::vector<char> data(4 + i * 8 + j % 16, static_cast<char>(j));
+                LogRecord log_record(i, prev_lsn, LogRecordType::INSERT, Rid{i, j},
+                                     RmRecord(data.size(), data.data()), TEST_TABLE_ID);
+                prev_lsn = log_manager_->AppendLogRecord(&log_record);
+                lsns[i].push_back(prev_lsn);
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    log_manager_->WakeUpFlushThread(nullptr);
+    EXPECT_EQ(log_manager_->GetPersistentLsn(), num_threads * num_records - 1);
+    EXPECT_EQ(log_manager_->GetNextLsn(), num_threads * num_records);
+
+    // 磁盘上的日志按lsn连续存放, 每个线程的日志按追加的顺序出现
+    auto log_records = read_log();
+    ASSERT_EQ(log_records.size(), (size_t)num_threads * num_records);
+    std::vector<int> next(num_threads, 0);
+    for (size_t lsn = 0; lsn < log_records.size(); lsn++) {
+        auto &log_record = log_records[lsn];
+        EXPECT_EQ(log_record->GetLsn(), (lsn_t)lsn);
+        int i = log_record->GetTxnId();
+        ASSERT_TRUE(i >= 0 && i < num_threads);
+        int j = next[i]++;
+        EXPECT_EQ(lsns[i][j], (lsn_t)lsn);
+        EXPECT_EQ(log_record->GetPrevLsn(), j == 0 ? INVALID_LSN : lsns[i][j - 1]);
+        EXPECT_EQ(log_record->GetInsertRid().slot_no, j);
+        auto &tuple = log_record->GetInsertRecord();
+        EXPECT_EQ(tuple.size, 4 + i * 8 + j % 16);
+        EXPECT_EQ(tuple.data[0], static_cast<char>(j));
+        EXPECT_EQ(log_record->GetTableId(), TEST_TABLE_ID);
+    }
+}
+
+TEST_F(LogManagerTest, FlushWithoutFlushThread) {
+    LogRecord begin_log(1, INVALID_LSN, LogRecordType::BEGIN);
+    lsn_t lsn = log_manager_->AppendLogRecord(&begin_log);
+    LogRecord commit_log(1, lsn, LogRecordType::COMMIT);
+    lsn = log_manager_->AppendLogRecord(&commit_log);
+    EXPECT_EQ(log_manager_->GetPersistentLsn(), INVALID_LSN);
+
+    // 没有日志刷新线程时由调用者自己写盘
+    std::promise<void> promise;
+    auto future = promise.get_future();
+    log_manager_->WakeUpFlushThread(&promise);
+    EXPECT_EQ(future.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    EXPECT_EQ(log_manager_->GetPersistentLsn(), lsn);
+
+    auto log_records = read_log();
+    ASSERT_EQ(log_records.size(), 2);
+    EXPECT_EQ(log_records[0]->GetLogRecordType(), LogRecordType::BEGIN);
+    EXPECT_EQ(log_records[1]->GetLogRecordType(), LogRecordType::COMMIT);
+    EXPECT_EQ(log_records[1]->GetPrevLsn(), log_records[0]->GetLsn());
+}
+
+TEST_F(LogManagerTest, FlushOnTimeout) {
+    log_timeout = std::chrono::seconds(0);
+    log_manager_->RunFlushThread();
+    LogRecord begin_log(1, INVALID_LSN, LogRecordType::BEGIN);
+    lsn_t lsn = log_manager_->AppendLogRecord(&begin_log);
+    // 日志刷新线程超时后自己交换缓冲区并写盘
+    for (int i = 0; i < 1000 && log_manager_->GetPersistentLsn() != lsn; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    log_timeout = FLUSH_TIMEOUT;
+    EXPECT_EQ(log_manager_->GetPersistentLsn(), lsn);
+    log_manager_->StopFlushThread();
+    EXPECT_EQ(read_log().size(), 1);
+}
+
+TEST_F(LogManagerTest, GroupCommit) {
+    const int num_threads = 4;
+    const int num_txns = 20;
+    group_commit_delay = std::chrono::milliseconds(5);
+    log_manager_->RunFlushThread();
+    std::vector<std::thread> workers;
+    std::atomic<int> not_durable{0};
+    for (int i = 0; i < num_threads; i++) {
+        workers.emplace_back([&, i] {
+            for (int j = 0; j < num_txns; j++) {
+                txn_id_t txn_id = j * num_threads + i;
+                LogRecord begin_log(txn_id, INVALID_LSN, LogRecordType::BEGIN);
+                lsn_t lsn = log_manager_->AppendLogRecord(&begin_log);
+                LogRecord commit_log(txn_id, lsn, LogRecordType::COMMIT);
+                lsn = log_manager_->AppendLogRecord(&commit_log);
+                log_manager_->WaitForCommit(lsn);
+                if (log_manager_->GetPersistentLsn() < lsn) {
+                    not_durable++;
+                }
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    group_commit_delay = GROUP_COMMIT_DELAY;
+    EXPECT_EQ(not_durable, 0);
+
+    // 等待的事务共享fsync
+    auto stats = log_manager_->group_commit_stats();
+    EXPECT_EQ(stats.commits, (uint64_t)num_threads * num_txns);
+    EXPECT_GT(stats.syncs, 0);
+    EXPECT_LT(stats.syncs, stats.commits);
+    log_manager_->StopFlushThread();
+    EXPECT_EQ(read_log().size(), (size_t)num_threads * num_txns * 2);
+}
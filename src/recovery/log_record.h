@@ -1,28 +1,48 @@
 #pragma once
 
+#include <map>
+#include <vector>
+
 #include "system/sm_meta.h"
+#include "log_block.h"
 #include "log_defs.h"
 #include "record/rm_defs.h"
 
 enum class LogRecordType { INVALID = 0, CREATE_TABLE, MARK_DROP_TABLE, APPLY_DROP_TABLE, 
                             CREATE_INDEX, MARK_DROP_INDEX, APPLY_DROP_INDEX,
-                            INSERT, UPDATE, DELETE, BEGIN, COMMIT, ABORT, NEW_PAGE};
+                            INSERT, UPDATE, DELETE, BEGIN, COMMIT, ABORT, NEW_PAGE, CHECKPOINT,
+                            BEGIN_CHECKPOINT, END_CHECKPOINT};
 
-static std::string log_record_type[15] = {"INVALID", "CREATE_TABLE", "MARK_DROP_TABLE","APPLY_DROP_TABLE",
+static std::string log_record_type[17] = {"INVALID", "CREATE_TABLE", "MARK_DROP_TABLE","APPLY_DROP_TABLE",
                                    "CREATE_INDEX", "MARK_DROP_INDEX", "APPLY_DROP_INDEX",
-                                   "INSERT", "UPDATE", "DELETE", "BEGIN", "COMMIT", "ABORT", "NEW_PAGE"};
+                                   "INSERT", "UPDATE", "DELETE", "BEGIN", "COMMIT", "ABORT", "NEW_PAGE",
+                                   "CHECKPOINT", "BEGIN_CHECKPOINT", "END_CHECKPOINT"};
 
 /**
  * @brief for every write operation, you should write ahead a corresponding log record
  * 
- * LOG_HEADER
- * ---------------------------------------------
- * | size | lsn | txn_id | prev_lsn | log_type |
- * ---------------------------------------------
+ * LOG_HEADER (checksum是除checksum之外整条日志的CRC-32, 用来发现没有写完整的日志)
+ * --------------------------------------------------------
+ * | size | lsn | txn_id | prev_lsn | log_type | checksum |
+ * --------------------------------------------------------
  * transaction(begin/abort/commit)
  * --------------
  * | LOG_HEADER |
  * --------------
+ * checkpoint (all the pages have been flushed into the disk)
+ * --------------
+ * | LOG_HEADER |
+ * --------------
+ * begin_checkpoint (fuzzy checkpoint, pages are not flushed)
+ * --------------
+ * | LOG_HEADER |
+ * --------------
+ * end_checkpoint (prev_lsn is the lsn of the begin_checkpoint)
+ * -------------------------------------------------------------------------------------------------------
+ * | LOG_HEADER | txn_num | txn_num*(txn_id, last_lsn) | table_num | table_num*(table_name_size, table_name,
+ * -------------------------------------------------------------------------------------------------------
+ *   page_num, page_num*(page_no, rec_lsn)) |
+ * ------------------------------------------
  * create_table (the db_meta has not been flushed into the disk)
  * ---------------------------
  * | LOG_HEADER | table_meta |(table_name_size, table_name, col_num, col_num*(col_type, len, offset, index))
@@ -47,22 +67,22 @@ static std::string log_record_type[15] = {"INVALID", "CREATE_TABLE", "MARK_DROP_
  * ------------------------------------
  * | LOG_HEADER | tab_name | col_name |
  * ------------------------------------
- * insert
- * -----------------------------------------------------------------------------------
- * | LOG_HEADER | tuple_rid | tuple_size | tuple_data | table_name_size | table_name |
- * -----------------------------------------------------------------------------------
+ * insert (修改记录的日志用RmFileHdr中的表编号table_id代替表名)
+ * ----------------------------------------------------------------
+ * | LOG_HEADER | tuple_rid | tuple_size | tuple_data | table_id |
+ * ----------------------------------------------------------------
  * delete
- * -----------------------------------------------------------------------------------
- * | LOG_HEADER | tuple_rid | tuple_size | tuple_data | table_name_size | table_name |
- * -----------------------------------------------------------------------------------
- * update
- * -----------------------------------------------------------------------------------------------------
- * | LOG_HEADER | tuple_rid | old_size | old_data | new_size | new_data | table_name_size | table_name |
- * -----------------------------------------------------------------------------------------------------
+ * ----------------------------------------------------------------
+ * | LOG_HEADER | tuple_rid | tuple_size | tuple_data | table_id |
+ * ----------------------------------------------------------------
+ * update (只记录修改前后不同的字节区间, 每个区间记录修改前后的内容, 重做和撤销都不需要整条记录)
+ * -------------------------------------------------------------------------------------------------------
+ * | LOG_HEADER | tuple_rid | tuple_size | range_num | range_num*(offset, len, old_data, new_data) | table_id |
+ * -------------------------------------------------------------------------------------------------------
  * new_page
- * -------------------------------------------------------
- * | LOG_HEADER | page_no | table_name_size | table_name |
- * -------------------------------------------------------
+ * ---------------------------------
+ * | LOG_HEADER | page_no | table_id |
+ * ---------------------------------
  */
 
 class LogRecord {
@@ -73,10 +93,10 @@ class LogRecord {
 public:
     LogRecord() = default;
 
-    // constructor for transaction_operation (begin/commit/abort)
+    // constructor for transaction_operation (begin/commit/abort) and checkpoint
     LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_type)
         : size_(HEADER_SIZE), txn_id_(txn_id), prev_lsn_(prev_lsn), log_type_(log_type) {
-            assert(log_type == LogRecordType::BEGIN || log_type == LogRecordType::COMMIT || log_type == LogRecordType::ABORT);
+            assert(IsHeaderOnly(log_type));
         }
 
     LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_type, const std::string &table_name)
@@ -87,21 +107,34 @@ public:
             size_ = HEADER_SIZE + sizeof(int) + tab_name_size_;
     }
 
-    // constructor for update operation
+    /**
+     * @brief constructor for update operation, 比较修改前后的记录得到修改的字节区间
+     * @param old_tuple 修改前的记录
+     * @param new_tuple 修改后的记录, 和old_tuple一样长
+     */
     LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_type, const Rid &rid,
-            const RmRecord &old_tuple, const RmRecord &new_tuple, const std::string &table_name) 
-        : txn_id_(txn_id), prev_lsn_(prev_lsn), log_type_(log_type), 
-        update_rid_(rid), old_tuple_(old_tuple), new_tuple_(new_tuple) {
-            tab_name_size_ = table_name.size();
-            tab_name_ = new char[tab_name_size_];
-            memcpy(tab_name_, table_name.c_str(), tab_name_size_);
-            size_ = HEADER_SIZE + sizeof(Rid) + sizeof(int) * 3 + old_tuple_.size + new_tuple_.size + tab_name_size_;
+            const RmRecord &old_tuple, const RmRecord &new_tuple, int table_id)
+        : txn_id_(txn_id), prev_lsn_(prev_lsn), log_type_(log_type), tab_id_(table_id),
+        update_rid_(rid), update_size_(old_tuple.size) {
+            assert(old_tuple.size == new_tuple.size);
+            ComputeUpdateRanges(old_tuple.data, new_tuple.data);
+            size_ = HEADER_SIZE + sizeof(Rid) + sizeof(int) * 3 +
+                    update_ranges_.size() * sizeof(uint16_t) * 2 + update_old_.size() + update_new_.size();
+        }
+
+    // constructor for the update that undoes update_log, 修改的区间相同, 修改前后的内容对调
+    LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecord &update_log)
+        : size_(update_log.size_), txn_id_(txn_id), prev_lsn_(prev_lsn), log_type_(LogRecordType::UPDATE),
+          tab_id_(update_log.tab_id_), update_rid_(update_log.update_rid_), update_size_(update_log.update_size_),
+          update_ranges_(update_log.update_ranges_), update_old_(update_log.update_new_),
+          update_new_(update_log.update_old_) {
+            assert(update_log.log_type_ == LogRecordType::UPDATE);
         }
 
     // constructor for insert / delete operation
     LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_type, const Rid &rid, 
-            const RmRecord &record, const std::string &table_name)
-        : txn_id_(txn_id), prev_lsn_(prev_lsn), log_type_(log_type) {
+            const RmRecord &record, int table_id)
+        : txn_id_(txn_id), prev_lsn_(prev_lsn), log_type_(log_type), tab_id_(table_id) {
             if(log_type == LogRecordType::INSERT) {
                 insert_rid_ = rid;
                 insert_tuple_ = record;
@@ -111,22 +144,141 @@ public:
                 delete_rid_ = rid;
                 delete_tuple_ = record;
             }
-            tab_name_size_ = table_name.size();
-            tab_name_ = new char[tab_name_size_];
-            memcpy(tab_name_, table_name.c_str(), tab_name_size_);
-            size_ = HEADER_SIZE + sizeof(Rid) + sizeof(int) * 2 + record.size + tab_name_size_;
+            size_ = HEADER_SIZE + sizeof(Rid) + sizeof(int) * 2 + record.size;
         }
 
     // constructor for new_page operation
-    LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_type, int page_no, const std::string &table_name)
-        :txn_id_(txn_id), prev_lsn_(prev_lsn), log_type_(log_type), new_page_no_(page_no) {
-            tab_name_size_ = table_name.size();
-            tab_name_ = new char[tab_name_size_];
-            memcpy(tab_name_, table_name.c_str(), tab_name_size_);
-            size_ = HEADER_SIZE + sizeof(int) * 2 + tab_name_size_;
+    LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_type, int page_no, int table_id)
+        :txn_id_(txn_id), prev_lsn_(prev_lsn), log_type_(log_type), tab_id_(table_id), new_page_no_(page_no) {
+            size_ = HEADER_SIZE + sizeof(int) * 2;
         }
 
-    ~LogRecord() = default;
+    /**
+     * @brief constructor for end_checkpoint
+     * @param begin_lsn 对应的BEGIN_CHECKPOINT的lsn
+     * @param active_txns 活动事务表, 事务ID -> 事务的最后一条日志的lsn
+     * @param dirty_pages 脏页表, 表名 -> 页面编号 -> rec_lsn
+     */
+    LogRecord(lsn_t begin_lsn, std::vector<std::pair<txn_id_t, lsn_t>> active_txns,
+              std::map<std::string, std::vector<std::pair<page_id_t, lsn_t>>> dirty_pages)
+        : txn_id_(INVALID_TXN_ID), prev_lsn_(begin_lsn), log_type_(LogRecordType::END_CHECKPOINT),
+          active_txns_(std::move(active_txns)), dirty_pages_(std::move(dirty_pages)) {
+        size_ = HEADER_SIZE + sizeof(int) + active_txns_.size() * (sizeof(txn_id_t) + sizeof(lsn_t)) + sizeof(int);
+        for (auto &entry : dirty_pages_) {
+            size_ += sizeof(int) * 2 + entry.first.size() + entry.second.size() * (sizeof(page_id_t) + sizeof(lsn_t));
+        }
+    }
+
+    ~LogRecord() { delete[] tab_name_; }
+
+    LogRecord(const LogRecord &other) = delete;
+    LogRecord &operator=(const LogRecord &other) = delete;
+
+    /**
+     * @brief 按文件开头注释中的格式把日志写入dest, dest至少有size_个字节
+     */
+    void Serialize(char *dest) {
+        int pos = 0;
+        SerializeHeader(dest, pos);
+        switch (log_type_) {
+            case LogRecordType::INSERT:
+                SerializeTuple(dest, pos, insert_rid_, insert_tuple_);
+                SerializeValue(dest, pos, tab_id_);
+                break;
+            case LogRecordType::DELETE:
+                SerializeTuple(dest, pos, delete_rid_, delete_tuple_);
+                SerializeValue(dest, pos, tab_id_);
+                break;
+            case LogRecordType::UPDATE:
+                SerializeUpdate(dest, pos);
+                SerializeValue(dest, pos, tab_id_);
+                break;
+            case LogRecordType::NEW_PAGE:
+                SerializeValue(dest, pos, new_page_no_);
+                SerializeValue(dest, pos, tab_id_);
+                break;
+            case LogRecordType::END_CHECKPOINT:
+                SerializeCheckpoint(dest, pos);
+                break;
+            case LogRecordType::BEGIN:
+            case LogRecordType::COMMIT:
+            case LogRecordType::ABORT:
+            case LogRecordType::CHECKPOINT:
+            case LogRecordType::BEGIN_CHECKPOINT:
+                break;
+            default:
+                SerializeTableName(dest, pos);
+                break;
+        }
+        assert(pos == size_);
+        uint32_t checksum = Checksum(dest);
+        std::memcpy(dest + CHECKSUM_OFFSET, &checksum, sizeof(checksum));
+    }
+
+    /**
+     * @brief 从src中读出一条日志, src中至少有一个完整的日志头
+     * @param len src中可读的字节数
+     * @return 日志不完整或者格式错误时返回false
+     */
+    bool Deserialize(const char *src, size_t len) {
+        if (len < static_cast<size_t>(HEADER_SIZE)) {
+            return false;
+        }
+        int pos = 0;
+        DeserializeValue(src, pos, size_);
+        DeserializeValue(src, pos, lsn_);
+        DeserializeValue(src, pos, txn_id_);
+        DeserializeValue(src, pos, prev_lsn_);
+        int log_type;
+        DeserializeValue(src, pos, log_type);
+        log_type_ = static_cast<LogRecordType>(log_type);
+        uint32_t checksum;
+        DeserializeValue(src, pos, checksum);
+        if (size_ < HEADER_SIZE || static_cast<size_t>(size_) > len || log_type <= 0 ||
+            log_type > static_cast<int>(LogRecordType::END_CHECKPOINT) || checksum != Checksum(src)) {
+            return false;
+        }
+        bool ok = true;
+        switch (log_type_) {
+            case LogRecordType::INSERT:
+                ok = DeserializeTuple(src, pos, insert_rid_, insert_tuple_);
+                break;
+            case LogRecordType::DELETE:
+                ok = DeserializeTuple(src, pos, delete_rid_, delete_tuple_);
+                break;
+            case LogRecordType::UPDATE:
+                ok = DeserializeUpdate(src, pos);
+                break;
+            case LogRecordType::NEW_PAGE:
+                ok = pos + static_cast<int>(sizeof(int)) <= size_;
+                if (ok) {
+                    DeserializeValue(src, pos, new_page_no_);
+                }
+                break;
+            case LogRecordType::END_CHECKPOINT:
+                return DeserializeCheckpoint(src, pos) && pos == size_;
+            default:
+                break;
+        }
+        if (ok && HasTableId(log_type_)) {
+            ok = pos + static_cast<int>(sizeof(int)) <= size_;
+            if (ok) {
+                DeserializeValue(src, pos, tab_id_);
+            }
+        } else if (ok && !IsHeaderOnly(log_type_)) {
+            int name_size = -1;
+            if (pos + static_cast<int>(sizeof(int)) <= size_) {
+                std::memcpy(&name_size, src + pos, sizeof(int));
+            }
+            ok = name_size >= 0 && pos + static_cast<int>(sizeof(int)) + name_size <= size_;
+            if (ok) {
+                delete[] tab_name_;
+                DeserializeTableName(src + pos);
+                pos += sizeof(int) + tab_name_size_;
+            }
+        }
+        return ok && pos == size_;
+    }
 
     inline Rid &GetInsertRid() { return insert_rid_; }
 
@@ -148,14 +300,29 @@ public:
 
     inline RmRecord &GetDeleteRecord() { return delete_tuple_; }
 
-    inline RmRecord &GetOldRecord() { return old_tuple_; }
+    // UPDATE修改的记录的长度
+    inline int GetUpdateSize() { return update_size_; }
 
-    inline RmRecord &GetNewRecord() { return new_tuple_; }
+    /**
+     * @brief 把UPDATE修改的字节区间改成修改后的内容, data是修改前(或者已经重做过这条日志)的记录
+     */
+    void RedoUpdate(char *data) { ApplyUpdateRanges(data, update_new_); }
+
+    /**
+     * @brief 把UPDATE修改的字节区间改回修改前的内容, data是修改后的记录
+     */
+    void UndoUpdate(char *data) { ApplyUpdateRanges(data, update_old_); }
+
+    // 修改记录和NEW_PAGE的日志所属的表的编号
+    inline int GetTableId() { return tab_id_; }
 
     inline TabMeta &GetTabMeta() { return tab_meta_; }
 
+    inline std::vector<std::pair<txn_id_t, lsn_t>> &GetActiveTxns() { return active_txns_; }
+
+    inline std::map<std::string, std::vector<std::pair<page_id_t, lsn_t>>> &GetDirtyPages() { return dirty_pages_; }
+
     inline std::string GetTableName() {
-        std::cout<<tab_name_size_<<std::endl;
         std::string str(tab_name_, tab_name_ + tab_name_size_);
         return str;
     }
@@ -170,7 +337,7 @@ public:
         std::memcpy(log_buffer + pos, &tab_name_size_, sizeof(int));
         pos += sizeof(int);
         std::memcpy(log_buffer + pos, tab_name_, tab_name_size_);
-        pos += sizeof(tab_name_size_);
+        pos += tab_name_size_;
     }
 
     // used for debug
@@ -182,19 +349,246 @@ public:
     }
 
 private:
+    // 两个修改的区间之间相同的字节不超过这么多时合并成一个区间:
+    // 合并时相同的字节要写两遍, 分开时多写一个(offset, len)
+    static constexpr int MAX_RANGE_GAP = sizeof(uint16_t);
+
+    static bool HasTableId(LogRecordType log_type) {
+        return log_type == LogRecordType::INSERT || log_type == LogRecordType::DELETE ||
+               log_type == LogRecordType::UPDATE || log_type == LogRecordType::NEW_PAGE;
+    }
+
+    static bool IsHeaderOnly(LogRecordType log_type) {
+        return log_type == LogRecordType::BEGIN || log_type == LogRecordType::COMMIT ||
+               log_type == LogRecordType::ABORT || log_type == LogRecordType::CHECKPOINT ||
+               log_type == LogRecordType::BEGIN_CHECKPOINT;
+    }
+
+    template <typename T>
+    static void SerializeValue(char *dest, int &pos, const T &value) {
+        std::memcpy(dest + pos, &value, sizeof(T));
+        pos += sizeof(T);
+    }
+
+    template <typename T>
+    static void DeserializeValue(const char *src, int &pos, T &value) {
+        std::memcpy(&value, src + pos, sizeof(T));
+        pos += sizeof(T);
+    }
+
+    void SerializeHeader(char *dest, int &pos) {
+        SerializeValue(dest, pos, size_);
+        SerializeValue(dest, pos, lsn_);
+        SerializeValue(dest, pos, txn_id_);
+        SerializeValue(dest, pos, prev_lsn_);
+        SerializeValue(dest, pos, static_cast<int>(log_type_));
+        SerializeValue(dest, pos, static_cast<uint32_t>(0));  // 写完整条日志后再填checksum
+    }
+
+    // 计算src中size_字节的日志的checksum, 跳过checksum本身
+    uint32_t Checksum(const char *src) const {
+        uint32_t crc = Crc32(0, src, CHECKSUM_OFFSET);
+        return Crc32(crc, src + HEADER_SIZE, size_ - HEADER_SIZE);
+    }
+
+    // 找出old_data和new_data中不同的字节区间, 相隔不超过MAX_RANGE_GAP的区间合并
+    void ComputeUpdateRanges(const char *old_data, const char *new_data) {
+        int pos = 0;
+        while (true) {
+            while (pos < update_size_ && old_data[pos] == new_data[pos]) {
+                pos++;
+            }
+            if (pos == update_size_) {
+                break;
+            }
+            int begin = pos;
+            int end = pos + 1;  // 区间中最后一个不同的字节之后
+            for (int next = end; next < update_size_ && next - end <= MAX_RANGE_GAP; next++) {
+                if (old_data[next] != new_data[next]) {
+                    end = next + 1;
+                }
+            }
+            update_ranges_.emplace_back(begin, end - begin);
+            update_old_.insert(update_old_.end(), old_data + begin, old_data + end);
+            update_new_.insert(update_new_.end(), new_data + begin, new_data + end);
+            pos = end;
+        }
+    }
+
+    // 按update_ranges_把区间的内容(update_old_或者update_new_)复制到data中
+    void ApplyUpdateRanges(char *data, const std::vector<char> &contents) {
+        size_t pos = 0;
+        for (auto &range : update_ranges_) {
+            std::memcpy(data + range.first, contents.data() + pos, range.second);
+            pos += range.second;
+        }
+    }
+
+    // | rid | tuple_size | range_num | range_num*(offset, len, old_data, new_data) |
+    void SerializeUpdate(char *dest, int &pos) {
+        SerializeValue(dest, pos, update_rid_);
+        SerializeValue(dest, pos, update_size_);
+        SerializeValue(dest, pos, static_cast<int>(update_ranges_.size()));
+        size_t data_pos = 0;
+        for (auto &range : update_ranges_) {
+            SerializeValue(dest, pos, range.first);
+            SerializeValue(dest, pos, range.second);
+            std::memcpy(dest + pos, update_old_.data() + data_pos, range.second);
+            pos += range.second;
+            std::memcpy(dest + pos, update_new_.data() + data_pos, range.second);
+            pos += range.second;
+            data_pos += range.second;
+        }
+    }
+
+    // 读出UPDATE的字节区间, 区间超出记录或者日志的长度时返回false
+    bool DeserializeUpdate(const char *src, int &pos) {
+        int num_ranges;
+        if (pos + static_cast<int>(sizeof(Rid) + sizeof(int) * 2) > size_) {
+            return false;
+        }
+        DeserializeValue(src, pos, update_rid_);
+        DeserializeValue(src, pos, update_size_);
+        DeserializeValue(src, pos, num_ranges);
+        if (update_size_ < 0 || num_ranges < 0) {
+            return false;
+        }
+        update_ranges_.clear();
+        update_old_.clear();
+        update_new_.clear();
+        for (int i = 0; i < num_ranges; i++) {
+            std::pair<uint16_t, uint16_t> range;
+            if (pos + static_cast<int>(sizeof(uint16_t) * 2) > size_) {
+                return false;
+            }
+            DeserializeValue(src, pos, range.first);
+            DeserializeValue(src, pos, range.second);
+            if (range.first + range.second > update_size_ || pos + range.second * 2 > size_) {
+                return false;
+            }
+            update_ranges_.push_back(range);
+            update_old_.insert(update_old_.end(), src + pos, src + pos + range.second);
+            pos += range.second;
+            update_new_.insert(update_new_.end(), src + pos, src + pos + range.second);
+            pos += range.second;
+        }
+        return true;
+    }
+
+    // | rid | tuple_size | tuple_data |
+    static void SerializeTuple(char *dest, int &pos, const Rid &rid, const RmRecord &tuple) {
+        SerializeValue(dest, pos, rid);
+        SerializeValue(dest, pos, tuple.size);
+        std::memcpy(dest + pos, tuple.data, tuple.size);
+        pos += tuple.size;
+    }
+
+    // 读出| rid | tuple_size | tuple_data |, 超出日志长度时返回false
+    bool DeserializeTuple(const char *src, int &pos, Rid &rid, RmRecord &tuple) {
+        if (pos + static_cast<int>(sizeof(Rid) + sizeof(int)) > size_) {
+            return false;
+        }
+        DeserializeValue(src, pos, rid);
+        int size;
+        DeserializeValue(src, pos, size);
+        if (size < 0 || pos + size > size_) {
+            return false;
+        }
+        if (tuple.allocated_) {
+            delete[] tuple.data;
+        }
+        tuple = RmRecord(size, const_cast<char *>(src + pos));
+        pos += size;
+        return true;
+    }
+
+    void SerializeCheckpoint(char *dest, int &pos) {
+        SerializeValue(dest, pos, static_cast<int>(active_txns_.size()));
+        for (auto &txn : active_txns_) {
+            SerializeValue(dest, pos, txn.first);
+            SerializeValue(dest, pos, txn.second);
+        }
+        SerializeValue(dest, pos, static_cast<int>(dirty_pages_.size()));
+        for (auto &entry : dirty_pages_) {
+            SerializeValue(dest, pos, static_cast<int>(entry.first.size()));
+            std::memcpy(dest + pos, entry.first.data(), entry.first.size());
+            pos += entry.first.size();
+            SerializeValue(dest, pos, static_cast<int>(entry.second.size()));
+            for (auto &page : entry.second) {
+                SerializeValue(dest, pos, page.first);
+                SerializeValue(dest, pos, page.second);
+            }
+        }
+    }
+
+    // 读出END_CHECKPOINT的活动事务表和脏页表, 超出日志长度时返回false
+    bool DeserializeCheckpoint(const char *src, int &pos) {
+        auto fits = [&](int64_t num, int64_t item_size) {
+            return num >= 0 && pos + num * item_size <= size_;
+        };
+        int num_txns;
+        if (!fits(1, sizeof(int))) {
+            return false;
+        }
+        DeserializeValue(src, pos, num_txns);
+        if (!fits(num_txns, sizeof(txn_id_t) + sizeof(lsn_t))) {
+            return false;
+        }
+        active_txns_.resize(num_txns);
+        for (auto &txn : active_txns_) {
+            DeserializeValue(src, pos, txn.first);
+            DeserializeValue(src, pos, txn.second);
+        }
+        int num_tables;
+        if (!fits(1, sizeof(int))) {
+            return false;
+        }
+        DeserializeValue(src, pos, num_tables);
+        dirty_pages_.clear();
+        for (int i = 0; i < num_tables; i++) {
+            int name_size;
+            if (!fits(1, sizeof(int))) {
+                return false;
+            }
+            DeserializeValue(src, pos, name_size);
+            if (!fits(name_size, 1)) {
+                return false;
+            }
+            auto &pages = dirty_pages_[std::string(src + pos, name_size)];
+            pos += name_size;
+            int num_pages;
+            if (!fits(1, sizeof(int))) {
+                return false;
+            }
+            DeserializeValue(src, pos, num_pages);
+            if (!fits(num_pages, sizeof(page_id_t) + sizeof(lsn_t))) {
+                return false;
+            }
+            pages.resize(num_pages);
+            for (auto &page : pages) {
+                DeserializeValue(src, pos, page.first);
+                DeserializeValue(src, pos, page.second);
+            }
+        }
+        return true;
+    }
+
     int32_t size_{0};
     lsn_t lsn_{INVALID_LSN};
     txn_id_t txn_id_{INVALID_TXN_ID};
     lsn_t prev_lsn_{INVALID_LSN};
     LogRecordType log_type_{LogRecordType::INVALID};
-    int tab_name_size_;
-    char *tab_name_;
+    int tab_name_size_{0};
+    char *tab_name_{nullptr};
+    int tab_id_{0};
     TabMeta tab_meta_;
 
     // update
     Rid update_rid_;
-    RmRecord old_tuple_;
-    RmRecord new_tuple_;
+    int update_size_{0};
+    std::vector<std::pair<uint16_t, uint16_t>> update_ranges_;  // 修改的字节区间(offset, len)
+    std::vector<char> update_old_;  // 各个区间修改前的内容, 按区间的顺序相连
+    std::vector<char> update_new_;  // 各个区间修改后的内容
 
     // insert 
     Rid insert_rid_;
@@ -207,5 +601,10 @@ private:
     // new_page
     int new_page_no_;
 
-    static constexpr int HEADER_SIZE = 20;
+    // end_checkpoint
+    std::vector<std::pair<txn_id_t, lsn_t>> active_txns_;
+    std::map<std::string, std::vector<std::pair<page_id_t, lsn_t>>> dirty_pages_;
+
+    static constexpr int CHECKSUM_OFFSET = 20;
+    static constexpr int HEADER_SIZE = 24;
 };
\ No newline at end of file
@@ -1,28 +1,292 @@
 #include "log_recovery.h"
+
+#include <algorithm>
+#include <queue>
+#include <thread>
+
 #include "record/rm.h"
 #include "system/sm_manager.h"
 
+// 修改记录的日志(INSERT/DELETE/UPDATE)修改的rid, 其他日志返回nullptr
+static const Rid *GetRecordRid(LogRecord &log_record) {
+    switch (log_record.GetLogRecordType()) {
+        case LogRecordType::INSERT:
+            return &log_record.GetInsertRid();
+        case LogRecordType::DELETE:
+            return &log_record.GetDeleteRid();
+        case LogRecordType::UPDATE:
+            return &log_record.GetUpdateRid();
+        default:
+            return nullptr;
+    }
+}
+
+bool LogRecovery::DeserializeLogRecord(const char *data, int size, LogRecord &log_record) {
+    return size > 0 && log_record.Deserialize(data, size);
+}
+
+void LogRecovery::LoadTables() {
+    tables_.clear();
+    for (auto &entry : sm_manager_->db_.get_tables()) {
+        tables_[entry.second.id] = {entry.first, nullptr};
+    }
+}
+
+LogRecovery::Table *LogRecovery::GetTable(LogRecord &log_record) {
+    auto it = tables_.find(log_record.GetTableId());
+    if (it == tables_.end()) {
+        return nullptr;
+    }
+    if (it->second.file_handle == nullptr) {
+        it->second.file_handle = sm_manager_->get_file_handle(it->second.name);
+    }
+    return &it->second;
+}
+
+/**
+ * 分析阶段: 从日志的开头每次读出LOG_READ_SIZE字节, 顺序解码其中的日志块, 维护事务活动列表active_txns_
+ * 遇到不完整, 校验和错误或者lsn不连续的块时认为日志到此结束, 之后的内容是故障时没有写完的日志,
+ * 或者回收的段中以前的日志
+ */
+void LogRecovery::Analyze() {
+    lsn_t last_lsn = INVALID_LSN;
+    log_offset_ = disk_manager_->GetLogBegin();
+    log_buffer_.resize(LOG_READ_SIZE);
+    std::vector<char> block;
+    bool end = false;
+    while (!end) {
+        int64_t len = disk_manager_->ReadLog(log_buffer_.data(), log_buffer_.size(), log_offset_);
+        int64_t pos = 0;
+        LogBlock::Header header;
+        while (LogBlock::ReadHeader(log_buffer_.data() + pos, len - pos, header) &&
+               LogBlock::HEADER_SIZE + header.stored_size <= len - pos) {
+            if (!LogBlock::Decode(log_buffer_.data() + pos, header, block) || !AnalyzeBlock(block, last_lsn)) {
+                end = true;
+                break;
+            }
+            pos += LogBlock::HEADER_SIZE + header.stored_size;
+        }
+        log_offset_ += pos;
+        if (pos == 0 && !end) {
+            // 缓冲区放不下下一个块时加大缓冲区重新读, 否则读到了日志的末尾
+            if (len < static_cast<int64_t>(log_buffer_.size()) ||
+                !LogBlock::ReadHeader(log_buffer_.data(), len, header)) {
+                break;
+            }
+            log_buffer_.resize(LogBlock::HEADER_SIZE + header.stored_size);
+        }
+    }
+    log_buffer_ = std::vector<char>();
+    disk_manager_->SetLogEnd(log_offset_);
+    if (log_records_.empty()) {
+        return;
+    }
+    log_manager_->SetNextLsn(last_lsn + 1);
+    // 上次正常关闭时所有页面都已经写回磁盘, 只需要撤销关闭时没有结束的事务
+    clean_shutdown_ = log_records_.back()->GetLogRecordType() == LogRecordType::CHECKPOINT;
+    recovery_mode_ = !clean_shutdown_ || !active_txns_.empty();
+    if (!recovery_mode_) {
+        log_records_.clear();
+        lsn_mapping_.clear();
+        dirty_pages_.clear();
+    }
+}
+
+bool LogRecovery::AnalyzeBlock(const std::vector<char> &block, lsn_t &last_lsn) {
+    std::vector<std::unique_ptr<LogRecord>> log_records;
+    lsn_t lsn = last_lsn;
+    size_t pos = 0;
+    while (pos < block.size()) {
+        auto log_record = std::make_unique<LogRecord>();
+        if (!DeserializeLogRecord(block.data() + pos, block.size() - pos, *log_record) ||
+            (lsn != INVALID_LSN && log_record->GetLsn() != lsn + 1)) {
+            return false;
+        }
+        lsn = log_record->GetLsn();
+        pos += log_record->GetSize();
+        log_records.push_back(std::move(log_record));
+    }
+    for (auto &log_record : log_records) {
+        last_lsn = log_record->GetLsn();
+        switch (log_record->GetLogRecordType()) {
+            case LogRecordType::COMMIT:
+            case LogRecordType::ABORT:
+                active_txns_.erase(log_record->GetTxnId());
+                break;
+            case LogRecordType::CHECKPOINT:
+            case LogRecordType::BEGIN_CHECKPOINT:
+                break;
+            case LogRecordType::END_CHECKPOINT:
+                // 只用最后一个完整的检查点的脏页表
+                checkpoint_lsn_ = log_record->GetPrevLsn();
+                dirty_pages_.clear();
+                for (auto &entry : log_record->GetDirtyPages()) {
+                    auto &pages = dirty_pages_[entry.first];
+                    pages.insert(entry.second.begin(), entry.second.end());
+                }
+                break;
+            default:
+                active_txns_[log_record->GetTxnId()] = last_lsn;
+                break;
+        }
+        lsn_mapping_[last_lsn] = log_records_.size();
+        log_records_.push_back(std::move(log_record));
+    }
+    return true;
+}
+
+bool LogRecovery::NeedRedo(LogRecord &log_record, const std::string &tab_name, const Rid &rid) {
+    // 检查点之后的日志, 或者没有检查点时都需要检查页面
+    if (checkpoint_lsn_ == INVALID_LSN || log_record.GetLsn() >= checkpoint_lsn_) {
+        return true;
+    }
+    // 检查点开始之前的修改: 页面不在脏页表中时修改已经写回磁盘, 否则rec_lsn之前的修改已经写回磁盘
+    auto table = dirty_pages_.find(tab_name);
+    if (table == dirty_pages_.end()) {
+        return false;
+    }
+    auto page = table->second.find(rid.page_no);
+    return page != table->second.end() && log_record.GetLsn() >= page->second;
+}
+
 /**
  * 重做未刷入磁盘的写操作
  * 只需要考虑DML操作，暂时不需要考虑DDL操作
+ * 同一个页面上的日志由同一个线程按lsn顺序重做, 不同页面之间没有依赖, 可以并行
  */
 void LogRecovery::Redo() {
-    // Todo:
-    // 1. 从磁盘的日志文件中顺序读取日志记录
-    // 2. 根据日志对应操作的类型，执行相应的操作
-    // 2.1 如果是事务相关操作，则需要维护事务活动列表active_txns_
-    // 2.2 如果是写操作，需要比较该日志的日志序列号和对应数据页的page_lsn_，判断是否要执行写操作
+    if (clean_shutdown_) {
+        return;
+    }
+    LoadTables();
+    // 先在单线程中分配日志中用到的页面, 故障前新分配的页面可能没有写回磁盘
+    std::vector<std::pair<RmFileHandle *, LogRecord *>> redo_records;
+    std::unordered_map<RmFileHandle *, int> max_page_no;
+    for (auto &log_record : log_records_) {
+        const Rid *rid = GetRecordRid(*log_record);
+        if (rid == nullptr) {
+            continue;
+        }
+        Table *table = GetTable(*log_record);
+        if (table == nullptr) {
+            continue;
+        }
+        auto it = max_page_no.emplace(table->file_handle.get(), rid->page_no).first;
+        it->second = std::max(it->second, rid->page_no);
+        if (NeedRedo(*log_record, table->name, *rid)) {
+            redo_records.emplace_back(table->file_handle.get(), log_record.get());
+        }
+    }
+    for (auto &entry : max_page_no) {
+        entry.first->recover_pages(entry.second);
+    }
 
+    // 按(fd, page_no)把日志分给各个线程
+    size_t num_workers = std::max(1u, std::thread::hardware_concurrency());
+    num_workers = std::max<size_t>(1, std::min(num_workers, redo_records.size()));
+    std::vector<std::vector<size_t>> partitions(num_workers);
+    for (size_t i = 0; i < redo_records.size(); i++) {
+        const Rid *rid = GetRecordRid(*redo_records[i].second);
+        size_t key = (static_cast<size_t>(redo_records[i].first->GetFd()) << 32) ^ static_cast<size_t>(rid->page_no);
+        partitions[std::hash<size_t>()(key) % num_workers].push_back(i);
+    }
+    std::atomic<size_t> num_redone{0};
+    auto redo_partition = [&](const std::vector<size_t> &partition) {
+        size_t redone = 0;
+        for (size_t i : partition) {
+            RmFileHandle *file_handle = redo_records[i].first;
+            LogRecord &log_record = *redo_records[i].second;
+            const Rid &rid = *GetRecordRid(log_record);
+            bool redo;
+            if (log_record.GetLogRecordType() == LogRecordType::UPDATE) {
+                redo = log_record.GetUpdateSize() == file_handle->get_file_hdr().record_size &&
+                       file_handle->recover_update(rid, log_record, log_record.GetLsn());
+            } else if (log_record.GetLogRecordType() == LogRecordType::INSERT) {
+                redo = log_record.GetInsertRecord().size == file_handle->get_file_hdr().record_size &&
+                       file_handle->recover_record(rid, log_record.GetInsertRecord().data, log_record.GetLsn());
+            } else {
+                redo = file_handle->recover_record(rid, nullptr, log_record.GetLsn());
+            }
+            if (redo) {
+                redone++;
+            }
+        }
+        num_redone += redone;
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < num_workers; i++) {
+        workers.emplace_back(redo_partition, std::cref(partitions[i]));
+    }
+    redo_partition(partitions[0]);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    num_redone_ = num_redone;
 }
 
 /**
  * 撤销未完成事务的写操作
  * 只需要考虑DML操作，暂时不需要考虑DDL操作
+ * 所有未完成事务的日志按lsn从大到小撤销, 每次撤销写一条相反操作的日志, 最后为每个事务写ABORT日志
  */
 void LogRecovery::Undo() {
-    // Todo:
-    // 1. 遍历事务活动列表active_txns_获取所有未完成事务
-    // 2. 根据日志中的prev_lsn_信息遍历该事务已经执行的所有写操作
-    // 3. 撤销该事务的所有写操作
+    LoadTables();
+    std::priority_queue<std::pair<lsn_t, txn_id_t>> undo_lsns;
+    std::unordered_map<txn_id_t, lsn_t> prev_lsns = active_txns_;
+    for (auto &entry : active_txns_) {
+        undo_lsns.emplace(entry.second, entry.first);
+    }
+    while (!undo_lsns.empty()) {
+        auto [lsn, txn_id] = undo_lsns.top();
+        undo_lsns.pop();
+        auto it = lsn_mapping_.find(lsn);
+        if (it == lsn_mapping_.end()) {
+            continue;
+        }
+        LogRecord &log_record = *log_records_[it->second];
+        const Rid *rid = GetRecordRid(log_record);
+        Table *table = rid == nullptr ? nullptr : GetTable(log_record);
+        if (table != nullptr) {
+            RmFileHandle *file_handle = table->file_handle.get();
+            int tab_id = log_record.GetTableId();
+            lsn_t &prev_lsn = prev_lsns[txn_id];
+            if (log_record.GetLogRecordType() == LogRecordType::INSERT) {
+                LogRecord undo_log(txn_id, prev_lsn, LogRecordType::DELETE, *rid, log_record.GetInsertRecord(),
+                                   tab_id);
+                prev_lsn = log_manager_->AppendLogRecord(&undo_log);
+                file_handle->recover_record(*rid, nullptr, prev_lsn);
+            } else if (log_record.GetLogRecordType() == LogRecordType::DELETE) {
+                LogRecord undo_log(txn_id, prev_lsn, LogRecordType::INSERT, *rid, log_record.GetDeleteRecord(),
+                                   tab_id);
+                prev_lsn = log_manager_->AppendLogRecord(&undo_log);
+                file_handle->recover_record(*rid, log_record.GetDeleteRecord().data, prev_lsn);
+            } else {
+                // 撤销UPDATE只需要把修改的区间改回修改前的内容
+                LogRecord undo_log(txn_id, prev_lsn, log_record);
+                prev_lsn = log_manager_->AppendLogRecord(&undo_log);
+                file_handle->recover_update(*rid, undo_log, prev_lsn);
+            }
+        }
+        if (log_record.GetPrevLsn() != INVALID_LSN) {
+            undo_lsns.emplace(log_record.GetPrevLsn(), txn_id);
+        }
+    }
+    for (auto &entry : prev_lsns) {
+        LogRecord abort_log(entry.first, entry.second, LogRecordType::ABORT);
+        log_manager_->AppendLogRecord(&abort_log);
+    }
+    log_manager_->WakeUpFlushThread(nullptr);
 
-}
\ No newline at end of file
+    // 故障前file_hdr_没有写回磁盘, 撤销也会让页面从满变成未满
+    for (auto &entry : sm_manager_->db_.get_tables()) {
+        sm_manager_->get_file_handle(entry.first)->recover_free_list();
+    }
+    sm_manager_->recover_indexes();
+
+    tables_.clear();
+    active_txns_.clear();
+    lsn_mapping_.clear();
+    log_records_.clear();
+    dirty_pages_.clear();
+    recovery_mode_ = false;
+}
@@ -1,38 +1,89 @@
 #pragma once
 
-#include "log_record.h"
+#include <memory>
+#include <vector>
+
+#include "log_manager.h"
 #include "system/sm_manager.h"
 
+/**
+ * @brief 故障恢复, 启动时依次执行Analyze, Redo和Undo
+ * @details Analyze从日志的开头按块顺序读出并解码所有段文件中的日志块, 找出没有结束的事务;
+ * Redo按(fd, page_no)把修改记录的日志分给多个线程, 每个线程按lsn顺序重做自己的页面上page_lsn小于日志lsn的修改;
+ * Undo沿prev_lsn撤销未结束事务的修改, 撤销本身也写日志, 最后为这些事务写ABORT日志. 日志中最后一条不是CHECKPOINT时(上次没有正常关闭),
+ * 或者撤销过事务时, 重建所有索引.
+ * 模糊检查点之前的日志已经被截掉了一部分, 剩下的检查点之前的日志根据最后一个检查点的脏页表跳过, 不用读页面
+ */
 class LogRecovery {
    public:
-    LogRecovery(SmManager *sm_manager, DiskManager *disk_manager) {
-        log_buffer_ = new char[LOG_BUFFER_SIZE];
+    LogRecovery(SmManager *sm_manager, DiskManager *disk_manager, LogManager *log_manager) {
         log_offset_ = 0;
         active_txns_ = std::unordered_map<txn_id_t, lsn_t>();
         lsn_mapping_ = std::unordered_map<lsn_t, int>();
         sm_manager_ = sm_manager;
         disk_manager_ = disk_manager;
+        log_manager_ = log_manager;
     }
 
     ~LogRecovery() {
-        delete[] log_buffer_;
         sm_manager_ = nullptr;
         disk_manager_ = nullptr;
+        log_manager_ = nullptr;
     }
 
+    /**
+     * @brief 读出日志中的所有日志, 把日志末尾设置到最后一条完整的日志之后, 并让log_manager_从最后一条日志之后继续分配lsn
+     * 日志不为空时开启recovery_mode_
+     */
+    void Analyze();
     void Redo();
     void Undo();
     inline bool GetRecoveryMode() { return recovery_mode_; }
 
-    bool DeserializeLogRecord(const char* data, LogRecord &log_record);
+    /**
+     * @brief 从data中读出一条日志
+     * @param size data中可读的字节数
+     * @return 日志不完整或者格式错误时返回false
+     */
+    bool DeserializeLogRecord(const char* data, int size, LogRecord &log_record);
+
+    // Redo重做的日志条数
+    inline size_t GetNumRedone() { return num_redone_; }
 
    private:
+    struct Table {
+        std::string name;
+        std::shared_ptr<RmFileHandle> file_handle;  // 第一次用到时打开, 恢复期间一直钉住
+    };
+
+    /**
+     * @brief 解析一个日志块中的所有日志, 块中的日志都完整并且lsn接着last_lsn时才加入log_records_
+     * @return 块中的日志不能全部使用时返回false, 日志到这个块之前结束
+     */
+    bool AnalyzeBlock(const std::vector<char> &block, lsn_t &last_lsn);
+
+    // 根据系统目录建立表的编号到表的映射, 不打开表的文件
+    void LoadTables();
+
+    // 日志修改的记录所在的表, 表已经不存在时返回nullptr; 打开表的文件
+    Table *GetTable(LogRecord &log_record);
+
+    // 根据检查点的脏页表判断修改tab_name中rid的日志是否可能还没有写回磁盘
+    bool NeedRedo(LogRecord &log_record, const std::string &tab_name, const Rid &rid);
+
     // store the running transactions, the mapping of running transactions to their lastest log records
     std::unordered_map<txn_id_t, lsn_t> active_txns_;   // 活动事务列表，记录当前系统运行过程中所有正在执行的事务
-    std::unordered_map<lsn_t, int> lsn_mapping_;
-    char *log_buffer_;      // 从磁盘中读取的日志记录
-    int log_offset_;        // log_buffer_的偏移量
+    std::unordered_map<lsn_t, int> lsn_mapping_;        // lsn在log_records_中的下标
+    std::vector<std::unique_ptr<LogRecord>> log_records_;  // 日志文件中的所有日志, 按lsn排列
+    std::vector<char> log_buffer_;  // 从磁盘中读取的日志块, 放不下一个块时加大
+    int64_t log_offset_;            // log_buffer_开头在日志中的偏移量
+    std::unordered_map<int, Table> tables_;  // 表的编号 -> 表
     SmManager *sm_manager_;
     DiskManager *disk_manager_;
+    LogManager *log_manager_;
     bool recovery_mode_ = false; // 用于标识在系统开启时是否进行系统故障恢复
-};
\ No newline at end of file
+    bool clean_shutdown_ = false;  // 最后一条日志是否是CHECKPOINT
+    lsn_t checkpoint_lsn_ = INVALID_LSN;  // 最后一个完整的模糊检查点的BEGIN_CHECKPOINT的lsn
+    std::unordered_map<std::string, std::unordered_map<page_id_t, lsn_t>> dirty_pages_;  // 检查点的脏页表
+    size_t num_redone_ = 0;
+};
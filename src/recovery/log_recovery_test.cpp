@@ -0,0 +1,229 @@
+#include "log_recovery.h"
+
+#include "checkpoint.h"
+#include "transaction/concurrency/lock_manager.h"
+#include "execution/execution_manager.h"
+#include "interp.h"
+#include "transaction/transaction_manager.h"
+#include "gtest/gtest.h"
+
+#define BUFFER_LENGTH 8192
+const std::string TEST_DB_NAME = "LogRecoveryTestDB";
+
+/**
+ * 故障恢复的测试. 不调用close_db直接丢弃所有组件模拟故障: 缓冲池中的脏页丢失, 只有已经写回磁盘的页面和日志还在,
+ * 然后用新的组件打开数据库并执行恢复
+ */
+class LogRecoveryTest : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+    std::unique_ptr<QlManager> ql_manager_;
+    std::unique_ptr<LockManager> lock_manager_;
+    std::unique_ptr<LogManager> log_manager_;
+    std::unique_ptr<TransactionManager> txn_manager_;
+    std::unique_ptr<Interp> interp_;
+    std::unique_ptr<LogRecovery> recovery_;
+    char result_[BUFFER_LENGTH];
+
+   public:
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        start();
+        if (sm_manager_->is_dir(TEST_DB_NAME)) {
+            sm_manager_->drop_db(TEST_DB_NAME);
+        }
+        sm_manager_->create_db(TEST_DB_NAME);
+        sm_manager_->open_db(TEST_DB_NAME);
+    }
+
+    void TearDown() override {
+        sm_manager_->close_db();
+        sm_manager_->drop_db(TEST_DB_NAME);
+    }
+
+    // 创建所有组件, 日志刷新线程不运行, 提交时由提交的事务自己写日志
+    void start() {
+        disk_manager_ = std::make_unique<DiskManager>();
+        log_manager_ = std::make_unique<LogManager>(disk_manager_.get());
+        log_manager_->SetLogMode(true);
+        buffer_pool_manager_ =
+            std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager_.get(), log_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+        ql_manager_ = std::make_unique<QlManager>(sm_manager_.get());
+        lock_manager_ = std::make_unique<LockManager>();
+        txn_manager_ = std::make_unique<TransactionManager>(lock_manager_.get(), sm_manager_.get());
+        interp_ = std::make_unique<Interp>(sm_manager_.get(), ql_manager_.get(), txn_manager_.get());
+        recovery_ = std::make_unique<LogRecovery>(sm_manager_.get(), disk_manager_.get(), log_manager_.get());
+    }
+
+    // 丢弃所有组件模拟故障, 然后重新打开数据库, 需要时执行恢复
+    void crash_and_recover(bool need_recovery = true) {
+        ASSERT_EQ(chdir(".."), 0);
+        recovery_.reset();
+        interp_.reset();
+        txn_manager_.reset();
+        lock_manager_.reset();
+        log_manager_.reset();
+        ql_manager_.reset();
+        sm_manager_.reset();
+        ix_manager_.reset();
+        rm_manager_.reset();
+        buffer_pool_manager_.reset();
+        disk_manager_.reset();
+        start();
+        sm_manager_->open_db(TEST_DB_NAME);
+        recovery_->Analyze();
+        ASSERT_EQ(recovery_->GetRecoveryMode(), need_recovery);
+        if (need_recovery) {
+            recovery_->Redo();
+            recovery_->Undo();
+        }
+    }
+
+    void flush_pages(const std::string &tab_name) {
+        buffer_pool_manager_->FlushAllPages(sm_manager_->get_file_handle(tab_name)->GetFd());
+    }
+
+    // 执行一条sql, 返回输出的结果
+    std::string exec_sql(const std::string &sql, txn_id_t *txn_id) {
+        std::shared_ptr<ast::TreeNode> parse_tree;
+        bool parsed = ast::parse(sql, &parse_tree);
+        assert(parsed && parse_tree != nullptr);
+        memset(result_, 0, BUFFER_LENGTH);
+        int offset = 0;
+        Context context(lock_manager_.get(), log_manager_.get(), nullptr, result_, &offset);
+        interp_->interp_sql(parse_tree, txn_id, &context);
+        context.writer_->flush();
+        return std::string(result_, offset);
+    }
+
+    // 以autocommit方式执行一条sql
+    std::string exec_sql(const std::string &sql) {
+        txn_id_t txn_id = INVALID_TXN_ID;
+        return exec_sql(sql, &txn_id);
+    }
+
+    static std::string row(int id, int num) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "| %16d | %16d |\n", id, num);
+        return buf;
+    }
+
+    static bool has_row(const std::string &result, int id, int num) {
+        return result.find(row(id, num)) != std::string::npos;
+    }
+
+    static bool has_total(const std::string &result, int total) {
+        return result.find("Total record(s): " + std::to_string(total) + "\n") != std::string::npos;
+    }
+
+    void expect_recovered() {
+        auto result = exec_sql("select * from t1;");
+        EXPECT_TRUE(has_row(result, 1, 1));
+        EXPECT_TRUE(has_row(result, 2, 20));
+        EXPECT_TRUE(has_row(result, 3, 3));
+        EXPECT_TRUE(has_total(result, 3));
+        // 索引按恢复后的记录重建
+        EXPECT_TRUE(has_total(exec_sql("select * from t1 where id = 1;"), 1));
+        EXPECT_TRUE(has_total(exec_sql("select * from t1 where id = 4;"), 0));
+    }
+};
+
+TEST_F(LogRecoveryTest, RedoCommittedAndUndoUncommitted) {
+    exec_sql("create table t1 (id int, num int);");
+    exec_sql("create index t1 (id);");
+    exec_sql("insert into t1 values (1, 1), (2, 2);");
+    // 部分修改已经写回磁盘, 重做时根据page_lsn跳过
+    flush_pages("t1");
+    exec_sql("update t1 set num = 20 where num = 2;");
+    exec_sql("insert into t1 values (3, 3);");
+
+    // 故障时没有提交的事务, 它的日志已经写回磁盘, 重做时先重复它的修改, 再由撤销回滚
+    txn_id_t loser = INVALID_TXN_ID;
+    exec_sql("begin;", &loser);
+    exec_sql("insert into t1 values (4, 4);", &loser);
+    exec_sql("delete from t1 where num = 1;", &loser);
+    exec_sql("update t1 set num = 30 where num = 3;", &loser);
+    log_manager_->WakeUpFlushThread(nullptr);
+
+    crash_and_recover();
+    EXPECT_GT(recovery_->GetNumRedone(), 0);
+    expect_recovered();
+
+    // 恢复过程中再次故障, 撤销写的日志让第二次恢复得到同样的结果
+    crash_and_recover();
+    expect_recovered();
+
+    // 恢复之后lsn继续递增, 新的修改可以正常写日志并再次恢复
+    crash_and_recover();
+    exec_sql("insert into t1 values (5, 5);");
+    crash_and_recover();
+    auto result = exec_sql("select * from t1;");
+    EXPECT_TRUE(has_row(result, 5, 5));
+    EXPECT_TRUE(has_total(result, 4));
+}
+
+TEST_F(LogRecoveryTest, CleanShutdownSkipsRecovery) {
+    exec_sql("create table t1 (id int, num int);");
+    exec_sql("insert into t1 values (1, 1);");
+    lsn_t next_lsn = log_manager_->GetNextLsn();
+    sm_manager_->close_db();
+    LogRecord checkpoint_log(INVALID_TXN_ID, INVALID_LSN, LogRecordType::CHECKPOINT);
+    log_manager_->AppendLogRecord(&checkpoint_log);
+    log_manager_->WakeUpFlushThread(nullptr);
+
+    ASSERT_EQ(chdir(TEST_DB_NAME.c_str()), 0);
+    crash_and_recover(false);
+    EXPECT_EQ(log_manager_->GetNextLsn(), next_lsn + 1);
+    EXPECT_TRUE(has_row(exec_sql("select * from t1;"), 1, 1));
+}
+
+TEST_F(LogRecoveryTest, FuzzyCheckpointTruncatesLog) {
+    auto checkpoint_manager = std::make_unique<CheckpointManager>(txn_manager_.get(), log_manager_.get(),
+                                                                  buffer_pool_manager_.get(), disk_manager_.get());
+    // 用较小的段文件, 截断时可以回收段
+    disk_manager_->SetLogSegmentSize(LOG_SEGMENT_HEADER_SIZE + 4096);
+    exec_sql("create table t1 (id int, num int);");
+    for (int i = 0; i < 100; i++) {
+        exec_sql("insert into t1 values (" + std::to_string(i) + ", " + std::to_string(i) + ");");
+    }
+    checkpoint_manager->CreateCheckpoint();
+    int64_t log_begin = disk_manager_->GetLogBegin();
+    exec_sql("update t1 set num = 1000 where id = 1;");
+
+    // 第二个检查点把第一个检查点之前变脏的页面写回磁盘, 日志截断到第一个检查点
+    checkpoint_manager->CreateCheckpoint();
+    auto stats = checkpoint_manager->checkpoint_stats();
+    EXPECT_EQ(stats.checkpoints, 2);
+    EXPECT_GT(stats.truncated_bytes, 0);
+    EXPECT_GT(disk_manager_->GetLogBegin(), log_begin);
+    EXPECT_EQ(disk_manager_->GetLogBegin(), (int64_t)stats.truncated_bytes);
+    EXPECT_FALSE(disk_manager_->is_file(LOG_FILE_NAME + ".00000000"));
+
+    // 活动事务的日志在检查点之后仍然保留, 故障后可以撤销
+    txn_id_t loser = INVALID_TXN_ID;
+    exec_sql("begin;", &loser);
+    exec_sql("insert into t1 values (100, 100);", &loser);
+    exec_sql("update t1 set num = 2000 where id = 2;", &loser);
+    checkpoint_manager->CreateCheckpoint();
+    checkpoint_manager->CreateCheckpoint();
+    exec_sql("insert into t1 values (101, 101);");
+    checkpoint_manager->CreateCheckpoint();
+    log_manager_->WakeUpFlushThread(nullptr);
+    checkpoint_manager.reset();
+
+    crash_and_recover();
+    auto result = exec_sql("select * from t1;");
+    EXPECT_TRUE(has_row(result, 1, 1000));
+    EXPECT_TRUE(has_row(result, 2, 2));
+    EXPECT_TRUE(has_row(result, 101, 101));
+    EXPECT_FALSE(has_row(result, 100, 100));
+    EXPECT_TRUE(has_total(result, 101));
+}
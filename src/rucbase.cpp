@@ -1,182 +1,296 @@
-#include <netinet/in.h>
-#include <readline/history.h>
-#include <readline/readline.h>
-#include <setjmp.h>
 #include <signal.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+
 #include "errors.h"
+#include "execution/row_sink.h"
 #include "interp.h"
+#include "net/protocol.h"
+#include "net/server.h"
+#include "recovery/checkpoint.h"
 #include "recovery/log_recovery.h"
 
 #define SOCK_PORT 8765
-#define BUFFER_LENGTH 8192
-#define MAX_CONN_LIMIT 8
-
-static bool should_exit = false;
 
 auto disk_manager = std::make_unique<DiskManager>();
-auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+auto log_manager = std::make_unique<LogManager>(disk_manager.get());
+auto buffer_pool_manager =
+    std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get(), log_manager.get());
 auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
 auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
 auto sm_manager =
     std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
 auto ql_manager = std::make_unique<QlManager>(sm_manager.get());
 auto lock_manager = std::make_unique<LockManager>();
-auto txn_manager = std::make_unique<TransactionManager>(lock_manager.get(), sm_manager.get());
-auto log_manager = std::make_unique<LogManager>(disk_manager.get());
+auto version_store = std::make_unique<VersionStore>();
+auto txn_manager = std::make_unique<TransactionManager>(lock_manager.get(), sm_manager.get(),
+                                                        ConcurrencyMode::TWO_PHASE_LOCKING, version_store.get());
 auto interp = std::make_unique<Interp>(sm_manager.get(), ql_manager.get(), txn_manager.get());
-auto recovery = std::make_unique<LogRecovery>(sm_manager.get(), disk_manager.get());
+auto recovery = std::make_unique<LogRecovery>(sm_manager.get(), disk_manager.get(), log_manager.get());
+auto checkpoint_manager = std::make_unique<CheckpointManager>(txn_manager.get(), log_manager.get(),
+                                                              buffer_pool_manager.get(), disk_manager.get());
+
+static std::atomic<Server *> server{nullptr};
 
-static jmp_buf jmpbuf;
 void sigint_handler(int signo) {
-    should_exit = true;
-    if (log_manager->GetLogMode()) {
-        log_manager->StopFlushThread();
+    Server *curr_server = server.load();
+    if (curr_server != nullptr) {
+        curr_server->stop();
     }
-    std::cout << "The Server receive Crtl+C, will been closed\n";
-    longjmp(jmpbuf, 1);
 }
 
-void *client_handler(void *sock_fd) {
-    int count = 0;
-    int fd = *((int *)sock_fd);
-    int i_recvBytes;
-    char data_recv[BUFFER_LENGTH];
-    // const char *data_send = "Server has received your request!\n";
-    char *data_send = new char[BUFFER_LENGTH];
-    int offset = 0;
-    // the latest transaction's txn_id
-    txn_id_t txn_id = INVALID_TXN_ID;
-    //    const std::string end = "\n";
-
-    while (true) {
-        std::cout << "Waiting for request..." << std::endl;
-        memset(data_recv, 0, BUFFER_LENGTH);
-
-        i_recvBytes = read(fd, data_recv, BUFFER_LENGTH);
-
-        if (i_recvBytes == 0) {
-            std::cout << "Maybe the client has closed" << std::endl;
-            break;
-        }
-        if (i_recvBytes == -1) {
-            std::cout << "Client read error!" << std::endl;
-            break;
-        }
-        if (strcmp(data_recv, "exit") == 0) {
-            std::cout << "Client exit." << std::endl;
-            break;
+/**
+ * @brief 二进制协议连接上的会话状态
+ */
+struct Session : public Connection::State {
+    std::unordered_map<uint32_t, std::shared_ptr<PreparedStmt>> stmts;  // 预编译的语句
+    uint32_t next_stmt_id = 1;
+};
+
+/**
+ * @brief 解析一条sql, 语法错误时返回nullptr
+ */
+std::shared_ptr<ast::TreeNode> parse_sql(const std::string &sql) {
+    std::shared_ptr<ast::TreeNode> parse_tree;
+    return ast::parse(sql, &parse_tree) ? parse_tree : nullptr;
+}
+
+/**
+ * @brief 执行客户端发来的一条sql, 结果流式地写回客户端
+ * @return 返回false时关闭连接
+ */
+bool handle_text_request(Connection *conn, const std::string &request) {
+    std::cout << "Read from client " << conn->fd() << ": " << request << std::endl;
+    ResultWriter &writer = conn->writer();
+
+    Context context(lock_manager.get(), log_manager.get(), nullptr, &writer);
+    context.version_store_ = version_store.get();
+    size_t sent_before = writer.bytes_sent();
+    try {
+        interp->interp_sql(request, &conn->txn_id_, &context);
+    } catch (TransactionAbortException &e) {
+        // 未发送的部分结果作废, 改为返回abort信息; 已经发出了一部分时告诉客户端结果不完整
+        writer.discard();
+        if (writer.bytes_sent() != sent_before) {
+            writer.write(std::string("\n") + protocol::TEXT_RESULT_ABORTED);
         }
-        count++;
-        std::cout << "Read from client " << fd << ": " << data_recv << std::endl;
-
-        memset(data_send, 0, BUFFER_LENGTH);
-        offset = 0;
-
-        // TODO: call function named "exec_simple_sql"
-        //        RC rc = sql_handler.exec_simple_sql(data_recv);
-        add_history(data_recv);
-        YY_BUFFER_STATE buf = yy_scan_string(data_recv);
-        if (yyparse() == 0) {
-            if (ast::parse_tree != nullptr) {
-                Context *context = new Context(lock_manager.get(), log_manager.get(), nullptr, data_send, &offset);
-                try {
-                    interp->interp_sql(ast::parse_tree, &txn_id, context);
-                    // memcpy(data_send + offset, end, strlen(end) + 1);
-                    // offset += strlen(end) + 1;
-                } catch (TransactionAbortException &e) {
-                    std::string str = e.GetInfo();
-                    memcpy(data_send, str.c_str(), str.length());
-                    data_send[str.length()] = '\0';
-                    txn_manager->Abort(context->txn_, log_manager.get());
-                } catch (RedBaseError &e) {
-                    std::cerr << e.what() << std::endl;
-                }
-            }
+        writer.write(e.GetInfo());
+        txn_manager->Abort(context.txn_, log_manager.get());
+    } catch (RedBaseError &e) {
+        // 和abort一样, 未发送的部分结果作废, 改为返回错误信息
+        std::cerr << e.what() << std::endl;
+        writer.discard();
+        if (writer.bytes_sent() != sent_before) {
+            writer.write(std::string("\n") + protocol::TEXT_RESULT_ABORTED);
         }
-        yy_delete_buffer(buf);
-        // TODO: 格式化 sql_handler.result, 传给客户端
-        // send result with fixed format, use protobuf in the future
-        if (write(fd, data_send, offset + 1) == -1) {
-            break;
+        writer.write(std::string(e.what()) + "\n");
+    }
+    // 发送剩余结果和结束符'\0'
+    try {
+        writer.finish();
+    } catch (UnixError &e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 读取EXECUTE消息中的参数
+ */
+std::vector<Value> read_params(protocol::MessageReader &reader) {
+    std::vector<Value> params(reader.get_u16());
+    for (auto &param : params) {
+        auto type = (ColType)reader.get_u8();
+        if (type == TYPE_INT) {
+            param.set_int(reader.get_i32());
+        } else if (type == TYPE_FLOAT) {
+            param.set_float(reader.get_f32());
+        } else if (type == TYPE_STRING) {
+            param.set_str(reader.get_str());
+        } else {
+            throw ProtocolError("unknown parameter type " + std::to_string(type));
         }
     }
+    if (!reader.good() || !reader.at_end()) {
+        throw ProtocolError("malformed EXECUTE message");
+    }
+    return params;
+}
 
-    // Clear
-    std::cout << "Terminating current client_connection..." << std::endl;
-    close(fd);           // close a file descriptor.
-    pthread_exit(NULL);  // terminate calling thread!
+/**
+ * @brief 请求出错时作废本次请求还未发送的结果, 返回ERROR; 一部分结果已经发给客户端时返回ABORTED
+ */
+void send_error(ResultWriter &writer, size_t sent_before, const std::string &msg) {
+    writer.discard();
+    char type = writer.bytes_sent() == sent_before ? protocol::MSG_ERROR : protocol::MSG_ABORTED;
+    writer.write(protocol::MessageBuilder(type).put_str(msg).build());
 }
 
-void start_server() {
-    int sockfd_server;
-    int sockfd;
-    int fd_temp;
-    struct sockaddr_in s_addr_in {};
-    struct sockaddr_in s_addr_client {};
-    int client_length;
-
-    sockfd_server = socket(AF_INET, SOCK_STREAM, 0);  // ipv4,TCP
-    assert(sockfd_server != -1);
-    int val = 1;
-    setsockopt(sockfd_server, SOL_SOCKET, SO_REUSEADDR, &val, sizeof(val));
-
-    // before bind(), set the attr of structure sockaddr.
-    memset(&s_addr_in, 0, sizeof(s_addr_in));
-    s_addr_in.sin_family = AF_INET;
-    s_addr_in.sin_addr.s_addr = htonl(INADDR_ANY);
-    s_addr_in.sin_port = htons(SOCK_PORT);
-    fd_temp = bind(sockfd_server, (struct sockaddr *)(&s_addr_in), sizeof(s_addr_in));
-    if (fd_temp == -1) {
-        std::cout << "Bind error!" << std::endl;
-        exit(1);
+/**
+ * @brief 执行二进制协议的一条消息, 每个请求的响应以READY结束
+ * @details select的结果以ROW_DESC/DATA_ROW/COMPLETE返回, 其他语句的文本输出以一条TEXT返回
+ * @return 返回false时关闭连接
+ */
+bool handle_binary_request(Connection *conn, const std::string &request) {
+    ResultWriter &writer = conn->writer();
+    if (conn->state_ == nullptr) {
+        conn->state_ = std::make_unique<Session>();
     }
-
-    fd_temp = listen(sockfd_server, MAX_CONN_LIMIT);
-    if (fd_temp == -1) {
-        std::cout << "Listen error!" << std::endl;
-        exit(1);
+    auto session = static_cast<Session *>(conn->state_.get());
+    if (request.empty()) {
+        return false;
     }
+    char type = request[0];
+    protocol::MessageReader reader(request.data() + 1, request.size() - 1);
 
-    if (recovery->GetRecoveryMode()) {
-        recovery->Redo();
-        recovery->Undo();
+    size_t sent_before = writer.bytes_sent();
+    std::string text;
+    ResultWriter text_writer(&text);
+    BinaryRowSink row_sink(&writer);
+    Context context(lock_manager.get(), log_manager.get(), nullptr, &text_writer);
+    context.row_sink_ = &row_sink;
+    context.version_store_ = version_store.get();
+    try {
+        if (type == protocol::MSG_QUERY || type == protocol::MSG_PREPARE) {
+            std::string sql = reader.get_str();
+            if (!reader.good()) {
+                throw ProtocolError("malformed message");
+            }
+            std::cout << "Read from client " << conn->fd() << ": " << sql << std::endl;
+            if (type == protocol::MSG_QUERY) {
+                if (!interp->interp_sql(sql, &conn->txn_id_, &context)) {
+                    throw ProtocolError("syntax error");
+                }
+            } else {
+                auto parse_tree = parse_sql(sql);
+                if (parse_tree == nullptr) {
+                    throw ProtocolError("syntax error");
+                }
+                auto stmt = interp->prepare(parse_tree);
+                uint32_t stmt_id = session->next_stmt_id++;
+                session->stmts[stmt_id] = stmt;
+                writer.write(protocol::MessageBuilder(protocol::MSG_PREPARED)
+                                 .put_u32(stmt_id)
+                                 .put_u16(stmt->num_params)
+                                 .build());
+            }
+        } else if (type == protocol::MSG_EXECUTE) {
+            uint32_t stmt_id = reader.get_u32();
+            auto params = read_params(reader);
+            auto it = session->stmts.find(stmt_id);
+            if (it == session->stmts.end()) {
+                throw StatementNotFoundError(stmt_id);
+            }
+            interp->execute(*it->second, params, &conn->txn_id_, &context);
+        } else if (type == protocol::MSG_CLOSE) {
+            uint32_t stmt_id = reader.get_u32();
+            if (!reader.good() || session->stmts.erase(stmt_id) == 0) {
+                throw StatementNotFoundError(stmt_id);
+            }
+        } else {
+            throw ProtocolError("unknown message type " + std::to_string((int)type));
+        }
+        if (!text.empty()) {
+            writer.write(protocol::MessageBuilder(protocol::MSG_TEXT).put_str(text).build());
+        }
+    } catch (TransactionAbortException &e) {
+        txn_manager->Abort(context.txn_, log_manager.get());
+        send_error(writer, sent_before, e.GetInfo());
+    } catch (RedBaseError &e) {
+        send_error(writer, sent_before, e.what());
     }
+    try {
+        writer.write(protocol::MessageBuilder(protocol::MSG_READY).build());
+        writer.flush();
+    } catch (UnixError &e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
 
+bool handle_request(Connection *conn, const std::string &request) {
+    return conn->is_binary() ? handle_binary_request(conn, request) : handle_text_request(conn, request);
+}
+
+void start_server() {
+    log_manager->SetLogMode(enable_logging);
     if (log_manager->GetLogMode()) {
+        recovery->Analyze();
+        if (recovery->GetRecoveryMode()) {
+            auto start = std::chrono::steady_clock::now();
+            recovery->Redo();
+            recovery->Undo();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << "Recovery: redid " << recovery->GetNumRedone() << " log record(s) in " << elapsed.count()
+                      << " s" << std::endl;
+        }
         log_manager->RunFlushThread();
+        checkpoint_manager->RunCheckpointThread();
     }
+    lock_manager->RunCycleDetection();
 
-    while (!should_exit) {
+    {
+        // 请求由大小为CPU核数的线程池执行
+        Server rucbase_server(SOCK_PORT, handle_request);
+        server = &rucbase_server;
         std::cout << "Waiting for new connection..." << std::endl;
-        pthread_t thread_id;
-        client_length = sizeof(s_addr_client);
-
-        if (setjmp(jmpbuf)) {
-            std::cout << "Break from Server Listen Loop\n";
-            break;
-        }
-
-        // Block here. Until server accepts a new connection.
-        sockfd = accept(sockfd_server, (struct sockaddr *)(&s_addr_client), (socklen_t *)(&client_length));
-        if (sockfd == -1) {
-            std::cout << "Accept error!" << std::endl;
-            continue;  // ignore current socket ,continue while loop.
-        }
-        std::cout << "A new connection occurs!" << std::endl;
-        if (pthread_create(&thread_id, nullptr, &client_handler, (void *)(&sockfd)) != 0) {
-            std::cout << "Create thread fail!" << std::endl;
-            break;  // break while loop
-        }
+        rucbase_server.run();
+        server = nullptr;
+        std::cout << "The Server receive Crtl+C, will been closed\n";
+        auto stats = interp->plan_cache_stats();
+        uint64_t lookups = stats.hits + stats.misses;
+        std::cout << " Plan cache: " << stats.hits << " hits / " << lookups << " lookups ("
+                  << (lookups == 0 ? 0 : stats.hits * 100 / lookups) << "%), " << stats.size << " entries, "
+                  << stats.saved_ns / 1000 << " us of planning saved\n";
+        auto escalation_stats = lock_manager->escalation_stats();
+        std::cout << " Lock manager: " << lock_manager->num_deadlocks() << " deadlocks, "
+                  << escalation_stats.escalations << " escalations ("
+                  << escalation_stats.failed_escalations << " skipped)\n";
+        auto group_commit_stats = log_manager->group_commit_stats();
+        std::cout << " Group commit: " << group_commit_stats.commits << " commits / " << group_commit_stats.syncs
+                  << " log fsyncs ("
+                  << (group_commit_stats.syncs == 0 ? 0.0 : (double)group_commit_stats.commits / group_commit_stats.syncs)
+                  << " commits per fsync)\n";
+        auto log_volume_stats = log_manager->log_volume_stats();
+        std::cout << " Log volume: " << log_volume_stats.record_bytes << " bytes of log records written as "
+                  << log_volume_stats.written_bytes << " bytes\n";
+        auto checkpoint_stats = checkpoint_manager->checkpoint_stats();
+        std::cout << " Checkpoint: " << checkpoint_stats.checkpoints << " checkpoints, "
+                  << checkpoint_stats.truncated_bytes << " bytes of log truncated\n";
+        auto eviction_stats = buffer_pool_manager->eviction_stats();
+        std::cout << " Buffer pool: " << eviction_stats.evictions << " dirty page evictions, "
+                  << eviction_stats.wal_stalls << " stalled on the log\n";
+        auto file_handle_stats = sm_manager->file_handle_stats();
+        auto index_handle_stats = sm_manager->index_handle_stats();
+        std::cout << " File handles: " << file_handle_stats.opens << " table / " << index_handle_stats.opens
+                  << " index file opens, " << file_handle_stats.evictions + index_handle_stats.evictions
+                  << " evicted (limit " << MAX_OPEN_FILES << " each)\n";
+        std::cout << " Statistics: " << sm_manager->auto_analyze_count()
+                  << " tables analyzed again after too many modifications\n";
+        // Clear: 析构时等待正在执行的请求结束, 并关闭所有连接
+        std::cout << " Try to close all client-connection.\n";
     }
 
-    // Clear
-    std::cout << " Try to close all client-connection.\n";
-    int ret = shutdown(sockfd_server, SHUT_WR);  // shut down the all or part of a full-duplex connection.
-    if(ret == -1) { printf("%s\n", strerror(errno)); }
-//    assert(ret != -1);
+    lock_manager->StopCycleDetection();
+    checkpoint_manager->StopCheckpointThread();
+    if (log_manager->GetLogMode()) {
+        // 页面写回磁盘之前, 修改它们的日志必须已经写入磁盘
+        log_manager->WakeUpFlushThread(nullptr);
+    }
     sm_manager->close_db();
+    if (log_manager->GetLogMode()) {
+        // 所有页面都已经写回磁盘, 下次启动时不需要重做; 没有写过日志时日志文件不存在, 也不需要检查点
+        if (log_manager->GetNextLsn() > 0) {
+            LogRecord checkpoint_log(INVALID_TXN_ID, INVALID_LSN, LogRecordType::CHECKPOINT);
+            log_manager->AppendLogRecord(&checkpoint_log);
+        }
+        log_manager->StopFlushThread();
+    }
     std::cout << " DB has been closed.\n";
     std::cout << "Server shuts down." << std::endl;
 }
@@ -1,12 +1,17 @@
 #include "buffer_pool_manager.h"
 #include <mutex>
 
+#include "recovery/log_manager.h"
+
 /**
  * @brief 从free_list或replacer中得到可淘汰帧页的 *frame_id
+ * replacer给出的候选页面中, 跳过修改的日志还没有写盘的脏页, 最多检查VICTIM_CANDIDATES个;
+ * 候选页面都不能写回时释放latch_等待日志写盘, 然后重新选择
  * @param frame_id 帧页id指针,返回成功找到的可替换帧id
+ * @param lock 持有的latch_
  * @return true: 可替换帧查找成功 , false: 可替换帧查找失败
  */
-bool BufferPoolManager::FindVictimPage(frame_id_t *frame_id) {
+bool BufferPoolManager::FindVictimPage(frame_id_t *frame_id, std::unique_lock<std::mutex> &lock) {
     // Todo:
     // 1 使用BufferPoolManager::free_list_判断缓冲池是否已满需要淘汰页面
     // 1.1 未满获得frame
@@ -16,9 +21,44 @@ bool BufferPoolManager::FindVictimPage(frame_id_t *frame_id) {
     	free_list_.erase(free_list_.begin());
     	return true;
     }
-    bool res=replacer_->Victim(frame_id);
-    return res;
-    return false;
+    while (true) {
+        std::vector<frame_id_t> skipped;
+        bool found = false;
+        while (skipped.size() < VICTIM_CANDIDATES && replacer_->Victim(frame_id)) {
+            if (IsLogDurable(&pages_[*frame_id])) {
+                found = true;
+                break;
+            }
+            skipped.push_back(*frame_id);
+        }
+        if (skipped.empty()) {
+            return found;
+        }
+        // 跳过的页面放回replacer, 请求日志刷新线程写盘, 之后再淘汰它们时不用等待
+        lsn_t max_lsn = INVALID_LSN;
+        for (frame_id_t skipped_frame_id : skipped) {
+            max_lsn = std::max(max_lsn, pages_[skipped_frame_id].GetPageLsn());
+            replacer_->Unpin(skipped_frame_id);
+        }
+        log_manager_->RequestFlush(max_lsn);
+        if (found) {
+            return true;
+        }
+        num_wal_stalls_++;
+        WaitForLog(lock, max_lsn);
+    }
+}
+
+bool BufferPoolManager::IsLogDurable(Page *page) {
+    // 上次写回之后没有写过日志的修改的页面没有rec_lsn, 比如索引页面; 页面被修改时可能还没有置脏, 不检查is_dirty_
+    return log_manager_ == nullptr || page->GetRecLsn() == INVALID_LSN || !log_manager_->GetLogMode() ||
+           page->GetPageLsn() <= log_manager_->GetPersistentLsn();
+}
+
+void BufferPoolManager::WaitForLog(std::unique_lock<std::mutex> &lock, lsn_t lsn) {
+    lock.unlock();
+    log_manager_->WaitForFlush(lsn);
+    lock.lock();
 }
 
 /**
@@ -37,8 +77,10 @@ void BufferPoolManager::UpdatePage(Page *page, PageId new_page_id, frame_id_t ne
     if(page->is_dirty_){
     	disk_manager_->write_page(old_id.fd, old_id.page_no,page->GetData(),PAGE_SIZE);
     	page->is_dirty_=false;
+        num_evictions_++;
     }
     page->ResetMemory();
+    page->rec_lsn_=INVALID_LSN;
     if(page_table_.find(old_id)!=page_table_.end())page_table_.erase(old_id);
     page->id_=new_page_id;
     page_table_[new_page_id]=new_frame_id;
@@ -61,7 +103,7 @@ Page *BufferPoolManager::FetchPage(PageId page_id) {
     // 2.     If R is dirty, write it back to the disk.
     // 3.     Delete R from the page table and insert P.
     // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
-    std::scoped_lock lock{latch_}; 
+    std::unique_lock<std::mutex> lock{latch_};
     if(page_table_.find(page_id)!=page_table_.end()){
     	auto target_frame_id=page_table_[page_id];
     	replacer_->Pin(target_frame_id);
@@ -69,7 +111,15 @@ Page *BufferPoolManager::FetchPage(PageId page_id) {
     	return &pages_[target_frame_id];
     }
     frame_id_t frame_id;
-    if(FindVictimPage(&frame_id)){
+    if(FindVictimPage(&frame_id, lock)){
+        // 等待日志时释放过latch_, 其他线程可能已经读入了这个页面
+        auto it = page_table_.find(page_id);
+        if (it != page_table_.end()) {
+            replacer_->Unpin(frame_id);
+            replacer_->Pin(it->second);
+            pages_[it->second].pin_count_++;
+            return &pages_[it->second];
+        }
     	auto page=&pages_[frame_id];
         UpdatePage(page,page_id,frame_id);
         disk_manager_->read_page(page->GetPageId().fd,page->GetPageId().page_no,page->GetData(),PAGE_SIZE);
@@ -80,6 +130,17 @@ Page *BufferPoolManager::FetchPage(PageId page_id) {
     return nullptr;
 }
 
+Page *BufferPoolManager::PinPage(PageId page_id) {
+    std::scoped_lock lock{latch_};
+    auto it = page_table_.find(page_id);
+    if (it == page_table_.end()) {
+        return nullptr;
+    }
+    replacer_->Pin(it->second);
+    pages_[it->second].pin_count_++;
+    return &pages_[it->second];
+}
+
 /**
  * Unpin the target page from the buffer pool. 取消固定pin_count>0的在缓冲池中的page
  * @param page_id id of page to be unpinned
@@ -120,13 +181,23 @@ bool BufferPoolManager::FlushPage(PageId page_id) {
     // 2. 存在时如何写回磁盘
     // 3. 写回后页面的脏位
     // Make sure you call DiskManager::WritePage!
-    std::scoped_lock lock{latch_}; 
+    std::unique_lock<std::mutex> lock{latch_};
     auto p=page_table_.find(page_id);
     if(p==page_table_.end())return false;
     auto frame_id=(*p).second;
     Page* page=&pages_[frame_id];
+    while (!IsLogDurable(page)) {
+        // 等待时页面可能被淘汰, 淘汰时已经写回磁盘
+        WaitForLog(lock, page->GetPageLsn());
+        p = page_table_.find(page_id);
+        if (p == page_table_.end()) {
+            return true;
+        }
+        page = &pages_[p->second];
+    }
     disk_manager_->write_page(page_id.fd, page_id.page_no,page->GetData(),PAGE_SIZE);
     page->is_dirty_=false;
+    page->rec_lsn_=INVALID_LSN;
     return true;
     return true;
 }
@@ -144,9 +215,9 @@ Page *BufferPoolManager::NewPage(PageId *page_id) {
     // 3.   Pick a victim page P from either the free list or the replacer. Always pick from the free list first.
     // 4.   Update P's metadata, zero out memory and add P to the page table. pin_count set to 1.
     // 5.   Set the page ID output parameter. Return a pointer to P.
-    std::scoped_lock lock{latch_}; 
+    std::unique_lock<std::mutex> lock{latch_};
     frame_id_t frame_id;
-    bool res=FindVictimPage(&frame_id);
+    bool res=FindVictimPage(&frame_id, lock);
     if(!res)return nullptr;
     Page *page=&pages_[frame_id];
     page_id->page_no=disk_manager_->AllocatePage(page_id->fd);
@@ -171,14 +242,22 @@ bool BufferPoolManager::DeletePage(PageId page_id) {
     // 2.2  If P exists, but has a non-zero pin-count, return false. Someone is using the page.
     // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free
     // list.
-    std::scoped_lock lock{latch_}; 
+    std::unique_lock<std::mutex> lock{latch_};
     auto p=page_table_.find(page_id);
     if(p==page_table_.end())return true;
+    while (!IsLogDurable(&pages_[p->second])) {
+        WaitForLog(lock, pages_[p->second].GetPageLsn());
+        p = page_table_.find(page_id);
+        if (p == page_table_.end()) {
+            return true;
+        }
+    }
     auto frame_id=(*p).second;
     Page* page=&pages_[frame_id];
     if(page->pin_count_)return false;
     disk_manager_->write_page(page_id.fd, page_id.page_no,page->GetData(),PAGE_SIZE);
     page->ResetMemory();
+    page->rec_lsn_=INVALID_LSN;
     page_table_.erase(page_id);
     free_list_.emplace_back(frame_id);
     return true;
@@ -191,12 +270,98 @@ bool BufferPoolManager::DeletePage(PageId page_id) {
  */
 void BufferPoolManager::FlushAllPages(int fd) {
     // example for disk write
+    std::unique_lock<std::mutex> lock{latch_};
+    // 先等待这些页面的修改的日志都写入磁盘
+    WaitForFileLog(fd, lock);
+    for (frame_id_t frame_id : GetFileFrames(fd)) {
+        Page *page = &pages_[frame_id];
+        disk_manager_->write_page(page->GetPageId().fd, page->GetPageId().page_no, page->GetData(), PAGE_SIZE);
+        page->is_dirty_ = false;
+        page->rec_lsn_ = INVALID_LSN;
+    }
+}
+
+void BufferPoolManager::DiscardAllPages(int fd) {
+    std::unique_lock<std::mutex> lock{latch_};
+    // 等待日志时会释放latch_, 两个条件要在持有latch_时同时满足
+    while (true) {
+        file_unpinned_cv_.wait(lock, [&] { return pinned_files_.count(fd) == 0; });
+        WaitForFileLog(fd, lock);
+        if (pinned_files_.count(fd) == 0) {
+            break;
+        }
+    }
+    for (frame_id_t frame_id : GetFileFrames(fd)) {
+        Page *page = &pages_[frame_id];
+        disk_manager_->write_page(page->GetPageId().fd, page->GetPageId().page_no, page->GetData(), PAGE_SIZE);
+        replacer_->Pin(frame_id);
+        page_table_.erase(page->GetPageId());
+        page->id_.page_no = INVALID_PAGE_ID;
+        page->is_dirty_ = false;
+        page->rec_lsn_ = INVALID_LSN;
+        // 仍被固定的页面(没有unpin的页面)只移出页表, 之后的UnpinPage找不到它, 这个帧不再使用
+        if (page->pin_count_ == 0) {
+            page->ResetMemory();
+            free_list_.emplace_back(frame_id);
+        }
+    }
+}
+
+void BufferPoolManager::PinFile(int fd) {
+    std::scoped_lock lock{latch_};
+    pinned_files_[fd]++;
+}
+
+void BufferPoolManager::UnpinFile(int fd) {
+    {
+        std::scoped_lock lock{latch_};
+        auto it = pinned_files_.find(fd);
+        if (--it->second == 0) {
+            pinned_files_.erase(it);
+        }
+    }
+    file_unpinned_cv_.notify_all();
+}
+
+std::vector<frame_id_t> BufferPoolManager::GetFileFrames(int fd) {
+    // 遍历页表而不是所有的帧, 不用访问不属于这个文件的页面
+    std::vector<frame_id_t> frames;
+    for (auto &entry : page_table_) {
+        if (entry.first.fd == fd) {
+            frames.push_back(entry.second);
+        }
+    }
+    return frames;
+}
+
+void BufferPoolManager::WaitForFileLog(int fd, std::unique_lock<std::mutex> &lock) {
+    while (true) {
+        lsn_t max_lsn = INVALID_LSN;
+        for (frame_id_t frame_id : GetFileFrames(fd)) {
+            if (!IsLogDurable(&pages_[frame_id])) {
+                max_lsn = std::max(max_lsn, pages_[frame_id].GetPageLsn());
+            }
+        }
+        if (max_lsn == INVALID_LSN) {
+            return;
+        }
+        WaitForLog(lock, max_lsn);
+    }
+}
+
+std::vector<std::pair<PageId, lsn_t>> BufferPoolManager::GetDirtyPages() {
     std::scoped_lock lock{latch_};
-    for (size_t i = 0; i < pool_size_; i++) {
-        Page *page = &pages_[i];
-        if (page->GetPageId().fd == fd && page->GetPageId().page_no != INVALID_PAGE_ID) {
-            disk_manager_->write_page(page->GetPageId().fd, page->GetPageId().page_no, page->GetData(), PAGE_SIZE);
-            page->is_dirty_ = false;
+    std::vector<std::pair<PageId, lsn_t>> dirty_pages;
+    for (auto &entry : page_table_) {
+        lsn_t rec_lsn = pages_[entry.second].GetRecLsn();
+        if (rec_lsn != INVALID_LSN) {
+            dirty_pages.emplace_back(entry.first, rec_lsn);
         }
     }
-}
\ No newline at end of file
+    return dirty_pages;
+}
+
+BufferPoolManager::EvictionStats BufferPoolManager::eviction_stats() {
+    std::scoped_lock lock{latch_};
+    return {num_evictions_, num_wal_stalls_};
+}
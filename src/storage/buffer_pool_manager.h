@@ -27,6 +27,7 @@
 #include <unistd.h>
 
 #include <cassert>
+#include <condition_variable>
 #include <list>
 #include <unordered_map>
 #include <vector>
@@ -39,6 +40,14 @@
 #include "replacer/lru_replacer.h"
 #include "replacer/replacer.h"
 
+class LogManager;
+
+/**
+ * @brief 缓冲池
+ * @details 有log_manager_时写回脏页遵守WAL: 页面的page_lsn之前的日志必须已经写入磁盘.
+ * 淘汰页面时优先选择日志已经写盘的页面, 跳过的页面放回replacer, 并请求日志刷新线程异步写盘;
+ * 只有所有候选页面的日志都没有写盘时才释放latch_等待日志写盘
+ */
 class BufferPoolManager {
    private:
     /**
@@ -68,12 +77,23 @@ class BufferPoolManager {
      */
     Replacer *replacer_;
 
+    /** 为空时写回页面不检查日志 */
+    LogManager *log_manager_;
+
     /** This latch protects shared data structures */
     std::mutex latch_;
 
+    std::unordered_map<int, int> pinned_files_;  // fd -> PinFile的次数, 由latch_保护
+    std::condition_variable file_unpinned_cv_;   // 文件的PinFile全部解除时通知DiscardAllPages
+
+    uint64_t num_evictions_ = 0;   // 淘汰的脏页个数, 由latch_保护
+    uint64_t num_wal_stalls_ = 0;  // 淘汰脏页时等待日志写盘的次数, 由latch_保护
+
+    static constexpr size_t VICTIM_CANDIDATES = 16;  // 淘汰页面时最多检查的候选页面个数
+
    public:
-    BufferPoolManager(size_t pool_size, DiskManager *disk_manager)
-        : pool_size_(pool_size), disk_manager_(disk_manager) {
+    BufferPoolManager(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr)
+        : pool_size_(pool_size), disk_manager_(disk_manager), log_manager_(log_manager) {
         // We allocate a consecutive memory space for the buffer pool.
         pages_ = new Page[pool_size_];
         // can be changed to ClockReplacer
@@ -108,6 +128,12 @@ class BufferPoolManager {
      */
     Page *FetchPage(PageId page_id);
 
+    /**
+     * @brief 固定已经在缓冲池中的页面, 不从磁盘读取
+     * @return 页面不在缓冲池中时返回nullptr
+     */
+    Page *PinPage(PageId page_id);
+
     /**
      * Unpin the target page from the buffer pool.
      * @param page_id id of page to be unpinned
@@ -142,8 +168,48 @@ class BufferPoolManager {
      */
     void FlushAllPages(int fd);
 
+    /**
+     * @brief 把fd的所有页面写回磁盘并移出缓冲池, 关闭文件之前调用
+     * @details 关闭之后fd可能分配给其他文件, 缓冲池中不能留下旧文件的以fd为PageId的页面.
+     * 调用者保证没有其他线程在使用这个文件, 但检查点可能正在写回它的页面: 等待文件上的PinFile都解除之后再移出页面.
+     * 仍被固定的页面(没有unpin的页面)移出页表后不再使用
+     */
+    void DiscardAllPages(int fd);
+
+    /**
+     * @brief 固定fd对应的文件, UnpinFile之前DiscardAllPages(fd)等待, 所以fd不会被关闭并分配给其他文件
+     * @details 检查点按脏页表中的PageId写回页面时使用, 保证PinPage和UnpinPage作用在同一个文件的同一个页面上
+     */
+    void PinFile(int fd);
+
+    void UnpinFile(int fd);
+
+    /**
+     * @brief 检查点用的脏页表, 即缓冲池中所有rec_lsn有效的页面和它们的rec_lsn
+     */
+    std::vector<std::pair<PageId, lsn_t>> GetDirtyPages();
+
+    struct EvictionStats {
+        uint64_t evictions;   // 写回磁盘的被淘汰的脏页个数
+        uint64_t wal_stalls;  // 候选页面的日志都没有写盘, 淘汰时等待日志的次数
+    };
+
+    EvictionStats eviction_stats();
+
    private:
-    bool FindVictimPage(frame_id_t *frame_id);
+    bool FindVictimPage(frame_id_t *frame_id, std::unique_lock<std::mutex> &lock);
+
+    // 页面的修改的日志是否已经写入磁盘, 可以写回页面
+    bool IsLogDurable(Page *page);
+
+    // 等待lsn及之前的日志写入磁盘, 等待时释放latch_, 调用者需要重新检查页面
+    void WaitForLog(std::unique_lock<std::mutex> &lock, lsn_t lsn);
 
     void UpdatePage(Page *page, PageId new_page_id, frame_id_t new_frame_id);
+
+    // 缓冲池中属于fd的页面所在的帧, 调用者持有latch_
+    std::vector<frame_id_t> GetFileFrames(int fd);
+
+    // 等待缓冲池中属于fd的页面的修改的日志都写入磁盘, 等待时释放latch_
+    void WaitForFileLog(int fd, std::unique_lock<std::mutex> &lock);
 };
\ No newline at end of file
@@ -24,6 +24,7 @@
 
 #include "buffer_pool_manager.h"
 
+#include <atomic>
 #include <cassert>
 #include <cstring>
 #include <ctime>
@@ -33,6 +34,7 @@
 #include <vector>
 
 #include "gtest/gtest.h"
+#include "recovery/log_manager.h"
 
 constexpr int MAX_FILES = 32;
 constexpr int MAX_PAGES = 128;
@@ -451,3 +453,103 @@ TEST_F(BufferPoolManagerTest, ConcurrencyTest) {
 
     disk_manager_->close_file(fd);
 }
+
+/**
+ * @brief 淘汰页面遵守WAL: 优先淘汰日志已经写盘的页面, 所有候选页面的日志都没有写盘时等待日志写盘
+ */
+TEST_F(BufferPoolManagerTest, WalAwareEviction) {
+    const std::string filename = "WalAwareEvictionTestFile";
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    LogManager log_manager(disk_manager_.get());
+    log_manager.SetLogMode(true);
+    auto bpm = std::make_unique<BufferPoolManager>(2, disk_manager_.get(), &log_manager);
+
+    // 模拟写日志修改页面, 日志只在log_buffer_中
+    auto modify = [&](Page *page) {
+        LogRecord log_record(0, INVALID_LSN, LogRecordType::BEGIN);
+        page->SetRecLsn(log_manager.GetNextLsn());
+        lsn_t lsn = log_manager.AppendLogRecord(&log_record);
+        page->SetPageLsn(lsn);
+        return lsn;
+    };
+
+    PageId logged_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    Page *logged_page = bpm->NewPage(&logged_id);
+    lsn_t lsn = modify(logged_page);
+    ASSERT_TRUE(bpm->UnpinPage(logged_id, true));
+    PageId plain_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    ASSERT_NE(bpm->NewPage(&plain_id), nullptr);
+    ASSERT_TRUE(bpm->UnpinPage(plain_id, true));
+
+    // logged_page最久没有被访问, 但是日志没有写盘, 淘汰plain_id
+    PageId new_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    ASSERT_NE(bpm->NewPage(&new_id), nullptr);
+    EXPECT_EQ(bpm->FetchPage(logged_id), logged_page);
+    EXPECT_EQ(log_manager.GetPersistentLsn(), INVALID_LSN);
+    auto stats = bpm->eviction_stats();
+    EXPECT_EQ(stats.evictions, 1);
+    EXPECT_EQ(stats.wal_stalls, 0);
+
+    // 只剩logged_page可以淘汰, 等待它的日志写盘后再写回
+    ASSERT_TRUE(bpm->UnpinPage(logged_id, false));
+    PageId last_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    ASSERT_NE(bpm->NewPage(&last_id), nullptr);
+    EXPECT_GE(log_manager.GetPersistentLsn(), lsn);
+    stats = bpm->eviction_stats();
+    EXPECT_EQ(stats.evictions, 2);
+    EXPECT_EQ(stats.wal_stalls, 1);
+
+    ASSERT_TRUE(bpm->UnpinPage(new_id, false));
+    ASSERT_TRUE(bpm->UnpinPage(last_id, false));
+    bpm.reset();
+    disk_manager_->close_file(fd);
+}
+
+/**
+ * @brief 检查点用PinFile固定文件时, 关闭文件之前的DiscardAllPages等待UnpinFile, 之后页面被移出缓冲池
+ */
+TEST_F(BufferPoolManagerTest, DiscardWaitsForPinnedFile) {
+    const std::string filename = "DiscardWaitsForPinnedFileTestFile";
+    disk_manager_->create_file(filename);
+    int fd = disk_manager_->open_file(filename);
+    auto bpm = std::make_unique<BufferPoolManager>(2, disk_manager_.get());
+
+    PageId page_id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(page, nullptr);
+    snprintf(page->GetData(), PAGE_SIZE, "checkpoint");
+    ASSERT_TRUE(bpm->UnpinPage(page_id, true));
+
+    // 模拟检查点正在写回这个页面
+    bpm->PinFile(fd);
+    ASSERT_EQ(bpm->PinPage(page_id), page);
+    std::atomic<bool> discarded{false};
+    std::thread closer([&] {
+        bpm->DiscardAllPages(fd);
+        discarded = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_FALSE(discarded);
+    EXPECT_TRUE(bpm->FlushPage(page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+    bpm->UnpinFile(fd);
+    closer.join();
+    EXPECT_TRUE(discarded);
+
+    // 页面已经写回并移出缓冲池, 帧可以重新使用
+    EXPECT_EQ(bpm->PinPage(page_id), nullptr);
+    char buf[PAGE_SIZE];
+    disk_manager_->read_page(fd, page_id.page_no, buf, PAGE_SIZE);
+    EXPECT_STREQ(buf, "checkpoint");
+    PageId ids[2];
+    for (auto &id : ids) {
+        id = {.fd = fd, .page_no = INVALID_PAGE_ID};
+        EXPECT_NE(bpm->NewPage(&id), nullptr);
+    }
+    for (auto &id : ids) {
+        EXPECT_TRUE(bpm->UnpinPage(id, false));
+    }
+    bpm.reset();
+    disk_manager_->close_file(fd);
+}
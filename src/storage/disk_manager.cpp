@@ -1,14 +1,27 @@
 #include "storage/disk_manager.h"
 
 #include <assert.h>    // for assert
+#include <dirent.h>    // for opendir
+#include <fcntl.h>     // for fallocate
 #include <string.h>    // for memset
 #include <sys/stat.h>  // for stat
 #include <unistd.h>    // for lseek
 
+#include <algorithm>
+#include <cctype>
+#include <cstdio>  // for rename
+#include <vector>
+
 #include "defs.h"
 
 DiskManager::DiskManager() { memset(fd2pageno_, 0, MAX_FD * (sizeof(std::atomic<page_id_t>) / sizeof(char)));}
 
+DiskManager::~DiskManager() {
+    for (auto &entry : log_segments_) {
+        close(entry.second);
+    }
+}
+
 /**
  * @brief Write the contents of the specified page into disk file
  *
@@ -106,9 +119,11 @@ void DiskManager::destroy_file(const std::string &path) {
     if (!is_file(path)) {
             throw FileNotFoundError(path);
     }
+    std::unique_lock<std::mutex> lock(files_latch_);
     if (path2fd_.find(path)!=path2fd_.end()) {
             throw FileNotClosedError(path);
     }
+    lock.unlock();
     int fd=open(path.c_str(),O_RDWR);
     unlink(path.c_str());
 }
@@ -123,6 +138,7 @@ int DiskManager::open_file(const std::string &path) {
     if(!is_file(path))throw FileNotFoundError(path);
     int fd=open(path.c_str(),O_RDWR);
     if(fd<0)return -1;
+    std::lock_guard<std::mutex> lock(files_latch_);
     path2fd_[path]=fd;
     fd2path_[fd]=path;
     return fd;
@@ -135,6 +151,7 @@ void DiskManager::close_file(int fd) {
     // Todo:
     // 调用close()函数
     // 注意不能关闭未打开的文件，并且需要更新文件打开列表
+    std::lock_guard<std::mutex> lock(files_latch_);
     if(fd2path_.find(fd)==fd2path_.end())throw FileNotOpenError(fd);
     close(fd);
     std::string path=fd2path_[fd];
@@ -149,6 +166,7 @@ int DiskManager::GetFileSize(const std::string &file_name) {
 }
 
 std::string DiskManager::GetFileName(int fd) {
+    std::lock_guard<std::mutex> lock(files_latch_);
     if (!fd2path_.count(fd)) {
         throw FileNotOpenError(fd);
     }
@@ -156,41 +174,263 @@ std::string DiskManager::GetFileName(int fd) {
 }
 
 int DiskManager::GetFileFd(const std::string &file_name) {
-    if (!path2fd_.count(file_name)) {
-        return open_file(file_name);
+    {
+        std::lock_guard<std::mutex> lock(files_latch_);
+        auto it = path2fd_.find(file_name);
+        if (it != path2fd_.end()) {
+            return it->second;
+        }
     }
-    return path2fd_[file_name];
+    return open_file(file_name);
 }
 
-bool DiskManager::ReadLog(char *log_data, int size, int offset, int prev_log_end) {
-    // read log file from the previous end
-    if (log_fd_ == -1) {
-        log_fd_ = open_file(LOG_FILE_NAME);
-    }
-    offset += prev_log_end;
-    int file_size = GetFileSize(LOG_FILE_NAME);
-    if (offset >= file_size) {
-        return false;
+std::string DiskManager::GetLogSegmentName(int64_t segment_no) {
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%08lld", static_cast<long long>(segment_no));
+    return LOG_FILE_NAME + suffix;
+}
+
+// 同步当前目录, 保证创建, 重命名和删除段文件已经写入磁盘
+static void sync_dir() {
+    int dir_fd = open(".", O_RDONLY);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
     }
+}
 
-    size = std::min(size, file_size - offset);
-    lseek(log_fd_, offset, SEEK_SET);
-    ssize_t bytes_read = read(log_fd_, log_data, size);
-    if (bytes_read != size) {
+void DiskManager::OpenLog() {
+    if (log_opened_) {
+        return;
+    }
+    log_opened_ = true;
+    DIR *dir = opendir(".");
+    if (dir == nullptr) {
         throw UnixError();
     }
-    return true;
+    std::string prefix = LOG_FILE_NAME + ".";
+    std::vector<std::string> names;
+    while (struct dirent *entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() == prefix.size() + 8 && name.compare(0, prefix.size(), prefix) == 0 &&
+            std::all_of(name.begin() + prefix.size(), name.end(), ::isdigit)) {
+            names.push_back(name);
+        }
+    }
+    closedir(dir);
+
+    for (auto &name : names) {
+        int64_t segment_no = std::stoll(name.substr(prefix.size()));
+        int fd = open(name.c_str(), O_RDWR);
+        LogSegmentHeader header;
+        if (fd < 0 || pread(fd, &header, sizeof(header), 0) != sizeof(header) || header.magic != LOG_SEGMENT_MAGIC ||
+            header.segment_no != segment_no || header.segment_size <= LOG_SEGMENT_HEADER_SIZE) {
+            // 回收时没有改写完段头的段, 其中没有需要的日志
+            if (fd >= 0) {
+                close(fd);
+            }
+            unlink(name.c_str());
+            continue;
+        }
+        log_segment_size_ = header.segment_size;
+        log_segments_[segment_no] = fd;
+        if (log_segments_.begin()->first == segment_no) {
+            log_begin_ = std::max(segment_no * GetLogSegmentDataSize(), header.log_begin);
+        }
+    }
+    // 日志的末尾由故障恢复读出所有日志后通过SetLogEnd设置
+    log_end_ = log_begin_;
+    log_synced_ = log_begin_;
 }
 
-void DiskManager::WriteLog(char *log_data, int size) {
-    if (log_fd_ == -1) {
-        log_fd_ = open_file(LOG_FILE_NAME);
+void DiskManager::WriteLogSegmentHeader(int fd, int64_t segment_no, int64_t log_begin) {
+    char buf[LOG_SEGMENT_HEADER_SIZE] = {0};
+    LogSegmentHeader header{LOG_SEGMENT_MAGIC, 0, segment_no, log_segment_size_, log_begin};
+    memcpy(buf, &header, sizeof(header));
+    if (pwrite(fd, buf, sizeof(buf), 0) != sizeof(buf) || fdatasync(fd) < 0) {
+        throw UnixError();
     }
+}
 
-    // write from the file_end
-    lseek(log_fd_, 0, SEEK_END);
-    ssize_t bytes_write = write(log_fd_, log_data, size);
-    if (bytes_write != size) {
+int DiskManager::GetLogSegment(int64_t segment_no, bool create) {
+    auto it = log_segments_.find(segment_no);
+    if (it != log_segments_.end()) {
+        return it->second;
+    }
+    if (!create) {
+        return -1;
+    }
+    std::string name = GetLogSegmentName(segment_no);
+    int fd = open(name.c_str(), O_CREAT | O_RDWR, 0777);
+    if (fd < 0) {
         throw UnixError();
     }
+    // 一次分配整个段的空间, 追加日志时不会因为文件变长而更新元数据
+    if (fallocate(fd, 0, 0, log_segment_size_) < 0 && ftruncate(fd, log_segment_size_) < 0) {
+        close(fd);
+        throw UnixError();
+    }
+    WriteLogSegmentHeader(fd, segment_no, 0);
+    sync_dir();
+    log_segments_[segment_no] = fd;
+    return fd;
+}
+
+int64_t DiskManager::ReadLog(char *log_data, int64_t size, int64_t offset) {
+    std::lock_guard<std::mutex> lock(log_latch_);
+    OpenLog();
+    int64_t data_size = GetLogSegmentDataSize();
+    int64_t bytes_read = 0;
+    while (bytes_read < size) {
+        int64_t segment_no = (offset + bytes_read) / data_size;
+        int64_t pos = (offset + bytes_read) % data_size;
+        int fd = GetLogSegment(segment_no, false);
+        if (fd < 0) {
+            break;
+        }
+        int64_t len = std::min(size - bytes_read, data_size - pos);
+        ssize_t ret = pread(fd, log_data + bytes_read, len, LOG_SEGMENT_HEADER_SIZE + pos);
+        if (ret < 0) {
+            throw UnixError();
+        }
+        bytes_read += ret;
+        if (ret < len) {
+            break;
+        }
+    }
+    return bytes_read;
+}
+
+void DiskManager::WriteLog(const char *log_data, int64_t size) {
+    std::lock_guard<std::mutex> lock(log_latch_);
+    OpenLog();
+    int64_t data_size = GetLogSegmentDataSize();
+    int64_t bytes_written = 0;
+    while (bytes_written < size) {
+        int64_t segment_no = log_end_ / data_size;
+        int64_t pos = log_end_ % data_size;
+        int fd = GetLogSegment(segment_no, true);
+        int64_t len = std::min(size - bytes_written, data_size - pos);
+        if (pwrite(fd, log_data + bytes_written, len, LOG_SEGMENT_HEADER_SIZE + pos) != len) {
+            throw UnixError();
+        }
+        bytes_written += len;
+        log_end_ += len;
+    }
+}
+
+void DiskManager::SyncLog() {
+    std::lock_guard<std::mutex> lock(log_latch_);
+    if (log_synced_ >= log_end_) {
+        return;
+    }
+    // 只同步上次同步之后写过的段
+    int64_t data_size = GetLogSegmentDataSize();
+    for (int64_t segment_no = log_synced_ / data_size; segment_no <= (log_end_ - 1) / data_size; segment_no++) {
+        int fd = GetLogSegment(segment_no, false);
+        if (fd >= 0 && fdatasync(fd) < 0) {
+            throw UnixError();
+        }
+    }
+    log_synced_ = log_end_;
+}
+
+void DiskManager::SetLogEnd(int64_t offset) {
+    std::lock_guard<std::mutex> lock(log_latch_);
+    OpenLog();
+    int64_t data_size = GetLogSegmentDataSize();
+    int64_t end_segment = offset / data_size;
+    int fd = GetLogSegment(end_segment, false);
+    if (fd >= 0) {
+        off_t pos = LOG_SEGMENT_HEADER_SIZE + offset % data_size;
+        off_t len = log_segment_size_ - pos;
+        if (fallocate(fd, FALLOC_FL_ZERO_RANGE, pos, len) < 0) {
+            std::vector<char> zeros(std::min<off_t>(len, 1 << 20), 0);
+            for (off_t done = 0; done < len; done += zeros.size()) {
+                size_t n = std::min<off_t>(len - done, zeros.size());
+                if (pwrite(fd, zeros.data(), n, pos + done) != static_cast<ssize_t>(n)) {
+                    throw UnixError();
+                }
+            }
+        }
+        if (fdatasync(fd) < 0) {
+            throw UnixError();
+        }
+    }
+    for (auto it = log_segments_.upper_bound(end_segment); it != log_segments_.end();) {
+        close(it->second);
+        unlink(GetLogSegmentName(it->first).c_str());
+        it = log_segments_.erase(it);
+    }
+    sync_dir();
+    log_end_ = offset;
+    log_synced_ = offset;
+}
+
+int64_t DiskManager::GetLogBegin() {
+    std::lock_guard<std::mutex> lock(log_latch_);
+    OpenLog();
+    return log_begin_;
+}
+
+int64_t DiskManager::GetLogEnd() {
+    std::lock_guard<std::mutex> lock(log_latch_);
+    OpenLog();
+    return log_end_;
+}
+
+void DiskManager::RecycleLog(int64_t offset) {
+    std::lock_guard<std::mutex> lock(log_latch_);
+    OpenLog();
+    if (offset <= log_begin_ || offset > log_end_) {
+        return;
+    }
+    int64_t data_size = GetLogSegmentDataSize();
+    int64_t begin_segment = offset / data_size;
+    // 先记下新的开头, 之后故障时即使前面的段还没有回收也只是多读一些日志
+    int fd = GetLogSegment(begin_segment, false);
+    if (fd >= 0) {
+        WriteLogSegmentHeader(fd, begin_segment, offset);
+    }
+    log_begin_ = offset;
+
+    int64_t end_segment = std::max(log_end_ - 1, int64_t(0)) / data_size;
+    while (!log_segments_.empty() && log_segments_.begin()->first < begin_segment) {
+        auto [segment_no, segment_fd] = *log_segments_.begin();
+        log_segments_.erase(log_segments_.begin());
+        int64_t last_segment = log_segments_.empty() ? end_segment : log_segments_.rbegin()->first;
+        if (static_cast<size_t>(last_segment - end_segment) >= LOG_SEGMENT_SPARES) {
+            close(segment_fd);
+            unlink(GetLogSegmentName(segment_no).c_str());
+            continue;
+        }
+        // 先重命名再改写段头, 两步之间故障时段头和文件名不一致, 打开日志时删除
+        int64_t new_segment_no = std::max(last_segment, end_segment) + 1;
+        if (rename(GetLogSegmentName(segment_no).c_str(), GetLogSegmentName(new_segment_no).c_str()) < 0) {
+            throw UnixError();
+        }
+        WriteLogSegmentHeader(segment_fd, new_segment_no, 0);
+        log_segments_[new_segment_no] = segment_fd;
+    }
+    sync_dir();
+}
+
+void DiskManager::SetLogSegmentSize(int64_t size) {
+    std::lock_guard<std::mutex> lock(log_latch_);
+    OpenLog();
+    assert(size > LOG_SEGMENT_HEADER_SIZE);
+    if (log_segments_.empty()) {
+        log_segment_size_ = size;
+    }
+}
+
+void DiskManager::DestroyLog() {
+    std::lock_guard<std::mutex> lock(log_latch_);
+    OpenLog();
+    for (auto &[segment_no, fd] : log_segments_) {
+        close(fd);
+        unlink(GetLogSegmentName(segment_no).c_str());
+    }
+    log_segments_.clear();
+    log_begin_ = log_end_ = log_synced_ = 0;
 }
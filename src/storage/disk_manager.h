@@ -19,6 +19,8 @@
 #include <atomic>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
@@ -34,7 +36,7 @@ class DiskManager {
    public:
     explicit DiskManager();
 
-    ~DiskManager() = default;
+    ~DiskManager();
 
     /**
      * @brief 将buffer中的页面数据写回diskFile中
@@ -88,13 +90,51 @@ class DiskManager {
     int GetFileFd(const std::string &file_name);
 
     // LOG操作
-    bool ReadLog(char *log_data, int size, int offset, int prev_log_end);
+    // 日志是一个逻辑上连续的字节流, 按固定长度存放在段文件LOG_FILE_NAME.00000000, LOG_FILE_NAME.00000001, ...中.
+    // 每个段文件开头是LOG_SEGMENT_HEADER_SIZE字节的段头, 之后是日志数据; 日志偏移量offset位于第
+    // offset / 段中数据的长度 个段中. 第一次读写日志时打开当前目录下已有的段文件
 
-    void WriteLog(char *log_data, int size);
+    /**
+     * @brief 从日志偏移量offset开始读取最多size个字节
+     * @return 读到的字节数, 遇到不存在的段时提前结束; 读到的内容不一定都是有效的日志
+     */
+    int64_t ReadLog(char *log_data, int64_t size, int64_t offset);
+
+    /**
+     * @brief 把日志追加到日志末尾, 用pwrite顺序写入预先分配好的段文件, 需要时创建新的段
+     * 同一时间只有一个线程追加日志
+     */
+    void WriteLog(const char *log_data, int64_t size);
+
+    // 把上次同步之后写入的日志同步到磁盘
+    void SyncLog();
+
+    /**
+     * @brief 故障恢复时设置日志末尾, 之后的日志从offset开始写
+     * 末尾所在的段中offset之后的内容清零, 之后的段删除, 故障前没有写完的日志不会被当作新的日志读出
+     */
+    void SetLogEnd(int64_t offset);
+
+    // 最早的还需要保留的日志的偏移量, 一定是某条日志的开头
+    int64_t GetLogBegin();
+
+    // 已经写入的日志的末尾
+    int64_t GetLogEnd();
 
-    void SetLogFd(int log_fd) { log_fd_ = log_fd; }
+    /**
+     * @brief 丢弃offset之前的日志, offset必须是某条日志的开头
+     * @details offset先写入它所在的段的段头, 然后回收完全在offset之前的段: 重命名为之后要用的段号并改写段头,
+     * 留作之后追加日志时使用, 数据块已经分配并写过, 再写时不需要更新文件的元数据; 预留的段超过LOG_SEGMENT_SPARES个时删除
+     */
+    void RecycleLog(int64_t offset);
+
+    /**
+     * @brief 设置段文件的长度, 只对还没有段文件的日志有效; 已有的日志使用段头中记录的长度
+     */
+    void SetLogSegmentSize(int64_t size);
 
-    int GetLogFd() { return log_fd_; }
+    // 关闭并删除所有段文件
+    void DestroyLog();
 
     // 在fd对应文件中，从start_page_no开始分配page_no
     void set_fd2pageno(int fd, int start_page_no) { fd2pageno_[fd] = start_page_no; }
@@ -104,10 +144,40 @@ class DiskManager {
     static constexpr int MAX_FD = 8192;
 
    private:
-    // 文件打开列表，用于记录文件是否被打开
+    // 文件打开列表，用于记录文件是否被打开, 由files_latch_保护
+    std::mutex files_latch_;
     std::unordered_map<std::string, int> path2fd_;  //<Page文件磁盘路径,Page fd>哈希表
     std::unordered_map<int, std::string> fd2path_;  //<Page fd,Page文件磁盘路径>哈希表
 
-    int log_fd_ = -1;                             // log file
+    // 段头, 占段文件开头的LOG_SEGMENT_HEADER_SIZE字节, 改写段头时不会碰到日志数据所在的扇区
+    struct LogSegmentHeader {
+        uint32_t magic;
+        uint32_t reserved;
+        int64_t segment_no;    // 段号, 和文件名不一致时是没有改写完段头的回收的段
+        int64_t segment_size;  // 段文件的长度
+        int64_t log_begin;     // 日志的开头在这个段中时记录开头的偏移量, 否则为0
+    };
+    static constexpr uint32_t LOG_SEGMENT_MAGIC = 0x52424c47;
+
+    static std::string GetLogSegmentName(int64_t segment_no);
+
+    int64_t GetLogSegmentDataSize() { return log_segment_size_ - LOG_SEGMENT_HEADER_SIZE; }
+
+    // 打开当前目录下已有的段文件, 调用者持有log_latch_
+    void OpenLog();
+
+    // 写入segment_no段的段头并同步到磁盘
+    void WriteLogSegmentHeader(int fd, int64_t segment_no, int64_t log_begin);
+
+    // 返回segment_no段的文件, 不存在时create为true则创建并预先分配空间, 否则返回-1
+    int GetLogSegment(int64_t segment_no, bool create);
+
+    std::mutex log_latch_;                    // 保护以下日志相关的成员
+    bool log_opened_ = false;
+    int64_t log_segment_size_ = LOG_SEGMENT_SIZE;
+    std::map<int64_t, int> log_segments_;     // 段号 -> 段文件的fd, 包括末尾之后预留的段
+    int64_t log_begin_ = 0;
+    int64_t log_end_ = 0;
+    int64_t log_synced_ = 0;                  // 已经同步到磁盘的日志的末尾
     std::atomic<page_id_t> fd2pageno_[MAX_FD]{};  // 在文件fd中分配的page no个数
 };
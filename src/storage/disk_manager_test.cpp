@@ -12,6 +12,7 @@
 
 #include "disk_manager.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <unordered_map>
@@ -159,3 +160,50 @@ TEST_F(DiskManagerTest, PageOperation) {
     disk_manager_->destroy_file(filename);
     EXPECT_EQ(disk_manager_->is_file(filename), false);
 }
+
+/**
+ * @brief 测试日志段文件: 跨段追加和读取, 回收段, 重新打开后设置日志末尾
+ */
+TEST_F(DiskManagerTest, LogSegmentOperation) {
+    const int64_t data_size = 1000;  // 每个段中日志数据的长度
+    disk_manager_->DestroyLog();
+    disk_manager_->SetLogSegmentSize(LOG_SEGMENT_HEADER_SIZE + data_size);
+
+    // 每次追加300字节, 跨越段的边界
+    std::vector<char> data(3000);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<char>(i * 7);
+    }
+    for (int i = 0; i < 10; i++) {
+        disk_manager_->WriteLog(data.data() + i * 300, 300);
+    }
+    disk_manager_->SyncLog();
+    EXPECT_EQ(disk_manager_->GetLogEnd(), 3000);
+    std::vector<char> buf(data.size());
+    ASSERT_EQ(disk_manager_->ReadLog(buf.data(), buf.size(), 0), 3000);
+    EXPECT_EQ(buf, data);
+
+    // 第0段完全在1500之前, 回收为第3段
+    disk_manager_->RecycleLog(1500);
+    EXPECT_EQ(disk_manager_->GetLogBegin(), 1500);
+    EXPECT_FALSE(disk_manager_->is_file(LOG_FILE_NAME + ".00000000"));
+    EXPECT_TRUE(disk_manager_->is_file(LOG_FILE_NAME + ".00000003"));
+
+    // 重新打开后从段头中读出日志的开头, 末尾之后的内容清零, 之后的段删除
+    disk_manager_ = std::make_unique<DiskManager>();
+    EXPECT_EQ(disk_manager_->GetLogBegin(), 1500);
+    disk_manager_->SetLogEnd(2500);
+    EXPECT_FALSE(disk_manager_->is_file(LOG_FILE_NAME + ".00000003"));
+    ASSERT_EQ(disk_manager_->ReadLog(buf.data(), 1500, 1500), 1500);
+    EXPECT_TRUE(std::equal(buf.begin(), buf.begin() + 1000, data.begin() + 1500));
+    EXPECT_TRUE(std::all_of(buf.begin() + 1000, buf.begin() + 1500, [](char c) { return c == 0; }));
+
+    // 追加的日志接在新的末尾之后
+    disk_manager_->WriteLog(data.data(), 600);
+    EXPECT_EQ(disk_manager_->GetLogEnd(), 3100);
+    ASSERT_EQ(disk_manager_->ReadLog(buf.data(), 600, 2500), 600);
+    EXPECT_TRUE(std::equal(buf.begin(), buf.begin() + 600, data.begin()));
+
+    disk_manager_->DestroyLog();
+    EXPECT_FALSE(disk_manager_->is_file(LOG_FILE_NAME + ".00000002"));
+}
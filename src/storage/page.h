@@ -84,6 +84,15 @@ class Page {
 
     inline void SetPageLsn(lsn_t page_lsn) { memcpy(GetData() + OFFSET_LSN, &page_lsn, sizeof(lsn_t)); }
 
+    /** 页面上次写回磁盘之后的第一个修改的日志的lsn(或者更小的lsn), 页面没有未写回的写过日志的修改时为INVALID_LSN */
+    inline lsn_t GetRecLsn() const { return rec_lsn_.load(); }
+
+    /** 写日志修改页面之前调用, 调用者持有页面的写锁; 页面已经有rec_lsn时不变 */
+    inline void SetRecLsn(lsn_t rec_lsn) {
+        lsn_t expected = INVALID_LSN;
+        rec_lsn_.compare_exchange_strong(expected, rec_lsn);
+    }
+
    private:
     void ResetMemory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }  // 将data_的PAGE_SIZE个字节填充为0
 
@@ -98,6 +107,9 @@ class Page {
     /** 脏页判断 */
     bool is_dirty_ = false;
 
+    /** 检查点读取脏页表时不持有页面的锁, 由BufferPoolManager在页面写回磁盘后清除 */
+    std::atomic<lsn_t> rec_lsn_{INVALID_LSN};
+
     /** The pin count of this page. */
     int pin_count_ = 0;
 
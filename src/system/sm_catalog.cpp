@@ -0,0 +1,334 @@
+#include "sm_catalog.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "common/crc32.h"
+
+namespace {
+
+constexpr uint32_t CATALOG_MAGIC = 0x52424354;  // "RBCT"
+constexpr uint32_t CATALOG_VERSION = 1;
+constexpr size_t FILE_HEADER_SIZE = sizeof(uint32_t) * 2;
+constexpr size_t ENTRY_HEADER_SIZE = sizeof(uint32_t) * 2;
+
+enum class EntryType : int32_t { DATABASE = 1, CREATE_TABLE, DROP_TABLE, SET_INDEX, SET_STATS };
+
+// 组装一条修改, 开头留出entry头, finish时填写
+class EntryWriter {
+   public:
+    explicit EntryWriter(EntryType type) : buf_(ENTRY_HEADER_SIZE, '\0') { put(static_cast<int32_t>(type)); }
+
+    template <typename T>
+    void put(const T &value) {
+        buf_.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void put_string(const std::string &str) {
+        put(static_cast<uint32_t>(str.size()));
+        buf_.append(str);
+    }
+
+    std::string finish() {
+        uint32_t size = buf_.size() - ENTRY_HEADER_SIZE;
+        uint32_t checksum = Crc32(0, buf_.data() + ENTRY_HEADER_SIZE, size);
+        memcpy(&buf_[0], &size, sizeof(size));
+        memcpy(&buf_[sizeof(size)], &checksum, sizeof(checksum));
+        return std::move(buf_);
+    }
+
+   private:
+    std::string buf_;
+};
+
+// 读出一条修改的payload, 校验和正确但是内容超出payload时说明文件已经损坏
+class EntryReader {
+   public:
+    EntryReader(const char *data, size_t size) : data_(data), size_(size) {}
+
+    template <typename T>
+    T get() {
+        check(sizeof(T));
+        T value;
+        memcpy(&value, data_ + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return value;
+    }
+
+    std::string get_string() {
+        uint32_t size = get<uint32_t>();
+        check(size);
+        std::string str(data_ + pos_, size);
+        pos_ += size;
+        return str;
+    }
+
+   private:
+    void check(size_t size) {
+        if (size > size_ - pos_) {
+            throw InternalError("Corrupted catalog entry in " + DB_META_NAME);
+        }
+    }
+
+    const char *data_;
+    size_t size_;
+    size_t pos_ = 0;
+};
+
+std::string encode_create_table(const TabMeta &tab) {
+    EntryWriter writer(EntryType::CREATE_TABLE);
+    writer.put(static_cast<int32_t>(tab.id));
+    writer.put_string(tab.name);
+    writer.put(static_cast<uint32_t>(tab.cols.size()));
+    for (auto &col : tab.cols) {
+        writer.put_string(col.name);
+        writer.put(static_cast<int32_t>(col.type));
+        writer.put(static_cast<int32_t>(col.len));
+        writer.put(static_cast<int32_t>(col.offset));
+        writer.put(static_cast<uint8_t>(col.index));
+    }
+    return writer.finish();
+}
+
+TabMeta decode_create_table(EntryReader &reader) {
+    TabMeta tab;
+    tab.id = reader.get<int32_t>();
+    tab.name = reader.get_string();
+    uint32_t num_cols = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < num_cols; i++) {
+        ColMeta col;
+        col.tab_name = tab.name;
+        col.name = reader.get_string();
+        col.type = static_cast<ColType>(reader.get<int32_t>());
+        col.len = reader.get<int32_t>();
+        col.offset = reader.get<int32_t>();
+        col.index = reader.get<uint8_t>() != 0;
+        tab.cols.push_back(std::move(col));
+    }
+    tab.build_col_ids();
+    return tab;
+}
+
+std::string encode_set_stats(int tab_id, const TabStats &stats) {
+    EntryWriter writer(EntryType::SET_STATS);
+    writer.put(static_cast<int32_t>(tab_id));
+    writer.put(static_cast<int64_t>(stats.num_rows));
+    writer.put(static_cast<int64_t>(stats.num_pages));
+    writer.put(static_cast<uint32_t>(stats.cols.size()));
+    for (auto &col : stats.cols) {
+        writer.put(static_cast<int64_t>(col.num_distinct));
+        writer.put_string(col.min_val);
+        writer.put_string(col.max_val);
+        writer.put(static_cast<uint32_t>(col.bounds.size()));
+        for (auto &bound : col.bounds) {
+            writer.put_string(bound);
+        }
+    }
+    return writer.finish();
+}
+
+std::shared_ptr<TabStats> decode_set_stats(EntryReader &reader) {
+    auto stats = std::make_shared<TabStats>();
+    stats->num_rows = reader.get<int64_t>();
+    stats->num_pages = reader.get<int64_t>();
+    uint32_t num_cols = reader.get<uint32_t>();
+    for (uint32_t i = 0; i < num_cols; i++) {
+        ColStats col;
+        col.num_distinct = reader.get<int64_t>();
+        col.min_val = reader.get_string();
+        col.max_val = reader.get_string();
+        uint32_t num_bounds = reader.get<uint32_t>();
+        for (uint32_t j = 0; j < num_bounds; j++) {
+            col.bounds.push_back(reader.get_string());
+        }
+        stats->cols.push_back(std::move(col));
+    }
+    return stats;
+}
+
+void write_all(int fd, const std::string &data) {
+    if (write(fd, data.data(), data.size()) != static_cast<ssize_t>(data.size())) {
+        throw UnixError();
+    }
+}
+
+int open_catalog() {
+    int fd = ::open(DB_META_NAME.c_str(), O_RDWR | O_APPEND);
+    if (fd < 0) {
+        throw UnixError();
+    }
+    return fd;
+}
+
+}  // namespace
+
+void CatalogFile::create(const DbMeta &db) { write_snapshot(db); }
+
+void CatalogFile::write_snapshot(const DbMeta &db) {
+    std::string data(FILE_HEADER_SIZE, '\0');
+    memcpy(&data[0], &CATALOG_MAGIC, sizeof(CATALOG_MAGIC));
+    memcpy(&data[sizeof(CATALOG_MAGIC)], &CATALOG_VERSION, sizeof(CATALOG_VERSION));
+    EntryWriter writer(EntryType::DATABASE);
+    writer.put_string(db.name_);
+    writer.put(static_cast<int32_t>(db.next_tab_id_));
+    data += writer.finish();
+    for (auto &entry : db.tabs_) {
+        data += encode_create_table(entry.second);
+        if (auto stats = entry.second.stats->get()) {
+            data += encode_set_stats(entry.second.id, *stats);
+        }
+    }
+    std::string tmp_name = DB_META_NAME + ".tmp";
+    int fd = ::open(tmp_name.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0777);
+    if (fd < 0) {
+        throw UnixError();
+    }
+    write_all(fd, data);
+    if (fsync(fd) < 0) {
+        throw UnixError();
+    }
+    ::close(fd);
+    if (rename(tmp_name.c_str(), DB_META_NAME.c_str()) < 0) {
+        throw UnixError();
+    }
+}
+
+void CatalogFile::open(DbMeta &db) {
+    close_fd();
+    fd_ = open_catalog();
+    struct stat st;
+    if (fstat(fd_, &st) < 0) {
+        throw UnixError();
+    }
+    std::string data(st.st_size, '\0');
+    if (pread(fd_, &data[0], data.size(), 0) != static_cast<ssize_t>(data.size())) {
+        throw UnixError();
+    }
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    if (data.size() >= FILE_HEADER_SIZE) {
+        memcpy(&magic, data.data(), sizeof(magic));
+        memcpy(&version, data.data() + sizeof(magic), sizeof(version));
+    }
+    if (magic != CATALOG_MAGIC || version != CATALOG_VERSION) {
+        throw InternalError(DB_META_NAME + " is not a catalog of version " + std::to_string(CATALOG_VERSION));
+    }
+
+    db.name_.clear();
+    db.tabs_.clear();
+    db.next_tab_id_ = 1;
+    std::unordered_map<int, std::string> tab_names;  // 表的编号 -> 表名
+    auto get_table = [&](int tab_id) -> TabMeta & {
+        auto it = tab_names.find(tab_id);
+        if (it == tab_names.end()) {
+            throw InternalError("Corrupted catalog entry in " + DB_META_NAME);
+        }
+        return db.tabs_.at(it->second);
+    };
+    size_t pos = FILE_HEADER_SIZE;
+    num_entries_ = 0;
+    while (data.size() - pos >= ENTRY_HEADER_SIZE) {
+        uint32_t size;
+        uint32_t checksum;
+        memcpy(&size, data.data() + pos, sizeof(size));
+        memcpy(&checksum, data.data() + pos + sizeof(size), sizeof(checksum));
+        const char *payload = data.data() + pos + ENTRY_HEADER_SIZE;
+        if (size > data.size() - pos - ENTRY_HEADER_SIZE || Crc32(0, payload, size) != checksum) {
+            break;
+        }
+        EntryReader reader(payload, size);
+        switch (static_cast<EntryType>(reader.get<int32_t>())) {
+            case EntryType::DATABASE:
+                db.name_ = reader.get_string();
+                db.next_tab_id_ = std::max(db.next_tab_id_, reader.get<int32_t>());
+                break;
+            case EntryType::CREATE_TABLE: {
+                TabMeta tab = decode_create_table(reader);
+                db.next_tab_id_ = std::max(db.next_tab_id_, tab.id + 1);
+                tab_names[tab.id] = tab.name;
+                db.tabs_[tab.name] = std::move(tab);
+            } break;
+            case EntryType::DROP_TABLE: {
+                int tab_id = reader.get<int32_t>();
+                db.tabs_.erase(get_table(tab_id).name);
+                tab_names.erase(tab_id);
+            } break;
+            case EntryType::SET_INDEX: {
+                TabMeta &tab = get_table(reader.get<int32_t>());
+                uint32_t col_id = reader.get<uint32_t>();
+                if (col_id >= tab.cols.size()) {
+                    throw InternalError("Corrupted catalog entry in " + DB_META_NAME);
+                }
+                tab.cols[col_id].index = reader.get<uint8_t>() != 0;
+            } break;
+            case EntryType::SET_STATS: {
+                TabMeta &tab = get_table(reader.get<int32_t>());
+                auto stats = decode_set_stats(reader);
+                if (stats->cols.size() != tab.cols.size()) {
+                    throw InternalError("Corrupted catalog entry in " + DB_META_NAME);
+                }
+                tab.stats->set(std::move(stats));
+            } break;
+            default:
+                throw InternalError("Corrupted catalog entry in " + DB_META_NAME);
+        }
+        pos += ENTRY_HEADER_SIZE + size;
+        num_entries_++;
+    }
+    // 截掉写到一半时故障留下的修改, 之后的修改接在完整的修改之后
+    if (pos < data.size() && ftruncate(fd_, pos) < 0) {
+        throw UnixError();
+    }
+}
+
+void CatalogFile::close(const DbMeta &db) {
+    if (fd_ < 0) {
+        return;
+    }
+    close_fd();
+    size_t num_live_entries = 1 + db.tabs_.size();
+    for (auto &entry : db.tabs_) {
+        num_live_entries += entry.second.stats->get() != nullptr;
+    }
+    if (num_entries_ > num_live_entries + MAX_STALE_ENTRIES) {
+        write_snapshot(db);
+    }
+}
+
+void CatalogFile::append_create_table(const TabMeta &tab) { append(encode_create_table(tab)); }
+
+void CatalogFile::append_drop_table(int tab_id) {
+    EntryWriter writer(EntryType::DROP_TABLE);
+    writer.put(static_cast<int32_t>(tab_id));
+    append(writer.finish());
+}
+
+void CatalogFile::append_set_index(int tab_id, int col_id, bool index) {
+    EntryWriter writer(EntryType::SET_INDEX);
+    writer.put(static_cast<int32_t>(tab_id));
+    writer.put(static_cast<uint32_t>(col_id));
+    writer.put(static_cast<uint8_t>(index));
+    append(writer.finish());
+}
+
+void CatalogFile::append_set_stats(int tab_id, const TabStats &stats) { append(encode_set_stats(tab_id, stats)); }
+
+void CatalogFile::append(const std::string &entry) {
+    std::scoped_lock lock(latch_);
+    write_all(fd_, entry);
+    if (fdatasync(fd_) < 0) {
+        throw UnixError();
+    }
+    num_entries_++;
+}
+
+void CatalogFile::close_fd() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+
+#include "sm_meta.h"
+
+/**
+ * @brief 系统目录文件DB_META_NAME, 二进制格式, DDL只在文件末尾追加一条修改, 不重写整个文件
+ * @details 文件格式:
+ * ----------------------------------------------
+ * | magic | version | entry | entry | ... |
+ * ----------------------------------------------
+ * entry (checksum是payload的CRC-32)
+ * ------------------------------------------------
+ * | payload_size | checksum | entry_type | payload |
+ * ------------------------------------------------
+ * DATABASE:     | name | next_tab_id |
+ * CREATE_TABLE: | tab_id | name | col_num | col_num*(name, type, len, offset, index) |
+ * DROP_TABLE:   | tab_id |
+ * SET_INDEX:    | tab_id | col_id | index |
+ * SET_STATS:    | tab_id | num_rows | num_pages | col_num | col_num*(num_distinct, min, max, bound_num, bounds) |
+ * 字符串存为| size | bytes |. 打开时按顺序重放所有修改, 写到一半时故障留下的不完整的修改被截掉.
+ * 作废的修改(已经删除的表等)太多时, 先把当前的目录写到临时文件再rename, 重写整个文件
+ */
+class CatalogFile {
+   public:
+    ~CatalogFile() { close_fd(); }
+
+    /**
+     * @brief 在当前目录下创建只包含db的目录文件
+     */
+    static void create(const DbMeta &db);
+
+    /**
+     * @brief 打开当前目录下的目录文件, 读出其中的db
+     * 文件的格式或者版本不对时抛出InternalError
+     */
+    void open(DbMeta &db);
+
+    /**
+     * @brief 关闭目录文件, 作废的修改太多时先重写
+     */
+    void close(const DbMeta &db);
+
+    void append_create_table(const TabMeta &tab);
+
+    void append_drop_table(int tab_id);
+
+    void append_set_index(int tab_id, int col_id, bool index);
+
+    // 表的统计信息, 替换之前的统计信息
+    void append_set_stats(int tab_id, const TabStats &stats);
+
+   private:
+    // 当前目录中的每个表是一条CREATE_TABLE, 收集过统计信息的表再加一条SET_STATS, 文件中的修改比这多出MAX_STALE_ENTRIES条以上时重写
+    static constexpr size_t MAX_STALE_ENTRIES = 64;
+
+    // 把db写入临时文件再rename为DB_META_NAME
+    static void write_snapshot(const DbMeta &db);
+
+    // 追加一条修改并同步到磁盘, 自动收集统计信息时可能和DDL同时追加
+    void append(const std::string &entry);
+
+    void close_fd();
+
+    int fd_ = -1;
+    std::mutex latch_;        // 保护追加
+    size_t num_entries_ = 0;  // 文件中的修改条数
+};
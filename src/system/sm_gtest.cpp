@@ -1,7 +1,11 @@
 #undef NDEBUG
 
+#include <atomic>
 #include <cassert>
+#include <cstring>
+#include <fstream>
 #include <string>
+#include <thread>
 
 #include "gtest/gtest.h"
 #include "record/rm_manager.h"
@@ -23,7 +27,10 @@ TEST(SystemManagerTest, SimpleTest) {
         std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
     char *result = new char[BUFFER_LENGTH];
     int offset = 0;
-    Context *context = new Context(nullptr, nullptr, nullptr, result, &offset);
+    // DDL要对表加排他锁
+    LockManager lock_manager;
+    Transaction txn(0);
+    Context *context = new Context(&lock_manager, nullptr, &txn, result, &offset);
 
     if (sm_manager->is_dir(db)) {
         sm_manager->drop_db(db);
@@ -87,4 +94,265 @@ TEST(SystemManagerTest, SimpleTest) {
     // Clean up
     sm_manager->close_db();
     sm_manager->drop_db(db);
-}
\ No newline at end of file
+}
+// DDL追加到系统目录文件中, 重新打开数据库后读出相同的目录; 写到一半的修改被截掉
+TEST(SystemManagerTest, CatalogPersistence) {
+    std::string db = "catalog_db";
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto sm_manager =
+        std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    // DDL要对表加排他锁
+    LockManager lock_manager;
+    Transaction txn(0);
+    Context *context = new Context(&lock_manager, nullptr, &txn, result, &offset);
+
+    if (sm_manager->is_dir(db)) {
+        sm_manager->drop_db(db);
+    }
+    sm_manager->create_db(db);
+    sm_manager->open_db(db);
+    std::vector<ColDef> col_defs = {{.name = "a", .type = TYPE_INT, .len = 4},
+                                    {.name = "b", .type = TYPE_STRING, .len = 16}};
+    const int num_tables = 200;
+    for (int i = 0; i < num_tables; i++) {
+        sm_manager->create_table("tab" + std::to_string(i), col_defs, context);
+    }
+    sm_manager->create_index("tab7", "b", context);
+    sm_manager->drop_table("tab3", context);
+    int tab_id = sm_manager->db_.get_table("tab5").id;
+    sm_manager->close_db();
+
+    sm_manager->open_db(db);
+    EXPECT_FALSE(sm_manager->db_.is_table("tab3"));
+    EXPECT_EQ(sm_manager->db_.get_table("tab5").id, tab_id);
+    EXPECT_EQ(sm_manager->get_file_handle("tab5")->GetTabId(), tab_id);
+    TabMeta &tab = sm_manager->db_.get_table("tab7");
+    EXPECT_TRUE(tab.is_col("b"));
+    EXPECT_FALSE(tab.is_col("c"));
+    EXPECT_EQ(tab.get_col("b") - tab.cols.begin(), 1);
+    EXPECT_EQ(tab.get_col("c"), tab.cols.end());
+    EXPECT_TRUE(tab.get_col("b")->index);
+    EXPECT_FALSE(tab.get_col("a")->index);
+    // 表的编号不会重复使用
+    sm_manager->create_table("tab3", col_defs, context);
+    EXPECT_EQ(sm_manager->db_.get_table("tab3").id, num_tables + 1);
+    sm_manager->close_db();
+
+    // 在目录文件末尾留下半条修改, 打开时被截掉, 之后的DDL接在完整的修改之后
+    std::string meta_name = db + "/" + DB_META_NAME;
+    {
+        std::ofstream ofs(meta_name, std::ios::app | std::ios::binary);
+        ofs << "torn";
+    }
+    sm_manager->open_db(db);
+    sm_manager->drop_index("tab7", "b", context);
+    sm_manager->close_db();
+    sm_manager->open_db(db);
+    EXPECT_TRUE(sm_manager->db_.is_table("tab3"));
+    EXPECT_TRUE(sm_manager->db_.is_table("tab" + std::to_string(num_tables - 1)));
+    EXPECT_FALSE(sm_manager->db_.get_table("tab7").get_col("b")->index);
+    sm_manager->close_db();
+    sm_manager->drop_db(db);
+    delete context;
+    delete[] result;
+}
+
+// 打开数据库时不打开表和索引的文件, 第一次访问时打开; 打开的文件超过MAX_OPEN_FILES个时关闭最近最少使用的
+TEST(SystemManagerTest, LazyFileHandles) {
+    std::string db = "lazy_db";
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto sm_manager =
+        std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    LockManager lock_manager;
+    Transaction txn(0);
+    Context *context = new Context(&lock_manager, nullptr, &txn, result, &offset);
+
+    if (sm_manager->is_dir(db)) {
+        sm_manager->drop_db(db);
+    }
+    sm_manager->create_db(db);
+    sm_manager->open_db(db);
+    std::vector<ColDef> col_defs = {{.name = "a", .type = TYPE_INT, .len = 4},
+                                    {.name = "b", .type = TYPE_INT, .len = 4}};
+    const int num_tables = MAX_OPEN_FILES + 44;
+    auto tab_name = [](int i) { return "tab" + std::to_string(i); };
+    for (int i = 0; i < num_tables; i++) {
+        sm_manager->create_table(tab_name(i), col_defs, context);
+        sm_manager->create_index(tab_name(i), "a", context);
+    }
+    // 一直被持有的句柄不会被关闭
+    auto pinned = sm_manager->get_file_handle(tab_name(0));
+    std::vector<Rid> rids(num_tables);
+    for (int i = 0; i < num_tables; i++) {
+        int record[2] = {i, i * 2};
+        rids[i] = sm_manager->get_file_handle(tab_name(i))->insert_record(reinterpret_cast<char *>(record), context);
+        sm_manager->get_index_handle(tab_name(i), 0)->insert_entry(reinterpret_cast<char *>(record), rids[i], &txn);
+    }
+    auto file_stats = sm_manager->file_handle_stats();
+    auto index_stats = sm_manager->index_handle_stats();
+    EXPECT_GE(file_stats.evictions, static_cast<uint64_t>(num_tables) - MAX_OPEN_FILES);
+    EXPECT_LE(file_stats.opens - file_stats.evictions, MAX_OPEN_FILES);
+    EXPECT_LE(index_stats.opens - index_stats.evictions, MAX_OPEN_FILES);
+    EXPECT_EQ(reinterpret_cast<int *>(pinned->get_record(rids[0], context)->data)[1], 0);
+    pinned = nullptr;
+    sm_manager->close_db();
+
+    // 打开数据库不打开文件, 被关闭的文件重新打开后读出关闭前写入的记录和索引
+    sm_manager->open_db(db);
+    EXPECT_EQ(sm_manager->file_handle_stats().opens, file_stats.opens);
+    for (int i = num_tables - 1; i >= 0; i--) {
+        auto rec = sm_manager->get_file_handle(tab_name(i))->get_record(rids[i], context);
+        EXPECT_EQ(reinterpret_cast<int *>(rec->data)[1], i * 2);
+        std::vector<Rid> found;
+        EXPECT_TRUE(sm_manager->get_index_handle(tab_name(i), 0)->GetValue(reinterpret_cast<char *>(&i), &found, &txn));
+        EXPECT_EQ(found, std::vector<Rid>{rids[i]});
+    }
+    sm_manager->close_db();
+    sm_manager->drop_db(db);
+    delete context;
+    delete[] result;
+}
+
+// 淘汰句柄时在缓存的latch_外关闭文件: 关闭期间其他文件的访问不被阻塞, 同一个文件要等关闭完成才重新打开
+TEST(SystemManagerTest, HandleCacheClosesOutsideLatch) {
+    std::atomic<bool> closing{false};
+    std::atomic<int> closed{0};
+    HandleCache<int> cache(1, [&](int *) {
+        closing = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        closed++;
+    });
+    auto open = [] { return std::make_unique<int>(0); };
+    cache.get("a", open);
+    // 打开b时淘汰a, a的关闭很慢
+    std::thread evictor([&] { cache.get("b", open); });
+    while (!closing) {
+        std::this_thread::yield();
+    }
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(cache.stats().evictions, 1u);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+    // a关闭完成之后才能重新打开
+    cache.get("a", [&] {
+        EXPECT_EQ(closed, 1);
+        return std::make_unique<int>(0);
+    });
+    evictor.join();
+    EXPECT_EQ(cache.stats().opens, 3u);
+    cache.clear();
+    EXPECT_EQ(closed, 3);
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+// ANALYZE收集的统计信息: 小表全部扫描, 大表抽样扫描; 统计信息保存在系统目录中, 修改过多时自动重新收集
+TEST(SystemManagerTest, TableStatistics) {
+    std::string db = "stats_db";
+    auto disk_manager = std::make_unique<DiskManager>();
+    auto buffer_pool_manager = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager.get());
+    auto rm_manager = std::make_unique<RmManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto ix_manager = std::make_unique<IxManager>(disk_manager.get(), buffer_pool_manager.get());
+    auto sm_manager =
+        std::make_unique<SmManager>(disk_manager.get(), buffer_pool_manager.get(), rm_manager.get(), ix_manager.get());
+    char *result = new char[BUFFER_LENGTH];
+    int offset = 0;
+    LockManager lock_manager;
+    Transaction txn(0, IsolationLevel::READ_UNCOMMITTED);
+    Context *context = new Context(&lock_manager, nullptr, &txn, result, &offset);
+
+    if (sm_manager->is_dir(db)) {
+        sm_manager->drop_db(db);
+    }
+    sm_manager->create_db(db);
+    sm_manager->open_db(db);
+    // 每页只能放下8条记录, 大表的数据页超过STATS_SAMPLE_PAGES
+    std::vector<ColDef> col_defs = {{.name = "a", .type = TYPE_INT, .len = 4},
+                                    {.name = "b", .type = TYPE_INT, .len = 4},
+                                    {.name = "c", .type = TYPE_STRING, .len = 500}};
+    auto fill = [&](const std::string &tab_name, int num_rows) {
+        sm_manager->create_table(tab_name, col_defs, context);
+        auto fh = sm_manager->get_file_handle(tab_name);
+        char record[508] = {};
+        for (int i = 0; i < num_rows; i++) {
+            int vals[2] = {i, i % 10};
+            memcpy(record, vals, sizeof(vals));
+            fh->insert_record(record, context);
+        }
+    };
+    const int small_rows = 1000;
+    const int big_rows = STATS_SAMPLE_PAGES * 12;
+    fill("small", small_rows);
+    fill("big", big_rows);
+    EXPECT_EQ(sm_manager->db_.get_table("small").stats->get(), nullptr);
+    EXPECT_EQ(sm_manager->db_.get_table("small").stats->estimate_rows(), -1);
+    // 只有用到重新收集的表的执行计划需要重新生成, catalog版本不变
+    uint64_t catalog_version = sm_manager->get_catalog_version();
+    uint64_t small_version = sm_manager->db_.get_table("small").stats->version();
+    uint64_t big_version = sm_manager->db_.get_table("big").stats->version();
+    sm_manager->analyze_table("small", context);
+    EXPECT_GT(sm_manager->db_.get_table("small").stats->version(), small_version);
+    EXPECT_EQ(sm_manager->db_.get_table("big").stats->version(), big_version);
+    sm_manager->analyze_table("big", nullptr);
+    EXPECT_GT(sm_manager->db_.get_table("big").stats->version(), big_version);
+    EXPECT_EQ(sm_manager->get_catalog_version(), catalog_version);
+
+    auto small = sm_manager->db_.get_table("small").stats->get();
+    ASSERT_NE(small, nullptr);
+    EXPECT_EQ(small->num_rows, small_rows);
+    EXPECT_EQ(*reinterpret_cast<const int *>(small->cols[0].min_val.data()), 0);
+    EXPECT_EQ(*reinterpret_cast<const int *>(small->cols[0].max_val.data()), small_rows - 1);
+    EXPECT_NEAR(small->cols[0].num_distinct, small_rows, small_rows * 0.05);
+    EXPECT_NEAR(small->cols[1].num_distinct, 10, 1);
+    EXPECT_EQ(small->cols[0].bounds.size(), STATS_HISTOGRAM_BUCKETS);
+    int key = 3;
+    EXPECT_NEAR(small->cols[1].eq_selectivity(reinterpret_cast<char *>(&key), TYPE_INT, 4), 0.1, 0.02);
+    key = small_rows / 4;
+    EXPECT_NEAR(small->cols[0].lt_selectivity(reinterpret_cast<char *>(&key), TYPE_INT, 4, false), 0.25, 0.02);
+    key = -1;
+    EXPECT_EQ(small->cols[0].eq_selectivity(reinterpret_cast<char *>(&key), TYPE_INT, 4), 0);
+
+    auto big = sm_manager->db_.get_table("big").stats->get();
+    ASSERT_NE(big, nullptr);
+    EXPECT_GT(big->num_pages, static_cast<int64_t>(STATS_SAMPLE_PAGES));
+    EXPECT_NEAR(big->num_rows, big_rows, big_rows * 0.1);
+    EXPECT_NEAR(big->cols[0].num_distinct, big_rows, big_rows * 0.15);
+    EXPECT_NEAR(big->cols[1].num_distinct, 10, 1);
+    key = big_rows / 2;
+    EXPECT_NEAR(big->cols[0].lt_selectivity(reinterpret_cast<char *>(&key), TYPE_INT, 4, true), 0.5, 0.1);
+
+    // 插入和删除修正行数的估计, 修改的行数超过阈值后由后台线程自动重新收集
+    auto table_stats = sm_manager->db_.get_table("small").stats;
+    sm_manager->record_modifications("small", 10, 4, 100);
+    EXPECT_EQ(table_stats->estimate_rows(), small_rows + 6);
+    EXPECT_FALSE(table_stats->is_stale());
+    EXPECT_EQ(sm_manager->auto_analyze_count(), 0);
+    sm_manager->record_modifications("small", 0, 0, STATS_STALE_MIN_ROWS + small_rows * STATS_STALE_PERCENT / 100);
+    for (int i = 0; i < 500 && sm_manager->auto_analyze_count() == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(sm_manager->auto_analyze_count(), 1);
+    EXPECT_EQ(table_stats->estimate_rows(), small_rows);
+    EXPECT_FALSE(table_stats->is_stale());
+
+    // 统计信息在重新打开数据库后还在
+    sm_manager->close_db();
+    sm_manager->open_db(db);
+    auto reopened = sm_manager->db_.get_table("big").stats->get();
+    ASSERT_NE(reopened, nullptr);
+    EXPECT_EQ(reopened->num_rows, big->num_rows);
+    EXPECT_EQ(reopened->cols[0].bounds, big->cols[0].bounds);
+    EXPECT_EQ(sm_manager->db_.get_table("small").stats->estimate_rows(), small_rows);
+    sm_manager->close_db();
+    sm_manager->drop_db(db);
+    delete context;
+    delete[] result;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct HandleCacheStats {
+    uint64_t hits;       // 句柄已经打开的访问次数
+    uint64_t opens;      // 打开文件的次数
+    uint64_t evictions;  // 因为句柄过多而关闭的次数
+};
+
+/**
+ * @brief 按文件名缓存打开的文件句柄, 第一次访问时才打开文件, 按LRU关闭不用的句柄
+ * @details get返回的shared_ptr在使用期间钉住句柄, 只有只被缓存持有(use_count为1)的句柄才会被关闭.
+ * 打开新的句柄之前, 句柄个数达到capacity时关闭最近最少使用的没有被钉住的句柄; 都被钉住时暂时超过capacity.
+ * 句柄只在latch_内被复制出缓存, 所以检查到use_count为1之后不会再有其他线程拿到它.
+ * 关闭句柄要把缓冲池中的页刷到磁盘, 所以在latch_内只把句柄移出缓存, 释放latch_后再关闭;
+ * 关闭完成之前再次get同一个文件会等待, 不会在旧句柄写回文件头之前重新打开文件
+ */
+template <typename Handle>
+class HandleCache {
+   public:
+    using CloseFunc = std::function<void(Handle *)>;
+
+    /**
+     * @param close 关闭文件, 在句柄被淘汰, erase或者clear时调用, 之后句柄被释放
+     */
+    HandleCache(size_t capacity, CloseFunc close) : capacity_(capacity), close_(std::move(close)) {}
+
+    HandleCache(const HandleCache &) = delete;
+    HandleCache &operator=(const HandleCache &) = delete;
+
+    /**
+     * @brief 返回name的句柄, 还没有打开时调用open()打开
+     * @param open 返回std::unique_ptr<Handle>, 抛出异常时缓存不变
+     */
+    template <typename OpenFunc>
+    std::shared_ptr<Handle> get(const std::string &name, OpenFunc &&open) {
+        Detached victim;
+        std::unique_lock<std::mutex> lock(latch_);
+        closed_cv_.wait(lock, [&] { return closing_.count(name) == 0; });
+        auto it = entries_.find(name);
+        if (it != entries_.end()) {
+            lru_.splice(lru_.end(), lru_, it->second.lru_pos);
+            hits_++;
+            return it->second.handle;
+        }
+        if (entries_.size() >= capacity_) {
+            victim = evict();
+        }
+        std::shared_ptr<Handle> handle;
+        try {
+            handle = open();
+        } catch (...) {
+            lock.unlock();
+            close_detached(victim);
+            throw;
+        }
+        lru_.push_back(name);
+        entries_.emplace(name, Entry{handle, std::prev(lru_.end())});
+        opens_++;
+        lock.unlock();
+        close_detached(victim);
+        return handle;
+    }
+
+    /**
+     * @brief 关闭name的句柄, 删除文件之前调用; 调用者保证没有其他线程在使用它
+     */
+    void erase(const std::string &name) {
+        Detached victim;
+        {
+            std::scoped_lock lock(latch_);
+            auto it = entries_.find(name);
+            if (it != entries_.end()) {
+                victim = detach(it);
+            }
+        }
+        close_detached(victim);
+    }
+
+    // 关闭所有句柄
+    void clear() {
+        std::vector<Detached> victims;
+        {
+            std::scoped_lock lock(latch_);
+            while (!entries_.empty()) {
+                victims.push_back(detach(entries_.begin()));
+            }
+        }
+        for (auto &victim : victims) {
+            close_detached(victim);
+        }
+    }
+
+    size_t size() {
+        std::scoped_lock lock(latch_);
+        return entries_.size();
+    }
+
+    HandleCacheStats stats() {
+        std::scoped_lock lock(latch_);
+        return {hits_, opens_, evictions_};
+    }
+
+   private:
+    struct Entry {
+        std::shared_ptr<Handle> handle;
+        std::list<std::string>::iterator lru_pos;
+    };
+
+    // 已经移出缓存, 等待在latch_外关闭的句柄
+    struct Detached {
+        std::string name;
+        std::shared_ptr<Handle> handle;
+    };
+
+    using EntryIter = typename std::unordered_map<std::string, Entry>::iterator;
+
+    // 移出最近最少使用的一个没有被钉住的句柄, 调用者持有latch_; 都被钉住时返回空的Detached
+    Detached evict() {
+        for (auto pos = lru_.begin(); pos != lru_.end(); ++pos) {
+            auto it = entries_.find(*pos);
+            if (it->second.handle.use_count() == 1) {
+                evictions_++;
+                return detach(it);
+            }
+        }
+        return {};
+    }
+
+    // 把句柄移出缓存并记入closing_, 调用者持有latch_
+    Detached detach(EntryIter it) {
+        Detached victim{it->first, std::move(it->second.handle)};
+        closing_.insert(victim.name);
+        lru_.erase(it->second.lru_pos);
+        entries_.erase(it);
+        return victim;
+    }
+
+    // 关闭detach移出的句柄, 调用者不持有latch_
+    void close_detached(Detached &victim) {
+        if (victim.handle == nullptr) {
+            return;
+        }
+        try {
+            close_(victim.handle.get());
+        } catch (...) {
+            finish_close(victim.name);
+            throw;
+        }
+        finish_close(victim.name);
+    }
+
+    void finish_close(const std::string &name) {
+        {
+            std::scoped_lock lock(latch_);
+            closing_.erase(name);
+        }
+        closed_cv_.notify_all();
+    }
+
+    size_t capacity_;
+    CloseFunc close_;
+    std::mutex latch_;                              // 保护以下成员
+    std::unordered_map<std::string, Entry> entries_;  // 文件名 -> 句柄
+    std::list<std::string> lru_;                    // 文件名, 最近使用的在末尾
+    std::unordered_set<std::string> closing_;       // 已经移出缓存, 正在关闭的文件名
+    std::condition_variable closed_cv_;             // closing_中的文件关闭完成时通知
+    uint64_t hits_ = 0;
+    uint64_t opens_ = 0;
+    uint64_t evictions_ = 0;
+};
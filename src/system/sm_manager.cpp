@@ -3,7 +3,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
-#include <fstream>
+#include <algorithm>
 
 #include "index/ix.h"
 #include "record/rm.h"
@@ -29,15 +29,9 @@ void SmManager::create_db(const std::string &db_name) {
         throw UnixError();
     }
     // Create the system catalogs
-    DbMeta *new_db = new DbMeta();
-    new_db->name_ = db_name;
-    
-    // 注意，此处ofstream会在当前目录创建(如果没有此文件先创建)和打开一个名为DB_META_NAME的文件
-    std::ofstream ofs(DB_META_NAME);
-
-    // 将new_db中的信息，按照定义好的operator<<操作符，写入到ofs打开的DB_META_NAME文件中
-    ofs << *new_db;  // 注意：此处重载了操作符<<
-    delete new_db;
+    DbMeta new_db;
+    new_db.name_ = db_name;
+    CatalogFile::create(new_db);
 
     // cd back to root dir
     if (chdir("..") < 0) {
@@ -64,26 +58,10 @@ void SmManager::open_db(const std::string &db_name) {
     if (chdir(db_name.c_str()) < 0) {
         throw UnixError();
     }
-    // Load meta
-    // 打开一个名为DB_META_NAME的文件
-    std::ifstream ifs(DB_META_NAME);
-    // 将ofs打开的DB_META_NAME文件中的信息，按照定义好的operator>>操作符，读出到db_中
-    ifs >> db_;  // 注意：此处重载了操作符>>
-    // Open all record files & index files
-    for (auto &entry : db_.tabs_) {
-        auto &tab = entry.second;
-        // fhs_[tab.name] = rm_manager_->open_file(tab.name);
-        fhs_.emplace(tab.name, rm_manager_->open_file(tab.name));
-        for (size_t i = 0; i < tab.cols.size(); i++) {
-            auto &col = tab.cols[i];
-            if (col.index) {
-                auto index_name = ix_manager_->get_index_name(tab.name, i);
-                assert(ihs_.count(index_name) == 0);
-                // ihs_[index_name] = ix_manager_->open_index(tab.name, i);
-                ihs_.emplace(index_name, ix_manager_->open_index(tab.name, i));
-            }
-        }
-    }
+    // Load meta, 记录文件和索引文件在第一次访问时再打开
+    catalog_.open(db_);
+    catalog_version_++;
+    start_analyze_thread();
 }
 
 void SmManager::close_db() {
@@ -92,34 +70,45 @@ void SmManager::close_db() {
     // 关闭rm_manager_ ix_manager_文件
     // 清理fhs_, ihs_
 
-    std::ofstream ofs(DB_META_NAME);
-    ofs<<db_;
+    stop_analyze_thread();
+    catalog_.close(db_);
     db_.name_.clear();
     db_.tabs_.clear();
-    // Close all record files
-    for (auto &entry : fhs_) {
-        rm_manager_->close_file(entry.second.get());
-    }
-	fhs_.clear();
-	// Close all index files
-    for(auto &entry:ihs_){
-        ix_manager_->close_index(entry.second.get());
-    }
-	ihs_.clear();
+    // Close all record files & index files
+    fhs_.clear();
+    ihs_.clear();
     if (chdir("..") < 0) {
         throw UnixError();
     }
     // lab3 task1 Todo End
 }
 
+std::shared_ptr<RmFileHandle> SmManager::get_file_handle(const std::string &tab_name) {
+    return fhs_.get(tab_name, [&] {
+        if (!db_.is_table(tab_name)) {
+            throw TableNotFoundError(tab_name);
+        }
+        return rm_manager_->open_file(tab_name);
+    });
+}
+
+std::shared_ptr<IxIndexHandle> SmManager::get_index_handle(const std::string &tab_name, int col_idx) {
+    return ihs_.get(ix_manager_->get_index_name(tab_name, col_idx),
+                    [&] { return ix_manager_->open_index(tab_name, col_idx); });
+}
+
 void SmManager::show_tables(Context *context) {
     RecordPrinter printer(1);
     printer.print_separator(context);
     printer.print_record({"Tables"}, context);
     printer.print_separator(context);
+    std::vector<std::string> tab_names;
     for (auto &entry : db_.tabs_) {
-        auto &tab = entry.second;
-        printer.print_record({tab.name}, context);
+        tab_names.push_back(entry.first);
+    }
+    std::sort(tab_names.begin(), tab_names.end());
+    for (auto &tab_name : tab_names) {
+        printer.print_record({tab_name}, context);
     }
     printer.print_separator(context);
 }
@@ -149,6 +138,7 @@ void SmManager::create_table(const std::string &tab_name, const std::vector<ColD
     // Create table meta
     int curr_offset = 0;
     TabMeta tab;
+    tab.id = db_.next_tab_id_;
     tab.name = tab_name;
     for (auto &col_def : col_defs) {
         ColMeta col = {.tab_name = tab_name,
@@ -162,10 +152,12 @@ void SmManager::create_table(const std::string &tab_name, const std::vector<ColD
     }
     // Create & open record file
     int record_size = curr_offset;  // record_size就是col meta所占的大小（表的元数据也是以记录的形式进行存储的）
-    rm_manager_->create_file(tab_name, record_size);
-    db_.tabs_[tab_name] = tab;
-    // fhs_[tab_name] = rm_manager_->open_file(tab_name);
-    fhs_.emplace(tab_name, rm_manager_->open_file(tab_name));
+    rm_manager_->create_file(tab_name, record_size, tab.id);
+    tab.build_col_ids();
+    catalog_.append_create_table(tab);
+    db_.next_tab_id_++;
+    db_.tabs_[tab_name] = std::move(tab);
+    catalog_version_++;
 }
 
 void SmManager::drop_table(const std::string &tab_name, Context *context) {
@@ -174,23 +166,23 @@ void SmManager::drop_table(const std::string &tab_name, Context *context) {
     // Close & destroy record file
     // Close & destroy index file
     TabMeta &tab = db_.get_table(tab_name);
-    context->lock_mgr_->LockExclusiveOnTable(context->txn_,fhs_[tab_name].get()->GetFd());
-    rm_manager_->close_file(fhs_[tab_name].get());
+    context->lock_mgr_->LockExclusiveOnTable(context->txn_,tab.id);
+    // 后台线程收集统计信息时不加锁, 等待它结束后再关闭文件
+    std::lock_guard<std::mutex> stats_guard(stats_latch_);
+    fhs_.erase(tab_name);
     rm_manager_->destroy_file(tab_name);
     int cnt=0;
     for(auto col=tab.cols.begin();col!=tab.cols.end();col++){
         if(col->index){
             int col_idx=cnt;
-            const std::string &col_name=ix_manager_->get_index_name(tab_name,col_idx);
-            auto target=ihs_[col_name].get();
-            ix_manager_->close_index(target);
+            ihs_.erase(ix_manager_->get_index_name(tab_name,col_idx));
             ix_manager_->destroy_index(tab_name,col_idx);
-            ihs_.erase(col_name);
         }
         cnt++;
     }
+    catalog_.append_drop_table(tab.id);
     db_.tabs_.erase(tab_name);
-    fhs_.erase(tab_name);
+    catalog_version_++;
     // lab3 task1 Todo End
 }
 
@@ -200,51 +192,178 @@ void SmManager::create_index(const std::string &tab_name, const std::string &col
     if (col->index) {
         throw IndexExistsError(tab_name, col_name);
     }
-    context->lock_mgr_->LockExclusiveOnTable(context->txn_,fhs_[tab_name].get()->GetFd());
+    context->lock_mgr_->LockExclusiveOnTable(context->txn_,tab.id);
     // Create index file
     int col_idx = col - tab.cols.begin();
     ix_manager_->create_index(tab_name, col_idx, col->type, col->len);  // 这里调用了
     // Open index file
-    auto ih = ix_manager_->open_index(tab_name, col_idx);
+    auto ih = get_index_handle(tab_name, col_idx);
     // Get record file handle
-    auto file_handle = fhs_.at(tab_name).get();
+    auto file_handle = get_file_handle(tab_name);
     // Index all records into index
-    for (RmScan rm_scan(file_handle); !rm_scan.is_end(); rm_scan.next()) {
+    for (RmScan rm_scan(file_handle.get()); !rm_scan.is_end(); rm_scan.next()) {
         auto rec = file_handle->get_record(rm_scan.rid(), context);  // rid是record的存储位置，作为value插入到索引里
         const char *key = rec->data + col->offset;
         // record data里以各个属性的offset进行分隔，属性的长度为col len，record里面每个属性的数据作为key插入索引里
         ih->insert_entry(key, rm_scan.rid(), context->txn_);
     }
-    // Store index handle
-    auto index_name = ix_manager_->get_index_name(tab_name, col_idx);
-    assert(ihs_.count(index_name) == 0);
-    // ihs_[index_name] = std::move(ih);
-    ihs_.emplace(index_name, std::move(ih));
     // Mark column index as created
+    catalog_.append_set_index(tab.id, col_idx, true);
     col->index = true;
+    catalog_version_++;
 }
 
 void SmManager::drop_index(const std::string &tab_name, const std::string &col_name, Context *context) {
-    TabMeta &tab = db_.tabs_[tab_name];
+    TabMeta &tab = db_.get_table(tab_name);
     auto col = tab.get_col(col_name);
     if (!col->index) {
         throw IndexNotFoundError(tab_name, col_name);
     }
-    context->lock_mgr_->LockExclusiveOnTable(context->txn_,fhs_[tab_name].get()->GetFd());
+    context->lock_mgr_->LockExclusiveOnTable(context->txn_,tab.id);
     int col_idx = col - tab.cols.begin();
-    auto index_name = ix_manager_->get_index_name(tab_name, col_idx);
-    ix_manager_->close_index(ihs_.at(index_name).get());
+    ihs_.erase(ix_manager_->get_index_name(tab_name, col_idx));
     ix_manager_->destroy_index(tab_name, col_idx);
-    ihs_.erase(index_name);
+    catalog_.append_set_index(tab.id, col_idx, false);
     col->index = false;
+    catalog_version_++;
+}
+
+void SmManager::analyze_table(const std::string &tab_name, Context *context) {
+    std::unique_lock<std::mutex> stats_guard(stats_latch_);
+    TabMeta &tab = db_.get_table(tab_name);
+    auto file_handle = get_file_handle(tab_name);
+    Transaction txn(INVALID_TXN_ID, IsolationLevel::READ_UNCOMMITTED);
+    Context read_context(nullptr, nullptr, &txn);
+    std::shared_ptr<const TabStats> stats = collect_table_stats(file_handle.get(), tab, &read_context);
+    catalog_.append_set_stats(tab.id, *stats);
+    // 统计信息的版本变化, 用到这张表的执行计划按新的统计信息重新生成
+    tab.stats->set(stats);
+    stats_guard.unlock();
+    if (context == nullptr) {
+        return;
+    }
+    std::vector<std::string> captions = {"Field", "Distinct", "Min", "Max"};
+    RecordPrinter printer(captions.size());
+    printer.print_separator(context);
+    printer.print_record(captions, context);
+    printer.print_separator(context);
+    auto val2str = [](const std::string &val, const ColMeta &col) -> std::string {
+        if (val.empty()) {
+            return "";
+        } else if (col.type == TYPE_INT) {
+            return std::to_string(*(const int *)val.data());
+        } else if (col.type == TYPE_FLOAT) {
+            return std::to_string(*(const float *)val.data());
+        }
+        return std::string(val.c_str());
+    };
+    for (size_t i = 0; i < tab.cols.size(); i++) {
+        auto &col_stats = stats->cols[i];
+        printer.print_record({tab.cols[i].name, std::to_string(col_stats.num_distinct),
+                              val2str(col_stats.min_val, tab.cols[i]), val2str(col_stats.max_val, tab.cols[i])},
+                             context);
+    }
+    printer.print_separator(context);
+    if (context->writer_ != nullptr) {
+        context->writer_->write("Analyzed " + std::to_string(stats->num_rows) + " record(s) in " +
+                                std::to_string(stats->num_pages) + " page(s)\n");
+    }
+}
+
+void SmManager::record_modifications(const std::string &tab_name, int64_t num_inserted, int64_t num_deleted,
+                                     int64_t num_updated) {
+    TabMeta &tab = db_.get_table(tab_name);
+    auto table_stats = tab.stats;
+    table_stats->add_modified(num_inserted, num_deleted, num_updated);
+    if (!table_stats->is_stale() || !table_stats->try_begin_analyze()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(analyze_thread_latch_);
+        if (enable_analyze_thread_) {
+            analyze_queue_.emplace_back(tab_name, table_stats);
+            analyze_thread_cv_.notify_one();
+            return;
+        }
+    }
+    table_stats->end_analyze();
+}
+
+void SmManager::start_analyze_thread() {
+    std::lock_guard<std::mutex> guard(analyze_thread_latch_);
+    if (enable_analyze_thread_) {
+        return;
+    }
+    enable_analyze_thread_ = true;
+    analyze_thread_ = std::thread([this] {
+        std::unique_lock<std::mutex> lock(analyze_thread_latch_);
+        while (true) {
+            analyze_thread_cv_.wait(lock, [this] { return !enable_analyze_thread_ || !analyze_queue_.empty(); });
+            if (!enable_analyze_thread_) {
+                break;
+            }
+            auto [tab_name, table_stats] = std::move(analyze_queue_.front());
+            analyze_queue_.pop_front();
+            lock.unlock();
+            try {
+                analyze_table(tab_name, nullptr);
+                auto_analyze_count_++;
+            } catch (RedBaseError &) {
+                // 表已经被删除
+            }
+            table_stats->end_analyze();
+            lock.lock();
+        }
+        for (auto &entry : analyze_queue_) {
+            entry.second->end_analyze();
+        }
+        analyze_queue_.clear();
+    });
+}
+
+void SmManager::stop_analyze_thread() {
+    {
+        std::lock_guard<std::mutex> guard(analyze_thread_latch_);
+        if (!enable_analyze_thread_) {
+            return;
+        }
+        enable_analyze_thread_ = false;
+    }
+    analyze_thread_cv_.notify_all();
+    analyze_thread_.join();
+}
+
+void SmManager::recover_indexes() {
+    // 读未提交的事务读记录时不加锁
+    Transaction txn(INVALID_TXN_ID, IsolationLevel::READ_UNCOMMITTED);
+    Context context(nullptr, nullptr, &txn);
+    for (auto &entry : db_.tabs_) {
+        auto &tab = entry.second;
+        for (size_t col_idx = 0; col_idx < tab.cols.size(); col_idx++) {
+            auto &col = tab.cols[col_idx];
+            if (!col.index) {
+                continue;
+            }
+            auto file_handle = get_file_handle(tab.name);
+            ihs_.erase(ix_manager_->get_index_name(tab.name, col_idx));
+            ix_manager_->destroy_index(tab.name, col_idx);
+            ix_manager_->create_index(tab.name, col_idx, col.type, col.len);
+            auto ih = get_index_handle(tab.name, col_idx);
+            for (RmScan rm_scan(file_handle.get()); !rm_scan.is_end(); rm_scan.next()) {
+                auto rec = file_handle->get_record(rm_scan.rid(), &context);
+                ih->insert_entry(rec->data + col.offset, rm_scan.rid(), &txn);
+            }
+        }
+    }
+    catalog_version_++;
 }
 void SmManager::rollback_insert(const std::string &tab_name, const Rid &rid, Context *context){
-        auto rm_handler=fhs_[tab_name].get();
+        auto rm_handler=get_file_handle(tab_name);
         int cnt=0;
-        auto tb=db_.get_table(tab_name);
-        for(auto col:tb.cols){
+        auto &tb=db_.get_table(tab_name);
+        for(auto &col:tb.cols){
             if(col.index){
-                auto idx_handler=ihs_[get_ix_manager()->get_index_name(tab_name,cnt)].get();
+                auto idx_handler=get_index_handle(tab_name,cnt);
                 auto record=rm_handler->get_record(rid,context);
                 auto key=record.get()->data+col.offset;
                 idx_handler->delete_entry(key,context->txn_);
@@ -252,33 +371,35 @@ void SmManager::rollback_insert(const std::string &tab_name, const Rid &rid, Con
             cnt++;
         }
         rm_handler->delete_record(rid,context);
+        tb.stats->add_modified(0, 1, 0);
 }
 void SmManager::rollback_delete(const std::string &tab_name, const RmRecord &record, Context *context){
-        auto rm_handler=fhs_[tab_name].get();
+        auto rm_handler=get_file_handle(tab_name);
         int cnt=0;
         auto rid=rm_handler->insert_record(record.data,context);
-        auto tb=db_.get_table(tab_name);
-        for(auto col:tb.cols){
+        auto &tb=db_.get_table(tab_name);
+        for(auto &col:tb.cols){
             if(col.index){
-                auto idx_handler=ihs_[get_ix_manager()->get_index_name(tab_name,cnt)].get();
+                auto idx_handler=get_index_handle(tab_name,cnt);
                 auto key=record.data+col.offset;
                 idx_handler->insert_entry(key,rid,context->txn_);
             }
             cnt++;
         }
+        tb.stats->add_modified(1, 0, 0);
 }
 
 void SmManager::rollback_update(const std::string &tab_name, const Rid &rid, const RmRecord &record, Context *context)
 {
-        auto rm_handler=fhs_[tab_name].get();
+        auto rm_handler=get_file_handle(tab_name);
         int cnt=0;
 
-        auto pre_record=rm_handler->get_record(rid,context).get();
+        auto pre_record=rm_handler->get_record(rid,context);
 
-        auto tb=db_.get_table(tab_name);
-        for(auto col:tb.cols){
+        auto &tb=db_.get_table(tab_name);
+        for(auto &col:tb.cols){
             if(col.index){
-                auto idx_handler=ihs_[get_ix_manager()->get_index_name(tab_name,cnt)].get();
+                auto idx_handler=get_index_handle(tab_name,cnt);
                 auto key=record.data+col.offset;
                 auto pre_key=pre_record->data+col.offset;
                 idx_handler->delete_entry(pre_key,context->txn_);
@@ -287,4 +408,5 @@ void SmManager::rollback_update(const std::string &tab_name, const Rid &rid, con
             cnt++;
         }
         rm_handler->update_record(rid,record.data,context);
+        tb.stats->add_modified(0, 0, 1);
 }
\ No newline at end of file
@@ -1,10 +1,19 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #include "index/ix.h"
 // #include "record/rm.h"
 #include "common/context.h"
 #include "record/rm_file_handle.h"
+#include "record/rm_manager.h"
+#include "sm_catalog.h"
 #include "sm_defs.h"
+#include "sm_handle_cache.h"
 #include "sm_meta.h"
 
 class Context;
@@ -20,18 +29,27 @@ struct ColDef {
 // 每个SmManager对应一个db
 class SmManager {
    public:
-    DbMeta db_;  // create_db时将会将DbMeta写入文件，open_db时将会从文件中读出DbMeta
-    std::unordered_map<std::string, std::unique_ptr<RmFileHandle>> fhs_;   // file name -> record file handle
-    std::unordered_map<std::string, std::unique_ptr<IxIndexHandle>> ihs_;  // file name -> index file handle
+    DbMeta db_;  // create_db时将会将DbMeta写入文件，open_db时将会从文件中读出DbMeta, DDL时追加修改
    private:
     DiskManager *disk_manager_;
     BufferPoolManager *buffer_pool_manager_;
     RmManager *rm_manager_;
     IxManager *ix_manager_;
+    std::atomic<uint64_t> catalog_version_{0};  // 每次DDL后加一, 缓存的执行计划据此判断是否失效
+    CatalogFile catalog_;                       // 打开的数据库的系统目录文件
+    std::atomic<uint64_t> auto_analyze_count_{0};
+    // 修改过多的表由后台线程重新收集统计信息, 触发它的DML语句不等待收集, 也不在收集期间持有锁
+    std::thread analyze_thread_;
+    std::mutex analyze_thread_latch_;                // 保护analyze_queue_和enable_analyze_thread_
+    std::condition_variable analyze_thread_cv_;      // 有表需要收集或者停止后台线程时唤醒它
+    std::deque<std::pair<std::string, std::shared_ptr<TableStatistics>>> analyze_queue_;
+    bool enable_analyze_thread_ = false;
+    std::mutex stats_latch_;  // 收集统计信息期间持有, 删除表时等待正在进行的收集结束
+    // open_db时不打开任何文件, 记录文件和索引文件在第一次访问时打开, 分别最多保持MAX_OPEN_FILES个不用的文件打开
+    HandleCache<RmFileHandle> fhs_;   // file name -> record file handle
+    HandleCache<IxIndexHandle> ihs_;  // file name -> index file handle
     // TODO: 全部改成私有变量，并且改成指针形式
     // DbMeta *db_;
-    // std::map<std::string, std::unique_ptr<RmFileHandle>> *fhs_;
-    // std::map<std::string, std::unique_ptr<IxIndexHandle>> *ihs_;
 
    public:
     SmManager(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, RmManager *rm_manager,
@@ -39,20 +57,34 @@ class SmManager {
         : disk_manager_(disk_manager),
           buffer_pool_manager_(buffer_pool_manager),
           rm_manager_(rm_manager),
-          ix_manager_(ix_manager) {
+          ix_manager_(ix_manager),
+          fhs_(MAX_OPEN_FILES, [rm_manager](RmFileHandle *fh) { rm_manager->close_file(fh); }),
+          ihs_(MAX_OPEN_FILES, [ix_manager](IxIndexHandle *ih) { ix_manager->close_index(ih); }) {
         // db_ = new DbMeta();
     }
 
     ~SmManager() {
         // delete db_;
+        stop_analyze_thread();
     }
 
     // TODO: Get private variables （注意，这里的get方法都必须返回指针，否则上层调用会出问题）
     // DbMeta *get_db() { return db_; }
 
-    // std::map<std::string, std::unique_ptr<RmFileHandle>> *get_fhs() { return fhs_; }
+    /**
+     * @brief 表的记录文件句柄, 没有打开时先打开
+     * 持有返回的句柄期间文件不会被关闭; 句柄的fd在文件关闭后可能改变, 锁和版本链用表的编号
+     */
+    std::shared_ptr<RmFileHandle> get_file_handle(const std::string &tab_name);
+
+    /**
+     * @brief 表的第col_idx列上的索引的句柄, 没有打开时先打开
+     */
+    std::shared_ptr<IxIndexHandle> get_index_handle(const std::string &tab_name, int col_idx);
+
+    HandleCacheStats file_handle_stats() { return fhs_.stats(); }
 
-    // std::map<std::string, std::unique_ptr<IxIndexHandle>> *get_ihs() { return ihs_; }
+    HandleCacheStats index_handle_stats() { return ihs_.stats(); }
 
     RmManager *get_rm_manager() { return rm_manager_; }  // called in some excutors to modify record
 
@@ -60,6 +92,8 @@ class SmManager {
 
     BufferPoolManager *get_bpm() { return buffer_pool_manager_; }
 
+    uint64_t get_catalog_version() const { return catalog_version_.load(); }
+
     // Database management
     bool is_dir(const std::string &db_name);
 
@@ -89,6 +123,36 @@ class SmManager {
 
     void apply_drop_index(const std::string &tab_name, const std::string &col_name, Context *context);
 
+    // Statistics management
+    /**
+     * @brief 收集表的统计信息并写入系统目录, context不为nullptr时输出每一列的统计信息
+     * @details 读记录时不加锁, 统计信息本来就是近似的, 不阻塞对表的修改; 收集期间持有stats_latch_, 表不会被删除
+     */
+    void analyze_table(const std::string &tab_name, Context *context);
+
+    /**
+     * @brief 记录DML修改的行数, ANALYZE之后修改的行数超过阈值时交给后台线程重新收集表的统计信息
+     */
+    void record_modifications(const std::string &tab_name, int64_t num_inserted, int64_t num_deleted,
+                              int64_t num_updated);
+
+    // 因为修改过多而自动重新收集统计信息的次数
+    uint64_t auto_analyze_count() const { return auto_analyze_count_.load(); }
+
+   private:
+    // open_db时启动, close_db时停止, 停止时还没有收集的表被放弃
+    void start_analyze_thread();
+
+    void stop_analyze_thread();
+
+   public:
+
+    /**
+     * @brief 故障恢复之后根据记录文件重建所有索引
+     * @details 索引的修改不写日志, 故障前写回磁盘的索引页面可能和恢复后的记录不一致
+     */
+    void recover_indexes();
+
     // Transaction rollback management
     /**
      * @brief rollback the insert operation
@@ -1,13 +1,13 @@
 #pragma once
 
-#include <algorithm>
-#include <iostream>
-#include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "errors.h"
 #include "sm_defs.h"
+#include "sm_stats.h"
 
 struct ColMeta {
     std::string tab_name;  // 字段所属表名称
@@ -16,21 +16,42 @@ struct ColMeta {
     int len;               // 字段长度
     int offset;            // 字段位于记录中的偏移量
     bool index;            // 该字段上是否建立索引
-
-    friend std::ostream &operator<<(std::ostream &os, const ColMeta &col) {
-        // ColMeta中有各个基本类型的变量，然后调用重载的这些变量的操作符<<（具体实现逻辑在defs.h）
-        return os << col.tab_name << ' ' << col.name << ' ' << col.type << ' ' << col.len << ' ' << col.offset << ' '
-                  << col.index;
-    }
-
-    friend std::istream &operator>>(std::istream &is, ColMeta &col) {
-        return is >> col.tab_name >> col.name >> col.type >> col.len >> col.offset >> col.index;
-    }
 };
 
 struct TabMeta {
+    int id = 0;  // 表的编号, 和记录文件头中的tab_id相同
     std::string name;
-    std::vector<ColMeta> cols;
+    std::vector<ColMeta> cols;  // 列的编号就是它在cols中的下标, 索引文件按列的编号命名
+    std::shared_ptr<TableStatistics> stats = std::make_shared<TableStatistics>();  // ANALYZE收集的统计信息
+
+    /**
+     * @brief 建立列名到列的编号的哈希表, cols确定之后调用
+     * 哈希表建好之后不再修改, 复制TabMeta时共享同一个哈希表
+     */
+    void build_col_ids() {
+        auto col_ids = std::make_shared<std::unordered_map<std::string, size_t>>();
+        for (size_t i = 0; i < cols.size(); i++) {
+            col_ids->emplace(cols[i].name, i);
+        }
+        col_ids_ = std::move(col_ids);
+    }
+
+    /**
+     * @brief 根据列名查找列的编号
+     * @return 没有这个列时返回cols.size()
+     */
+    size_t find_col(const std::string &col_name) const {
+        // 没有建立哈希表, 或者之后cols又被修改过时逐个比较
+        if (col_ids_ != nullptr && col_ids_->size() == cols.size()) {
+            auto it = col_ids_->find(col_name);
+            return it == col_ids_->end() ? cols.size() : it->second;
+        }
+        size_t i = 0;
+        while (i < cols.size() && cols[i].name != col_name) {
+            i++;
+        }
+        return i;
+    }
 
     /**
      * @brief 根据列名在本表元数据结构体中查找是否有该名字的列
@@ -39,57 +60,29 @@ struct TabMeta {
      * @return true
      * @return false
      */
-    bool is_col(const std::string &col_name) const {
-        // lab3 task1 Todo
-        for(auto i:cols){
-            if(i.name==col_name)return true;
-        }
-        return false;
-        // lab3 task1 Todo End
-    }
+    bool is_col(const std::string &col_name) const { return find_col(col_name) < cols.size(); }
+
     /**
      * @brief 根据列名获得列元数据ColMeta
      *
      * @param col_name 目标列名
-     * @return std::vector<ColMeta>::iterator
+     * @return std::vector<ColMeta>::iterator, 没有这个列时返回cols.end()
      */
-    std::vector<ColMeta>::iterator get_col(const std::string &col_name) {
-        // lab3 task1 Todo
-        std::vector<ColMeta>::iterator it;
-        for(it=cols.begin();it!=cols.end();it++){
-            if(it->name==col_name)return it;
-        }
-        return it;
-        // lab3 task1 Todo End
-    }
+    std::vector<ColMeta>::iterator get_col(const std::string &col_name) { return cols.begin() + find_col(col_name); }
 
-    friend std::ostream &operator<<(std::ostream &os, const TabMeta &tab) {
-        os << tab.name << '\n' << tab.cols.size() << '\n';
-        for (auto &col : tab.cols) {
-            os << col << '\n';  // col是ColMeta类型，然后调用重载的ColMeta的操作符<<
-        }
-        return os;
-    }
-
-    friend std::istream &operator>>(std::istream &is, TabMeta &tab) {
-        size_t n;
-        is >> tab.name >> n;
-        for (size_t i = 0; i < n; i++) {
-            ColMeta col;
-            is >> col;
-            tab.cols.push_back(col);
-        }
-        return is;
-    }
+   private:
+    std::shared_ptr<const std::unordered_map<std::string, size_t>> col_ids_;
 };
 
-// 注意重载了操作符 << 和 >>，这需要更底层同样重载TabMeta、ColMeta的操作符 << 和 >>
+// 系统目录在磁盘上的格式见CatalogFile
 class DbMeta {
     friend class SmManager;
+    friend class CatalogFile;
 
    private:
-    std::string name_;                     // 数据库名称
-    std::map<std::string, TabMeta> tabs_;  // 数据库内的表名称和元数据的映射
+    std::string name_;                               // 数据库名称
+    std::unordered_map<std::string, TabMeta> tabs_;  // 数据库内的表名称和元数据的映射
+    int next_tab_id_ = 1;                            // 下一个新建的表的编号, 编号不会重复使用
 
    public:
     // DbMeta(std::string name) : name_(name) {}
@@ -104,23 +97,6 @@ class DbMeta {
         return pos->second;
     }
 
-    // 重载操作符 <<
-    friend std::ostream &operator<<(std::ostream &os, const DbMeta &db_meta) {
-        os << db_meta.name_ << '\n' << db_meta.tabs_.size() << '\n';
-        for (auto &entry : db_meta.tabs_) {
-            os << entry.second << '\n';  // entry.second是TabMeta类型，然后调用重载的TabMeta的操作符<<
-        }
-        return os;
-    }
-
-    friend std::istream &operator>>(std::istream &is, DbMeta &db_meta) {
-        size_t n;
-        is >> db_meta.name_ >> n;
-        for (size_t i = 0; i < n; i++) {
-            TabMeta tab;
-            is >> tab;
-            db_meta.tabs_[tab.name] = tab;
-        }
-        return is;
-    }
+    // 所有表的表名和元数据
+    const std::unordered_map<std::string, TabMeta> &get_tables() const { return tabs_; }
 };
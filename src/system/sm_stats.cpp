@@ -0,0 +1,150 @@
+#include "sm_stats.h"
+
+#include <cmath>
+#include <iterator>
+#include <numeric>
+#include <random>
+
+#include "common/hyperloglog.h"
+#include "index/ix.h"
+#include "record/rm.h"
+#include "sm_meta.h"
+
+namespace {
+
+// 直方图桶内按数值线性插值, 字符串没有数值, 按桶的一半估计
+bool to_number(const std::string &val, ColType type, double *number) {
+    if (type == TYPE_INT) {
+        *number = *reinterpret_cast<const int *>(val.data());
+    } else if (type == TYPE_FLOAT) {
+        *number = *reinterpret_cast<const float *>(val.data());
+    } else {
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool TableStatistics::is_stale() const {
+    int64_t num_rows = std::max<int64_t>(estimate_rows(), 0);
+    return num_modified_ > STATS_STALE_MIN_ROWS + num_rows * STATS_STALE_PERCENT / 100;
+}
+
+double ColStats::eq_selectivity(const char *val, ColType type, int len) const {
+    if (bounds.empty() || ix_compare(val, min_val.data(), type, len) < 0 ||
+        ix_compare(val, max_val.data(), type, len) > 0) {
+        return 0;
+    }
+    // 一个值是多个桶的上界时, 它至少占了这些桶的行数
+    size_t num_buckets = 0;
+    for (auto &bound : bounds) {
+        num_buckets += ix_compare(val, bound.data(), type, len) == 0;
+    }
+    double frac = num_distinct > 0 ? 1.0 / num_distinct : 1.0;
+    return std::max(frac, static_cast<double>(num_buckets) / bounds.size());
+}
+
+double ColStats::lt_selectivity(const char *val, ColType type, int len, bool inclusive) const {
+    if (bounds.empty() || ix_compare(val, min_val.data(), type, len) < 0) {
+        return 0;
+    }
+    if (ix_compare(val, max_val.data(), type, len) > 0) {
+        return 1;
+    }
+    // 第一个上界不小于val的桶, 之前的桶中的值都小于val
+    size_t bucket = 0;
+    while (bucket < bounds.size() && ix_compare(bounds[bucket].data(), val, type, len) < 0) {
+        bucket++;
+    }
+    double frac_in_bucket = 0.5;
+    const std::string &lower = bucket == 0 ? min_val : bounds[bucket - 1];
+    double lo, hi, x;
+    if (bucket < bounds.size() && to_number(lower, type, &lo) && to_number(bounds[bucket], type, &hi) &&
+        to_number(std::string(val, len), type, &x) && hi > lo) {
+        frac_in_bucket = (x - lo) / (hi - lo);
+    }
+    double frac = (bucket + frac_in_bucket) / bounds.size();
+    if (inclusive) {
+        frac += eq_selectivity(val, type, len);
+    }
+    return std::min(std::max(frac, 0.0), 1.0);
+}
+
+std::shared_ptr<TabStats> collect_table_stats(RmFileHandle *file_handle, const TabMeta &tab, Context *context) {
+    auto stats = std::make_shared<TabStats>();
+    stats->num_pages = file_handle->get_file_hdr().num_pages - 1;
+    stats->cols.resize(tab.cols.size());
+    if (stats->num_pages <= 0) {
+        return stats;
+    }
+    std::mt19937_64 rng(std::random_device{}());
+    std::unique_ptr<RmScan> scan;
+    int64_t num_sampled_pages = stats->num_pages;
+    if (stats->num_pages > static_cast<int64_t>(STATS_SAMPLE_PAGES)) {
+        std::vector<int> all_pages(stats->num_pages);
+        std::iota(all_pages.begin(), all_pages.end(), 1);
+        std::vector<int> page_nos;
+        page_nos.reserve(STATS_SAMPLE_PAGES);
+        // std::sample保持原来的顺序, 页面按编号递增访问
+        std::sample(all_pages.begin(), all_pages.end(), std::back_inserter(page_nos), STATS_SAMPLE_PAGES, rng);
+        num_sampled_pages = page_nos.size();
+        scan = std::make_unique<RmScan>(file_handle, std::move(page_nos));
+    } else {
+        scan = std::make_unique<RmScan>(file_handle);
+    }
+
+    size_t num_cols = tab.cols.size();
+    std::vector<HyperLogLog> distinct(num_cols);
+    std::vector<std::vector<std::string>> samples(num_cols);  // 蓄水池抽样的值, 每一列抽取相同的行
+    int64_t num_seen = 0;
+    for (; !scan->is_end(); scan->next()) {
+        auto rec = file_handle->get_record(scan->rid(), context);
+        num_seen++;
+        // 前STATS_SAMPLE_VALUES行全部保留, 之后第n行以STATS_SAMPLE_VALUES/n的概率替换一个
+        int64_t slot = num_seen <= static_cast<int64_t>(STATS_SAMPLE_VALUES)
+                           ? num_seen - 1
+                           : std::uniform_int_distribution<int64_t>(0, num_seen - 1)(rng);
+        for (size_t i = 0; i < num_cols; i++) {
+            auto &col = tab.cols[i];
+            auto &col_stats = stats->cols[i];
+            const char *val = rec->data + col.offset;
+            distinct[i].add(val, col.len);
+            if (col_stats.min_val.empty() || ix_compare(val, col_stats.min_val.data(), col.type, col.len) < 0) {
+                col_stats.min_val.assign(val, col.len);
+            }
+            if (col_stats.max_val.empty() || ix_compare(val, col_stats.max_val.data(), col.type, col.len) > 0) {
+                col_stats.max_val.assign(val, col.len);
+            }
+            if (slot < static_cast<int64_t>(samples[i].size())) {
+                samples[i][slot].assign(val, col.len);
+            } else if (slot == static_cast<int64_t>(samples[i].size())) {
+                samples[i].emplace_back(val, col.len);
+            }
+        }
+    }
+
+    bool sampled = num_sampled_pages < stats->num_pages;
+    stats->num_rows = sampled ? std::llround(static_cast<double>(num_seen) * stats->num_pages / num_sampled_pages)
+                              : num_seen;
+    for (size_t i = 0; i < num_cols; i++) {
+        auto &col = tab.cols[i];
+        auto &col_stats = stats->cols[i];
+        double num_distinct = std::min(distinct[i].estimate(), static_cast<double>(num_seen));
+        // 抽样中几乎没有重复值时认为这一列接近唯一, 不同值个数随行数放大; 否则认为抽样已经见过大部分不同值
+        if (sampled && num_distinct > 0.9 * num_seen) {
+            num_distinct = num_distinct * stats->num_rows / num_seen;
+        }
+        col_stats.num_distinct = std::min<int64_t>(std::max<int64_t>(std::llround(num_distinct), num_seen > 0),
+                                                   stats->num_rows);
+        auto &vals = samples[i];
+        std::sort(vals.begin(), vals.end(), [&](const std::string &a, const std::string &b) {
+            return ix_compare(a.data(), b.data(), col.type, col.len) < 0;
+        });
+        size_t num_buckets = std::min(STATS_HISTOGRAM_BUCKETS, vals.size());
+        for (size_t b = 0; b < num_buckets; b++) {
+            col_stats.bounds.push_back(vals[(b + 1) * vals.size() / num_buckets - 1]);
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sm_defs.h"
+
+class Context;
+class RmFileHandle;
+struct TabMeta;
+
+/**
+ * @brief 一列的统计信息, 值都是列的原始字节(长度为列的len), 按ix_compare的顺序比较
+ */
+struct ColStats {
+    int64_t num_distinct = 0;          // 不同值个数的估计
+    std::string min_val;               // 表为空时为空串
+    std::string max_val;
+    std::vector<std::string> bounds;   // 等深直方图每个桶的上界, 升序, 每个桶的行数相同; 第一个桶的下界是min_val
+
+    /**
+     * @brief 估计等于val的行所占的比例
+     */
+    double eq_selectivity(const char *val, ColType type, int len) const;
+
+    /**
+     * @brief 估计小于val(inclusive为true时小于等于)的行所占的比例
+     */
+    double lt_selectivity(const char *val, ColType type, int len, bool inclusive) const;
+};
+
+struct TabStats {
+    int64_t num_rows = 0;
+    int64_t num_pages = 0;        // 数据页的个数, 不含文件头页
+    std::vector<ColStats> cols;   // 下标是列的编号
+};
+
+/**
+ * @brief 一张表最近一次ANALYZE的统计信息, 以及之后修改过的行数, TabMeta的所有副本共享同一个对象
+ * @details 统计信息收集好之后不再修改, 整体替换, 读者拿到的shared_ptr一直有效
+ */
+class TableStatistics {
+   public:
+    // 没有收集过时返回nullptr
+    std::shared_ptr<const TabStats> get() const { return std::atomic_load(&stats_); }
+
+    // 替换统计信息, 修改计数清零
+    void set(std::shared_ptr<const TabStats> stats) {
+        std::atomic_store(&stats_, std::move(stats));
+        num_inserted_ = 0;
+        num_deleted_ = 0;
+        num_modified_ = 0;
+        version_++;
+    }
+
+    /**
+     * @brief 每次set加一; 执行计划在读取统计信息之前记录各个表的版本, 只有用到重新收集的表的计划需要重新生成
+     */
+    uint64_t version() const { return version_.load(); }
+
+    void add_modified(int64_t num_inserted, int64_t num_deleted, int64_t num_updated) {
+        num_inserted_ += num_inserted;
+        num_deleted_ += num_deleted;
+        num_modified_ += num_inserted + num_deleted + num_updated;
+    }
+
+    /**
+     * @brief 按ANALYZE之后插入和删除的行数修正的行数, 没有统计信息时返回-1
+     */
+    int64_t estimate_rows() const {
+        auto stats = get();
+        if (stats == nullptr) {
+            return -1;
+        }
+        return std::max<int64_t>(stats->num_rows + num_inserted_ - num_deleted_, 0);
+    }
+
+    /**
+     * @brief 修改过的行数超过STATS_STALE_MIN_ROWS加上行数的STATS_STALE_PERCENT%时需要重新收集
+     */
+    bool is_stale() const;
+
+    /**
+     * @brief 同一张表同时只进行一次自动收集, 返回false表示其他线程正在收集
+     */
+    bool try_begin_analyze() { return !analyzing_.exchange(true); }
+
+    void end_analyze() { analyzing_ = false; }
+
+   private:
+    std::shared_ptr<const TabStats> stats_;
+    std::atomic<int64_t> num_inserted_{0};
+    std::atomic<int64_t> num_deleted_{0};
+    std::atomic<int64_t> num_modified_{0};
+    std::atomic<bool> analyzing_{false};
+    std::atomic<uint64_t> version_{0};
+};
+
+/**
+ * @brief 扫描记录文件, 收集表和每一列的统计信息
+ * @details 数据页超过STATS_SAMPLE_PAGES时随机抽取STATS_SAMPLE_PAGES个页面扫描, 行数和不同值个数按比例放大.
+ * 不同值个数用HyperLogLog估计, 直方图由最多STATS_SAMPLE_VALUES个蓄水池抽样的值排序得到
+ * @param context 读取记录用的上下文, 调用者决定是否加锁
+ */
+std::shared_ptr<TabStats> collect_table_stats(RmFileHandle *file_handle, const TabMeta &tab, Context *context);
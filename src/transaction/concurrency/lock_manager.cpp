@@ -1,406 +1,487 @@
 #include "lock_manager.h"
-#include <shared_mutex>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+
+#include "common/thread_pool.h"
+
+std::chrono::milliseconds cycle_detection_interval = std::chrono::milliseconds(50);
+std::chrono::milliseconds lock_wait_timeout = std::chrono::seconds(50);
 
 /**
  * 申请行级读锁
  * @param txn 要申请锁的事务对象指针
  * @param rid 加锁的目标记录ID
- * @param tab_fd 记录所在的表的fd
+ * @param tab_id 记录所在的表的编号
  * @return 返回加锁是否成功
  */
-bool LockManager::LockSharedOnRecord(Transaction *txn, const Rid &rid, int tab_fd) {
-    // Todo:
-    // 1. 通过mutex申请访问全局锁表
-    // 2. 检查事务的状态
-    // 3. 查找当前事务是否已经申请了目标数据项上的锁，如果存在则根据锁类型进行操作，否则执行下一步操作
-    // 4. 将要申请的锁放入到全局锁表中，并通过组模式来判断是否可以成功授予锁
-    // 5. 如果成功，更新目标数据项在全局锁表中的信息，否则阻塞当前操作
-    // 提示：步骤5中的阻塞操作可以通过条件变量来完成，
-    //所有加锁操作都遵循上述步骤，在下面的加锁操作中不再进行注释提示
-    if(txn->GetState()!=TransactionState::GROWING&&txn->GetState()!=TransactionState::DEFAULT){
-        assert(0);
-        return false;
-    }
-    txn->SetState(TransactionState::GROWING);
-    auto lock_data_id=new LockDataId(tab_fd,rid,LockDataType::RECORD);
-    std::unique_lock<std::mutex> lock(latch_);
-    auto lock_set=txn->GetLockSet();
-
-    for(auto lock:*lock_set){
-        if(lock.fd_==tab_fd&&lock.rid_==rid){
-            //一定会是读or写锁，所以不用判断直接return
-            return true;
-        }
-    }
-
-    while(lock_table_[*lock_data_id].group_lock_mode_!=GroupLockMode::S&&
-        lock_table_[*lock_data_id].group_lock_mode_!=GroupLockMode::NON_LOCK
-    ){
-        lock_table_[*lock_data_id].cv_.wait(lock);
-    }
-    lock_table_[*lock_data_id].group_lock_mode_=GroupLockMode::S;
-    lock_table_[*lock_data_id].shared_lock_num_++;
-    auto lock_request=new LockRequest(txn->GetTransactionId(),LockMode::SHARED);
-    lock_table_[*lock_data_id].request_queue_.push_back(*lock_request);
-    lock_table_[*lock_data_id].cv_.notify_all();
-    lock_set->insert(*lock_data_id);
-    return true;
+bool LockManager::LockSharedOnRecord(Transaction *txn, const Rid &rid, int tab_id) {
+    return Lock(txn, LockDataId(tab_id, rid, LockDataType::RECORD), LockMode::SHARED);
 }
 
 /**
  * 申请行级写锁
  * @param txn 要申请锁的事务对象指针
  * @param rid 加锁的目标记录ID
- * @param tab_fd 记录所在的表的fd
+ * @param tab_id 记录所在的表的编号
  * @return 返回加锁是否成功
  */
-bool LockManager::LockExclusiveOnRecord(Transaction *txn, const Rid &rid, int tab_fd) {
-    if(txn->GetState()!=TransactionState::GROWING&&txn->GetState()!=TransactionState::DEFAULT){
-        assert(0);
-        return false;
-    }
-    txn->SetState(TransactionState::GROWING);
-    auto lock_data_id=new LockDataId(tab_fd,rid,LockDataType::RECORD);
-    std::unique_lock<std::mutex> lock(latch_);
-    auto lock_set=txn->GetLockSet();
-    int my_shared_lock_cnt=0;
-    for(auto lock:*lock_set){
-        if(lock.fd_==tab_fd&&lock.rid_==rid){
-            for(auto i:lock_table_[*lock_data_id].request_queue_){
-                //如果是写锁就return，如果是读锁则记录
-                if(i.txn_id_==txn->GetTransactionId()){
-                    if(i.lock_mode_==LockMode::EXLUCSIVE){
-                        return true;
-                    }
-                    else{
-                        my_shared_lock_cnt++;//最多只有一个
-                    }
-                    break;
-                }
-            }
-        }
-        break;
-    }
-    while(
-        lock_table_[*lock_data_id].group_lock_mode_!=GroupLockMode::NON_LOCK&&
-        my_shared_lock_cnt<lock_table_[*lock_data_id].request_queue_.size()
-    ){
-        lock_table_[*lock_data_id].cv_.wait(lock);
-    }
-    lock_table_[*lock_data_id].group_lock_mode_=GroupLockMode::X;
-    if(!my_shared_lock_cnt){
-        auto lock_request=new LockRequest(txn->GetTransactionId(),LockMode::EXLUCSIVE);
-        lock_table_[*lock_data_id].request_queue_.push_back(*lock_request);
-        lock_set->insert(*lock_data_id);
-    }
-    else{
-        lock_table_[*lock_data_id].request_queue_.begin()->lock_mode_=LockMode::EXLUCSIVE;
-    }
-    lock_table_[*lock_data_id].cv_.notify_all();
-    return true;
+bool LockManager::LockExclusiveOnRecord(Transaction *txn, const Rid &rid, int tab_id) {
+    return Lock(txn, LockDataId(tab_id, rid, LockDataType::RECORD), LockMode::EXLUCSIVE);
 }
 
 /**
  * 申请表级读锁
  * @param txn 要申请锁的事务对象指针
- * @param tab_fd 目标表的fd
+ * @param tab_id 目标表的编号
  * @return 返回加锁是否成功
  */
-bool LockManager::LockSharedOnTable(Transaction *txn, int tab_fd) {
-    auto lock_data_id=new LockDataId(tab_fd,LockDataType::TABLE);
-    if(txn->GetState()!=TransactionState::GROWING&&txn->GetState()!=TransactionState::DEFAULT){
-        assert(0);
-        return false;
-    }
-    txn->SetState(TransactionState::GROWING);
-    std::unique_lock<std::mutex> lock(latch_);
-    auto lock_set=txn->GetLockSet();
-    int status=0;
-    for(auto lock:*lock_set){
-        if(lock.fd_==tab_fd){
-            //如果是X或者SIX或者S则return
-            //如果是IS或者IX则分别标记
-            for(auto i:lock_table_[*lock_data_id].request_queue_){
-                if(i.txn_id_==txn->GetTransactionId()){
-                    if(i.lock_mode_==LockMode::EXLUCSIVE||i.lock_mode_==LockMode::SHARED||
-                    i.lock_mode_==LockMode::S_IX){
-                        return true;
-                    }
-                    else{
-                        if(i.lock_mode_==LockMode::INTENTION_SHARED){
-                            status=1;
-                        }
-                        else if(i.lock_mode_==LockMode::INTENTION_EXCLUSIVE){
-                            status=2;
-                        }
-                        break;
-                    }
-                }
-            }
-            break;
-        }
-    }
-
-    while(lock_table_[*lock_data_id].group_lock_mode_!=GroupLockMode::S&&
-        lock_table_[*lock_data_id].group_lock_mode_!=GroupLockMode::IS&&
-        lock_table_[*lock_data_id].group_lock_mode_!=GroupLockMode::NON_LOCK&&
-        !((status==2)&&lock_table_[*lock_data_id].IX_lock_num_==1)
-    ){
-        lock_table_[*lock_data_id].cv_.wait(lock);
-    }
-    
-    if(status==0){
-        auto lock_request=new LockRequest(txn->GetTransactionId(),LockMode::SHARED);
-        lock_table_[*lock_data_id].request_queue_.push_back(*lock_request);
-        lock_set->insert(*lock_data_id);
-        lock_table_[*lock_data_id].group_lock_mode_=GroupLockMode::S;
-        lock_table_[*lock_data_id].shared_lock_num_++;
-    }
-    else if(status==1){
-        lock_table_[*lock_data_id].group_lock_mode_=GroupLockMode::S;
-        lock_table_[*lock_data_id].request_queue_.begin()->lock_mode_=LockMode::SHARED;
-        lock_table_[*lock_data_id].shared_lock_num_++;
-    }
-    else{
-        lock_table_[*lock_data_id].group_lock_mode_=GroupLockMode::SIX;
-        lock_table_[*lock_data_id].request_queue_.begin()->lock_mode_=LockMode::S_IX;
-        lock_table_[*lock_data_id].IX_lock_num_--;
-    }
-    lock_table_[*lock_data_id].cv_.notify_all();
-    return true;
+bool LockManager::LockSharedOnTable(Transaction *txn, int tab_id) {
+    return Lock(txn, LockDataId(tab_id, LockDataType::TABLE), LockMode::SHARED);
 }
 
 /**
  * 申请表级写锁
  * @param txn 要申请锁的事务对象指针
- * @param tab_fd 目标表的fd
+ * @param tab_id 目标表的编号
  * @return 返回加锁是否成功
  */
-bool LockManager::LockExclusiveOnTable(Transaction *txn, int tab_fd) {
-    auto lock_data_id=new LockDataId(tab_fd,LockDataType::TABLE);
-    if(txn->GetState()!=TransactionState::GROWING&&txn->GetState()!=TransactionState::DEFAULT){
-        assert(0);
-        return false;
-    }
-    txn->SetState(TransactionState::GROWING);
-    std::unique_lock<std::mutex> lock(latch_);
-    auto lock_set=txn->GetLockSet();
-    int status=0;
-    for(auto lock:*lock_set){
-        if(lock.fd_==tab_fd){
-            //如果是X则return
-            //如果其他则同一标记（无区别）
-            for(auto i:lock_table_[*lock_data_id].request_queue_){
-                if(i.txn_id_==txn->GetTransactionId()){
-                    if(i.lock_mode_==LockMode::EXLUCSIVE){
-                        return true;
-                    }
-                    else{
-                        status=1;
-                        break;
-                    }
-                }
-            }
-            break;
-        }
-    }
+bool LockManager::LockExclusiveOnTable(Transaction *txn, int tab_id) {
+    return Lock(txn, LockDataId(tab_id, LockDataType::TABLE), LockMode::EXLUCSIVE);
+}
 
-    while(lock_table_[*lock_data_id].group_lock_mode_!=GroupLockMode::NON_LOCK&&
-        status<lock_table_[*lock_data_id].request_queue_.size()
-    ){
-        lock_table_[*lock_data_id].cv_.wait(lock);
-    }
-    
-    if(status==0){
-        auto lock_request=new LockRequest(txn->GetTransactionId(),LockMode::EXLUCSIVE);
-        lock_table_[*lock_data_id].request_queue_.push_back(*lock_request);
-        lock_set->insert(*lock_data_id);
-        lock_table_[*lock_data_id].group_lock_mode_=GroupLockMode::X;
+/**
+ * 申请表级意向读锁
+ * @param txn 要申请锁的事务对象指针
+ * @param tab_id 目标表的编号
+ * @return 返回加锁是否成功
+ */
+bool LockManager::LockISOnTable(Transaction *txn, int tab_id) {
+    return Lock(txn, LockDataId(tab_id, LockDataType::TABLE), LockMode::INTENTION_SHARED);
+}
+
+/**
+ * 申请表级意向写锁
+ * @param txn 要申请锁的事务对象指针
+ * @param tab_id 目标表的编号
+ * @return 返回加锁是否成功
+ */
+bool LockManager::LockIXOnTable(Transaction *txn, int tab_id) {
+    return Lock(txn, LockDataId(tab_id, LockDataType::TABLE), LockMode::INTENTION_EXCLUSIVE);
+}
+
+/**
+ * 释放锁
+ * @param txn 要释放锁的事务对象指针
+ * @param lock_data_id 要释放的锁ID
+ * @return 返回解锁是否成功, 事务没有持有该锁时返回false
+ */
+bool LockManager::Unlock(Transaction *txn, LockDataId lock_data_id) {
+    if (txn->GetState() != TransactionState::SHRINKING && txn->GetState() != TransactionState::GROWING) {
+        return false;
     }
-    else if(status==1){
-        lock_table_[*lock_data_id].group_lock_mode_=GroupLockMode::X;
-        lock_table_[*lock_data_id].request_queue_.begin()->lock_mode_=LockMode::EXLUCSIVE;
+    txn->SetState(TransactionState::SHRINKING);
+    auto lock_set = txn->GetLockSet();
+    auto held = lock_set->find(lock_data_id);
+    if (held == lock_set->end() || held->second.released) {
+        return false;
     }
-    lock_table_[*lock_data_id].cv_.notify_all();
+    // 只做标记, 不从lock_set中删除, 提交和回滚时可以一边遍历lock_set一边解锁
+    Release(txn, held);
     return true;
 }
 
 /**
- * 申请表级意向读锁
+ * 申请锁, 已持有同样或更强的锁时直接返回, 持有较弱的锁时升级
  * @param txn 要申请锁的事务对象指针
- * @param tab_fd 目标表的fd
+ * @param lock_data_id 加锁的目标
+ * @param lock_mode 要申请的锁模式
  * @return 返回加锁是否成功
  */
-bool LockManager::LockISOnTable(Transaction *txn, int tab_fd) {
-    auto lock_data_id=new LockDataId(tab_fd,LockDataType::TABLE);
-    if(txn->GetState()!=TransactionState::GROWING&&txn->GetState()!=TransactionState::DEFAULT){
-        assert(0);
-        return false;
+bool LockManager::Lock(Transaction *txn, const LockDataId &lock_data_id, LockMode lock_mode) {
+    if (txn->GetState() != TransactionState::GROWING && txn->GetState() != TransactionState::DEFAULT) {
+        throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHIRINKING);
     }
     txn->SetState(TransactionState::GROWING);
-    std::unique_lock<std::mutex> lock(latch_);
-    auto lock_set=txn->GetLockSet();
-    for(auto lock:*lock_set){
-        if(lock.fd_==tab_fd){
-            //任意级别都>=IS,可以直接return
+
+    // 已授予的请求的模式只会被持有者自己修改, 不需要加分区锁就可以读
+    auto lock_set = txn->GetLockSet();
+    bool is_record = lock_data_id.type_ == LockDataType::RECORD;
+    if (is_record && escalation_threshold_ > 0) {
+        // 表锁已经包含了行锁的权限, 例如锁升级之后
+        auto table = lock_set->find(LockDataId(lock_data_id.tab_id_, LockDataType::TABLE));
+        if (table != lock_set->end() && !table->second.released &&
+            CoversRecords(table->second.request->lock_mode_, lock_mode)) {
             return true;
         }
     }
+    // 事务已经持有这个对象上的锁
+    auto held = lock_set->find(lock_data_id);
+    bool is_upgrade = held != lock_set->end() && !held->second.released;
+    if (is_upgrade && Covers(held->second.request->lock_mode_, lock_mode)) {
+        return true;
+    }
+    Acquire(txn, lock_data_id, lock_mode, held, true);
 
-    while(lock_table_[*lock_data_id].group_lock_mode_==GroupLockMode::X
-    ){
-        lock_table_[*lock_data_id].cv_.wait(lock);
+    if (is_record && escalation_threshold_ > 0) {
+        auto &row_locks = txn->GetRowLocks(lock_data_id.tab_id_);
+        if (!is_upgrade) {
+            row_locks.num_locks++;
+        }
+        if (lock_mode == LockMode::EXLUCSIVE) {
+            row_locks.num_exclusive++;
+        }
+        MaybeEscalate(txn, lock_data_id.tab_id_);
     }
-    auto lock_request=new LockRequest(txn->GetTransactionId(),LockMode::INTENTION_SHARED);
-    lock_table_[*lock_data_id].request_queue_.push_back(*lock_request);
-    lock_set->insert(*lock_data_id);
-    if(lock_table_[*lock_data_id].group_lock_mode_==GroupLockMode::NON_LOCK)
-        lock_table_[*lock_data_id].group_lock_mode_=GroupLockMode::IS;
-    lock_table_[*lock_data_id].cv_.notify_all();
     return true;
 }
 
-/**
- * 申请表级意向写锁
- * @param txn 要申请锁的事务对象指针
- * @param tab_fd 目标表的fd
- * @return 返回加锁是否成功
- */
-bool LockManager::LockIXOnTable(Transaction *txn, int tab_fd) {
-    auto lock_data_id=new LockDataId(tab_fd,LockDataType::TABLE);
-    if(txn->GetState()!=TransactionState::GROWING&&txn->GetState()!=TransactionState::DEFAULT){
-        assert(0);
-        return false;
-    }
-    txn->SetState(TransactionState::GROWING);
-    std::unique_lock<std::mutex> lock(latch_);
-    auto lock_set=txn->GetLockSet();
-    int status=0;
-    for(auto lock:*lock_set){
-        if(lock.fd_==tab_fd){
-            //如果是IX或者SIX或者X则return
-            //如果是IS或者S则分别标记
-            for(auto i:lock_table_[*lock_data_id].request_queue_){
-                if(i.txn_id_==txn->GetTransactionId()){
-                    if(i.lock_mode_==LockMode::EXLUCSIVE||i.lock_mode_==LockMode::INTENTION_EXCLUSIVE||
-                    i.lock_mode_==LockMode::S_IX){
-                        return true;
-                    }
-                    else{
-                        if(i.lock_mode_==LockMode::INTENTION_SHARED){
-                            status=1;
-                        }
-                        else if(i.lock_mode_==LockMode::SHARED){
-                            status=2;
-                        }
-                        break;
-                    }
-                }
+bool LockManager::Acquire(Transaction *txn, const LockDataId &lock_data_id, LockMode lock_mode,
+                          LockSet::iterator held, bool wait) {
+    auto lock_set = txn->GetLockSet();
+    bool is_upgrade = held != lock_set->end() && !held->second.released;
+    auto &partition = GetPartition(lock_data_id);
+    std::unique_lock<std::mutex> lock(partition.latch_);
+    auto &queue = partition.lock_table_[lock_data_id];
+    std::list<LockRequest>::iterator request;
+    LockMode held_mode = lock_mode;
+    if (is_upgrade) {
+        request = held->second.request;
+        held_mode = request->lock_mode_;
+        if (queue.upgrading_ != INVALID_TXN_ID) {
+            if (!wait) {
+                return false;
             }
-            break;
+            throw TransactionAbortException(txn->GetTransactionId(), AbortReason::UPGRADE_CONFLICT);
+        }
+        // 放弃原来的锁, 原地改成升级后的模式; 原请求在所有等待者之前, 升级请求自然排在它们前面
+        LockMode upgraded = Upgrade(request->lock_mode_, lock_mode);
+        queue.granted_num_[static_cast<int>(request->lock_mode_)]--;
+        if (!wait && !IsCompatible(queue, upgraded)) {
+            queue.granted_num_[static_cast<int>(request->lock_mode_)]++;
+            return false;
+        }
+        request->lock_mode_ = upgraded;
+        request->granted_ = false;
+    } else {
+        if (!wait && !(IsCompatible(queue, lock_mode) && queue.waiting_num_ == 0)) {
+            if (queue.request_queue_.empty()) {
+                partition.lock_table_.erase(lock_data_id);
+            }
+            return false;
+        }
+        if (partition.free_requests_.empty()) {
+            request = queue.request_queue_.emplace(queue.request_queue_.end(), txn->GetTransactionId(), lock_mode);
+        } else {
+            request = partition.free_requests_.begin();
+            queue.request_queue_.splice(queue.request_queue_.end(), partition.free_requests_, request);
+            request->txn_id_ = txn->GetTransactionId();
+            request->lock_mode_ = lock_mode;
+            request->granted_ = false;
+            request->aborted_ = false;
+        }
+        if (held != lock_set->end()) {
+            held->second = HeldLock{request, false};
+        } else {
+            lock_set->emplace(lock_data_id, HeldLock{request, false});
         }
     }
+    bool can_grant = IsCompatible(queue, request->lock_mode_) && (is_upgrade || queue.waiting_num_ == 0);
+    if (can_grant) {
+        request->granted_ = true;
+        queue.granted_num_[static_cast<int>(request->lock_mode_)]++;
+        return true;
+    }
+    queue.waiting_num_++;
+    if (is_upgrade) {
+        queue.upgrading_ = txn->GetTransactionId();
+    }
+    {
+        // 等待期间工作线程不计入线程池的大小, 持有锁的事务的后续请求仍然有线程执行
+        ThreadPool::BlockingScope blocking;
+        request->cv_.wait_for(lock, lock_wait_timeout, [&] { return request->granted_ || request->aborted_; });
+    }
+    if (!request->granted_) {
+        // 被死锁检测选为牺牲者或等待超时: 撤销这次请求, 升级时恢复原来持有的锁
+        AbortReason reason = request->aborted_ ? AbortReason::DEADLOCK_PREVENTION : AbortReason::LOCK_WAIT_TIMEOUT;
+        queue.waiting_num_--;
+        if (is_upgrade) {
+            queue.upgrading_ = INVALID_TXN_ID;
+            request->lock_mode_ = held_mode;
+            request->granted_ = true;
+            request->aborted_ = false;
+            queue.granted_num_[static_cast<int>(held_mode)]++;
+        } else {
+            lock_set->erase(lock_data_id);
+            RecycleRequest(&partition, &queue, request);
+        }
+        if (queue.request_queue_.empty()) {
+            partition.lock_table_.erase(lock_data_id);
+        } else {
+            GrantWaiters(&queue);
+        }
+        throw TransactionAbortException(txn->GetTransactionId(), reason);
+    }
+    return true;
+}
 
-    while(lock_table_[*lock_data_id].group_lock_mode_!=GroupLockMode::IX&&
-        lock_table_[*lock_data_id].group_lock_mode_!=GroupLockMode::IS&&
-        lock_table_[*lock_data_id].group_lock_mode_!=GroupLockMode::NON_LOCK&&
-        !(status==2&&lock_table_[*lock_data_id].shared_lock_num_==1)
-    ){
-        lock_table_[*lock_data_id].cv_.wait(lock);
+void LockManager::Release(Transaction *txn, LockSet::iterator held) {
+    const LockDataId &lock_data_id = held->first;
+    auto request = held->second.request;
+    if (lock_data_id.type_ == LockDataType::RECORD && escalation_threshold_ > 0) {
+        auto &row_locks = txn->GetRowLocks(lock_data_id.tab_id_);
+        row_locks.num_locks--;
+        if (request->lock_mode_ == LockMode::EXLUCSIVE) {
+            row_locks.num_exclusive--;
+        }
     }
-    
-    if(status==0){
-        auto lock_request=new LockRequest(txn->GetTransactionId(),LockMode::INTENTION_EXCLUSIVE);
-        lock_table_[*lock_data_id].request_queue_.push_back(*lock_request);
-        lock_set->insert(*lock_data_id);
-        lock_table_[*lock_data_id].group_lock_mode_=GroupLockMode::IX;
-        lock_table_[*lock_data_id].IX_lock_num_++;
+    auto &partition = GetPartition(lock_data_id);
+    std::unique_lock<std::mutex> lock(partition.latch_);
+    auto queue_it = partition.lock_table_.find(lock_data_id);
+    auto &queue = queue_it->second;
+    queue.granted_num_[static_cast<int>(request->lock_mode_)]--;
+    RecycleRequest(&partition, &queue, request);
+    held->second.released = true;
+    if (queue.request_queue_.empty()) {
+        partition.lock_table_.erase(queue_it);
+    } else {
+        GrantWaiters(&queue);
     }
-    else if(status==1){
-        lock_table_[*lock_data_id].group_lock_mode_=GroupLockMode::IX;
-        lock_table_[*lock_data_id].request_queue_.begin()->lock_mode_=LockMode::INTENTION_EXCLUSIVE;
-        lock_table_[*lock_data_id].IX_lock_num_++;
+}
+
+void LockManager::RecycleRequest(LockTablePartition *partition, LockRequestQueue *queue,
+                                 std::list<LockRequest>::iterator request) {
+    if (partition->free_requests_.size() < MAX_FREE_REQUESTS) {
+        partition->free_requests_.splice(partition->free_requests_.begin(), queue->request_queue_, request);
+    } else {
+        queue->request_queue_.erase(request);
     }
-    else{
-        lock_table_[*lock_data_id].group_lock_mode_=GroupLockMode::SIX;
-        lock_table_[*lock_data_id].request_queue_.begin()->lock_mode_=LockMode::S_IX;
-        lock_table_[*lock_data_id].shared_lock_num_--;
+}
+
+void LockManager::MaybeEscalate(Transaction *txn, int tab_id) {
+    auto &row_locks = txn->GetRowLocks(tab_id);
+    if (row_locks.num_locks <= escalation_threshold_ || row_locks.num_locks < row_locks.escalate_at) {
+        return;
+    }
+    // 只有行读锁时升级为表读锁, 否则升级为表写锁; 已有的IS/IX锁按Upgrade合并
+    LockMode table_mode = row_locks.num_exclusive > 0 ? LockMode::EXLUCSIVE : LockMode::SHARED;
+    LockDataId table_id(tab_id, LockDataType::TABLE);
+    auto lock_set = txn->GetLockSet();
+    auto table = lock_set->find(table_id);
+    bool held = table != lock_set->end() && !table->second.released;
+    if (!(held && Covers(table->second.request->lock_mode_, table_mode)) &&
+        !Acquire(txn, table_id, table_mode, table, false)) {
+        // 其他事务持有这张表上的锁, 不等待, 继续使用行锁
+        row_locks.escalate_at = row_locks.num_locks + escalation_threshold_;
+        failed_escalations_++;
+        return;
+    }
+    uint64_t released = 0;
+    for (auto it = lock_set->begin(); it != lock_set->end();) {
+        if (it->first.type_ != LockDataType::RECORD || it->first.tab_id_ != tab_id) {
+            ++it;
+            continue;
+        }
+        if (!it->second.released) {
+            Release(txn, it);
+            released++;
+        }
+        it = lock_set->erase(it);
     }
-    
-    lock_table_[*lock_data_id].cv_.notify_all();
-    
-    return true;
+    row_locks.escalate_at = 0;
+    escalations_++;
+    released_row_locks_ += released;
 }
 
-/**
- * 释放锁
- * @param txn 要释放锁的事务对象指针
- * @param lock_data_id 要释放的锁ID
- * @return 返回解锁是否成功
- */
-bool LockManager::Unlock(Transaction *txn, LockDataId lock_data_id) {
+void LockManager::GrantWaiters(LockRequestQueue *queue) {
+    for (auto &request : queue->request_queue_) {
+        // 被abort的请求由等待的线程自己删除
+        if (request.granted_ || request.aborted_) {
+            continue;
+        }
+        if (!IsCompatible(*queue, request.lock_mode_)) {
+            break;
+        }
+        request.granted_ = true;
+        queue->granted_num_[static_cast<int>(request.lock_mode_)]++;
+        queue->waiting_num_--;
+        if (queue->upgrading_ == request.txn_id_) {
+            queue->upgrading_ = INVALID_TXN_ID;
+        }
+        request.cv_.notify_one();
+    }
+}
 
-    if(txn->GetState()!=TransactionState::SHRINKING&&txn->GetState()!=TransactionState::GROWING){
-        assert(0);
+bool LockManager::IsCompatible(const LockRequestQueue &queue, LockMode lock_mode) {
+    auto granted = [&](LockMode mode) { return queue.granted_num_[static_cast<int>(mode)] > 0; };
+    switch (lock_mode) {
+        case LockMode::INTENTION_SHARED:
+            return !granted(LockMode::EXLUCSIVE);
+        case LockMode::INTENTION_EXCLUSIVE:
+            return !granted(LockMode::SHARED) && !granted(LockMode::S_IX) && !granted(LockMode::EXLUCSIVE);
+        case LockMode::SHARED:
+            return !granted(LockMode::INTENTION_EXCLUSIVE) && !granted(LockMode::S_IX) &&
+                   !granted(LockMode::EXLUCSIVE);
+        case LockMode::S_IX:
+            return !granted(LockMode::INTENTION_EXCLUSIVE) && !granted(LockMode::SHARED) &&
+                   !granted(LockMode::S_IX) && !granted(LockMode::EXLUCSIVE);
+        case LockMode::EXLUCSIVE:
+            return !granted(LockMode::INTENTION_SHARED) && !granted(LockMode::INTENTION_EXCLUSIVE) &&
+                   !granted(LockMode::SHARED) && !granted(LockMode::S_IX) && !granted(LockMode::EXLUCSIVE);
+    }
+    return false;
+}
+
+bool LockManager::IsCompatible(LockMode a, LockMode b) {
+    if (a == LockMode::EXLUCSIVE || b == LockMode::EXLUCSIVE) {
         return false;
     }
-    txn->SetState(TransactionState::SHRINKING);
-    std::unique_lock<std::mutex> lock(latch_);
-    auto lock_set=txn->GetLockSet();
-    bool judge=false;
-    for(auto i:*lock_set){
-        if(i==lock_data_id){
-            judge=true;
-            break;
+    if (a == LockMode::INTENTION_SHARED || b == LockMode::INTENTION_SHARED) {
+        return true;
+    }
+    // 剩下IX, S, SIX两两之间只有IX和IX, S和S相容
+    return a == b && a != LockMode::S_IX;
+}
+
+bool LockManager::Covers(LockMode held, LockMode requested) {
+    if (held == requested || held == LockMode::EXLUCSIVE || requested == LockMode::INTENTION_SHARED) {
+        return true;
+    }
+    return held == LockMode::S_IX && requested != LockMode::EXLUCSIVE;
+}
+
+bool LockManager::CoversRecords(LockMode held, LockMode requested) {
+    if (held == LockMode::EXLUCSIVE) {
+        return true;
+    }
+    return (held == LockMode::SHARED || held == LockMode::S_IX) && requested == LockMode::SHARED;
+}
+
+LockManager::LockMode LockManager::Upgrade(LockMode held, LockMode requested) {
+    if (held == LockMode::INTENTION_SHARED) {
+        return requested;
+    }
+    if (requested == LockMode::EXLUCSIVE) {
+        return LockMode::EXLUCSIVE;
+    }
+    // S + IX, IX + S, 或者升级到SIX
+    return LockMode::S_IX;
+}
+
+void LockManager::RunCycleDetection() {
+    std::lock_guard<std::mutex> guard(cycle_detection_latch_);
+    if (enable_cycle_detection_) {
+        return;
+    }
+    enable_cycle_detection_ = true;
+    cycle_detection_thread_ = std::thread([this] {
+        std::unique_lock<std::mutex> lock(cycle_detection_latch_);
+        while (!cycle_detection_cv_.wait_for(lock, cycle_detection_interval,
+                                             [this] { return !enable_cycle_detection_; })) {
+            lock.unlock();
+            DetectDeadlocks();
+            lock.lock();
         }
+    });
+}
+
+void LockManager::StopCycleDetection() {
+    {
+        std::lock_guard<std::mutex> guard(cycle_detection_latch_);
+        if (!enable_cycle_detection_) {
+            return;
+        }
+        enable_cycle_detection_ = false;
     }
-    if(!judge)assert(0);
-    std::vector<LockManager::LockRequest> v;
-    for(auto i:lock_table_[lock_data_id].request_queue_){
-        if(i.txn_id_==txn->GetTransactionId()){
-            if(i.lock_mode_==LockMode::EXLUCSIVE){
-                lock_table_[lock_data_id].group_lock_mode_=GroupLockMode::NON_LOCK;
-            }
-            else if(i.lock_mode_==LockMode::INTENTION_EXCLUSIVE){
-                lock_table_[lock_data_id].IX_lock_num_--;
-                if(!lock_table_[lock_data_id].IX_lock_num_){
-                    if(lock_table_[lock_data_id].request_queue_.size()>1){
-                        lock_table_[lock_data_id].group_lock_mode_=GroupLockMode::IS;
-                    }
-                    else lock_table_[lock_data_id].group_lock_mode_=GroupLockMode::NON_LOCK;
+    cycle_detection_cv_.notify_one();
+    cycle_detection_thread_.join();
+}
+
+/**
+ * 按分区顺序锁住整个锁表, 由请求队列构建等待图: 等待的请求等待所有与它不相容的已授予请求,
+ * 以及排在它前面的等待请求. 每找到一个环就abort环中事务ID最大的事务, 把它从图中删除后继续查找
+ */
+std::vector<txn_id_t> LockManager::DetectDeadlocks() {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(num_partitions_);
+    for (size_t i = 0; i < num_partitions_; i++) {
+        locks.emplace_back(partitions_[i].latch_);
+    }
+
+    std::map<txn_id_t, std::vector<txn_id_t>> waits_for;
+    std::unordered_map<txn_id_t, LockRequest *> waiting;
+    for (size_t i = 0; i < num_partitions_; i++) {
+        for (auto &entry : partitions_[i].lock_table_) {
+            auto &request_queue = entry.second.request_queue_;
+            std::vector<txn_id_t> waiters_ahead;
+            for (auto &request : request_queue) {
+                if (request.granted_ || request.aborted_) {
+                    continue;
                 }
-            }
-            else if(i.lock_mode_==LockMode::SHARED){
-                lock_table_[lock_data_id].shared_lock_num_--;
-                if(!lock_table_[lock_data_id].shared_lock_num_){
-                    if(lock_table_[lock_data_id].request_queue_.size()>1){
-                        lock_table_[lock_data_id].group_lock_mode_=GroupLockMode::IS;
+                auto &edges = waits_for[request.txn_id_];
+                for (auto &other : request_queue) {
+                    if (other.granted_ && other.txn_id_ != request.txn_id_ &&
+                        !IsCompatible(other.lock_mode_, request.lock_mode_)) {
+                        edges.push_back(other.txn_id_);
                     }
-                    else lock_table_[lock_data_id].group_lock_mode_=GroupLockMode::NON_LOCK;
                 }
+                edges.insert(edges.end(), waiters_ahead.begin(), waiters_ahead.end());
+                waiters_ahead.push_back(request.txn_id_);
+                waiting[request.txn_id_] = &request;
             }
-            else if(i.lock_mode_==LockMode::INTENTION_SHARED){
-                if(!lock_table_[lock_data_id].shared_lock_num_){
-                    if(lock_table_[lock_data_id].request_queue_.size()==1){
-                        lock_table_[lock_data_id].group_lock_mode_=GroupLockMode::NON_LOCK;
+        }
+    }
+    for (auto &node : waits_for) {
+        std::sort(node.second.begin(), node.second.end());
+        node.second.erase(std::unique(node.second.begin(), node.second.end()), node.second.end());
+    }
+
+    std::vector<txn_id_t> victims;
+    while (true) {
+        // 从事务ID最小的事务开始深度优先搜索, 路径上再次出现的事务说明找到了环
+        std::unordered_map<txn_id_t, int> state;  // 1: 在当前路径上, 2: 已经搜索完
+        std::vector<txn_id_t> path;
+        txn_id_t victim = INVALID_TXN_ID;
+        std::function<bool(txn_id_t)> dfs = [&](txn_id_t txn_id) {
+            state[txn_id] = 1;
+            path.push_back(txn_id);
+            auto node = waits_for.find(txn_id);
+            if (node != waits_for.end()) {
+                for (txn_id_t next : node->second) {
+                    if (state[next] == 1) {
+                        auto begin = std::find(path.begin(), path.end(), next);
+                        victim = *std::max_element(begin, path.end());
+                        return true;
+                    }
+                    if (state[next] == 0 && dfs(next)) {
+                        return true;
                     }
                 }
             }
-            else if(i.lock_mode_==LockMode::S_IX){
-                if(lock_table_[lock_data_id].request_queue_.size()>1){
-                    lock_table_[lock_data_id].group_lock_mode_=GroupLockMode::IS;
-                }
-                else lock_table_[lock_data_id].group_lock_mode_=GroupLockMode::NON_LOCK;
+            state[txn_id] = 2;
+            path.pop_back();
+            return false;
+        };
+        for (auto &node : waits_for) {
+            if (state[node.first] == 0 && dfs(node.first)) {
+                break;
             }
         }
-        else{
-            v.push_back(i);
+        if (victim == INVALID_TXN_ID) {
+            break;
         }
+        // 删除牺牲者的出边和所有指向它的边
+        waits_for.erase(victim);
+        for (auto &node : waits_for) {
+            auto &edges = node.second;
+            edges.erase(std::remove(edges.begin(), edges.end(), victim), edges.end());
+        }
+        auto request = waiting[victim];
+        request->aborted_ = true;
+        request->cv_.notify_one();
+        victims.push_back(victim);
+        deadlocks_++;
     }
-    lock_table_[lock_data_id].request_queue_.clear();
-    for(auto i:v){
-        lock_table_[lock_data_id].request_queue_.push_back(i);
-    }
-    lock_table_[lock_data_id].cv_.notify_all();
-    return true;
-}
\ No newline at end of file
+    return victims;
+}
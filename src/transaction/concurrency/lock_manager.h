@@ -1,73 +1,174 @@
 #pragma once
 
-#include <mutex>
+#include <atomic>
 #include <condition_variable>
-#include "transaction/transaction.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
-static const std::string GroupLockModeStr[10] = {"NON_LOCK", "IS", "IX", "S", "X", "SIX"};
+#include "transaction/transaction.h"
 
-class LockManager {
+/**
+ * @brief 多粒度锁管理器, 支持表级IS/IX/S/SIX/X锁和行级S/X锁
+ * @details 锁表按LockDataId的哈希值分成若干个分区, 每个分区有独立的互斥锁, 不同分区上的加锁解锁互不阻塞.
+ * 每个数据对象上的请求按到达顺序排队, 新请求只有在与所有已授予的锁相容、并且前面没有等待者时才立即授予;
+ * 锁释放后按顺序授予排在最前面的相容请求, 只唤醒被授予的等待者.
+ * 同一事务再次申请已持有的锁时直接返回, 申请更强的锁时原地升级, 升级请求排在所有等待者之前.
+ * 事务在自己的LockSet中记录每个锁对应的请求, 检查是否已持有、升级和解锁都不需要扫描请求队列.
+ * 一个事务在一张表上的行锁超过escalation_threshold个时, 尝试把它们换成一个表级S锁(只有行读锁时)或X锁,
+ * 表锁不能立即授予时不等待, 继续使用行锁, 再多加escalation_threshold个行锁后重试.
+ * RunCycleDetection启动后台线程, 每隔cycle_detection_interval根据请求队列构建等待图,
+ * 每个环中事务ID最大(最年轻)的事务被abort, 它在Lock中抛出DEADLOCK_PREVENTION异常.
+ * 等待超过lock_wait_timeout的事务抛出LOCK_WAIT_TIMEOUT异常; 等待期间工作线程不计入线程池的大小(ThreadPool::BlockingScope)
+ */
+class LockRequest {
+public:
     enum class LockMode { SHARED, EXLUCSIVE, INTENTION_SHARED, INTENTION_EXCLUSIVE, S_IX };
-    /**
-     * @brief the locks on data
-     * NON_LOCK: there is no lock on the data
-     * IS : intention shared lock
-     * IX : intention exclusive lock
-     * S : shared lock
-     * X : exclusive lock
-     * SIX : shared lock + intention exclusive lock(locks are from the same transaction)
-     */
-    enum class GroupLockMode { NON_LOCK, IS, IX, S, X, SIX};
 
-    class LockRequest {
-    public:
-        LockRequest(txn_id_t txn_id, LockMode lock_mode)
-            : txn_id_(txn_id), lock_mode_(lock_mode), granted_(false) {}
+    LockRequest(txn_id_t txn_id, LockMode lock_mode)
+        : txn_id_(txn_id), lock_mode_(lock_mode), granted_(false), aborted_(false) {}
 
-        txn_id_t txn_id_;
-        LockMode lock_mode_;
-        bool granted_;
-    };
+    txn_id_t txn_id_;
+    LockMode lock_mode_;
+    bool granted_;
+    bool aborted_;                  // 等待中的请求被死锁检测选为牺牲者
+    std::condition_variable cv_;    // 等待者在自己的条件变量上等待, 授予时只通知这一个线程
+};
+
+class LockManager {
+    using LockMode = LockRequest::LockMode;
+    static constexpr int NUM_LOCK_MODES = 5;
+    // 每个分区最多缓存的空闲请求个数
+    static constexpr size_t MAX_FREE_REQUESTS = 1024;
 
     class LockRequestQueue {
     public:
-        // locks on the data
-        std::list<LockRequest> request_queue_;      // 位于同一个数据对象上的锁的队列
-        // notify lock request
-        std::condition_variable cv_;                // 条件变量，用于唤醒request_queue_
-        // the group_lock_mode_ decides whether to grant a lock request or not
-        GroupLockMode group_lock_mode_ = GroupLockMode::NON_LOCK;   // 当前数据对象上加锁的组模式
-        // waiting bit: if there is a lock request which is not granted, the waiting -bit will be true
-        bool is_waiting_ = false;
-        // upgrading_flag: if there is a lock waiting for upgrading, other transactions that request for upgrading will be aborted
-        // (deadlock prevetion)
-        bool upgrading_ = false;                    // 当前队列中是否存在一个正在upgrade的锁
-        // the number of shared locks
-        int shared_lock_num_ = 0;
-        // the number of IX locks
-        int IX_lock_num_ = 0;
+        // 已授予的请求和正在升级的请求在前, 等待的新请求在后, 等待的请求按到达顺序排列
+        std::list<LockRequest> request_queue_;
+        // 每种模式已授予的锁的个数, 用于判断新请求是否相容
+        int granted_num_[NUM_LOCK_MODES] = {0};
+        // 等待中的请求个数
+        int waiting_num_ = 0;
+        // 正在等待升级的事务, 同一时刻只允许一个事务升级, 其他升级请求被abort
+        txn_id_t upgrading_ = INVALID_TXN_ID;
+    };
+
+    // 锁表的一个分区
+    struct LockTablePartition {
+        std::mutex latch_;
+        std::unordered_map<LockDataId, LockRequestQueue> lock_table_;
+        // 释放的请求节点, 新请求从这里splice到请求队列中, 避免每次加锁都分配内存
+        std::list<LockRequest> free_requests_;
     };
 
 public:
-    LockManager() {}
+    struct EscalationStats {
+        uint64_t escalations;         // 成功的锁升级次数
+        uint64_t failed_escalations;  // 表锁不能立即授予而放弃的锁升级次数
+        uint64_t released_row_locks;  // 锁升级释放的行锁个数
+    };
 
-    ~LockManager() {}
+    /**
+     * @param num_partitions 锁表的分区数
+     * @param escalation_threshold 一个事务在一张表上最多持有的行锁个数, 超过后尝试升级为表锁, 0表示不升级
+     */
+    explicit LockManager(size_t num_partitions = LOCK_TABLE_PARTITIONS,
+                         size_t escalation_threshold = LOCK_ESCALATION_THRESHOLD)
+        : num_partitions_(num_partitions),
+          partitions_(new LockTablePartition[num_partitions]),
+          escalation_threshold_(escalation_threshold) {}
+
+    ~LockManager() { StopCycleDetection(); }
 
-    bool LockSharedOnRecord(Transaction *txn, const Rid &rid, int tab_fd);
+    bool LockSharedOnRecord(Transaction *txn, const Rid &rid, int tab_id);
 
-    bool LockExclusiveOnRecord(Transaction *txn, const Rid &rid, int tab_fd);
+    bool LockExclusiveOnRecord(Transaction *txn, const Rid &rid, int tab_id);
 
-    bool LockSharedOnTable(Transaction *txn, int tab_fd);
+    bool LockSharedOnTable(Transaction *txn, int tab_id);
 
-    bool LockExclusiveOnTable(Transaction *txn, int tab_fd);
+    bool LockExclusiveOnTable(Transaction *txn, int tab_id);
 
-    bool LockISOnTable(Transaction *txn, int tab_fd);
+    bool LockISOnTable(Transaction *txn, int tab_id);
 
-    bool LockIXOnTable(Transaction *txn, int tab_fd);
+    bool LockIXOnTable(Transaction *txn, int tab_id);
 
     bool Unlock(Transaction *txn, LockDataId lock_data_id);
 
+    EscalationStats escalation_stats() {
+        return {escalations_.load(), failed_escalations_.load(), released_row_locks_.load()};
+    }
+
+    // 启动死锁检测线程
+    void RunCycleDetection();
+
+    // 停止死锁检测线程, 没有启动时什么也不做
+    void StopCycleDetection();
+
+    /**
+     * @brief 检测一次死锁, abort每个环中最年轻的事务
+     * @return 被abort的事务
+     */
+    std::vector<txn_id_t> DetectDeadlocks();
+
+    // 因死锁被abort的事务个数
+    uint64_t num_deadlocks() { return deadlocks_.load(); }
+
 private:
-    std::mutex latch_;  // 互斥锁，用于锁表的互斥访问
-    std::unordered_map<LockDataId, LockRequestQueue> lock_table_;   // 全局锁表
+    bool Lock(Transaction *txn, const LockDataId &lock_data_id, LockMode lock_mode);
+
+    /**
+     * @brief 在锁表中授予或升级一个锁, held是事务已持有的同一对象上的锁, 没有时为lock_set的end()
+     * @param wait 不能立即授予时是否等待, 不等待时返回false
+     */
+    bool Acquire(Transaction *txn, const LockDataId &lock_data_id, LockMode lock_mode, LockSet::iterator held,
+                 bool wait);
+
+    // 在锁表中释放held对应的请求, 不改变事务的状态
+    void Release(Transaction *txn, LockSet::iterator held);
+
+    // 把请求从队列中删除, 节点放回分区的空闲链表
+    static void RecycleRequest(LockTablePartition *partition, LockRequestQueue *queue,
+                               std::list<LockRequest>::iterator request);
+
+    // 事务在tab_id上的行锁过多时, 尝试升级为表锁并释放这些行锁
+    void MaybeEscalate(Transaction *txn, int tab_id);
+
+    // 把队列最前面的相容的等待请求依次授予, 遇到第一个不相容的请求时停止
+    void GrantWaiters(LockRequestQueue *queue);
+
+    static bool IsCompatible(const LockRequestQueue &queue, LockMode lock_mode);
+
+    // 两个事务能否同时持有a和b两种模式的锁
+    static bool IsCompatible(LockMode a, LockMode b);
+
+    // held模式的锁是否已经包含了requested模式的权限
+    static bool Covers(LockMode held, LockMode requested);
+
+    // held模式的表锁是否已经包含了对表中所有记录加requested模式行锁的权限
+    static bool CoversRecords(LockMode held, LockMode requested);
+
+    // 同时持有held和requested两种模式时需要升级到的模式
+    static LockMode Upgrade(LockMode held, LockMode requested);
+
+    LockTablePartition &GetPartition(const LockDataId &lock_data_id) {
+        // 行锁的哈希值低位只和slot_no有关, 先打散再取模
+        uint64_t hash = std::hash<LockDataId>()(lock_data_id) * 0x9e3779b97f4a7c15ull;
+        return partitions_[(hash >> 32) % num_partitions_];
+    }
+
+    size_t num_partitions_;
+    std::unique_ptr<LockTablePartition[]> partitions_;
+    size_t escalation_threshold_;
+    std::atomic<uint64_t> escalations_{0};
+    std::atomic<uint64_t> failed_escalations_{0};
+    std::atomic<uint64_t> released_row_locks_{0};
+    std::atomic<uint64_t> deadlocks_{0};
+
+    std::thread cycle_detection_thread_;
+    std::mutex cycle_detection_latch_;
+    std::condition_variable cycle_detection_cv_;  // 停止检测时唤醒检测线程
+    bool enable_cycle_detection_ = false;
 };
@@ -0,0 +1,133 @@
+#include "version_store.h"
+
+#include <cstring>
+
+void VersionStore::add_version(int tab_id, const Rid &rid, const char *before, int record_size, Transaction *txn) {
+    std::unique_ptr<char[]> copy;
+    if (before != nullptr) {
+        copy.reset(new char[record_size]);
+        memcpy(copy.get(), before, record_size);
+    }
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    auto &table = tables_[tab_id];
+    table.record_size = record_size;
+    table.chains[rid_key(rid)].push_back({txn->GetTransactionId(), INVALID_TIMESTAMP, std::move(copy)});
+    writes_[txn->GetTransactionId()].emplace_back(tab_id, rid_key(rid));
+    num_versions_++;
+}
+
+std::unique_ptr<RmRecord> VersionStore::read(int tab_id, const Rid &rid, std::unique_ptr<RmRecord> heap,
+                                             Transaction *txn) {
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    auto table = tables_.find(tab_id);
+    if (table == tables_.end()) {
+        return heap;
+    }
+    auto chain = table->second.chains.find(rid_key(rid));
+    if (chain == table->second.chains.end()) {
+        return heap;
+    }
+    // 从最新的修改开始, 撤销所有不可见的修改
+    auto &versions = chain->second;
+    for (auto it = versions.rbegin(); it != versions.rend() && !is_visible(*it, txn); ++it) {
+        if (it->before == nullptr) {
+            heap = nullptr;
+        } else {
+            heap = std::make_unique<RmRecord>(table->second.record_size);
+            memcpy(heap->data, it->before.get(), table->second.record_size);
+        }
+    }
+    return heap;
+}
+
+std::vector<Rid> VersionStore::get_rids(int tab_id) {
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    std::vector<Rid> rids;
+    auto table = tables_.find(tab_id);
+    if (table == tables_.end()) {
+        return rids;
+    }
+    rids.reserve(table->second.chains.size());
+    for (auto &chain : table->second.chains) {
+        rids.push_back(Rid{static_cast<int>(chain.first >> 32), static_cast<int>(chain.first & 0xffffffff)});
+    }
+    return rids;
+}
+
+bool VersionStore::has_conflict(int tab_id, const Rid &rid, Transaction *txn) {
+    std::shared_lock<std::shared_mutex> lock(latch_);
+    auto table = tables_.find(tab_id);
+    if (table == tables_.end()) {
+        return false;
+    }
+    auto chain = table->second.chains.find(rid_key(rid));
+    return chain != table->second.chains.end() && !is_visible(chain->second.back(), txn);
+}
+
+void VersionStore::commit(Transaction *txn, timestamp_t commit_ts) {
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    auto writes = writes_.find(txn->GetTransactionId());
+    if (writes == writes_.end()) {
+        return;
+    }
+    for (auto &key : writes->second) {
+        auto &versions = tables_[key.first].chains[key.second];
+        // 事务持有写锁直到提交, 它的版本都在版本链的末尾
+        for (auto it = versions.rbegin(); it != versions.rend() && it->writer == txn->GetTransactionId(); ++it) {
+            it->commit_ts = commit_ts;
+        }
+    }
+    committed_.emplace_back(commit_ts, std::move(writes->second));
+    writes_.erase(writes);
+}
+
+void VersionStore::abort(Transaction *txn) {
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    auto writes = writes_.find(txn->GetTransactionId());
+    if (writes == writes_.end()) {
+        return;
+    }
+    for (auto &key : writes->second) {
+        auto &chains = tables_[key.first].chains;
+        auto chain = chains.find(key.second);
+        if (chain == chains.end()) {
+            continue;
+        }
+        auto &versions = chain->second;
+        while (!versions.empty() && versions.back().writer == txn->GetTransactionId()) {
+            versions.pop_back();
+            num_versions_--;
+        }
+        if (versions.empty()) {
+            chains.erase(chain);
+        }
+    }
+    writes_.erase(writes);
+}
+
+void VersionStore::gc(timestamp_t oldest_snapshot) {
+    std::unique_lock<std::shared_mutex> lock(latch_);
+    while (!committed_.empty() && committed_.front().first <= oldest_snapshot) {
+        for (auto &key : committed_.front().second) {
+            auto &chains = tables_[key.first].chains;
+            auto chain = chains.find(key.second);
+            if (chain == chains.end()) {
+                continue;
+            }
+            // 最新的对所有快照都可见的修改和更早的修改都不再需要
+            auto &versions = chain->second;
+            auto end = versions.begin();
+            for (auto it = versions.begin(); it != versions.end(); ++it) {
+                if (it->commit_ts != INVALID_TIMESTAMP && it->commit_ts <= oldest_snapshot) {
+                    end = it + 1;
+                }
+            }
+            num_versions_ -= end - versions.begin();
+            versions.erase(versions.begin(), end);
+            if (versions.empty()) {
+                chains.erase(chain);
+            }
+        }
+        committed_.pop_front();
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "record/rm_defs.h"
+#include "transaction/transaction.h"
+
+/**
+ * @brief 记录的旧版本存储, 用于快照读
+ * @details 堆文件中只保存每条记录的最新版本. 写事务插入、删除、更新一条记录时, 在这里为它追加一个版本,
+ * 保存修改前的记录(插入前记录不存在). 同一条记录的版本按修改的先后组成版本链, 由于写事务持有记录的写锁直到提交,
+ * 版本链上的修改也是按提交的先后排列的. 事务提交时给它的版本打上提交时间戳, 回滚时删除它的版本.
+ * 快照读从堆中的最新记录出发, 沿版本链从新到旧撤销所有对快照不可见的修改, 得到快照可见的版本.
+ * 提交时间戳不晚于所有活跃快照的版本已经不会再被用到, 由gc回收
+ */
+class VersionStore {
+    struct UndoVersion {
+        txn_id_t writer;
+        timestamp_t commit_ts;           // 提交前为INVALID_TIMESTAMP
+        std::unique_ptr<char[]> before;  // 修改前的记录, 插入时为nullptr
+    };
+
+    // 旧的修改在前, 新的修改在后
+    using VersionChain = std::vector<UndoVersion>;
+
+    struct TableVersions {
+        int record_size = 0;
+        std::unordered_map<int64_t, VersionChain> chains;  // 以rid为key
+    };
+
+    // 一次修改所在的表和记录
+    using VersionKey = std::pair<int, int64_t>;
+
+public:
+    /**
+     * @brief 写事务修改堆中的记录前调用, 调用者持有记录的写锁和所在页面的写latch
+     * @param before 修改前的记录, 插入时为nullptr
+     */
+    void add_version(int tab_id, const Rid &rid, const char *before, int record_size, Transaction *txn);
+
+    /**
+     * @brief 返回对txn的快照可见的版本
+     * @param heap 堆中当前的记录, 槽位为空时为nullptr
+     * @return 快照中记录不存在时返回nullptr
+     */
+    std::unique_ptr<RmRecord> read(int tab_id, const Rid &rid, std::unique_ptr<RmRecord> heap, Transaction *txn);
+
+    // 表中所有有旧版本的记录, 快照读扫描完堆文件后还要检查这些记录, 找回快照中存在但已经被删除或移走的记录
+    std::vector<Rid> get_rids(int tab_id);
+
+    // 记录在txn的快照之后是否被其他事务修改并提交, 调用者持有记录的写锁
+    bool has_conflict(int tab_id, const Rid &rid, Transaction *txn);
+
+    // txn是否修改过记录
+    bool has_writes(Transaction *txn) {
+        std::shared_lock<std::shared_mutex> lock(latch_);
+        return writes_.count(txn->GetTransactionId()) > 0;
+    }
+
+    // 给txn的所有版本打上提交时间戳
+    void commit(Transaction *txn, timestamp_t commit_ts);
+
+    // 删除txn的所有版本, 在堆中的修改被撤销之后调用
+    void abort(Transaction *txn);
+
+    // 回收提交时间戳不晚于oldest_snapshot的版本
+    void gc(timestamp_t oldest_snapshot);
+
+    size_t num_versions() {
+        std::shared_lock<std::shared_mutex> lock(latch_);
+        return num_versions_;
+    }
+
+private:
+    static int64_t rid_key(const Rid &rid) { return (static_cast<int64_t>(rid.page_no) << 32) | rid.slot_no; }
+
+    static bool is_visible(const UndoVersion &version, Transaction *txn) {
+        return version.writer == txn->GetTransactionId() ||
+               (version.commit_ts != INVALID_TIMESTAMP && version.commit_ts <= txn->GetStartTs());
+    }
+
+    std::shared_mutex latch_;
+    std::unordered_map<int, TableVersions> tables_;                 // 以表的编号为key
+    std::unordered_map<txn_id_t, std::vector<VersionKey>> writes_;  // 未结束的事务修改过的记录
+    std::deque<std::pair<timestamp_t, std::vector<VersionKey>>> committed_;  // 等待回收的修改, 按提交时间戳排序
+    size_t num_versions_ = 0;
+};
@@ -33,7 +33,6 @@ class ConcurrencyTest : public ::testing::Test {
     std::unique_ptr<LogManager> log_manager_;
     std::unique_ptr<TransactionManager> txn_manager_;
     std::unique_ptr<Interp> interp_;
-    std::mutex mutex;
 
    public:
     void SetUp() override {
@@ -62,16 +61,14 @@ class ConcurrencyTest : public ::testing::Test {
     }
 
     void exec_sql(const std::string &sql, char* result, int *offset, int *txn_id) {
-        std::unique_lock<std::mutex> lock(mutex);
-        YY_BUFFER_STATE yy_buffer = yy_scan_string(sql.c_str());
-        assert(yyparse() == 0 && ast::parse_tree != nullptr);
-        yy_delete_buffer(yy_buffer);
-        lock.unlock();
+        std::shared_ptr<ast::TreeNode> parse_tree;
+        bool parsed = ast::parse(sql, &parse_tree);
+        assert(parsed && parse_tree != nullptr);
         memset(result, 0, BUFFER_LENGTH);
         *offset = 0;
         Context *context = new Context(lock_manager_.get(), log_manager_.get(),
                                        nullptr, result, offset);
-        interp_->interp_sql(ast::parse_tree, txn_id, context);  // 主要执行逻辑
+        interp_->interp_sql(parse_tree, txn_id, context);  // 主要执行逻辑
     }
 
     void RunLockOperation(Transaction *txn, const LockOperation &operation) {
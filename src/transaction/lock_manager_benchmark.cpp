@@ -0,0 +1,132 @@
+/**
+ * @brief 锁管理器吞吐量测试: 分别用1, 2, 4, ...个线程并发加锁解锁, 统计每秒授予的锁数
+ * @details 用法: lock_manager_benchmark [max_threads]
+ * uncontended: 每个线程只锁自己的表上的记录, 互不冲突, 只测锁表本身的开销
+ * hotspot: 所有线程在同一张表的HOTSPOT_RECORDS条记录上随机加读锁或写锁, 写锁占WRITE_PERCENT%
+ * 每个场景分别用只有一个分区的锁表(相当于一把全局锁)和默认分区数的锁表测试
+ * deadlock: 打开死锁检测, 所有线程按随机顺序对同一张表的HOTSPOT_RECORDS条记录加写锁, 统计每秒提交和abort的事务数
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "concurrency/lock_manager.h"
+
+static constexpr int BENCHMARK_MILLISECONDS = 1000;
+static constexpr int LOCKS_PER_TXN = 16;
+static constexpr int UNCONTENDED_RECORDS = 100000;
+static constexpr int HOTSPOT_RECORDS = 64;
+static constexpr int WRITE_PERCENT = 20;
+
+static uint64_t run_benchmark(size_t num_partitions, int num_threads, bool hotspot) {
+    LockManager lock_manager(num_partitions);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> total{0};
+    std::atomic<txn_id_t> next_txn_id{0};
+    std::vector<std::thread> workers;
+    for (int i = 0; i < num_threads; i++) {
+        workers.emplace_back([&, i] {
+            std::mt19937 rng(i);
+            int tab_fd = hotspot ? 0 : i;
+            int num_records = hotspot ? HOTSPOT_RECORDS : UNCONTENDED_RECORDS;
+            uint64_t count = 0;
+            std::vector<int> slots(LOCKS_PER_TXN);
+            while (!stop) {
+                Transaction txn(next_txn_id++);
+                // 按记录的顺序加锁, 避免死锁
+                for (auto &slot : slots) {
+                    slot = rng() % num_records;
+                }
+                std::sort(slots.begin(), slots.end());
+                bool write = hotspot && (int)(rng() % 100) < WRITE_PERCENT;
+                if (write) {
+                    lock_manager.LockIXOnTable(&txn, tab_fd);
+                } else {
+                    lock_manager.LockISOnTable(&txn, tab_fd);
+                }
+                for (int slot : slots) {
+                    Rid rid{1, slot};
+                    if (write) {
+                        lock_manager.LockExclusiveOnRecord(&txn, rid, tab_fd);
+                    } else {
+                        lock_manager.LockSharedOnRecord(&txn, rid, tab_fd);
+                    }
+                }
+                count += txn.GetLockSet()->size();
+                for (auto &entry : *txn.GetLockSet()) {
+                    lock_manager.Unlock(&txn, entry.first);
+                }
+            }
+            total += count;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCHMARK_MILLISECONDS));
+    stop = true;
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    return total * 1000 / BENCHMARK_MILLISECONDS;
+}
+
+// 返回每秒提交和abort的事务数
+static std::pair<uint64_t, uint64_t> run_deadlock_benchmark(int num_threads) {
+    LockManager lock_manager;
+    lock_manager.RunCycleDetection();
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> commits{0};
+    std::atomic<uint64_t> aborts{0};
+    std::atomic<txn_id_t> next_txn_id{0};
+    std::vector<std::thread> workers;
+    for (int i = 0; i < num_threads; i++) {
+        workers.emplace_back([&, i] {
+            std::mt19937 rng(i);
+            int tab_fd = 0;
+            while (!stop) {
+                Transaction txn(next_txn_id++);
+                try {
+                    lock_manager.LockIXOnTable(&txn, tab_fd);
+                    for (int j = 0; j < LOCKS_PER_TXN; j++) {
+                        lock_manager.LockExclusiveOnRecord(&txn, Rid{1, (int)(rng() % HOTSPOT_RECORDS)}, tab_fd);
+                    }
+                    commits++;
+                } catch (TransactionAbortException &e) {
+                    aborts++;
+                }
+                for (auto &entry : *txn.GetLockSet()) {
+                    lock_manager.Unlock(&txn, entry.first);
+                }
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(BENCHMARK_MILLISECONDS));
+    stop = true;
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    return {commits * 1000 / BENCHMARK_MILLISECONDS, aborts * 1000 / BENCHMARK_MILLISECONDS};
+}
+
+int main(int argc, char *argv[]) {
+    int max_threads = argc >= 2 ? atoi(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+    for (bool hotspot : {false, true}) {
+        std::cout << (hotspot ? "hotspot" : "uncontended") << std::endl;
+        for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+            uint64_t single = run_benchmark(1, num_threads, hotspot);
+            uint64_t partitioned = run_benchmark(LOCK_TABLE_PARTITIONS, num_threads, hotspot);
+            std::cout << "threads: " << num_threads << "\t1 partition: " << single << " locks/s\t"
+                      << LOCK_TABLE_PARTITIONS << " partitions: " << partitioned << " locks/s" << std::endl;
+        }
+    }
+    std::cout << "deadlock" << std::endl;
+    for (int num_threads = 2; num_threads <= std::max(2, max_threads); num_threads *= 2) {
+        auto result = run_deadlock_benchmark(num_threads);
+        std::cout << "threads: " << num_threads << "\tcommits: " << result.first << " txns/s\taborts: " << result.second
+                  << " txns/s" << std::endl;
+    }
+    return 0;
+}
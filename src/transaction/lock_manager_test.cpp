@@ -366,6 +366,210 @@ TEST_F(LockManagerTest, BasicTest6_INTENTION_EXCLUSIVE) {
     EXPECT_EQ(operation_expected, operation);
 }
 
+// 同一事务在持有其他锁的情况下把读锁升级为写锁, 其他事务的读锁要等到写锁释放
+TEST_F(LockManagerTest, UpgradeTest) {
+    int tab_fd = 0;
+    Rid rid0{0, 0};
+    Rid rid1{1, 1};
+    LockDataId tuple1(tab_fd, rid1, LockDataType::RECORD);
+
+    std::vector<int> operation;
+
+    std::thread t0([&] {
+        Transaction txn0(0);
+        EXPECT_TRUE(lock_manager_->LockSharedOnRecord(&txn0, rid0, tab_fd));
+        EXPECT_TRUE(lock_manager_->LockSharedOnRecord(&txn0, rid1, tab_fd));
+        EXPECT_TRUE(lock_manager_->LockExclusiveOnRecord(&txn0, rid1, tab_fd));
+        // 已经持有写锁, 再申请读锁直接返回
+        EXPECT_TRUE(lock_manager_->LockSharedOnRecord(&txn0, rid1, tab_fd));
+        EXPECT_EQ(txn0.GetLockSet()->size(), 2);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        operation.push_back(0);
+        EXPECT_TRUE(lock_manager_->Unlock(&txn0, tuple1));
+        EXPECT_FALSE(lock_manager_->Unlock(&txn0, tuple1));
+    });
+
+    std::thread t1([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        Transaction txn1(1);
+        EXPECT_TRUE(lock_manager_->LockSharedOnRecord(&txn1, rid1, tab_fd));
+        operation.push_back(1);
+        EXPECT_TRUE(lock_manager_->Unlock(&txn1, tuple1));
+    });
+
+    t0.join();
+    t1.join();
+    EXPECT_EQ(operation, (std::vector<int>{0, 1}));
+}
+
+// 两个事务同时把同一条记录上的读锁升级为写锁, 后升级的事务被abort
+TEST_F(LockManagerTest, UpgradeConflictTest) {
+    int tab_fd = 0;
+    Rid rid{0, 0};
+    LockDataId tuple(tab_fd, rid, LockDataType::RECORD);
+    Transaction txn0(0);
+    Transaction txn1(1);
+    EXPECT_TRUE(lock_manager_->LockSharedOnRecord(&txn0, rid, tab_fd));
+    EXPECT_TRUE(lock_manager_->LockSharedOnRecord(&txn1, rid, tab_fd));
+
+    std::thread t0([&] { EXPECT_TRUE(lock_manager_->LockExclusiveOnRecord(&txn0, rid, tab_fd)); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    EXPECT_THROW(lock_manager_->LockExclusiveOnRecord(&txn1, rid, tab_fd), TransactionAbortException);
+    EXPECT_TRUE(lock_manager_->Unlock(&txn1, tuple));
+    t0.join();
+    EXPECT_TRUE(lock_manager_->Unlock(&txn0, tuple));
+}
+
+// 一个事务持有大量行锁时, 重复加锁和升级只查事务自己的锁集合, 解锁后的请求节点被其他事务复用
+TEST_F(LockManagerTest, ManyRecordLocksTest) {
+    int tab_fd = 0;
+    int num_records = 10000;
+    // 关闭锁升级
+    lock_manager_ = std::make_unique<LockManager>(LOCK_TABLE_PARTITIONS, 0);
+    Transaction txn0(0);
+    EXPECT_TRUE(lock_manager_->LockIXOnTable(&txn0, tab_fd));
+    for (int i = 0; i < num_records; i++) {
+        EXPECT_TRUE(lock_manager_->LockSharedOnRecord(&txn0, Rid{0, i}, tab_fd));
+    }
+    for (int i = 0; i < num_records; i++) {
+        EXPECT_TRUE(lock_manager_->LockSharedOnRecord(&txn0, Rid{0, i}, tab_fd));
+        EXPECT_TRUE(lock_manager_->LockExclusiveOnRecord(&txn0, Rid{0, i}, tab_fd));
+    }
+    EXPECT_EQ(txn0.GetLockSet()->size(), num_records + 1);
+    for (auto &entry : *txn0.GetLockSet()) {
+        EXPECT_TRUE(lock_manager_->Unlock(&txn0, entry.first));
+    }
+    for (auto &entry : *txn0.GetLockSet()) {
+        EXPECT_FALSE(lock_manager_->Unlock(&txn0, entry.first));
+    }
+
+    // txn0的锁都已释放, 其他事务可以立即加写锁
+    Transaction txn1(1);
+    EXPECT_TRUE(lock_manager_->LockIXOnTable(&txn1, tab_fd));
+    for (int i = 0; i < num_records; i++) {
+        EXPECT_TRUE(lock_manager_->LockExclusiveOnRecord(&txn1, Rid{0, i}, tab_fd));
+    }
+    for (auto &entry : *txn1.GetLockSet()) {
+        EXPECT_TRUE(lock_manager_->Unlock(&txn1, entry.first));
+    }
+}
+
+// 行锁超过阈值后升级为表锁: 只有行读锁时升级为表读锁, 有行写锁时升级为表写锁, 其他事务持有冲突的表锁时不升级
+TEST_F(LockManagerTest, EscalationTest) {
+    size_t threshold = 10;
+    lock_manager_ = std::make_unique<LockManager>(LOCK_TABLE_PARTITIONS, threshold);
+    int tab_fd0 = 0;
+    int tab_fd1 = 1;
+    LockDataId table0(tab_fd0, LockDataType::TABLE);
+    LockDataId table1(tab_fd1, LockDataType::TABLE);
+
+    Transaction txn0(0);
+    EXPECT_TRUE(lock_manager_->LockISOnTable(&txn0, tab_fd0));
+    for (int i = 0; i <= (int)threshold; i++) {
+        EXPECT_TRUE(lock_manager_->LockSharedOnRecord(&txn0, Rid{0, i}, tab_fd0));
+    }
+    // 行锁都被释放, 之后对这张表的读锁不再加入锁集合
+    EXPECT_EQ(txn0.GetLockSet()->size(), 1);
+    EXPECT_TRUE(lock_manager_->LockSharedOnRecord(&txn0, Rid{1, 0}, tab_fd0));
+    EXPECT_EQ(txn0.GetLockSet()->size(), 1);
+    auto stats = lock_manager_->escalation_stats();
+    EXPECT_EQ(stats.escalations, 1);
+    EXPECT_EQ(stats.released_row_locks, threshold + 1);
+
+    EXPECT_TRUE(lock_manager_->Unlock(&txn0, table0));
+
+    // txn1持有table1上的意向读锁, txn2的行写锁不能升级为表写锁, 继续使用行锁
+    Transaction txn1(1);
+    EXPECT_TRUE(lock_manager_->LockISOnTable(&txn1, tab_fd1));
+    EXPECT_TRUE(lock_manager_->LockSharedOnRecord(&txn1, Rid{1, 0}, tab_fd1));
+    Transaction txn2(2);
+    EXPECT_TRUE(lock_manager_->LockIXOnTable(&txn2, tab_fd1));
+    for (int i = 0; i <= (int)threshold; i++) {
+        EXPECT_TRUE(lock_manager_->LockExclusiveOnRecord(&txn2, Rid{0, i}, tab_fd1));
+    }
+    EXPECT_EQ(txn2.GetLockSet()->size(), threshold + 2);
+    stats = lock_manager_->escalation_stats();
+    EXPECT_EQ(stats.escalations, 1);
+    EXPECT_EQ(stats.failed_escalations, 1);
+
+    // txn1释放锁之后, txn2再加threshold个行锁时重试成功
+    EXPECT_TRUE(lock_manager_->Unlock(&txn1, LockDataId(tab_fd1, Rid{1, 0}, LockDataType::RECORD)));
+    EXPECT_TRUE(lock_manager_->Unlock(&txn1, table1));
+    for (int i = 0; i < (int)threshold; i++) {
+        EXPECT_TRUE(lock_manager_->LockExclusiveOnRecord(&txn2, Rid{1, i}, tab_fd1));
+    }
+    EXPECT_EQ(txn2.GetLockSet()->size(), 1);
+    stats = lock_manager_->escalation_stats();
+    EXPECT_EQ(stats.escalations, 2);
+    EXPECT_EQ(stats.released_row_locks, 3 * threshold + 2);
+    EXPECT_TRUE(lock_manager_->Unlock(&txn2, table1));
+}
+
+// 三个事务循环等待行写锁, 死锁检测abort最年轻的事务, 其余两个事务依次完成
+TEST_F(LockManagerTest, DeadlockDetectionTest) {
+    lock_manager_->RunCycleDetection();
+    int tab_fd = 0;
+    int num_txns = 3;
+    std::vector<std::unique_ptr<Transaction>> txns;
+    for (int i = 0; i < num_txns; i++) {
+        txns.push_back(std::make_unique<Transaction>(i));
+        EXPECT_TRUE(lock_manager_->LockExclusiveOnRecord(txns[i].get(), Rid{0, i}, tab_fd));
+    }
+    std::atomic<int> aborted{-1};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_txns; i++) {
+        threads.emplace_back([&, i] {
+            Transaction *txn = txns[i].get();
+            try {
+                EXPECT_TRUE(lock_manager_->LockExclusiveOnRecord(txn, Rid{0, (i + 1) % num_txns}, tab_fd));
+                txn_manager_->Commit(txn, log_manager_.get());
+            } catch (TransactionAbortException &e) {
+                EXPECT_EQ(e.GetAbortReason(), AbortReason::DEADLOCK_PREVENTION);
+                aborted = i;
+                txn_manager_->Abort(txn, log_manager_.get());
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(aborted, num_txns - 1);
+    EXPECT_EQ(lock_manager_->num_deadlocks(), 1);
+    EXPECT_EQ(txns[0]->GetState(), TransactionState::COMMITTED);
+    EXPECT_EQ(txns[1]->GetState(), TransactionState::COMMITTED);
+    EXPECT_EQ(txns[2]->GetState(), TransactionState::ABORTED);
+}
+
+// 升级请求参与的死锁: txn0等待txn1在rid1上的写锁, txn1把rid0上的读锁升级为写锁时等待txn0,
+// 较年轻的txn1被abort, 仍然持有rid0上原来的读锁
+TEST_F(LockManagerTest, UpgradeDeadlockTest) {
+    int tab_fd = 0;
+    Rid rid0{0, 0};
+    Rid rid1{0, 1};
+    Transaction txn0(0);
+    Transaction txn1(1);
+    EXPECT_TRUE(lock_manager_->LockSharedOnRecord(&txn0, rid0, tab_fd));
+    EXPECT_TRUE(lock_manager_->LockSharedOnRecord(&txn1, rid0, tab_fd));
+    EXPECT_TRUE(lock_manager_->LockExclusiveOnRecord(&txn1, rid1, tab_fd));
+
+    std::thread t0([&] { EXPECT_TRUE(lock_manager_->LockSharedOnRecord(&txn0, rid1, tab_fd)); });
+    std::thread t1([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        EXPECT_THROW(lock_manager_->LockExclusiveOnRecord(&txn1, rid0, tab_fd), TransactionAbortException);
+        // 升级失败后仍持有rid0上的读锁
+        EXPECT_TRUE(lock_manager_->Unlock(&txn1, LockDataId(tab_fd, rid0, LockDataType::RECORD)));
+        EXPECT_TRUE(lock_manager_->Unlock(&txn1, LockDataId(tab_fd, rid1, LockDataType::RECORD)));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    EXPECT_EQ(lock_manager_->DetectDeadlocks(), (std::vector<txn_id_t>{1}));
+    t0.join();
+    t1.join();
+    EXPECT_TRUE(lock_manager_->DetectDeadlocks().empty());
+    EXPECT_TRUE(lock_manager_->Unlock(&txn0, LockDataId(tab_fd, rid0, LockDataType::RECORD)));
+    EXPECT_TRUE(lock_manager_->Unlock(&txn0, LockDataId(tab_fd, rid1, LockDataType::RECORD)));
+}
+
 // test deadlock prevention
 //TEST_F(LockManagerTest, Deadlock_Prevetion_Test) {
 //    // txn1 -> table0.tuple{0,0} exclusive
@@ -0,0 +1,238 @@
+#include "concurrency/lock_manager.h"
+#include "concurrency/version_store.h"
+#include "transaction_manager.h"
+#include "execution/execution_manager.h"
+#include "interp.h"
+#include "gtest/gtest.h"
+
+#define BUFFER_LENGTH 8192
+const std::string TEST_DB_NAME = "MvccTestDB";
+
+/**
+ * 快照读的测试. 快照读不加读锁, 不会被写事务阻塞, 所以两个事务的语句可以在同一个线程中交替执行
+ */
+class MvccTest : public ::testing::Test {
+   public:
+    std::unique_ptr<DiskManager> disk_manager_;
+    std::unique_ptr<BufferPoolManager> buffer_pool_manager_;
+    std::unique_ptr<RmManager> rm_manager_;
+    std::unique_ptr<IxManager> ix_manager_;
+    std::unique_ptr<SmManager> sm_manager_;
+    std::unique_ptr<QlManager> ql_manager_;
+    std::unique_ptr<LockManager> lock_manager_;
+    std::unique_ptr<LogManager> log_manager_;
+    std::unique_ptr<VersionStore> version_store_;
+    std::unique_ptr<TransactionManager> txn_manager_;
+    std::unique_ptr<Interp> interp_;
+    char result_[BUFFER_LENGTH];
+
+   public:
+    void SetUp() override {
+        ::testing::Test::SetUp();
+        disk_manager_ = std::make_unique<DiskManager>();
+        buffer_pool_manager_ = std::make_unique<BufferPoolManager>(BUFFER_POOL_SIZE, disk_manager_.get());
+        rm_manager_ = std::make_unique<RmManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        ix_manager_ = std::make_unique<IxManager>(disk_manager_.get(), buffer_pool_manager_.get());
+        sm_manager_ = std::make_unique<SmManager>(disk_manager_.get(), buffer_pool_manager_.get(), rm_manager_.get(),
+                                                  ix_manager_.get());
+        ql_manager_ = std::make_unique<QlManager>(sm_manager_.get());
+        log_manager_ = std::make_unique<LogManager>(disk_manager_.get());
+        log_manager_->SetLogMode(false);
+        lock_manager_ = std::make_unique<LockManager>();
+        version_store_ = std::make_unique<VersionStore>();
+        txn_manager_ = std::make_unique<TransactionManager>(lock_manager_.get(), sm_manager_.get(),
+                                                            ConcurrencyMode::TWO_PHASE_LOCKING, version_store_.get());
+        interp_ = std::make_unique<Interp>(sm_manager_.get(), ql_manager_.get(), txn_manager_.get());
+        if (sm_manager_->is_dir(TEST_DB_NAME)) {
+            sm_manager_->drop_db(TEST_DB_NAME);
+        }
+        sm_manager_->create_db(TEST_DB_NAME);
+        sm_manager_->open_db(TEST_DB_NAME);
+    }
+
+    void TearDown() override { sm_manager_->close_db(); }
+
+    // 执行一条sql, 返回输出的结果
+    std::string exec_sql(const std::string &sql, txn_id_t *txn_id) {
+        std::shared_ptr<ast::TreeNode> parse_tree;
+        bool parsed = ast::parse(sql, &parse_tree);
+        assert(parsed && parse_tree != nullptr);
+        memset(result_, 0, BUFFER_LENGTH);
+        int offset = 0;
+        Context context(lock_manager_.get(), log_manager_.get(), nullptr, result_, &offset);
+        context.version_store_ = version_store_.get();
+        interp_->interp_sql(parse_tree, txn_id, &context);
+        context.writer_->flush();
+        return std::string(result_, offset);
+    }
+
+    // 以autocommit方式执行一条sql
+    std::string exec_sql(const std::string &sql) {
+        txn_id_t txn_id = INVALID_TXN_ID;
+        return exec_sql(sql, &txn_id);
+    }
+
+    static std::string row(int id, int num) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "| %16d | %16d |\n", id, num);
+        return buf;
+    }
+
+    static bool has_row(const std::string &result, int id, int num) {
+        return result.find(row(id, num)) != std::string::npos;
+    }
+
+    static bool has_total(const std::string &result, int total) {
+        return result.find("Total record(s): " + std::to_string(total) + "\n") != std::string::npos;
+    }
+};
+
+TEST_F(MvccTest, SnapshotIgnoresUncommittedWrites) {
+    exec_sql("create table t1 (id int, num int);");
+    exec_sql("insert into t1 values (1, 1), (2, 2);");
+
+    txn_id_t writer = INVALID_TXN_ID;
+    exec_sql("begin;", &writer);
+    exec_sql("update t1 set num = 10 where id = 1;", &writer);
+    exec_sql("delete from t1 where id = 2;", &writer);
+    exec_sql("insert into t1 values (3, 3);", &writer);
+
+    // 写事务持有写锁, 快照读不被阻塞, 读到的是写事务开始前的数据
+    txn_id_t reader = INVALID_TXN_ID;
+    exec_sql("begin isolation level repeatable read;", &reader);
+    auto result = exec_sql("select * from t1;", &reader);
+    EXPECT_TRUE(has_row(result, 1, 1));
+    EXPECT_TRUE(has_row(result, 2, 2));
+    EXPECT_TRUE(has_total(result, 2));
+
+    // 写事务读到自己的修改
+    result = exec_sql("select * from t1;", &writer);
+    EXPECT_TRUE(has_row(result, 1, 10));
+    EXPECT_TRUE(has_row(result, 3, 3));
+    EXPECT_TRUE(has_total(result, 2));
+    exec_sql("commit;", &writer);
+
+    // REPEATABLE_READ在提交之后仍然读事务开始时的快照
+    result = exec_sql("select * from t1;", &reader);
+    EXPECT_TRUE(has_row(result, 1, 1));
+    EXPECT_TRUE(has_row(result, 2, 2));
+    EXPECT_TRUE(has_total(result, 2));
+    exec_sql("commit;", &reader);
+
+    // 所有快照结束后旧版本都被回收
+    EXPECT_EQ(version_store_->num_versions(), 0);
+    result = exec_sql("select * from t1;");
+    EXPECT_TRUE(has_row(result, 1, 10));
+    EXPECT_TRUE(has_row(result, 3, 3));
+    EXPECT_TRUE(has_total(result, 2));
+}
+
+TEST_F(MvccTest, ReadCommittedRefreshesSnapshot) {
+    exec_sql("create table t1 (id int, num int);");
+    exec_sql("insert into t1 values (1, 1);");
+
+    txn_id_t reader = INVALID_TXN_ID;
+    exec_sql("begin isolation level read committed;", &reader);
+    EXPECT_TRUE(has_row(exec_sql("select * from t1;", &reader), 1, 1));
+
+    txn_id_t writer = INVALID_TXN_ID;
+    exec_sql("begin;", &writer);
+    exec_sql("update t1 set num = 2 where id = 1;", &writer);
+    EXPECT_TRUE(has_row(exec_sql("select * from t1;", &reader), 1, 1));
+    exec_sql("commit;", &writer);
+
+    // 每条语句使用新的快照, 读到已经提交的修改
+    EXPECT_TRUE(has_row(exec_sql("select * from t1;", &reader), 1, 2));
+    exec_sql("commit;", &reader);
+    EXPECT_EQ(version_store_->num_versions(), 0);
+}
+
+TEST_F(MvccTest, IndexScanFindsMovedKeys) {
+    exec_sql("create table t1 (id int, num int);");
+    exec_sql("create index t1 (id);");
+    exec_sql("insert into t1 values (1, 1), (2, 2);");
+
+    txn_id_t reader = INVALID_TXN_ID;
+    exec_sql("begin isolation level repeatable read;", &reader);
+
+    // 索引中只有新的键, 快照中id = 1的记录要从版本存储中找回
+    exec_sql("update t1 set id = 5 where num = 1;");
+    auto result = exec_sql("select * from t1 where id = 1;", &reader);
+    EXPECT_TRUE(has_row(result, 1, 1));
+    EXPECT_TRUE(has_total(result, 1));
+    EXPECT_TRUE(has_total(exec_sql("select * from t1 where id = 5;", &reader), 0));
+    exec_sql("commit;", &reader);
+
+    EXPECT_TRUE(has_total(exec_sql("select * from t1 where id = 5;"), 1));
+}
+
+// 快照读的索引扫描不按快照中的键的顺序返回记录, ORDER BY索引列时仍然需要排序
+TEST_F(MvccTest, IndexScanOrderByMovedKey) {
+    exec_sql("create table t1 (id int, num int);");
+    exec_sql("create index t1 (id);");
+    exec_sql("insert into t1 values (1, 1), (2, 2), (3, 3), (4, 4);");
+
+    // 未提交的修改把id = 1移到了索引的末尾, 快照中它仍然是最小的键
+    txn_id_t writer = INVALID_TXN_ID;
+    exec_sql("begin;", &writer);
+    exec_sql("update t1 set id = 10 where num = 1;", &writer);
+
+    auto result = exec_sql("select * from t1 order by id limit 2;");
+    EXPECT_TRUE(has_row(result, 1, 1)) << result;
+    EXPECT_TRUE(has_row(result, 2, 2)) << result;
+    EXPECT_TRUE(has_total(result, 2));
+    result = exec_sql("select * from t1 order by id;");
+    size_t pos = 0;
+    for (int id = 1; id <= 4; id++) {
+        size_t next = result.find(row(id, id));
+        ASSERT_NE(next, std::string::npos) << result;
+        EXPECT_GE(next, pos) << result;
+        pos = next;
+    }
+    exec_sql("commit;", &writer);
+}
+
+TEST_F(MvccTest, FirstUpdaterWins) {
+    exec_sql("create table t1 (id int, num int);");
+    exec_sql("insert into t1 values (1, 1);");
+
+    txn_id_t txn = INVALID_TXN_ID;
+    exec_sql("begin isolation level repeatable read;", &txn);
+    exec_sql("select * from t1;", &txn);
+
+    // 快照之后其他事务修改并提交了这条记录, 再修改它会丢失那次更新, 事务被中止
+    exec_sql("update t1 set num = 2 where id = 1;");
+    try {
+        exec_sql("update t1 set num = 3 where id = 1;", &txn);
+        FAIL() << "expected a write conflict";
+    } catch (TransactionAbortException &e) {
+        EXPECT_EQ(e.GetAbortReason(), AbortReason::WRITE_CONFLICT);
+    }
+    exec_sql("abort;", &txn);
+
+    EXPECT_TRUE(has_row(exec_sql("select * from t1;"), 1, 2));
+    EXPECT_EQ(version_store_->num_versions(), 0);
+}
+
+TEST_F(MvccTest, ReadOnlyAutocommitSelect) {
+    exec_sql("create table t1 (id int, num int);");
+    exec_sql("create index t1 (id);");
+    exec_sql("insert into t1 values (1, 1);");
+
+    txn_id_t writer = INVALID_TXN_ID;
+    exec_sql("begin;", &writer);
+    exec_sql("update t1 set num = 2 where id = 1;", &writer);
+
+    // autocommit的select作为只读事务读快照, 不等待写锁, 也不加任何锁
+    txn_id_t txn_id = INVALID_TXN_ID;
+    EXPECT_TRUE(has_row(exec_sql("select * from t1 where id = 1;", &txn_id), 1, 1));
+    Transaction *txn = txn_manager_->GetTransaction(txn_id);
+    ASSERT_NE(txn, nullptr);
+    EXPECT_TRUE(txn->IsReadOnly());
+    EXPECT_EQ(txn->GetState(), TransactionState::COMMITTED);
+    EXPECT_TRUE(txn->GetLockSet()->empty());
+
+    exec_sql("commit;", &writer);
+    EXPECT_TRUE(has_row(exec_sql("select * from t1 where id = 1;", &txn_id), 1, 2));
+    EXPECT_EQ(version_store_->num_versions(), 0);
+}
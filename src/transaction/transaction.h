@@ -2,18 +2,37 @@
 
 #include <atomic>
 #include <deque>
+#include <list>
 #include <string>
 #include <thread>
-#include <unordered_set>
+#include <unordered_map>
 
 #include "txn_defs.h"
 
+class LockRequest;
+
+// 事务持有的一个锁, request指向锁表中该事务的请求; 锁释放后released为true, request不再有效
+struct HeldLock {
+    std::list<LockRequest>::iterator request;
+    bool released;
+};
+
+// 事务申请过的所有锁, 按LockDataId哈希, 查找已持有的锁和升级都不需要访问锁表
+using LockSet = std::unordered_map<LockDataId, HeldLock>;
+
+// 事务在一张表上持有的行锁个数, 用于判断是否需要锁升级
+struct TableRowLocks {
+    size_t num_locks = 0;
+    size_t num_exclusive = 0;
+    size_t escalate_at = 0;   // 行锁个数达到这个值时再尝试升级, 升级失败后推迟下一次尝试
+};
+
 class Transaction {
    public:
     explicit Transaction(txn_id_t txn_id, IsolationLevel isolation_level = IsolationLevel::SERIALIZABLE)
         : state_(TransactionState::DEFAULT), isolation_level_(isolation_level), txn_id_(txn_id) {
         write_set_ = std::make_shared<std::deque<WriteRecord *>>();
-        lock_set_ = std::make_shared<std::unordered_set<LockDataId>>();
+        lock_set_ = std::make_shared<LockSet>();
         page_set_ = std::make_shared<std::deque<Page *>>();
         deleted_page_set_ = std::make_shared<std::deque<Page *>>();
         prev_lsn_ = INVALID_LSN;
@@ -22,9 +41,31 @@ class Transaction {
 
     ~Transaction() = default;
 
+    /**
+     * @brief 把已经结束的事务对象重置为一个新事务, 各个集合清空但保留已经分配的空间
+     * @note 写集合中的WriteRecord由提交或回滚释放
+     */
+    void Reset(txn_id_t txn_id, IsolationLevel isolation_level = IsolationLevel::SERIALIZABLE) {
+        txn_id_ = txn_id;
+        state_ = TransactionState::DEFAULT;
+        isolation_level_ = isolation_level;
+        txn_mode_ = false;
+        read_only_ = false;
+        start_ts_ = INVALID_TIMESTAMP;
+        prev_lsn_ = INVALID_LSN;
+        first_lsn_ = INVALID_LSN;
+        thread_id_ = std::this_thread::get_id();
+        write_set_->clear();
+        lock_set_->clear();
+        row_locks_.clear();
+        page_set_->clear();
+        deleted_page_set_->clear();
+    }
+
     inline txn_id_t GetTransactionId() { return txn_id_; }
 
     inline std::thread::id GetThreadId() { return thread_id_; }
+    inline void SetThreadId(std::thread::id thread_id) { thread_id_ = thread_id; }
 
     inline void SetTxnMode(bool txn_mode) { txn_mode_ = txn_mode; }
     inline bool GetTxnMode() { return txn_mode_; }
@@ -33,6 +74,16 @@ class Transaction {
     inline timestamp_t GetStartTs() { return start_ts_; }
 
     inline IsolationLevel GetIsolationLevel() { return isolation_level_; }
+    inline void SetIsolationLevel(IsolationLevel isolation_level) { isolation_level_ = isolation_level; }
+
+    // 读操作是否读快照而不加读锁; REPEATABLE_READ在事务开始时取快照, READ_COMMITTED在每条语句开始时取快照
+    inline bool IsSnapshotRead() {
+        return isolation_level_ == IsolationLevel::REPEATABLE_READ || isolation_level_ == IsolationLevel::READ_COMMITTED;
+    }
+
+    // 只读事务不加行锁, 也不会修改数据, 提交时不需要提交时间戳
+    inline bool IsReadOnly() { return read_only_; }
+    inline void SetReadOnly(bool read_only) { read_only_ = read_only; }
 
     inline TransactionState GetState() { return state_; }
     inline void SetState(TransactionState state) { state_ = state; }
@@ -40,6 +91,13 @@ class Transaction {
     inline lsn_t GetPrevLsn() { return prev_lsn_; }
     inline void SetPrevLsn(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
+    /**
+     * @brief 事务的第一条日志(BEGIN)的lsn, 检查点据此保留事务回滚需要的日志
+     * @note 追加BEGIN之前先设为当时的下一个lsn, 检查点读到的值不会大于真正的lsn
+     */
+    inline lsn_t GetFirstLsn() { return first_lsn_; }
+    inline void SetFirstLsn(lsn_t first_lsn) { first_lsn_ = first_lsn; }
+
     inline std::shared_ptr<std::deque<WriteRecord *>> GetWriteSet() { return write_set_; }
 
     /**
@@ -48,7 +106,9 @@ class Transaction {
      */
     inline void AppendWriteRecord(WriteRecord *write_record) { write_set_->push_back(write_record); }
 
-    inline std::shared_ptr<std::unordered_set<LockDataId>> GetLockSet() { return lock_set_; }
+    inline std::shared_ptr<LockSet> GetLockSet() { return lock_set_; }
+
+    inline TableRowLocks &GetRowLocks(int tab_id) { return row_locks_[tab_id]; }
 
     /** @return the page set */
     inline std::shared_ptr<std::deque<Page *>> GetPageSet() {
@@ -72,16 +132,19 @@ class Transaction {
 
    private:
     bool txn_mode_;  // 用于标识当前事务是否还包含未执行的操作，用于interp函数，与lab需要完成的code无关
-    TransactionState state_;          // 事务状态
+    bool read_only_ = false;          // 是否为只读事务
+    std::atomic<TransactionState> state_;  // 事务状态
     IsolationLevel isolation_level_;  // 事务的隔离级别，默认隔离级别为可串行化
-    std::thread::id thread_id_;       // 当前事务对应的线程id
-    lsn_t prev_lsn_;                  // 当前事务执行的最后一条操作对应的lsn
+    std::thread::id thread_id_;       // 正在执行当前事务的请求的线程id
+    std::atomic<lsn_t> prev_lsn_;     // 当前事务执行的最后一条操作对应的lsn, 检查点会并发读取
+    std::atomic<lsn_t> first_lsn_{INVALID_LSN};  // 当前事务的BEGIN日志的lsn
     txn_id_t txn_id_;                 // 事务的ID，唯一标识符
     timestamp_t start_ts_;            // 事务的开始时间戳
 
     std::shared_ptr<std::deque<WriteRecord *>> write_set_;  // 事务包含的所有写操作
 
-    std::shared_ptr<std::unordered_set<LockDataId>> lock_set_;  // 事务申请的所有锁
+    std::shared_ptr<LockSet> lock_set_;  // 事务申请的所有锁
+    std::unordered_map<int, TableRowLocks> row_locks_;  // 每张表上的行锁个数, 以表的编号为key
 
     /** 用于索引lab: The pages that were latched during index operation, used for concurrent index */
     std::shared_ptr<std::deque<Page *>> page_set_;
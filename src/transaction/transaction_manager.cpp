@@ -1,8 +1,6 @@
 #include "transaction_manager.h"
 #include "record/rm_file_handle.h"
 
-std::unordered_map<txn_id_t, Transaction *> TransactionManager::txn_map = {};
-
 /**
  * 事务的开始方法
  * @param txn 事务指针
@@ -11,21 +9,84 @@ std::unordered_map<txn_id_t, Transaction *> TransactionManager::txn_map = {};
  * @tips: 事务的指针可能为空指针
  */
 Transaction * TransactionManager::Begin(Transaction *txn, LogManager *log_manager) {
+    return Begin(txn, log_manager, default_isolation_level_);
+}
+
+Transaction * TransactionManager::BeginReadOnly(LogManager *log_manager) {
+    IsolationLevel isolation_level = default_isolation_level_;
+    if (version_store_ != nullptr && isolation_level != IsolationLevel::READ_UNCOMMITTED) {
+        // 单条语句的快照是一致的, 只读语句读快照即可, 不需要加读锁
+        isolation_level = IsolationLevel::REPEATABLE_READ;
+    }
+    Transaction *txn = Begin(nullptr, log_manager, isolation_level);
+    txn->SetReadOnly(true);
+    return txn;
+}
+
+Transaction * TransactionManager::Begin(Transaction *txn, LogManager *log_manager, IsolationLevel isolation_level) {
     // Todo:
     // 1. 判断传入事务参数是否为空指针
     // 2. 如果为空指针，创建新事务
     // 3. 把开始事务加入到全局事务表中
     // 4. 返回当前事务指针
+    if (version_store_ == nullptr && isolation_level != IsolationLevel::READ_UNCOMMITTED) {
+        isolation_level = IsolationLevel::SERIALIZABLE;
+    }
     if(!txn){
-        txn=new Transaction(GetNextTxnId());
-        next_txn_id_++;
+        // 复用已经结束的事务对象
+        txn = txn_map.acquire(next_txn_id_.fetch_add(1), isolation_level);
+    } else {
+        txn->SetState(TransactionState::DEFAULT);
+        txn->SetIsolationLevel(isolation_level);
+        txn_map.insert(txn);
     }
-    txn->SetState(TransactionState::DEFAULT);
-    txn_map[txn->GetTransactionId()]=txn;
-    
+    if (txn->IsSnapshotRead()) {
+        StartSnapshot(txn);
+    }
+
     return txn;
 }
 
+void TransactionManager::RefreshSnapshot(Transaction *txn) {
+    if (!txn->IsSnapshotRead()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(snapshot_latch_);
+    active_snapshots_.erase(active_snapshots_.find(txn->GetStartTs()));
+    txn->SetStartTs(last_commit_ts_.load());
+    active_snapshots_.insert(txn->GetStartTs());
+}
+
+void TransactionManager::StartSnapshot(Transaction *txn) {
+    // 读取快照时间戳和登记快照在同一个临界区内, 避免gc回收掉这个快照还要用到的版本
+    std::lock_guard<std::mutex> lock(snapshot_latch_);
+    txn->SetStartTs(last_commit_ts_.load());
+    active_snapshots_.insert(txn->GetStartTs());
+}
+
+void TransactionManager::EndSnapshot(Transaction *txn, bool wrote) {
+    if (version_store_ == nullptr) {
+        return;
+    }
+    timestamp_t oldest;
+    bool was_oldest = false;
+    {
+        std::lock_guard<std::mutex> lock(snapshot_latch_);
+        // 已经结束的事务(例如被重复回滚)的快照已经注销过
+        bool ended = txn->GetState() == TransactionState::COMMITTED || txn->GetState() == TransactionState::ABORTED;
+        if (txn->IsSnapshotRead() && !ended) {
+            auto it = active_snapshots_.find(txn->GetStartTs());
+            was_oldest = it == active_snapshots_.begin();
+            active_snapshots_.erase(it);
+        }
+        oldest = active_snapshots_.empty() ? last_commit_ts_.load() : *active_snapshots_.begin();
+    }
+    // 没有提交新版本, 最早的快照也没有变化时, 不会有新的版本可以回收
+    if (wrote || was_oldest) {
+        version_store_->gc(oldest);
+    }
+}
+
 /**
  * 事务的提交方法
  * @param txn 事务指针
@@ -39,15 +100,30 @@ void TransactionManager::Commit(Transaction * txn, LogManager *log_manager) {
     // 3. 释放事务相关资源，eg.锁集
     // 4. 更新事务状态
     auto write_set=txn->GetWriteSet().get();
-    auto rm_manager_=sm_manager_->get_rm_manager();
-    
-    for(auto p=write_set->begin();p!=write_set->end();p++){
+    // 只读事务和没有修改过数据的事务不需要提交时间戳
+    bool wrote = !txn->IsReadOnly() && (!write_set->empty() ||
+                                        (version_store_ != nullptr && version_store_->has_writes(txn)));
+    for(auto p:*write_set){
+        delete p;
     }
     write_set->clear();
+    if (AppendTxnLog(txn, log_manager, LogRecordType::COMMIT)) {
+        // 组提交: COMMIT日志写入磁盘之后修改才对其他事务可见, 也才释放锁
+        log_manager->WaitForCommit(txn->GetPrevLsn());
+    }
+    if (wrote && version_store_ != nullptr) {
+        // 在释放写锁之前打上提交时间戳, 之后修改同一记录的事务的版本一定排在后面
+        std::lock_guard<std::mutex> lock(commit_latch_);
+        timestamp_t commit_ts = ++next_timestamp_;
+        version_store_->commit(txn, commit_ts);
+        last_commit_ts_ = commit_ts;
+    }
     auto lock_set=txn->GetLockSet().get();
-    for(auto i:*lock_set){
-        lock_manager_->Unlock(txn,i);
+    for(auto &i:*lock_set){
+        lock_manager_->Unlock(txn,i.first);
     }
+    lock_set->clear();
+    EndSnapshot(txn, wrote);
     txn->SetState(TransactionState::COMMITTED);
 }
 
@@ -64,28 +140,50 @@ void TransactionManager::Abort(Transaction * txn, LogManager *log_manager) {
     // 3. 清空事务相关资源，eg.锁集
     // 4. 更新事务状态
     auto write_set=txn->GetWriteSet().get();
-    auto  context=new Context(lock_manager_,log_manager,txn);
+    Context context(lock_manager_,log_manager,txn);
     while(!write_set->empty()){
         auto p=write_set->back();
         write_set->pop_back();
         if(p->GetWriteType()==WType::DELETE_TUPLE){
-            sm_manager_->rollback_delete(p->GetTableName(),p->GetRecord(),context);
+            sm_manager_->rollback_delete(p->GetTableName(),p->GetRecord(),&context);
         }
         else if(p->GetWriteType()==WType::INSERT_TUPLE){
-            sm_manager_->rollback_insert(p->GetTableName(),p->GetRid(),context);
+            sm_manager_->rollback_insert(p->GetTableName(),p->GetRid(),&context);
         }
         else if(p->GetWriteType()==WType::UPDATE_TUPLE){
-            sm_manager_->rollback_update(p->GetTableName(),p->GetRid(),p->GetRecord(),context);
+            sm_manager_->rollback_update(p->GetTableName(),p->GetRid(),p->GetRecord(),&context);
         }
+        delete p;
+    }
+    // 回滚产生的修改同样写了日志, 之后再写ABORT日志
+    AppendTxnLog(txn, log_manager, LogRecordType::ABORT);
+    // 回滚时context中没有版本存储, 不会产生新版本; 堆中的修改撤销后再删除事务的版本
+    if (version_store_ != nullptr) {
+        version_store_->abort(txn);
     }
     auto lock_set=txn->GetLockSet().get();
-    for(auto i:*lock_set){
-        lock_manager_->Unlock(txn,i);
+    for(auto &i:*lock_set){
+        lock_manager_->Unlock(txn,i.first);
     }
+    lock_set->clear();
+    EndSnapshot(txn, false);
     txn->SetState(TransactionState::ABORTED);
 }
 
-/** 以下函数用于日志实验中的checkpoint */
-void TransactionManager::BlockAllTransactions() {}
+/**
+ * 为写过日志的事务追加COMMIT/ABORT日志, 没有修改过数据的事务不写日志
+ * @return 是否追加了日志
+ */
+bool TransactionManager::AppendTxnLog(Transaction *txn, LogManager *log_manager, LogRecordType log_type) {
+    if (log_manager == nullptr || !log_manager->GetLogMode() || txn->GetPrevLsn() == INVALID_LSN) {
+        return false;
+    }
+    LogRecord log_record(txn->GetTransactionId(), txn->GetPrevLsn(), log_type);
+    txn->SetPrevLsn(log_manager->AppendLogRecord(&log_record));
+    return true;
+}
 
-void TransactionManager::ResumeAllTransactions() {}
\ No newline at end of file
+void TransactionManager::Release(Transaction *txn) {
+    assert(txn->GetState() == TransactionState::COMMITTED || txn->GetState() == TransactionState::ABORTED);
+    txn_map.release(txn);
+}
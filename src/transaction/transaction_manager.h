@@ -1,11 +1,14 @@
 #pragma once
 
 #include <atomic>
-#include <unordered_map>
+#include <mutex>
+#include <set>
 
 #include "transaction.h"
+#include "transaction_table.h"
 #include "recovery/log_manager.h"
 #include "concurrency/lock_manager.h"
+#include "concurrency/version_store.h"
 #include "system/sm_manager.h"
 
 enum class ConcurrencyMode { TWO_PHASE_LOCKING = 0, BASIC_TO };
@@ -13,26 +16,58 @@ enum class ConcurrencyMode { TWO_PHASE_LOCKING = 0, BASIC_TO };
 class TransactionManager{
    public:
     explicit TransactionManager(LockManager *lock_manager, SmManager *sm_manager,
-                                ConcurrencyMode concurrency_mode = ConcurrencyMode::TWO_PHASE_LOCKING) {
+                                ConcurrencyMode concurrency_mode = ConcurrencyMode::TWO_PHASE_LOCKING,
+                                VersionStore *version_store = nullptr) {
         sm_manager_ = sm_manager;
         lock_manager_ = lock_manager;
         concurrency_mode_ = concurrency_mode;
+        version_store_ = version_store;
     }
 
     ~TransactionManager() = default;
 
     Transaction * Begin(Transaction * txn, LogManager *log_manager);
 
+    /**
+     * @brief 以指定的隔离级别开始事务
+     * @details 快照读的隔离级别(REPEATABLE_READ, READ_COMMITTED)需要构造时传入版本存储, 没有版本存储时退化为SERIALIZABLE
+     */
+    Transaction * Begin(Transaction * txn, LogManager *log_manager, IsolationLevel isolation_level);
+
+    /**
+     * @brief 开始一个只读事务, 用于autocommit的select
+     * @details 有版本存储时读快照, 不加行锁; 否则由查询对每张表加一次表级读锁. 提交时不分配提交时间戳
+     */
+    Transaction * BeginReadOnly(LogManager *log_manager);
+
+    /**
+     * @brief READ_COMMITTED的事务在每条语句开始时调用, 让语句读到已经提交的最新数据
+     */
+    void RefreshSnapshot(Transaction *txn);
+
     void Commit(Transaction * txn, LogManager *log_manager);
 
     void Abort(Transaction * txn, LogManager *log_manager);
 
+    /**
+     * @brief 调用者不再使用已经结束的事务时调用, 事务从事务表中移除, 事务对象由之后的Begin复用
+     * @note 没有释放的事务对象仍由调用者管理
+     */
+    void Release(Transaction *txn);
+
     ConcurrencyMode GetConcurrencyMode() { return concurrency_mode_; }
 
     void SetConcurrencyMode(ConcurrencyMode concurrency_mode) { concurrency_mode_ = concurrency_mode; }
 
     LockManager *GetLockManager() { return lock_manager_; }
 
+    VersionStore *GetVersionStore() { return version_store_; }
+
+    // 没有指定隔离级别的事务使用的隔离级别
+    IsolationLevel GetDefaultIsolationLevel() { return default_isolation_level_; }
+
+    void SetDefaultIsolationLevel(IsolationLevel isolation_level) { default_isolation_level_ = isolation_level; }
+
     /**
      * 获取对应ID的事务指针
      * @param txn_id 事务ID
@@ -41,31 +76,38 @@ class TransactionManager{
     Transaction *GetTransaction(txn_id_t txn_id) {
         if(txn_id == INVALID_TXN_ID) return nullptr;
 
-        assert(TransactionManager::txn_map.find(txn_id) != TransactionManager::txn_map.end());
-
-        auto *res = TransactionManager::txn_map[txn_id];
-        assert(res != nullptr);
-        assert(res->GetThreadId() == std::this_thread::get_id());
-        return res;
+        // 已经释放的事务不在事务表中, 它的对象可能已经被复用.
+        // 事务属于客户端连接, 同一连接的请求依次执行, 但可能由线程池中不同的工作线程执行
+        return txn_map.find(txn_id);
     }
 
     // used for test
     inline txn_id_t GetNextTxnId() { return next_txn_id_; }
 
-    // global map of transactions which are running in the system.
-    static std::unordered_map<txn_id_t, Transaction *> txn_map;
-
-    /**
-     * @brief used for checkpoint
-     */
-    void BlockAllTransactions();
-    void ResumeAllTransactions();
+    // map of transactions which are running in the system.
+    TransactionTable txn_map;
 
    private:
+    // 登记txn的快照, 快照时间戳为最近一次提交的时间戳
+    void StartSnapshot(Transaction *txn);
+
+    // 注销txn的快照, 并回收不再被任何快照用到的版本; wrote表示txn是否提交了新版本
+    void EndSnapshot(Transaction *txn, bool wrote);
+
+    // 事务写过日志时追加一条COMMIT/ABORT日志
+    bool AppendTxnLog(Transaction *txn, LogManager *log_manager, LogRecordType log_type);
+
     ConcurrencyMode concurrency_mode_;      // 事务使用的并发控制算法，目前只需要考虑2PL
                                                   //    Transaction * current_txn_;
     std::atomic<txn_id_t> next_txn_id_{0};  // 用于分发事务ID
     std::atomic<timestamp_t> next_timestamp_{0};    // 用于分发事务时间戳
     SmManager *sm_manager_;
     LockManager *lock_manager_;
+    VersionStore *version_store_;
+    IsolationLevel default_isolation_level_ = IsolationLevel::SERIALIZABLE;
+
+    std::mutex commit_latch_;                    // 保证提交时间戳按version_store_->commit的顺序发布
+    std::atomic<timestamp_t> last_commit_ts_{0};  // 最近一次已经发布的提交时间戳
+    std::mutex snapshot_latch_;
+    std::multiset<timestamp_t> active_snapshots_;  // 活跃的快照读事务的快照时间戳
 };
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "transaction_table.h"
+
+TransactionTable::~TransactionTable() {
+    // 表中还没有释放的事务对象仍由开始事务的调用者管理
+    for (auto &partition : partitions_) {
+        for (auto txn : partition.free_txns) {
+            delete txn;
+        }
+    }
+}
+
+Transaction *TransactionTable::acquire(txn_id_t txn_id, IsolationLevel isolation_level) {
+    auto &partition = get_partition(txn_id);
+    std::lock_guard<std::mutex> lock(partition.latch);
+    Transaction *txn;
+    if (partition.free_txns.empty()) {
+        txn = new Transaction(txn_id, isolation_level);
+    } else {
+        txn = partition.free_txns.back();
+        partition.free_txns.pop_back();
+        txn->Reset(txn_id, isolation_level);
+    }
+    partition.txns[txn_id] = txn;
+    return txn;
+}
+
+void TransactionTable::insert(Transaction *txn) {
+    auto &partition = get_partition(txn->GetTransactionId());
+    std::lock_guard<std::mutex> lock(partition.latch);
+    partition.txns[txn->GetTransactionId()] = txn;
+}
+
+Transaction *TransactionTable::find(txn_id_t txn_id) {
+    auto &partition = get_partition(txn_id);
+    std::lock_guard<std::mutex> lock(partition.latch);
+    auto it = partition.txns.find(txn_id);
+    return it == partition.txns.end() ? nullptr : it->second;
+}
+
+void TransactionTable::release(Transaction *txn) {
+    auto &partition = get_partition(txn->GetTransactionId());
+    std::lock_guard<std::mutex> lock(partition.latch);
+    auto it = partition.txns.find(txn->GetTransactionId());
+    if (it == partition.txns.end() || it->second != txn) {
+        return;
+    }
+    partition.txns.erase(it);
+    if (partition.free_txns.size() < TXN_POOL_SIZE) {
+        partition.free_txns.push_back(txn);
+    } else {
+        delete txn;
+    }
+}
+
+size_t TransactionTable::size() {
+    size_t size = 0;
+    for (auto &partition : partitions_) {
+        std::lock_guard<std::mutex> lock(partition.latch);
+        size += partition.txns.size();
+    }
+    return size;
+}
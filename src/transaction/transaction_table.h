@@ -0,0 +1,62 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+#include "transaction.h"
+
+/**
+ * @brief 事务表, 按事务ID分成多个分区, 每个分区有自己的latch
+ * @details 每个分区同时缓存最多TXN_POOL_SIZE个已经释放的事务对象, 开始新事务时优先复用,
+ * autocommit的每条语句不再分配新的Transaction和它的各个集合
+ */
+class TransactionTable {
+    struct Partition {
+        std::mutex latch;
+        std::unordered_map<txn_id_t, Transaction *> txns;
+        std::vector<Transaction *> free_txns;
+    };
+
+   public:
+    explicit TransactionTable(size_t num_partitions = TXN_TABLE_PARTITIONS) : partitions_(num_partitions) {}
+
+    ~TransactionTable();
+
+    /**
+     * @brief 取得一个事务对象(优先复用已经释放的), 重置为新事务后加入事务表
+     */
+    Transaction *acquire(txn_id_t txn_id, IsolationLevel isolation_level);
+
+    // 把调用者分配的事务对象加入事务表
+    void insert(Transaction *txn);
+
+    // 事务不在表中时返回nullptr
+    Transaction *find(txn_id_t txn_id);
+
+    /**
+     * @brief 把已经结束的事务从事务表中移除, 事务对象放回缓存, 之后不能再使用txn
+     */
+    void release(Transaction *txn);
+
+    size_t size();
+
+    /**
+     * @brief 对表中的每个事务调用func, 调用时持有事务所在分区的latch, 事务对象不会被释放或者复用
+     */
+    template <typename Func>
+    void for_each(Func &&func) {
+        for (auto &partition : partitions_) {
+            std::lock_guard<std::mutex> lock(partition.latch);
+            for (auto &entry : partition.txns) {
+                func(entry.second);
+            }
+        }
+    }
+
+   private:
+    Partition &get_partition(txn_id_t txn_id) { return partitions_[static_cast<size_t>(txn_id) % partitions_.size()]; }
+
+    std::vector<Partition> partitions_;
+};
@@ -52,38 +52,38 @@ enum class LockDataType { TABLE = 0, RECORD = 1 };
 class LockDataId {
    public:
     // lock on table
-    LockDataId(int fd, LockDataType type) {
+    LockDataId(int tab_id, LockDataType type) {
         assert(type == LockDataType::TABLE);
-        fd_ = fd;
+        tab_id_ = tab_id;
         type_ = type;
         rid_.page_no = -1;
         rid_.slot_no = -1;
     }
 
-    LockDataId(int fd, const Rid &rid, LockDataType type) {
+    LockDataId(int tab_id, const Rid &rid, LockDataType type) {
         assert(type == LockDataType::RECORD);
-        fd_ = fd;
+        tab_id_ = tab_id;
         rid_ = rid;
         type_ = type;
     }
 
     inline int64_t Get() const {
         if (type_ == LockDataType::TABLE) {
-            // fd_
-            return static_cast<int64_t>(fd_);
+            // tab_id_
+            return static_cast<int64_t>(tab_id_);
         } else {
-            // fd_, rid_.page_no, rid.slot_no
-            return ((static_cast<int64_t>(type_)) << 63) | ((static_cast<int64_t>(fd_)) << 31) |
+            // tab_id_, rid_.page_no, rid.slot_no
+            return ((static_cast<int64_t>(type_)) << 63) | ((static_cast<int64_t>(tab_id_)) << 31) |
                    ((static_cast<int64_t>(rid_.page_no)) << 16) | rid_.slot_no;
         }
     }
 
     bool operator==(const LockDataId &other) const {
         if (type_ != other.type_) return false;
-        if (fd_ != other.fd_) return false;
+        if (tab_id_ != other.tab_id_) return false;
         return rid_ == other.rid_;
     }
-    int fd_;
+    int tab_id_;  // 表的编号, 和表的文件是否打开无关
     Rid rid_;
     LockDataType type_;
 };
@@ -93,7 +93,7 @@ struct std::hash<LockDataId> {
     size_t operator()(const LockDataId &obj) const { return std::hash<int64_t>()(obj.Get()); }
 };
 
-enum class AbortReason { LOCK_ON_SHIRINKING = 0, UPGRADE_CONFLICT, DEADLOCK_PREVENTION };
+enum class AbortReason { LOCK_ON_SHIRINKING = 0, UPGRADE_CONFLICT, DEADLOCK_PREVENTION, WRITE_CONFLICT, LOCK_WAIT_TIMEOUT };
 
 class TransactionAbortException : public std::exception {
     txn_id_t txn_id_;
@@ -121,6 +121,15 @@ class TransactionAbortException : public std::exception {
                 return "Transaction " + std::to_string(txn_id_) + " aborted for deadlock prevention\n";
             } break;
 
+            case AbortReason::WRITE_CONFLICT: {
+                return "Transaction " + std::to_string(txn_id_) +
+                       " aborted because the record was modified after its snapshot\n";
+            } break;
+
+            case AbortReason::LOCK_WAIT_TIMEOUT: {
+                return "Transaction " + std::to_string(txn_id_) + " aborted because it waited too long for a lock\n";
+            } break;
+
             default: {
                 return "Transaction aborted\n";
             } break;
@@ -55,14 +55,14 @@ public:
 
     // The below helper functions are useful for testing.
     void exec_sql(const std::string &sql) {
-        YY_BUFFER_STATE yy_buffer = yy_scan_string(sql.c_str());
-        assert(yyparse() == 0 && ast::parse_tree != nullptr);
-        yy_delete_buffer(yy_buffer);
+        std::shared_ptr<ast::TreeNode> parse_tree;
+        bool parsed = ast::parse(sql, &parse_tree);
+        assert(parsed && parse_tree != nullptr);
         memset(result, 0, BUFFER_LENGTH);
         offset = 0;
         Context *context = new Context(lock_manager_.get(), log_manager_.get(),
                                        nullptr, result, &offset);
-        interp_->interp_sql(ast::parse_tree, &txn_id, context);  // 主要执行逻辑
+        interp_->interp_sql(parse_tree, &txn_id, context);  // 主要执行逻辑
     };
 };
 
@@ -75,6 +75,33 @@ TEST_F(TransactionTest, BeginTest) {
     EXPECT_EQ(txn->GetState(), TransactionState::DEFAULT);
 }
 
+// test reusing released transactions
+TEST_F(TransactionTest, ReleaseTest) {
+    Transaction *txn = txn_manager_->Begin(nullptr, log_manager_.get());
+    txn_id_t txn_id = txn->GetTransactionId();
+    lock_manager_->LockISOnTable(txn, 0);
+    txn_manager_->Commit(txn, log_manager_.get());
+    EXPECT_EQ(txn_manager_->GetTransaction(txn_id), txn);
+
+    txn_manager_->Release(txn);
+    EXPECT_EQ(txn_manager_->GetTransaction(txn_id), nullptr);
+    EXPECT_EQ(txn_manager_->txn_map.size(), 0);
+
+    // 释放的事务对象被之后的事务复用, 状态和锁集合都被重置
+    std::set<Transaction *> txns = {txn};
+    for (size_t i = 0; i < 2 * TXN_TABLE_PARTITIONS; i++) {
+        Transaction *next = txn_manager_->Begin(nullptr, log_manager_.get());
+        EXPECT_EQ(next->GetState(), TransactionState::DEFAULT);
+        EXPECT_TRUE(next->GetLockSet()->empty());
+        EXPECT_EQ(txn_manager_->GetTransaction(next->GetTransactionId()), next);
+        lock_manager_->LockISOnTable(next, 0);
+        txn_manager_->Commit(next, log_manager_.get());
+        txn_manager_->Release(next);
+        txns.insert(next);
+    }
+    EXPECT_LE(txns.size(), TXN_TABLE_PARTITIONS);
+}
+
 // test commit
 TEST_F(TransactionTest, CommitTest) {
     exec_sql("create table t1 (num int);");
@@ -96,8 +123,8 @@ TEST_F(TransactionTest, CommitTest) {
     EXPECT_STREQ(result, str);
     // there should be 3 transactions
     EXPECT_EQ(txn_manager_->GetNextTxnId(), 3);
-    Transaction *txn = txn_manager_->GetTransaction(1);
-    EXPECT_EQ(txn->GetState(), TransactionState::COMMITTED);
+    // 会话开始下一个事务时, 已经结束的事务从事务表中移除, 事务对象被回收
+    EXPECT_EQ(txn_manager_->GetTransaction(1), nullptr);
 }
 
 // test abort
@@ -118,7 +145,7 @@ TEST_F(TransactionTest, AbortTest) {
         "Total record(s): 0\n";
     EXPECT_STREQ(result, str);
     EXPECT_EQ(txn_manager_->GetNextTxnId(), 3);
-    Transaction *txn = txn_manager_->GetTransaction(1);
-    EXPECT_EQ(txn->GetState(), TransactionState::ABORTED);
+    // 会话开始下一个事务时, 已经结束的事务从事务表中移除, 事务对象被回收
+    EXPECT_EQ(txn_manager_->GetTransaction(1), nullptr);
 }
 